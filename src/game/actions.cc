@@ -404,7 +404,8 @@ static int show_death(Object* obj, int anim)
     obj_bound(obj, &dirty_rect);
 
     if (obj->pid != 16777266 && obj->pid != 16777265 && obj->pid != 16777224) {
-        obj->flags |= OBJECT_NO_BLOCK;
+        obj_set_flag(obj, OBJECT_NO_BLOCK);
+
         if (obj_toggle_flat(obj, &temp_rect) == 0) {
             rect_min_bound(&dirty_rect, &temp_rect, &dirty_rect);
         }
@@ -17,6 +17,7 @@
 #include "game/item.h"
 #include "game/map.h"
 #include "game/object.h"
+#include "game/path.h"
 #include "game/perk.h"
 #include "game/protinst.h"
 #include "game/proto.h"
@@ -39,6 +40,9 @@ namespace fallout {
 #define ANIMATION_DESCRIPTION_LIST_CAPACITY 40
 #define ANIMATION_SAD_LIST_CAPACITY 16
 
+// Number of entries in path cache.
+#define PATH_CACHE_SIZE 32
+
 #define ANIMATION_SEQUENCE_FORCED 0x01
 
 typedef enum AnimationKind {
@@ -216,14 +220,20 @@ typedef struct AnimationSequence {
     AnimationDescription animations[ANIMATION_DESCRIPTION_LIST_CAPACITY];
 } AnimationSequence;
 
-typedef struct PathNode {
-    int tile;
+// Result of `make_path_func` remembered until blocking of any object on the
+// map changes.
+typedef struct PathCacheEntry {
+    Object* object;
+    PathBuilderCallback* callback;
+    unsigned int generation;
     int from;
-    // actual type is likely char
-    int rotation;
-    int field_C;
-    int field_10;
-} PathNode;
+    int to;
+    int elevation;
+    bool checkDestination;
+    bool inCombat;
+    int length;
+    unsigned char rotations[PATH_MAX_LENGTH];
+} PathCacheEntry;
 
 // TODO: I don't know what `sad` means, but it's definitely better than
 // `STRUCT_530014`. Find a better name.
@@ -268,7 +278,6 @@ static int anim_animate(Object* obj, int anim, int animationSequenceIndex, int f
 static void object_anim_compact();
 static int anim_turn_towards(Object* obj, int delta, int animationSequenceIndex);
 static int check_gravity(int tile, int elevation);
-
 // 0x4FEA98
 static int curr_sad = 0;
 
@@ -287,17 +296,17 @@ static bool anim_in_bk = false;
 // 0x540014
 static AnimationSad sad[ANIMATION_SAD_LIST_CAPACITY];
 
-// 0x5566D4
-static PathNode dad[2000];
-
 // 0x560314
 static AnimationSequence anim_set[ANIMATION_SEQUENCE_LIST_CAPACITY];
 
-// 0x56A1E4
-static unsigned char seen[5000];
+// CE: Critters re-plan the same paths over and over (combat AI probes
+// destination, then movement animation builds the same path again, mouse
+// hover rebuilds path every frame). Direct-mapped by from/to pair, entries
+// are valid as long as `obj_blocking_generation` did not change.
+static PathCacheEntry path_cache[PATH_CACHE_SIZE];
 
-// 0x54CA94
-static PathNode child[2000];
+static unsigned int path_cache_hits = 0;
+static unsigned int path_cache_misses = 0;
 
 // 0x56B56C
 static int curr_anim_counter;
@@ -334,6 +343,10 @@ void anim_exit()
 {
     // NOTE: Uninline.
     anim_stop();
+
+    path_exit();
+
+    memset(path_cache, 0, sizeof(path_cache));
 }
 
 // 0x413584
@@ -1516,7 +1529,7 @@ static int anim_set_check(int animationSequenceIndex)
                     tile_refresh_rect(&rect, animationDescription->owner->elevation);
                 }
             } else {
-                animationDescription->owner->flags |= animationDescription->objectFlag;
+                obj_set_flag(animationDescription->owner, animationDescription->objectFlag);
             }
 
             rc = anim_set_continue(animationSequenceIndex, 0);
@@ -1531,7 +1544,7 @@ static int anim_set_check(int animationSequenceIndex)
                     tile_refresh_rect(&rect, animationDescription->owner->elevation);
                 }
             } else {
-                animationDescription->owner->flags &= ~animationDescription->objectFlag;
+                obj_unset_flag(animationDescription->owner, animationDescription->objectFlag);
             }
 
             rc = anim_set_continue(animationSequenceIndex, 0);
@@ -1777,165 +1790,47 @@ int make_path_func(Object* object, int from, int to, unsigned char* rotations, i
         }
     }
 
-    bool isNotInCombat = !isInCombat();
-
-    memset(seen, 0, sizeof(seen));
-
-    seen[from / 8] |= 1 << (from & 7);
-
-    child[0].tile = from;
-    child[0].from = -1;
-    child[0].rotation = 0;
-    child[0].field_C = EST(from, to);
-    child[0].field_10 = 0;
-
-    for (int index = 1; index < 2000; index += 1) {
-        child[index].tile = -1;
-    }
-
-    int toScreenX;
-    int toScreenY;
-    tile_coord(to, &toScreenX, &toScreenY, object->elevation);
-
-    int closedPathNodeListLength = 0;
-    int openPathNodeListLength = 1;
-    PathNode temp;
-
-    while (1) {
-        int v63 = -1;
-
-        PathNode* prev = NULL;
-        int v12 = 0;
-        for (int index = 0; v12 < openPathNodeListLength; index += 1) {
-            PathNode* curr = &(child[index]);
-            if (curr->tile != -1) {
-                v12++;
-                if (v63 == -1 || (curr->field_C + curr->field_10) < (prev->field_C + prev->field_10)) {
-                    prev = curr;
-                    v63 = index;
-                }
-            }
-        }
-
-        PathNode* curr = &(child[v63]);
-
-        memcpy(&temp, curr, sizeof(temp));
-
-        openPathNodeListLength -= 1;
-
-        curr->tile = -1;
-
-        if (temp.tile == to) {
-            if (openPathNodeListLength == 0) {
-                openPathNodeListLength = 1;
-            }
-            break;
-        }
-
-        PathNode* curr1 = &(dad[closedPathNodeListLength]);
-        memcpy(curr1, &temp, sizeof(temp));
-
-        closedPathNodeListLength += 1;
-
-        if (closedPathNodeListLength == 2000) {
-            return 0;
-        }
-
-        for (int rotation = 0; rotation < ROTATION_COUNT; rotation++) {
-            int tile = tile_num_in_direction(temp.tile, rotation, 1);
-            int bit = 1 << (tile & 7);
-            if ((seen[tile / 8] & bit) != 0) {
-                continue;
-            }
-
-            if (tile != to) {
-                Object* v24 = callback(object, tile, object->elevation);
-                if (v24 != NULL) {
-                    if (!anim_can_use_door(object, v24)) {
-                        continue;
-                    }
-                }
-            }
-
-            int v25 = 0;
-            for (; v25 < 2000; v25++) {
-                if (child[v25].tile == -1) {
-                    break;
-                }
-            }
-
-            openPathNodeListLength += 1;
-
-            if (openPathNodeListLength == 2000) {
-                return 0;
-            }
-
-            seen[tile / 8] |= bit;
-
-            PathNode* v27 = &(child[v25]);
-            v27->tile = tile;
-            v27->from = temp.tile;
-            v27->rotation = rotation;
+    unsigned int generation = obj_blocking_generation();
+    bool inCombat = isInCombat();
 
-            int newX;
-            int newY;
-            tile_coord(tile, &newX, &newY, object->elevation);
+    unsigned int hash = (unsigned int)from * 0x9E3779B1 ^ (unsigned int)to;
+    PathCacheEntry* entry = &(path_cache[(hash ^ (hash >> 16)) % PATH_CACHE_SIZE]);
+    if (entry->object == object
+        && entry->generation == generation
+        && entry->from == from
+        && entry->to == to
+        && entry->elevation == object->elevation
+        && entry->callback == callback
+        && entry->checkDestination == (a5 != 0)
+        && entry->inCombat == inCombat) {
+        path_cache_hits++;
 
-            v27->field_C = idist(newX, newY, toScreenX, toScreenY);
-            v27->field_10 = temp.field_10 + 50;
-
-            if (isNotInCombat && temp.rotation != rotation) {
-                v27->field_10 += 10;
-            }
+        if (rotations != NULL) {
+            memcpy(rotations, entry->rotations, entry->length);
         }
 
-        if (openPathNodeListLength == 0) {
-            break;
-        }
+        return entry->length;
     }
 
-    if (openPathNodeListLength != 0) {
-        unsigned char* v39 = rotations;
-        int index = 0;
-        for (; index < 800; index++) {
-            if (temp.tile == from) {
-                break;
-            }
-
-            if (v39 != NULL) {
-                *v39 = temp.rotation & 0xFF;
-                v39 += 1;
-            }
-
-            int j = 0;
-            while (dad[j].tile != temp.from) {
-                j++;
-            }
+    path_cache_misses++;
 
-            PathNode* v36 = &(dad[j]);
-            memcpy(&temp, v36, sizeof(temp));
-        }
+    int length = path_find(object, from, to, entry->rotations, !inCombat, callback, anim_can_use_door);
 
-        if (rotations != NULL) {
-            // Looks like array resevering, probably because A* finishes it's path from end to start,
-            // this probably reverses it start-to-end.
-            unsigned char* beginning = rotations;
-            unsigned char* ending = rotations + index - 1;
-            int middle = index / 2;
-            for (int index = 0; index < middle; index++) {
-                unsigned char rotation = *ending;
-                *ending = *beginning;
-                *beginning = rotation;
-
-                ending -= 1;
-                beginning += 1;
-            }
-        }
+    entry->object = object;
+    entry->callback = callback;
+    entry->generation = generation;
+    entry->from = from;
+    entry->to = to;
+    entry->elevation = object->elevation;
+    entry->checkDestination = a5 != 0;
+    entry->inCombat = inCombat;
+    entry->length = length;
 
-        return index;
+    if (rotations != NULL) {
+        memcpy(rotations, entry->rotations, length);
     }
 
-    return 0;
+    return length;
 }
 
 // 0x415D9C
@@ -2169,12 +2064,12 @@ int make_straight_path_func(Object* a1, int from, int to, StraightPathNode* path
 static int anim_move_to_object(Object* from, Object* to, int a3, int anim, int animationSequenceIndex)
 {
     bool hidden = (to->flags & OBJECT_HIDDEN);
-    to->flags |= OBJECT_HIDDEN;
+    obj_set_flag(to, OBJECT_HIDDEN);
 
     int moveSadIndex = anim_move(from, to->tile, to->elevation, -1, anim, 0, animationSequenceIndex);
 
     if (!hidden) {
-        to->flags &= ~OBJECT_HIDDEN;
+        obj_unset_flag(to, OBJECT_HIDDEN);
     }
 
     if (moveSadIndex == -1) {
@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <new>
+
 #include "game/anim.h"
 #include "game/game.h"
 #include "game/gconfig.h"
@@ -23,12 +26,16 @@ typedef struct ArtListDescription {
     int fileNamesLength; // number of entries in list
 } ArtListDescription;
 
-static int art_readSubFrameData(unsigned char* data, DB_FILE* stream, int count);
-static int art_readFrameData(Art* art, DB_FILE* stream);
+static int art_read_file(DB_DATABASE* db_handle, const char* path);
+static int art_reserve_file_buffer(int size);
+static int art_parse_header(const unsigned char* src, int srcSize, Art* art);
+static int art_decode(const unsigned char* src, int srcSize, unsigned char* data, int dataSize);
 static int art_writeSubFrameData(unsigned char* data, DB_FILE* stream, int count);
 static int art_writeFrameData(Art* art, DB_FILE* stream);
 static int artGetDataSize(Art* art);
 static int paddingForSize(int size);
+static bool art_exists_key(int fid, int* keyPtr);
+static bool art_exists_lookup(int fid);
 
 // 0x4FEAB4
 static ArtListDescription art[OBJ_TYPE_COUNT] = {
@@ -67,8 +74,10 @@ int art_mapper_blank_tile = 1;
 // 0x56B700
 Cache art_cache;
 
+// CE: Thread-local because art cache procs can run on cache loader thread.
+//
 // 0x56B754
-static char art_name[COMPAT_MAX_PATH];
+static thread_local char art_name[COMPAT_MAX_PATH];
 
 // 0x56B858
 HeadDescription* head_info;
@@ -76,6 +85,41 @@ HeadDescription* head_info;
 // 0x56B85C
 static int* anon_alias;
 
+// Size of FRM header on disk.
+#define ART_FILE_HEADER_SIZE 62
+
+// Size of frame header on disk.
+#define ART_FILE_FRAME_HEADER_SIZE 12
+
+// CE: Contents of the last FRM file read on this thread. `art_data_size`
+// reads the whole file to learn its size, `art_data_load` for the same fid
+// decodes from here instead of reading it again.
+typedef struct ArtFileBuffer {
+    unsigned char* data;
+    int size;
+    int capacity;
+    int fid;
+    bool valid;
+
+    ~ArtFileBuffer()
+    {
+        free(data);
+    }
+} ArtFileBuffer;
+
+static thread_local ArtFileBuffer art_file_buffer;
+
+// CE: Keys of the existence table per list entry of critters (animation,
+// weapon code, rotation) and heads (fidget kind, fidget number).
+#define ART_EXISTS_CRITTER_KEYS (ANIM_COUNT * 16 * 8)
+#define ART_EXISTS_HEAD_KEYS (12 * 16)
+
+// CE: Lazily filled existence tables, one per object type. Every file a fid
+// can resolve to has two bits - whether it was looked up, and whether it
+// exists - so repeated `art_exists` calls are a single load instead of
+// building the path and searching the database.
+static std::atomic<unsigned int>* art_exists_table[OBJ_TYPE_COUNT];
+
 // 0x418170
 int art_init()
 {
@@ -250,6 +294,19 @@ int art_init()
 
     db_fclose(stream);
 
+    // CE: Tables are only allocated here, they're filled on demand. Failing
+    // to allocate one is not fatal, lookups for such type are not cached.
+    for (int objectType = 0; objectType < OBJ_TYPE_COUNT; objectType++) {
+        int keys = art[objectType].fileNamesLength;
+        if (objectType == OBJ_TYPE_CRITTER) {
+            keys *= ART_EXISTS_CRITTER_KEYS;
+        } else if (objectType == OBJ_TYPE_HEAD) {
+            keys *= ART_EXISTS_HEAD_KEYS;
+        }
+
+        art_exists_table[objectType] = new (std::nothrow) std::atomic<unsigned int>[(keys * 2 + 31) / 32 + 1]();
+    }
+
     return 0;
 }
 
@@ -268,6 +325,9 @@ void art_exit()
     for (int index = 0; index < OBJ_TYPE_COUNT; index++) {
         mem_free(art[index].fileNames);
         art[index].fileNames = NULL;
+
+        delete[] art_exists_table[index];
+        art_exists_table[index] = NULL;
     }
 
     mem_free(head_info);
@@ -448,6 +508,17 @@ int art_ptr_unlock(CacheEntry* handle)
     return cache_unlock(&art_cache, handle);
 }
 
+// Starts loading art into art cache in background, so that subsequent
+// `art_ptr_lock` does not block on I/O.
+int art_ptr_prefetch(int fid)
+{
+    if (!cache_prefetch(&art_cache, fid)) {
+        return -1;
+    }
+
+    return 0;
+}
+
 // 0x418A48
 int art_flush()
 {
@@ -834,29 +905,28 @@ ArtFrame* frame_ptr(Art* art, int frame, int rotation)
     return frm;
 }
 
+// CE: Safe to call from several threads, existence table is atomic and
+// database lookups are done under database lock with per-thread path buffer.
+//
 // 0x419050
 bool art_exists(int fid)
 {
-    bool result = false;
-    DB_DATABASE* oldDb = INVALID_DATABASE_HANDLE;
-
-    if (FID_TYPE(fid) == OBJ_TYPE_CRITTER) {
-        oldDb = db_current();
-        db_select(critter_db_handle);
+    int key;
+    if (!art_exists_key(fid, &key)) {
+        return art_exists_lookup(fid);
     }
 
-    char* filePath = art_get_name(fid);
-    if (filePath != NULL) {
-        dir_entry de;
-        if (db_dir_entry(filePath, &de) != -1) {
-            result = true;
-        }
-    }
+    std::atomic<unsigned int>* word = &(art_exists_table[FID_TYPE(fid)][key / 16]);
+    unsigned int shift = (key % 16) * 2;
 
-    if (oldDb != INVALID_DATABASE_HANDLE) {
-        db_select(oldDb);
+    unsigned int bits = word->load(std::memory_order_relaxed) >> shift;
+    if ((bits & 1) != 0) {
+        return (bits & 2) != 0;
     }
 
+    bool result = art_exists_lookup(fid);
+    word->fetch_or((1u | (result ? 2u : 0u)) << shift, std::memory_order_relaxed);
+
     return result;
 }
 
@@ -864,10 +934,60 @@ bool art_exists(int fid)
 //
 // 0x4190B8
 bool art_fid_valid(int fid)
+{
+    return art_exists(fid);
+}
+
+// CE: Returns index of the file `fid` resolves to in existence table of its
+// type, or `false` for fids outside of the table.
+static bool art_exists_key(int fid, int* keyPtr)
+{
+    int type = FID_TYPE(fid);
+    if (type < OBJ_TYPE_ITEM || type >= OBJ_TYPE_COUNT) {
+        return false;
+    }
+
+    if (art_exists_table[type] == NULL) {
+        return false;
+    }
+
+    int index = fid & 0xFFF;
+    if (index >= art[type].fileNamesLength) {
+        return false;
+    }
+
+    int anim = FID_ANIM_TYPE(fid);
+    int weaponAnim = (fid & 0xF000) >> 12;
+
+    switch (type) {
+    case OBJ_TYPE_CRITTER:
+        if (anim >= ANIM_COUNT) {
+            return false;
+        }
+        *keyPtr = ((index * ANIM_COUNT + anim) * 16 + weaponAnim) * 8 + ((fid & 0x70000000) >> 28);
+        return true;
+    case OBJ_TYPE_HEAD:
+        if (anim >= 12) {
+            return false;
+        }
+        *keyPtr = (index * 12 + anim) * 16 + weaponAnim;
+        return true;
+    default:
+        *keyPtr = index;
+        return true;
+    }
+}
+
+// Searches database for the file `fid` resolves to.
+static bool art_exists_lookup(int fid)
 {
     bool result = false;
     DB_DATABASE* oldDb = INVALID_DATABASE_HANDLE;
 
+    // Make temporary critter database selection atomic with respect to cache
+    // loader thread.
+    db_lock();
+
     if (FID_TYPE(fid) == OBJ_TYPE_CRITTER) {
         oldDb = db_current();
         db_select(critter_db_handle);
@@ -885,6 +1005,8 @@ bool art_fid_valid(int fid)
         db_select(oldDb);
     }
 
+    db_unlock();
+
     return result;
 }
 
@@ -921,58 +1043,53 @@ int art_alias_fid(int fid)
 // 0x4191D8
 int art_data_size(int fid, int* sizePtr)
 {
-    DB_DATABASE* oldDb = INVALID_DATABASE_HANDLE;
     int result = -1;
 
-    if (FID_TYPE(fid) == OBJ_TYPE_CRITTER) {
-        oldDb = db_current();
-        db_select(critter_db_handle);
-    }
+    art_file_buffer.valid = false;
 
     char* artFilePath = art_get_name(fid);
     if (artFilePath != NULL) {
-        DB_FILE* stream = NULL;
-
-        stream = db_fopen(artFilePath, "rb");
-        if (stream != NULL) {
+        // CE: Read the whole file once, `art_data_load` decodes it from the
+        // buffer.
+        if (art_read_file(FID_TYPE(fid) == OBJ_TYPE_CRITTER ? critter_db_handle : db_current(), artFilePath) == 0) {
             Art art;
-            if (art_readFrameData(&art, stream) == 0) {
+            if (art_parse_header(art_file_buffer.data, art_file_buffer.size, &art) == 0) {
                 *sizePtr = artGetDataSize(&art);
+                art_file_buffer.fid = fid;
+                art_file_buffer.valid = true;
                 result = 0;
             }
-            db_fclose(stream);
         }
     }
 
-    if (oldDb != INVALID_DATABASE_HANDLE) {
-        db_select(oldDb);
-    }
-
     return result;
 }
 
 // 0x41924C
 int art_data_load(int fid, int* sizePtr, unsigned char* data)
 {
-    DB_DATABASE* oldDb = INVALID_DATABASE_HANDLE;
     int result = -1;
 
-    if (FID_TYPE(fid) == OBJ_TYPE_CRITTER) {
-        oldDb = db_current();
-        db_select(critter_db_handle);
+    if (!art_file_buffer.valid || art_file_buffer.fid != fid) {
+        char* artFileName = art_get_name(fid);
+        if (artFileName != NULL && art_read_file(FID_TYPE(fid) == OBJ_TYPE_CRITTER ? critter_db_handle : db_current(), artFileName) == 0) {
+            art_file_buffer.fid = fid;
+            art_file_buffer.valid = true;
+        }
     }
 
-    char* artFileName = art_get_name(fid);
-    if (artFileName != NULL) {
-        if (load_frame_into(artFileName, data) == 0) {
-            *sizePtr = artGetDataSize((Art*)data);
-            result = 0;
+    if (art_file_buffer.valid && art_file_buffer.fid == fid) {
+        Art header;
+        if (art_parse_header(art_file_buffer.data, art_file_buffer.size, &header) == 0) {
+            int dataSize = artGetDataSize(&header);
+            if (art_decode(art_file_buffer.data, art_file_buffer.size, data, dataSize) == 0) {
+                *sizePtr = dataSize;
+                result = 0;
+            }
         }
     }
 
-    if (oldDb != INVALID_DATABASE_HANDLE) {
-        db_select(oldDb);
-    }
+    art_file_buffer.valid = false;
 
     return result;
 }
@@ -1024,42 +1141,169 @@ out:
     return ((v10 << 28) & 0x70000000) | (objectType << 24) | ((animType << 16) & 0xFF0000) | ((a3 << 12) & 0xF000) | (frmId & 0xFFF);
 }
 
-// 0x4193A0
-static int art_readSubFrameData(unsigned char* data, DB_FILE* stream, int count, int* paddingPtr)
+// CE: Reads the whole file from `db_handle` into `art_file_buffer`, its size
+// is taken from the database directory so the file is only opened and
+// unpacked once. When the datafile is mapped only the lookup takes the
+// database lock and unpacking runs outside of it, so the cache prefetch
+// thread and the main thread can decode different files at the same time.
+// Files overridden in patches directory and unmapped datafiles go through
+// `db_read_to_buf`.
+static int art_read_file(DB_DATABASE* db_handle, const char* path)
 {
-    unsigned char* ptr = data;
-    int padding = 0;
-    for (int index = 0; index < count; index++) {
-        ArtFrame* frame = (ArtFrame*)ptr;
+    dir_entry de;
+    const unsigned char* mapped;
+    DB_DATABASE* oldDb;
+    int rc = -1;
 
-        if (db_freadInt16(stream, &(frame->width)) == -1) return -1;
-        if (db_freadInt16(stream, &(frame->height)) == -1) return -1;
-        if (db_freadInt32(stream, &(frame->size)) == -1) return -1;
-        if (db_freadInt16(stream, &(frame->x)) == -1) return -1;
-        if (db_freadInt16(stream, &(frame->y)) == -1) return -1;
-        if (db_fread(ptr + sizeof(ArtFrame), frame->size, 1, stream) != 1) return -1;
+    art_file_buffer.valid = false;
 
-        ptr += sizeof(ArtFrame) + frame->size;
-        ptr += paddingForSize(frame->size);
-        padding += paddingForSize(frame->size);
+    if (db_map_entry(db_handle, path, &de, &mapped) == 0) {
+        if (art_reserve_file_buffer(de.length) == 0 && db_decode_entry(&de, mapped, art_file_buffer.data) == 0) {
+            art_file_buffer.size = de.length;
+            return 0;
+        }
+
+        return -1;
+    }
+
+    // Keep size and contents consistent with each other.
+    db_lock();
+
+    oldDb = db_current();
+    if (db_handle != oldDb) {
+        db_select(db_handle);
+    }
+
+    if (db_dir_entry(path, &de) == 0 && art_reserve_file_buffer(de.length) == 0) {
+        if (db_read_to_buf(path, art_file_buffer.data) == 0) {
+            rc = 0;
+        }
+    }
+
+    if (db_handle != oldDb) {
+        db_select(oldDb);
+    }
+
+    db_unlock();
+
+    if (rc == 0) {
+        art_file_buffer.size = de.length;
+    }
+
+    return rc;
+}
+
+// Grows `art_file_buffer` to hold at least `size` bytes.
+static int art_reserve_file_buffer(int size)
+{
+    unsigned char* data;
+
+    if (size < 0) {
+        return -1;
+    }
+
+    if (size <= art_file_buffer.capacity) {
+        return 0;
+    }
+
+    data = (unsigned char*)realloc(art_file_buffer.data, size);
+    if (data == NULL) {
+        return -1;
     }
 
-    *paddingPtr = padding;
+    art_file_buffer.data = data;
+    art_file_buffer.capacity = size;
 
     return 0;
 }
 
+static inline short art_read_int16(const unsigned char* src)
+{
+    return (short)((src[0] << 8) | src[1]);
+}
+
+static inline int art_read_int32(const unsigned char* src)
+{
+    return (int)(((unsigned int)src[0] << 24) | ((unsigned int)src[1] << 16) | ((unsigned int)src[2] << 8) | (unsigned int)src[3]);
+}
+
+// Reads big-endian FRM header. Fields which are not stored on disk are left
+// untouched.
+//
 // 0x41945C
-static int art_readFrameData(Art* art, DB_FILE* stream)
+static int art_parse_header(const unsigned char* src, int srcSize, Art* art)
+{
+    if (srcSize < ART_FILE_HEADER_SIZE) {
+        return -1;
+    }
+
+    art->field_0 = art_read_int32(src);
+    art->framesPerSecond = art_read_int16(src + 4);
+    art->actionFrame = art_read_int16(src + 6);
+    art->frameCount = art_read_int16(src + 8);
+
+    for (int index = 0; index < ROTATION_COUNT; index++) {
+        art->xOffsets[index] = art_read_int16(src + 10 + index * 2);
+        art->yOffsets[index] = art_read_int16(src + 22 + index * 2);
+        art->dataOffsets[index] = art_read_int32(src + 34 + index * 4);
+    }
+
+    art->dataSize = art_read_int32(src + 58);
+
+    return 0;
+}
+
+// Converts FRM file contents into `Art` followed by frames, each padded to
+// the size of int. `data` must be at least `dataSize` bytes.
+static int art_decode(const unsigned char* src, int srcSize, unsigned char* data, int dataSize)
 {
-    if (db_freadInt32(stream, &(art->field_0)) == -1) return -1;
-    if (db_freadInt16(stream, &(art->framesPerSecond)) == -1) return -1;
-    if (db_freadInt16(stream, &(art->actionFrame)) == -1) return -1;
-    if (db_freadInt16(stream, &(art->frameCount)) == -1) return -1;
-    if (db_freadInt16List(stream, art->xOffsets, ROTATION_COUNT) == -1) return -1;
-    if (db_freadInt16List(stream, art->yOffsets, ROTATION_COUNT) == -1) return -1;
-    if (db_freadInt32List(stream, art->dataOffsets, ROTATION_COUNT) == -1) return -1;
-    if (db_freadInt32(stream, &(art->dataSize)) == -1) return -1;
+    Art* art = (Art*)data;
+    if (art_parse_header(src, srcSize, art) != 0) {
+        return -3;
+    }
+
+    int pos = ART_FILE_HEADER_SIZE;
+    int currentPadding = paddingForSize(sizeof(Art));
+    int previousPadding = 0;
+
+    for (int index = 0; index < ROTATION_COUNT; index++) {
+        art->padding[index] = currentPadding;
+
+        if (index == 0 || art->dataOffsets[index - 1] != art->dataOffsets[index]) {
+            art->padding[index] += previousPadding;
+            currentPadding += previousPadding;
+
+            int offset = (int)sizeof(Art) + art->dataOffsets[index] + art->padding[index];
+            previousPadding = 0;
+
+            for (int frame = 0; frame < art->frameCount; frame++) {
+                if (pos > srcSize - ART_FILE_FRAME_HEADER_SIZE) {
+                    return -5;
+                }
+
+                int size = art_read_int32(src + pos + 4);
+                if (size < 0 || size > srcSize - pos - ART_FILE_FRAME_HEADER_SIZE) {
+                    return -5;
+                }
+
+                if (offset < (int)sizeof(Art) || offset > dataSize - (int)sizeof(ArtFrame) - size) {
+                    return -5;
+                }
+
+                ArtFrame* frm = (ArtFrame*)(data + offset);
+                frm->width = art_read_int16(src + pos);
+                frm->height = art_read_int16(src + pos + 2);
+                frm->size = size;
+                frm->x = art_read_int16(src + pos + 8);
+                frm->y = art_read_int16(src + pos + 10);
+                memcpy(frm + 1, src + pos + ART_FILE_FRAME_HEADER_SIZE, size);
+
+                pos += ART_FILE_FRAME_HEADER_SIZE + size;
+                offset += (int)sizeof(ArtFrame) + size + paddingForSize(size);
+                previousPadding += paddingForSize(size);
+            }
+        }
+    }
 
     return 0;
 }
@@ -1067,27 +1311,23 @@ static int art_readFrameData(Art* art, DB_FILE* stream)
 // 0x419500
 Art* load_frame(const char* path)
 {
-    DB_FILE* stream;
     Art header;
 
-    stream = db_fopen(path, "rb");
-    if (stream == NULL) {
+    if (art_read_file(db_current(), path) != 0) {
         return nullptr;
     }
 
-    if (art_readFrameData(&header, stream) != 0) {
-        db_fclose(stream);
+    if (art_parse_header(art_file_buffer.data, art_file_buffer.size, &header) != 0) {
         return nullptr;
     }
 
-    db_fclose(stream);
-
-    unsigned char* data = reinterpret_cast<unsigned char*>(mem_malloc(artGetDataSize(&header)));
+    int dataSize = artGetDataSize(&header);
+    unsigned char* data = reinterpret_cast<unsigned char*>(mem_malloc(dataSize));
     if (data == NULL) {
         return nullptr;
     }
 
-    if (load_frame_into(path, data) != 0) {
+    if (art_decode(art_file_buffer.data, art_file_buffer.size, data, dataSize) != 0) {
         mem_free(data);
         return nullptr;
     }
@@ -1095,38 +1335,23 @@ Art* load_frame(const char* path)
     return reinterpret_cast<Art*>(data);
 }
 
+// NOTE: `data` is expected to be at least as large as `artGetDataSize`
+// reports for the header of this file.
+//
 // 0x419600
 int load_frame_into(const char* path, unsigned char* data)
 {
-    DB_FILE* stream = db_fopen(path, "rb");
-    if (stream == NULL) {
+    Art header;
+
+    if (art_read_file(db_current(), path) != 0) {
         return -2;
     }
 
-    Art* art = (Art*)data;
-    if (art_readFrameData(art, stream) != 0) {
-        db_fclose(stream);
+    if (art_parse_header(art_file_buffer.data, art_file_buffer.size, &header) != 0) {
         return -3;
     }
 
-    int currentPadding = paddingForSize(sizeof(Art));
-    int previousPadding = 0;
-
-    for (int index = 0; index < ROTATION_COUNT; index++) {
-        art->padding[index] = currentPadding;
-
-        if (index == 0 || art->dataOffsets[index - 1] != art->dataOffsets[index]) {
-            art->padding[index] += previousPadding;
-            currentPadding += previousPadding;
-            if (art_readSubFrameData(data + sizeof(Art) + art->dataOffsets[index] + art->padding[index], stream, art->frameCount, &previousPadding) != 0) {
-                db_fclose(stream);
-                return -5;
-            }
-        }
-    }
-
-    db_fclose(stream);
-    return 0;
+    return art_decode(art_file_buffer.data, art_file_buffer.size, data, artGetDataSize(&header));
 }
 
 // 0x4196B0
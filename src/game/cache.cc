@@ -5,32 +5,89 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "int/sound.h"
+#include "plib/db/db.h"
 #include "plib/gnw/debug.h"
 #include "plib/gnw/memory.h"
 
 namespace fallout {
 
-static bool cache_add(Cache* cache, int key, int* indexPtr);
-static bool cache_insert(Cache* cache, CacheEntry* cacheEntry, int index);
+typedef struct CacheSync {
+    std::mutex mutex;
+
+    // Signalled when an entry leaves `CACHE_ENTRY_LOADING` state.
+    std::condition_variable loaded;
+
+    // The number of requests for this cache being served by prefetch threads.
+    // Guarded by `prefetch_mutex`.
+    int prefetching;
+} CacheSync;
+
+typedef struct CachePrefetchRequest {
+    Cache* cache;
+    int key;
+} CachePrefetchRequest;
+
+static bool cache_add(Cache* cache, int key, CacheEntry** cacheEntryPtr, std::unique_lock<std::mutex>& lock);
+static bool cache_insert(Cache* cache, CacheEntry* cacheEntry);
 static int cache_find(Cache* cache, int key, int* indexPtr);
 static int cache_create_item(CacheEntry** cacheEntryPtr);
 static bool cache_init_item(CacheEntry* cacheEntry);
 static bool cache_destroy_item(Cache* cache, CacheEntry* cacheEntry);
 static bool cache_unlock_all(Cache* cache);
-static bool cache_reset_counter(Cache* cache);
 static bool cache_make_room(Cache* cache, int size);
-static bool cache_purge(Cache* cache);
+static void cache_evict(Cache* cache, CacheEntry* cacheEntry);
+static void cache_evict_all(Cache* cache);
+static void cache_remove(Cache* cache, CacheEntry* cacheEntry);
 static bool cache_resize_array(Cache* cache, int newCapacity);
-static int cache_compare_make_room(const void* a1, const void* a2);
-static int cache_compare_reset_counter(const void* a1, const void* a2);
+static unsigned int cache_hash(int key);
+static bool cache_hash_resize(Cache* cache, int newCapacity);
+static void cache_hash_remove(Cache* cache, CacheEntry* cacheEntry);
+static void cache_lru_append(Cache* cache, CacheEntry* cacheEntry);
+static void cache_lru_remove(Cache* cache, CacheEntry* cacheEntry);
+static void cache_prefetch_start();
+static void cache_prefetch_stop();
+static void cache_prefetch_cancel(Cache* cache);
+static void cache_prefetch_run(unsigned int generation);
+static void cache_prefetch_load(Cache* cache, int key);
 
 // 0x4FEC7C
 static int lock_sound_ticker = 0;
 
+// Guards prefetch queue and threads.
+static std::mutex prefetch_mutex;
+
+// Signalled when a request is queued or threads are asked to stop.
+static std::condition_variable prefetch_cv;
+
+// Signalled when prefetch thread finishes a request.
+static std::condition_variable prefetch_done_cv;
+
+static std::deque<CachePrefetchRequest> prefetch_queue;
+
+// Threads serving `prefetch_queue`. Heap-allocated so that static destructors
+// do not terminate the process if a cache is not properly shut down.
+static std::thread* prefetch_threads[CACHE_PREFETCH_THREADS];
+
+static bool prefetch_running = false;
+
+// Incremented to ask running prefetch threads to exit.
+static unsigned int prefetch_generation = 0;
+
+// The number of initialized caches. Prefetch threads are stopped when the
+// last one is shut down.
+static int cache_count = 0;
+
 // 0x41E9C0
 bool cache_init(Cache* cache, CacheSizeProc* sizeProc, CacheReadProc* readProc, CacheFreeProc* freeProc, int maxSize)
 {
+    cache->sync = NULL;
+
     if (!heap_init(&(cache->heap), maxSize)) {
         return false;
     }
@@ -40,7 +97,13 @@ bool cache_init(Cache* cache, CacheSizeProc* sizeProc, CacheReadProc* readProc,
     cache->entriesLength = 0;
     cache->entriesCapacity = CACHE_ENTRIES_INITIAL_CAPACITY;
     cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
     cache->entries = (CacheEntry**)mem_malloc(sizeof(*cache->entries) * cache->entriesCapacity);
+    cache->hashTable = NULL;
+    cache->hashCapacity = 0;
+    cache->lruHead = NULL;
+    cache->lruTail = NULL;
     cache->sizeProc = sizeProc;
     cache->readProc = readProc;
     cache->freeProc = freeProc;
@@ -51,18 +114,51 @@ bool cache_init(Cache* cache, CacheSizeProc* sizeProc, CacheReadProc* readProc,
 
     memset(cache->entries, 0, sizeof(*cache->entries) * cache->entriesCapacity);
 
+    if (!cache_hash_resize(cache, CACHE_HASH_INITIAL_CAPACITY)) {
+        mem_free(cache->entries);
+        cache->entries = NULL;
+        return false;
+    }
+
+    cache->sync = new CacheSync();
+    cache->sync->prefetching = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        cache_count++;
+    }
+
     return true;
 }
 
 // 0x41EA50
 bool cache_exit(Cache* cache)
 {
-    if (cache == NULL) {
+    if (cache == NULL || cache->sync == NULL) {
         return false;
     }
 
-    cache_unlock_all(cache);
-    cache_flush(cache);
+    // Drop queued prefetches for this cache and wait for in-flight ones.
+    // Requests for other caches are not affected.
+    cache_prefetch_cancel(cache);
+
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        cache_count--;
+        last = cache_count == 0;
+    }
+
+    if (last) {
+        cache_prefetch_stop();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache->sync->mutex);
+        cache_unlock_all(cache);
+        cache_evict_all(cache);
+    }
+
     heap_exit(&(cache->heap));
 
     cache->size = 0;
@@ -70,12 +166,26 @@ bool cache_exit(Cache* cache)
     cache->entriesLength = 0;
     cache->entriesCapacity = 0;
     cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
 
     if (cache->entries != NULL) {
         mem_free(cache->entries);
         cache->entries = NULL;
     }
 
+    if (cache->hashTable != NULL) {
+        mem_free(cache->hashTable);
+        cache->hashTable = NULL;
+    }
+
+    cache->hashCapacity = 0;
+    cache->lruHead = NULL;
+    cache->lruTail = NULL;
+
+    delete cache->sync;
+    cache->sync = NULL;
+
     cache->sizeProc = NULL;
     cache->readProc = NULL;
     cache->freeProc = NULL;
@@ -92,10 +202,16 @@ int cache_query(Cache* cache, int key)
         return 0;
     }
 
+    std::lock_guard<std::mutex> lock(cache->sync->mutex);
+
     if (cache_find(cache, key, &index) != 2) {
         return 0;
     }
 
+    if ((cache->entries[index]->flags & CACHE_ENTRY_LOADING) != 0) {
+        return 0;
+    }
+
     return 1;
 }
 
@@ -108,11 +224,35 @@ bool cache_lock(Cache* cache, int key, void** data, CacheEntry** cacheEntryPtr)
 
     *cacheEntryPtr = NULL;
 
+    std::unique_lock<std::mutex> lock(cache->sync->mutex);
+
     int index;
-    int rc = cache_find(cache, key, &index);
+    int rc;
+    while (true) {
+        rc = cache_find(cache, key, &index);
+        if (rc != 2 || (cache->entries[index]->flags & CACHE_ENTRY_LOADING) == 0) {
+            break;
+        }
+
+        // The entry is being read by another thread. The reader needs
+        // database lock, so if this thread holds it (e.g. when called from
+        // database read callback) waiting would never end. Report failure
+        // like for unreadable entry, the caller is expected to retry on the
+        // next frame.
+        if (db_lock_held()) {
+            return false;
+        }
+
+        // Wait for the read rather than reading it again. The read can fail,
+        // so look it up again.
+        cache->sync->loaded.wait(lock);
+    }
+
+    CacheEntry* cacheEntry;
+    bool shouldUpdateSound = false;
     if (rc == 2) {
         // Use existing cache entry.
-        CacheEntry* cacheEntry = cache->entries[index];
+        cacheEntry = cache->entries[index];
         cacheEntry->hits++;
     } else if (rc == 3) {
         // New cache entry is required.
@@ -120,37 +260,44 @@ bool cache_lock(Cache* cache, int key, void** data, CacheEntry** cacheEntryPtr)
             return false;
         }
 
-        if (!cache_add(cache, key, &index)) {
+        if (!cache_add(cache, key, &cacheEntry, lock)) {
             return false;
         }
 
         lock_sound_ticker %= 4;
         if (lock_sound_ticker == 0) {
-            soundUpdate();
+            shouldUpdateSound = true;
         }
     } else {
         return false;
     }
 
-    CacheEntry* cacheEntry = cache->entries[index];
     if (cacheEntry->referenceCount == 0) {
         if (!heap_lock(&(cache->heap), cacheEntry->heapHandleIndex, &(cacheEntry->data))) {
             return false;
         }
+
+        // Referenced entries are never evicted, keep them out of the list.
+        cache_lru_remove(cache, cacheEntry);
     }
 
     cacheEntry->referenceCount++;
 
+    // CE: Eviction order is maintained by LRU list, `mru` is informational
+    // only and is allowed to wrap around.
     cache->hits++;
     cacheEntry->mru = cache->hits;
 
-    if (cache->hits == UINT_MAX) {
-        cache_reset_counter(cache);
-    }
-
     *data = cacheEntry->data;
     *cacheEntryPtr = cacheEntry;
 
+    // CE: Sound callbacks can use caches, update sound without holding the
+    // lock. The entry is referenced at this point and cannot go away.
+    if (shouldUpdateSound) {
+        lock.unlock();
+        soundUpdate();
+    }
+
     return true;
 }
 
@@ -161,6 +308,8 @@ bool cache_unlock(Cache* cache, CacheEntry* cacheEntry)
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(cache->sync->mutex);
+
     if (cacheEntry->referenceCount == 0) {
         return false;
     }
@@ -169,6 +318,7 @@ bool cache_unlock(Cache* cache, CacheEntry* cacheEntry)
 
     if (cacheEntry->referenceCount == 0) {
         heap_unlock(&(cache->heap), cacheEntry->heapHandleIndex);
+        cache_lru_append(cache, cacheEntry);
     }
 
     return true;
@@ -184,18 +334,18 @@ int cache_discard(Cache* cache, int key)
         return 0;
     }
 
+    std::lock_guard<std::mutex> lock(cache->sync->mutex);
+
     if (cache_find(cache, key, &index) != 2) {
         return 0;
     }
 
     cacheEntry = cache->entries[index];
-    if (cacheEntry->referenceCount != 0) {
+    if (cacheEntry->referenceCount != 0 || (cacheEntry->flags & CACHE_ENTRY_LOADING) != 0) {
         return 0;
     }
 
-    cacheEntry->flags |= CACHE_ENTRY_MARKED_FOR_EVICTION;
-
-    cache_purge(cache);
+    cache_evict(cache, cacheEntry);
 
     return 1;
 }
@@ -207,16 +357,9 @@ bool cache_flush(Cache* cache)
         return false;
     }
 
-    // Loop thru cache entries and mark those with no references for eviction.
-    for (int index = 0; index < cache->entriesLength; index++) {
-        CacheEntry* cacheEntry = cache->entries[index];
-        if (cacheEntry->referenceCount == 0) {
-            cacheEntry->flags |= CACHE_ENTRY_MARKED_FOR_EVICTION;
-        }
-    }
+    std::lock_guard<std::mutex> lock(cache->sync->mutex);
 
-    // Sweep cache entries marked earlier.
-    cache_purge(cache);
+    cache_evict_all(cache);
 
     // Shrink cache entries array if it's too big.
     int optimalCapacity = cache->entriesLength + CACHE_ENTRIES_GROW_CAPACITY;
@@ -238,6 +381,8 @@ int cache_size(Cache* cache, int* sizePtr)
         return 0;
     }
 
+    std::lock_guard<std::mutex> lock(cache->sync->mutex);
+
     *sizePtr = cache->size;
 
     return 1;
@@ -250,7 +395,18 @@ bool cache_stats(Cache* cache, char* dest, size_t size)
         return false;
     }
 
-    snprintf(dest, size, "Cache stats are disabled.%s", "\n");
+    std::lock_guard<std::mutex> lock(cache->sync->mutex);
+
+    snprintf(dest,
+        size,
+        "Cache stats: %d entries, %d/%d bytes, %u hits, %u misses, %u evictions, %d hash slots\n",
+        cache->entriesLength,
+        cache->size,
+        cache->maxSize,
+        cache->hits,
+        cache->misses,
+        cache->evictions,
+        cache->hashCapacity);
 
     return true;
 }
@@ -273,6 +429,8 @@ int cache_create_list(Cache* cache, unsigned int a2, int** tagsPtr, int* tagsLen
         return 0;
     }
 
+    std::lock_guard<std::mutex> lock(cache->sync->mutex);
+
     *tagsLengthPtr = 0;
 
     switch (a2) {
@@ -355,10 +513,48 @@ int cache_destroy_list(int** tagsPtr)
     return 1;
 }
 
+// Schedules entry for the specified key to be read into the cache on a
+// background thread, so that subsequent `cache_lock` does not block on I/O.
+//
+// `sizeProc` and `readProc` of the cache must be safe to call from another
+// thread. Prefetched entries are unreferenced and subject to regular eviction.
+// Requests are hints, they are dropped when the cache is shut down.
+bool cache_prefetch(Cache* cache, int key)
+{
+    if (cache == NULL) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache->sync->mutex);
+
+        int index;
+        if (cache_find(cache, key, &index) == 2) {
+            // Already cached or being read.
+            return true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+
+    if (!prefetch_running) {
+        cache_prefetch_start();
+    }
+
+    prefetch_queue.push_back({ cache, key });
+    prefetch_cv.notify_one();
+
+    return true;
+}
+
 // Fetches entry for the specified key into the cache.
 //
+// Must be called with `lock` held. The lock is released while `sizeProc` and
+// `readProc` run, so other threads can use the cache in the meantime. On
+// success the new entry is unreferenced and most recently used.
+//
 // 0x41F0AC
-static bool cache_add(Cache* cache, int key, int* indexPtr)
+static bool cache_add(Cache* cache, int key, CacheEntry** cacheEntryPtr, std::unique_lock<std::mutex>& lock)
 {
     CacheEntry* cacheEntry;
 
@@ -367,9 +563,26 @@ static bool cache_add(Cache* cache, int key, int* indexPtr)
         return 0;
     }
 
+    // CE: Index the entry before reading it, so that concurrent requests for
+    // the same key wait for this read instead of starting another one.
+    cacheEntry->key = key;
+    cacheEntry->flags |= CACHE_ENTRY_LOADING;
+
+    if (!cache_insert(cache, cacheEntry)) {
+        // NOTE: Uninline.
+        cache_destroy_item(cache, cacheEntry);
+        return false;
+    }
+
+    bool loaded = false;
     do {
         int size;
-        if (cache->sizeProc(key, &size) != 0) {
+
+        lock.unlock();
+        int rc = cache->sizeProc(key, &size);
+        lock.lock();
+
+        if (rc != 0) {
             break;
         }
 
@@ -396,7 +609,7 @@ static bool cache_add(Cache* cache, int key, int* indexPtr)
         }
 
         if (!allocated) {
-            cache_flush(cache);
+            cache_evict_all(cache);
 
             allocated = true;
             if (!heap_allocate(&(cache->heap), &(cacheEntry->heapHandleIndex), size, 1)) {
@@ -410,53 +623,51 @@ static bool cache_add(Cache* cache, int key, int* indexPtr)
             break;
         }
 
-        do {
-            if (!heap_lock(&(cache->heap), cacheEntry->heapHandleIndex, &(cacheEntry->data))) {
-                break;
-            }
+        // The block stays locked while it's being read, so that allocations
+        // made by other threads in the meantime do not move it.
+        if (!heap_lock(&(cache->heap), cacheEntry->heapHandleIndex, &(cacheEntry->data))) {
+            break;
+        }
 
-            if (cache->readProc(key, &size, cacheEntry->data) != 0) {
-                break;
-            }
+        // Account the block right away so that concurrent loads do not
+        // overcommit the cache.
+        cacheEntry->size = size;
+        cache->size += size;
 
-            heap_unlock(&(cache->heap), cacheEntry->heapHandleIndex);
+        lock.unlock();
+        rc = cache->readProc(key, &size, cacheEntry->data);
+        lock.lock();
 
-            cacheEntry->size = size;
-            cacheEntry->key = key;
+        heap_unlock(&(cache->heap), cacheEntry->heapHandleIndex);
 
-            bool isNewKey = true;
-            if (*indexPtr < cache->entriesLength) {
-                if (key < cache->entries[*indexPtr]->key) {
-                    if (*indexPtr == 0 || key > cache->entries[*indexPtr - 1]->key) {
-                        isNewKey = false;
-                    }
-                }
-            }
+        if (rc != 0) {
+            break;
+        }
 
-            if (isNewKey) {
-                if (cache_find(cache, key, indexPtr) != 3) {
-                    break;
-                }
-            }
+        cache->size += size - cacheEntry->size;
+        cacheEntry->size = size;
 
-            if (!cache_insert(cache, cacheEntry, *indexPtr)) {
-                break;
-            }
+        loaded = true;
+    } while (0);
 
-            return true;
-        } while (0);
+    cacheEntry->flags &= ~CACHE_ENTRY_LOADING;
+    cache->sync->loaded.notify_all();
 
-        heap_unlock(&(cache->heap), cacheEntry->heapHandleIndex);
-    } while (0);
+    if (!loaded) {
+        cache_remove(cache, cacheEntry);
+        return false;
+    }
 
-    // NOTE: Uninline.
-    cache_destroy_item(cache, cacheEntry);
+    cache->misses++;
+    cache_lru_append(cache, cacheEntry);
 
-    return false;
+    *cacheEntryPtr = cacheEntry;
+
+    return true;
 }
 
 // 0x41F2E8
-static bool cache_insert(Cache* cache, CacheEntry* cacheEntry, int index)
+static bool cache_insert(Cache* cache, CacheEntry* cacheEntry)
 {
     // Ensure cache have enough space for new entry.
     if (cache->entriesLength == cache->entriesCapacity - 1) {
@@ -465,10 +676,23 @@ static bool cache_insert(Cache* cache, CacheEntry* cacheEntry, int index)
         }
     }
 
-    // Move entries below insertion point.
-    memmove(&(cache->entries[index + 1]), &(cache->entries[index]), sizeof(*cache->entries) * (cache->entriesLength - index));
+    // Keep hash index at most half full.
+    if ((cache->entriesLength + 1) * 2 > cache->hashCapacity) {
+        if (!cache_hash_resize(cache, cache->hashCapacity * 2)) {
+            return false;
+        }
+    }
+
+    unsigned int mask = cache->hashCapacity - 1;
+    unsigned int slot = cache_hash(cacheEntry->key) & mask;
+    while (cache->hashTable[slot] != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    cache->hashTable[slot] = cacheEntry;
 
-    cache->entries[index] = cacheEntry;
+    // CE: Entries are unordered, new entry is always appended.
+    cacheEntry->index = cache->entriesLength;
+    cache->entries[cache->entriesLength] = cacheEntry;
     cache->entriesLength++;
     cache->size += cacheEntry->size;
 
@@ -480,42 +704,24 @@ static bool cache_insert(Cache* cache, CacheEntry* cacheEntry, int index)
 // Returns 2 if entry already exists in cache, or 3 if entry does not exist. In
 // this case indexPtr represents insertion point.
 //
+// CE: Original code used binary search over `entries` sorted by key. Entries
+// are now located via hash index and new entries are appended.
+//
 // 0x41F354
 static int cache_find(Cache* cache, int key, int* indexPtr)
 {
-    int length = cache->entriesLength;
-    if (length == 0) {
-        *indexPtr = 0;
-        return 3;
-    }
-
-    int r = length - 1;
-    int l = 0;
-    int mid;
-    int cmp;
-
-    do {
-        mid = (l + r) / 2;
-
-        cmp = key - cache->entries[mid]->key;
-        if (cmp == 0) {
-            *indexPtr = mid;
+    unsigned int mask = cache->hashCapacity - 1;
+    unsigned int slot = cache_hash(key) & mask;
+    while (cache->hashTable[slot] != NULL) {
+        CacheEntry* cacheEntry = cache->hashTable[slot];
+        if (cacheEntry->key == key) {
+            *indexPtr = cacheEntry->index;
             return 2;
         }
-
-        if (cmp > 0) {
-            l = l + 1;
-        } else {
-            r = r - 1;
-        }
-    } while (r >= l);
-
-    if (cmp < 0) {
-        *indexPtr = mid;
-    } else {
-        *indexPtr = mid + 1;
+        slot = (slot + 1) & mask;
     }
 
+    *indexPtr = cache->entriesLength;
     return 3;
 }
 
@@ -543,6 +749,9 @@ static bool cache_init_item(CacheEntry* cacheEntry)
     cacheEntry->hits = 0;
     cacheEntry->flags = 0;
     cacheEntry->mru = 0;
+    cacheEntry->index = -1;
+    cacheEntry->prev = NULL;
+    cacheEntry->next = NULL;
     return true;
 }
 
@@ -571,42 +780,19 @@ static bool cache_unlock_all(Cache* cache)
         if (cacheEntry->referenceCount != 0) {
             heap_unlock(heap, cacheEntry->heapHandleIndex);
             cacheEntry->referenceCount = 0;
+            cache_lru_append(cache, cacheEntry);
         }
     }
 
     return true;
 }
 
-// 0x41F4D4
-static bool cache_reset_counter(Cache* cache)
-{
-    if (cache == NULL) {
-        return false;
-    }
-
-    CacheEntry** entries = (CacheEntry**)mem_malloc(sizeof(*entries) * cache->entriesLength);
-    if (entries == NULL) {
-        return false;
-    }
-
-    memcpy(entries, cache->entries, sizeof(*entries) * cache->entriesLength);
-
-    qsort(entries, cache->entriesLength, sizeof(*entries), cache_compare_reset_counter);
-
-    for (int index = 0; index < cache->entriesLength; index++) {
-        CacheEntry* cacheEntry = entries[index];
-        cacheEntry->mru = index;
-    }
-
-    cache->hits = cache->entriesLength;
-
-    // FIXME: Obviously leak `entries`.
-
-    return true;
-}
-
 // Prepare cache for storing new entry with the specified size.
 //
+// CE: Original code sorted a copy of `entries` by hits and recency on every
+// call and then swept marked entries in a separate pass. Unreferenced entries
+// are now kept in LRU list, so eviction simply walks it from the head.
+//
 // 0x41F54C
 static bool cache_make_room(Cache* cache, int size)
 {
@@ -621,61 +807,18 @@ static bool cache_make_room(Cache* cache, int size)
         return true;
     }
 
-    CacheEntry** entries = (CacheEntry**)mem_malloc(sizeof(*entries) * cache->entriesLength);
-    if (entries != NULL) {
-        memcpy(entries, cache->entries, sizeof(*entries) * cache->entriesLength);
-        qsort(entries, cache->entriesLength, sizeof(*entries), cache_compare_make_room);
-
-        // The sweeping threshold is 20% of cache size plus size for the new
-        // entry. Once the threshold is reached the marking process stops.
-        int threshold = size + (int)((double)cache->size * 0.2);
-
-        int accum = 0;
-        int index;
-        for (index = 0; index < cache->entriesLength; index++) {
-            CacheEntry* entry = entries[index];
-            if (entry->referenceCount == 0) {
-                if (entry->size >= threshold) {
-                    entry->flags |= CACHE_ENTRY_MARKED_FOR_EVICTION;
-
-                    // We've just found one huge entry, there is no point to
-                    // mark individual smaller entries in the code path below,
-                    // reset the accumulator to skip it entirely.
-                    accum = 0;
-                    break;
-                } else {
-                    accum += entry->size;
-
-                    if (accum >= threshold) {
-                        break;
-                    }
-                }
-            }
-        }
-
-        if (accum != 0) {
-            // The loop below assumes index to be positioned on the entry, where
-            // accumulator stopped. If we've reached the end, reposition
-            // it to the last entry.
-            if (index == cache->entriesLength) {
-                index -= 1;
-            }
+    // The eviction threshold is 20% of cache size plus size for the new
+    // entry, so that next few insertions do not need to evict again.
+    int threshold = size + (int)((double)cache->size * 0.2);
 
-            // Loop backwards from the point we've stopped and mark all
-            // unreferenced entries for sweeping.
-            for (; index >= 0; index--) {
-                CacheEntry* entry = entries[index];
-                if (entry->referenceCount == 0) {
-                    entry->flags |= CACHE_ENTRY_MARKED_FOR_EVICTION;
-                }
-            }
-        }
-
-        mem_free(entries);
+    int accum = 0;
+    while (cache->lruHead != NULL && accum < threshold) {
+        CacheEntry* cacheEntry = cache->lruHead;
+        accum += cacheEntry->size;
+        cache_evict(cache, cacheEntry);
+        cache->evictions++;
     }
 
-    cache_purge(cache);
-
     if (cache->maxSize - cache->size >= size) {
         return true;
     }
@@ -683,35 +826,44 @@ static bool cache_make_room(Cache* cache, int size)
     return false;
 }
 
-// 0x41F69C
-static bool cache_purge(Cache* cache)
+// Removes unreferenced entry from cache and destroys it.
+static void cache_evict(Cache* cache, CacheEntry* cacheEntry)
 {
-    for (int index = 0; index < cache->entriesLength; index++) {
-        CacheEntry* cacheEntry = cache->entries[index];
-        if ((cacheEntry->flags & CACHE_ENTRY_MARKED_FOR_EVICTION) != 0) {
-            if (cacheEntry->referenceCount != 0) {
-                // Entry was marked for eviction but still has references,
-                // unmark it.
-                cacheEntry->flags &= ~CACHE_ENTRY_MARKED_FOR_EVICTION;
-            } else {
-                int cacheEntrySize = cacheEntry->size;
-
-                // NOTE: Uninline.
-                cache_destroy_item(cache, cacheEntry);
-
-                // Move entries up.
-                memmove(&(cache->entries[index]), &(cache->entries[index + 1]), sizeof(*cache->entries) * ((cache->entriesLength - index) - 1));
-
-                cache->entriesLength--;
-                cache->size -= cacheEntrySize;
+    cache_lru_remove(cache, cacheEntry);
+    cache_remove(cache, cacheEntry);
+}
 
-                // The entry was removed, compensate index.
-                index--;
-            }
+// Evicts every entry with no references.
+static void cache_evict_all(Cache* cache)
+{
+    // Iterate backwards so that entries moved into the vacated slots are
+    // already visited.
+    for (int index = cache->entriesLength - 1; index >= 0; index--) {
+        CacheEntry* cacheEntry = cache->entries[index];
+        if (cacheEntry->referenceCount == 0 && (cacheEntry->flags & CACHE_ENTRY_LOADING) == 0) {
+            cache_evict(cache, cacheEntry);
         }
     }
+}
 
-    return true;
+// Removes entry from cache index (but not from LRU list) and destroys it.
+static void cache_remove(Cache* cache, CacheEntry* cacheEntry)
+{
+    cache_hash_remove(cache, cacheEntry);
+
+    // Move last entry into the vacated slot.
+    int index = cacheEntry->index;
+    cache->entriesLength--;
+    if (index != cache->entriesLength) {
+        cache->entries[index] = cache->entries[cache->entriesLength];
+        cache->entries[index]->index = index;
+    }
+    cache->entries[cache->entriesLength] = NULL;
+
+    cache->size -= cacheEntry->size;
+
+    // NOTE: Uninline.
+    cache_destroy_item(cache, cacheEntry);
 }
 
 // 0x41F740
@@ -732,48 +884,205 @@ static bool cache_resize_array(Cache* cache, int newCapacity)
     return true;
 }
 
-// 0x41F774
-static int cache_compare_make_room(const void* a1, const void* a2)
+static unsigned int cache_hash(int key)
+{
+    // Keys are FIDs and sound ids, which differ mostly in high bits, mix them
+    // down before masking.
+    unsigned int hash = (unsigned int)key * 0x9E3779B1;
+    return hash ^ (hash >> 16);
+}
+
+// Rebuilds hash index with the specified number of slots.
+static bool cache_hash_resize(Cache* cache, int newCapacity)
 {
-    CacheEntry* v1 = *(CacheEntry**)a1;
-    CacheEntry* v2 = *(CacheEntry**)a2;
+    CacheEntry** hashTable = (CacheEntry**)mem_malloc(sizeof(*hashTable) * newCapacity);
+    if (hashTable == NULL) {
+        return false;
+    }
+
+    memset(hashTable, 0, sizeof(*hashTable) * newCapacity);
+
+    unsigned int mask = newCapacity - 1;
+    for (int index = 0; index < cache->entriesLength; index++) {
+        CacheEntry* cacheEntry = cache->entries[index];
+        unsigned int slot = cache_hash(cacheEntry->key) & mask;
+        while (hashTable[slot] != NULL) {
+            slot = (slot + 1) & mask;
+        }
+        hashTable[slot] = cacheEntry;
+    }
 
-    if (v1->referenceCount != 0 && v2->referenceCount == 0) {
-        return 1;
+    if (cache->hashTable != NULL) {
+        mem_free(cache->hashTable);
     }
 
-    if (v2->referenceCount != 0 && v1->referenceCount == 0) {
-        return -1;
+    cache->hashTable = hashTable;
+    cache->hashCapacity = newCapacity;
+
+    return true;
+}
+
+static void cache_hash_remove(Cache* cache, CacheEntry* cacheEntry)
+{
+    unsigned int mask = cache->hashCapacity - 1;
+    unsigned int slot = cache_hash(cacheEntry->key) & mask;
+    while (cache->hashTable[slot] != cacheEntry) {
+        if (cache->hashTable[slot] == NULL) {
+            return;
+        }
+        slot = (slot + 1) & mask;
     }
 
-    if (v1->hits < v2->hits) {
-        return -1;
-    } else if (v1->hits > v2->hits) {
-        return 1;
+    // Shift following entries of the probe chain back into the hole so that
+    // lookups never stop early.
+    unsigned int hole = slot;
+    unsigned int next = slot;
+    while (true) {
+        next = (next + 1) & mask;
+        if (cache->hashTable[next] == NULL) {
+            break;
+        }
+
+        unsigned int home = cache_hash(cache->hashTable[next]->key) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            cache->hashTable[hole] = cache->hashTable[next];
+            hole = next;
+        }
     }
 
-    if (v1->mru < v2->mru) {
-        return -1;
-    } else if (v1->mru > v2->mru) {
-        return 1;
+    cache->hashTable[hole] = NULL;
+}
+
+static void cache_lru_append(Cache* cache, CacheEntry* cacheEntry)
+{
+    cacheEntry->prev = cache->lruTail;
+    cacheEntry->next = NULL;
+
+    if (cache->lruTail != NULL) {
+        cache->lruTail->next = cacheEntry;
+    } else {
+        cache->lruHead = cacheEntry;
     }
 
-    return 0;
+    cache->lruTail = cacheEntry;
 }
 
-// 0x41F7E8
-static int cache_compare_reset_counter(const void* a1, const void* a2)
+static void cache_lru_remove(Cache* cache, CacheEntry* cacheEntry)
 {
-    CacheEntry* v1 = *(CacheEntry**)a1;
-    CacheEntry* v2 = *(CacheEntry**)a2;
+    if (cacheEntry->prev != NULL) {
+        cacheEntry->prev->next = cacheEntry->next;
+    } else {
+        cache->lruHead = cacheEntry->next;
+    }
 
-    if (v1->mru < v2->mru) {
-        return 1;
-    } else if (v1->mru > v2->mru) {
-        return -1;
+    if (cacheEntry->next != NULL) {
+        cacheEntry->next->prev = cacheEntry->prev;
     } else {
-        return 0;
+        cache->lruTail = cacheEntry->prev;
+    }
+
+    cacheEntry->prev = NULL;
+    cacheEntry->next = NULL;
+}
+
+// Starts prefetch threads, must be called with `prefetch_mutex` held.
+static void cache_prefetch_start()
+{
+    for (int index = 0; index < CACHE_PREFETCH_THREADS; index++) {
+        prefetch_threads[index] = new std::thread(cache_prefetch_run, prefetch_generation);
     }
+
+    prefetch_running = true;
+}
+
+// Drops queued prefetch requests and waits for prefetch threads to finish
+// requests in progress.
+static void cache_prefetch_stop()
+{
+    std::thread* threads[CACHE_PREFETCH_THREADS];
+
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        if (!prefetch_running) {
+            return;
+        }
+
+        for (int index = 0; index < CACHE_PREFETCH_THREADS; index++) {
+            threads[index] = prefetch_threads[index];
+            prefetch_threads[index] = NULL;
+        }
+
+        prefetch_queue.clear();
+        prefetch_generation++;
+        prefetch_running = false;
+    }
+
+    prefetch_cv.notify_all();
+
+    for (int index = 0; index < CACHE_PREFETCH_THREADS; index++) {
+        threads[index]->join();
+        delete threads[index];
+    }
+}
+
+// Drops queued prefetch requests for the specified cache and waits for
+// prefetch threads to finish requests for it in progress.
+static void cache_prefetch_cancel(Cache* cache)
+{
+    std::unique_lock<std::mutex> lock(prefetch_mutex);
+
+    for (auto it = prefetch_queue.begin(); it != prefetch_queue.end();) {
+        if (it->cache == cache) {
+            it = prefetch_queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    prefetch_done_cv.wait(lock, [cache]() {
+        return cache->sync->prefetching == 0;
+    });
+}
+
+static void cache_prefetch_run(unsigned int generation)
+{
+    std::unique_lock<std::mutex> lock(prefetch_mutex);
+    while (true) {
+        prefetch_cv.wait(lock, [generation]() {
+            return prefetch_generation != generation || !prefetch_queue.empty();
+        });
+
+        if (prefetch_generation != generation) {
+            break;
+        }
+
+        CachePrefetchRequest request = prefetch_queue.front();
+        prefetch_queue.pop_front();
+
+        // Keep the cache alive until the request is served, see
+        // `cache_prefetch_cancel`.
+        request.cache->sync->prefetching++;
+
+        lock.unlock();
+        cache_prefetch_load(request.cache, request.key);
+        lock.lock();
+
+        request.cache->sync->prefetching--;
+        prefetch_done_cv.notify_all();
+    }
+}
+
+static void cache_prefetch_load(Cache* cache, int key)
+{
+    std::unique_lock<std::mutex> lock(cache->sync->mutex);
+
+    int index;
+    if (cache_find(cache, key, &index) != 3) {
+        return;
+    }
+
+    CacheEntry* cacheEntry;
+    cache_add(cache, key, &cacheEntry, lock);
 }
 
 } // namespace fallout
@@ -15,10 +15,17 @@ namespace fallout {
 // The number of cache entries added when cache capacity is reached.
 #define CACHE_ENTRIES_GROW_CAPACITY 50
 
+// The initial number of slots in cache hash index, must be a power of 2.
+#define CACHE_HASH_INITIAL_CAPACITY 256
+
+// The number of threads serving `cache_prefetch` requests.
+#define CACHE_PREFETCH_THREADS 1
+
 typedef enum CacheEntryFlags {
-    // Specifies that cache entry has no references as should be evicted during
-    // the next sweep operation.
-    CACHE_ENTRY_MARKED_FOR_EVICTION = 0x01,
+    // Specifies that entry data is being read (possibly by another thread).
+    // Such entry is already indexed to prevent duplicate reads, but it's not
+    // in LRU list and cannot be locked until loading completes.
+    CACHE_ENTRY_LOADING = 0x01,
 } CacheEntryFlags;
 
 typedef enum CacheListRequestType {
@@ -31,6 +38,9 @@ typedef int CacheSizeProc(int key, int* sizePtr);
 typedef int CacheReadProc(int key, int* sizePtr, unsigned char* buffer);
 typedef void CacheFreeProc(void* ptr);
 
+// Synchronization state of a cache, defined in cache.cc.
+struct CacheSync;
+
 typedef struct CacheEntry {
     int key;
     int size;
@@ -48,6 +58,13 @@ typedef struct CacheEntry {
     unsigned int mru;
 
     int heapHandleIndex;
+
+    // Position of this entry in `entries` array of the owning cache.
+    int index;
+
+    // Links in the list of unreferenced entries (see `Cache::lruHead`).
+    struct CacheEntry* prev;
+    struct CacheEntry* next;
 } CacheEntry;
 
 typedef struct Cache {
@@ -66,13 +83,36 @@ typedef struct Cache {
     // Total number of hits during cache lifetime.
     unsigned int hits;
 
-    // List of cache entries.
+    // Total number of misses (entries read with `readProc`) during cache
+    // lifetime.
+    unsigned int misses;
+
+    // Total number of entries evicted to make room for new ones.
+    unsigned int evictions;
+
+    // List of cache entries (unordered).
     CacheEntry** entries;
 
+    // Open-addressing (linear probing) index of `entries` by key.
+    CacheEntry** hashTable;
+
+    // The number of slots in `hashTable`, always a power of 2.
+    int hashCapacity;
+
+    // Unreferenced entries ordered from least to most recently used. Eviction
+    // starts from the head.
+    CacheEntry* lruHead;
+    CacheEntry* lruTail;
+
     CacheSizeProc* sizeProc;
     CacheReadProc* readProc;
     CacheFreeProc* freeProc;
     Heap heap;
+
+    // Guards everything above. All public functions are safe to call from
+    // several threads, `sizeProc` and `readProc` are called without holding
+    // it.
+    struct CacheSync* sync;
 } Cache;
 
 bool cache_init(Cache* cache, CacheSizeProc* sizeProc, CacheReadProc* readProc, CacheFreeProc* freeProc, int maxSize);
@@ -86,6 +126,7 @@ int cache_size(Cache* cache, int* sizePtr);
 bool cache_stats(Cache* cache, char* dest, size_t size);
 int cache_create_list(Cache* cache, unsigned int a2, int** tagsPtr, int* tagsLengthPtr);
 int cache_destroy_list(int** tagsPtr);
+bool cache_prefetch(Cache* cache, int key);
 
 } // namespace fallout
 
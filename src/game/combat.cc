@@ -1891,11 +1891,11 @@ void combat_give_exps(int exp_points)
         return;
     }
 
-    prefix.num = roll_random(0, 3) + 622; // generate prefix for message
+    prefix.num = roll_random_stream(ROLL_STREAM_COMBAT, 0, 3) + 622; // generate prefix for message
 
     current_hp = stat_level(obj_dude, STAT_CURRENT_HIT_POINTS);
     max_hp = stat_level(obj_dude, STAT_MAXIMUM_HIT_POINTS);
-    if (current_hp == max_hp && roll_random(0, 100) > 65) {
+    if (current_hp == max_hp && roll_random_stream(ROLL_STREAM_COMBAT, 0, 100) > 65) {
         prefix.num = 626; // Best possible prefix: For destroying your enemies without taking a scratch,
     }
 
@@ -2480,7 +2480,7 @@ int combat_attack(Object* attacker, Object* defender, int hitMode, int hitLocati
     bool aiming;
     int actionPoints;
 
-    if (hitMode == HIT_MODE_PUNCH && roll_random(1, 4) == 1) {
+    if (hitMode == HIT_MODE_PUNCH && roll_random_stream(ROLL_STREAM_COMBAT, 1, 4) == 1) {
         int fid = art_id(OBJ_TYPE_CRITTER, attacker->fid & 0xFFF, ANIM_KICK_LEG, (attacker->fid & 0xF000) >> 12, (attacker->fid & 0x70000000) >> 28);
         if (art_exists(fid)) {
             hitMode = HIT_MODE_KICK;
@@ -2580,7 +2580,7 @@ static bool check_ranged_miss(Attack* attack)
                             v6 = 5;
                         }
 
-                        if (roll_random(1, 100) <= v6) {
+                        if (roll_random_stream(ROLL_STREAM_COMBAT, 1, 100) <= v6) {
                             roll = ROLL_SUCCESS;
                             break;
                         }
@@ -2639,7 +2639,7 @@ static int shoot_along_path(Attack* attack, int endTile, int rounds, int anim)
             }
 
             int roundsHit = 0;
-            while (roll_random(1, 100) <= accuracy && remainingRounds > 0) {
+            while (roll_random_stream(ROLL_STREAM_COMBAT, 1, 100) <= accuracy && remainingRounds > 0) {
                 remainingRounds -= 1;
                 roundsHit += 1;
             }
@@ -2823,7 +2823,7 @@ static int compute_attack(Attack* attack)
 
     if (roll == ROLL_FAILURE) {
         if (trait_level(TRAIT_JINXED)) {
-            if (roll_random(0, 1) == 1) {
+            if (roll_random_stream(ROLL_STREAM_COMBAT, 0, 1) == 1) {
                 roll = ROLL_CRITICAL_FAILURE;
             }
         }
@@ -2865,7 +2865,7 @@ static int compute_attack(Attack* attack)
 
         if (roll == ROLL_SUCCESS && attack->attacker == obj_dude) {
             if (perk_level(PERK_SNIPER) != 0) {
-                if (roll_random(1, 10) <= stat_level(obj_dude, STAT_LUCK)) {
+                if (roll_random_stream(ROLL_STREAM_COMBAT, 1, 10) <= stat_level(obj_dude, STAT_LUCK)) {
                     roll = ROLL_CRITICAL_SUCCESS;
                 }
             }
@@ -2902,12 +2902,12 @@ static int compute_attack(Attack* attack)
             Object* defender;
 
             if (is_grenade) {
-                throw_distance = roll_random(1, distance / 2);
+                throw_distance = roll_random_stream(ROLL_STREAM_COMBAT, 1, distance / 2);
                 if (throw_distance == 0) {
                     throw_distance = 1;
                 }
 
-                rotation = roll_random(0, 5);
+                rotation = roll_random_stream(ROLL_STREAM_COMBAT, 0, 5);
                 tile = tile_num_in_direction(attack->defender->tile, rotation, throw_distance);
             } else {
                 tile = tile_num_beyond(attack->attacker->tile, attack->defender->tile, weapon_range);
@@ -3051,7 +3051,7 @@ static int attack_crit_success(Attack* attack)
 
     attack->attackerFlags |= DAM_CRITICAL;
 
-    int chance = roll_random(1, 100);
+    int chance = roll_random_stream(ROLL_STREAM_COMBAT, 1, 100);
 
     chance += stat_level(attack->attacker, STAT_BETTER_CRITICALS);
 
@@ -3114,7 +3114,7 @@ static int attack_crit_failure(Attack* attack)
         criticalFailureTableIndex = 0;
     }
 
-    int chance = roll_random(1, 100) - 5 * (stat_level(attack->attacker, STAT_LUCK) - 5);
+    int chance = roll_random_stream(ROLL_STREAM_COMBAT, 1, 100) - 5 * (stat_level(attack->attacker, STAT_LUCK) - 5);
 
     int effect;
     if (chance <= 20) {
@@ -3145,7 +3145,7 @@ static int attack_crit_failure(Attack* attack)
     }
 
     if ((attack->attackerFlags & DAM_HURT_SELF) != 0) {
-        attack->attackerDamage += roll_random(1, 5);
+        attack->attackerDamage += roll_random_stream(ROLL_STREAM_COMBAT, 1, 5);
     }
 
     if ((attack->attackerFlags & DAM_LOSE_TURN) != 0) {
@@ -3191,7 +3191,7 @@ static void do_random_cripple(int* flagsPtr)
 {
     *flagsPtr &= ~DAM_CRIP_RANDOM;
 
-    switch (roll_random(0, 3)) {
+    switch (roll_random_stream(ROLL_STREAM_COMBAT, 0, 3)) {
     case 0:
         *flagsPtr |= DAM_CRIP_LEG_LEFT;
         break;
@@ -48,6 +48,7 @@ static int ai_magic_hands(Object* critter, Object* item, int num);
 static int ai_check_drugs(Object* critter);
 static void ai_run_away(Object* critter);
 static int compare_nearer(const void* critter_ptr1, const void* critter_ptr2);
+static int compare_nearer_entry(const void* entry_ptr1, const void* entry_ptr2);
 static void ai_sort_list(Object** critterList, int length, Object* origin);
 static Object* ai_find_nearest_team(Object* critter, Object* other, int flags);
 static int ai_find_attackers(Object* critter, Object** a2, Object** a3, Object** a4);
@@ -70,6 +71,16 @@ static int combatai_unload_messages();
 // 0x504BF8
 static Object* combat_obj = NULL;
 
+// CE: Snapshot of the list being sorted by `ai_sort_list`, with distances to
+// the origin computed once per object instead of twice per comparison.
+typedef struct AiSortEntry {
+    Object* obj;
+    int distance;
+} AiSortEntry;
+
+static AiSortEntry* ai_sort_entries = NULL;
+static int ai_sort_entries_capacity = 0;
+
 // 0x504BFC
 static int num_caps = 0;
 
@@ -261,6 +272,12 @@ int combat_ai_exit()
     mem_free(cap);
     num_caps = 0;
 
+    if (ai_sort_entries != NULL) {
+        mem_free(ai_sort_entries);
+        ai_sort_entries = NULL;
+        ai_sort_entries_capacity = 0;
+    }
+
     combatai_is_initialized = false;
 
     // NOTE: Uninline.
@@ -476,11 +493,68 @@ static int compare_nearer(const void* critter_ptr1, const void* critter_ptr2)
     }
 }
 
+// CE: Same ordering as `compare_nearer` on precomputed distances.
+static int compare_nearer_entry(const void* entry_ptr1, const void* entry_ptr2)
+{
+    const AiSortEntry* entry1 = (const AiSortEntry*)entry_ptr1;
+    const AiSortEntry* entry2 = (const AiSortEntry*)entry_ptr2;
+
+    if (entry1->obj == NULL) {
+        if (entry2->obj == NULL) {
+            return 0;
+        }
+        return 1;
+    } else {
+        if (entry2->obj == NULL) {
+            return -1;
+        }
+    }
+
+    if (entry1->distance < entry2->distance) {
+        return -1;
+    } else if (entry1->distance > entry2->distance) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
 // 0x424E88
 static void ai_sort_list(Object** critterList, int length, Object* origin)
 {
     combat_obj = origin;
-    qsort(critterList, length, sizeof(*critterList), compare_nearer);
+
+    // CE: Sort a snapshot keyed by distance. `qsort` permutes elements based
+    // on comparison results only, so the resulting order (including ties) is
+    // the same as sorting the list itself with `compare_nearer`.
+    //
+    // Candidates are deliberately not evaluated on worker threads. Target and
+    // weapon selection is a fixed decision chain rather than scoring, lists
+    // are a few dozen objects at most, and checks beyond distance reach
+    // `proto_ptr`, which may load protos from the database.
+    if (length > ai_sort_entries_capacity) {
+        int capacity = length > 64 ? length : 64;
+        AiSortEntry* entries = (AiSortEntry*)mem_realloc(ai_sort_entries, sizeof(*entries) * capacity);
+        if (entries == NULL) {
+            qsort(critterList, length, sizeof(*critterList), compare_nearer);
+            return;
+        }
+
+        ai_sort_entries = entries;
+        ai_sort_entries_capacity = capacity;
+    }
+
+    for (int index = 0; index < length; index++) {
+        Object* obj = critterList[index];
+        ai_sort_entries[index].obj = obj;
+        ai_sort_entries[index].distance = obj != NULL ? obj_dist(obj, origin) : 0;
+    }
+
+    qsort(ai_sort_entries, length, sizeof(*ai_sort_entries), compare_nearer_entry);
+
+    for (int index = 0; index < length; index++) {
+        critterList[index] = ai_sort_entries[index].obj;
+    }
 }
 
 // 0x424EA0
@@ -864,7 +938,7 @@ static int ai_pick_hit_mode(Object* critter, Object* weapon)
         return HIT_MODE_RIGHT_WEAPON_PRIMARY;
     }
 
-    if (roll_random(1, ai_cap(critter)->secondary_freq) != 1) {
+    if (roll_random_stream(ROLL_STREAM_AI, 1, ai_cap(critter)->secondary_freq) != 1) {
         return HIT_MODE_RIGHT_WEAPON_PRIMARY;
     }
 
@@ -952,7 +1026,7 @@ static int ai_called_shot(Object* critter, Object* target, int hit_mode)
     if (item_w_mp_cost(critter, hit_mode, 1) <= critter->data.critter.combat.ap) {
         if (item_w_called_shot(critter, hit_mode)) {
             ai = ai_cap(critter);
-            if (roll_random(1, ai->called_freq) == 1) {
+            if (roll_random_stream(ROLL_STREAM_AI, 1, ai->called_freq) == 1) {
                 combat_difficulty = COMBAT_DIFFICULTY_NORMAL;
                 config_get_value(&game_config, GAME_CONFIG_PREFERENCES_KEY, GAME_CONFIG_COMBAT_DIFFICULTY_KEY, &combat_difficulty);
                 switch (combat_difficulty) {
@@ -968,7 +1042,7 @@ static int ai_called_shot(Object* critter, Object* target, int hit_mode)
                 }
 
                 if (stat_level(critter, STAT_INTELLIGENCE) >= min_intelligence) {
-                    hit_location = roll_random(0, 8);
+                    hit_location = roll_random_stream(ROLL_STREAM_AI, 0, 8);
                     to_hit = determine_to_hit(critter, target, hit_location, hit_mode);
                     if (to_hit < ai->min_to_hit) {
                         hit_location = HIT_LOCATION_TORSO;
@@ -1405,7 +1479,7 @@ int combatai_msg(Object* critter, Attack* attack, int type, int delay)
 
     debug_printf("%s is using %s packet with a %d%% chance to taunt\n", object_name(critter), ai->name, ai->chance);
 
-    if (roll_random(1, 100) > ai->chance) {
+    if (roll_random_stream(ROLL_STREAM_AI, 1, 100) > ai->chance) {
         return -1;
     }
 
@@ -1443,7 +1517,7 @@ int combatai_msg(Object* critter, Attack* attack, int type, int delay)
         return -1;
     }
 
-    messageListItem.num = roll_random(start, end);
+    messageListItem.num = roll_random_stream(ROLL_STREAM_AI, start, end);
     if (!message_search(&ai_message_file, &messageListItem)) {
         return -1;
     }
@@ -1499,7 +1573,7 @@ Object* combat_ai_random_target(Attack* attack)
 
     if (curr_crit_num != 0) {
         // Randomize starting critter.
-        int start = roll_random(0, curr_crit_num - 1);
+        int start = roll_random_stream(ROLL_STREAM_AI, 0, curr_crit_num - 1);
         int index = start;
         while (true) {
             Object* obj = curr_crit_list[index];
@@ -171,6 +171,7 @@ int critter_save(DB_FILE* stream)
 void critter_copy(CritterProtoData* dest, CritterProtoData* src)
 {
     memcpy(dest, src, sizeof(CritterProtoData));
+    stat_cache_invalidate(dest);
 }
 
 // 0x4279B8
@@ -764,7 +765,8 @@ void critter_kill(Object* critter, int anim, bool refresh_window)
     }
 
     if (critter->pid != 16777265 && critter->pid != 16777266 && critter->pid != 16777224) {
-        critter->flags |= OBJECT_NO_BLOCK;
+        obj_set_flag(critter, OBJECT_NO_BLOCK);
+
         if ((critter->flags & OBJECT_FLAT) == 0) {
             obj_toggle_flat(critter, &tempRect);
         }
@@ -939,6 +941,7 @@ int pc_load_data(const char* path)
     }
 
     proto->critter.data.baseStats[STAT_DAMAGE_RESISTANCE_EMP] = 100;
+    stat_cache_invalidate(&(proto->critter.data));
     proto->critter.data.bodyType = 0;
     proto->critter.data.experience = 0;
     proto->critter.data.killType = 0;
@@ -950,6 +953,8 @@ int pc_load_data(const char* path)
 // 0x4286DC
 int critter_read_data(DB_FILE* stream, CritterProtoData* critterData)
 {
+    stat_cache_invalidate(critterData);
+
     if (db_freadInt(stream, &(critterData->flags)) == -1) return -1;
     if (db_freadIntCount(stream, critterData->baseStats, SAVEABLE_STAT_COUNT) == -1) return -1;
     if (db_freadIntCount(stream, critterData->bonusStats, SAVEABLE_STAT_COUNT) == -1) return -1;
@@ -23,6 +23,7 @@
 #include "game/gmouse.h"
 #include "game/gmovie.h"
 #include "game/gsound.h"
+#include "game/heap.h"
 #include "game/intface.h"
 #include "game/inventry.h"
 #include "game/item.h"
@@ -162,6 +163,14 @@ int game_init(const char* windowTitle, bool isMapper, int font, int flags, int a
         return -1;
     }
 
+    // CE: Slab backend is opt-in (`slab_heap=1`), compacting heap stays the
+    // default. Caches create their heaps later during startup, so backend
+    // must be selected before any of them is initialized.
+    int slabHeap = 0;
+    if (config_get_value(&game_config, GAME_CONFIG_SYSTEM_KEY, GAME_CONFIG_SLAB_HEAP_KEY, &slabHeap) && slabHeap != 0) {
+        heap_enable_slab();
+    }
+
     win_set_minimized_title(windowTitle);
 
     VideoOptions video_options;
@@ -1307,10 +1316,12 @@ int game_quit_with_confirm()
 static int game_init_databases()
 {
     int hashing;
+    int mmap;
     char* main_file_name;
     char* patch_file_name;
 
     hashing = 0;
+    mmap = 0;
     main_file_name = NULL;
     patch_file_name = NULL;
 
@@ -1318,6 +1329,10 @@ static int game_init_databases()
         db_enable_hash_table();
     }
 
+    if (config_get_value(&game_config, GAME_CONFIG_SYSTEM_KEY, GAME_CONFIG_MMAP_KEY, &mmap) && mmap != 0) {
+        db_enable_mmap();
+    }
+
     config_get_string(&game_config, GAME_CONFIG_SYSTEM_KEY, GAME_CONFIG_MASTER_DAT_KEY, &main_file_name);
     if (*main_file_name == '\0') {
         main_file_name = NULL;
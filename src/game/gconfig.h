@@ -27,6 +27,8 @@ namespace fallout {
 #define GAME_CONFIG_COLOR_CYCLING_KEY "color_cycling"
 #define GAME_CONFIG_CYCLE_SPEED_FACTOR_KEY "cycle_speed_factor"
 #define GAME_CONFIG_HASHING_KEY "hashing"
+#define GAME_CONFIG_MMAP_KEY "mmap"
+#define GAME_CONFIG_SLAB_HEAP_KEY "slab_heap"
 #define GAME_CONFIG_SPLASH_KEY "splash"
 #define GAME_CONFIG_FREE_SPACE_KEY "free_space"
 #define GAME_CONFIG_TIMES_RUN_KEY "times_run"
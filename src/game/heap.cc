@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <mutex>
+
 #include "plib/gnw/debug.h"
 #include "plib/gnw/memory.h"
 
@@ -36,6 +38,22 @@ namespace fallout {
 
 #define HEAP_HANDLE_STATE_INVALID (-1)
 
+// The size of a single slab (including `HeapSlab` header).
+#define HEAP_SLAB_SIZE (64 * 1024)
+
+// The smallest and the largest object served from slabs. Bigger objects are
+// allocated individually.
+#define HEAP_SLAB_MIN_OBJECT_SIZE 64
+#define HEAP_SLAB_MAX_OBJECT_SIZE (16 * 1024)
+
+// The size of `HeapSlab` header rounded up to keep objects aligned.
+#define HEAP_SLAB_HEADER_SIZE 64
+
+// Size classes grow by a quarter of the nearest lower power of two: one class
+// for `HEAP_SLAB_MIN_OBJECT_SIZE` plus four classes per power of two up to
+// `HEAP_SLAB_MAX_OBJECT_SIZE`.
+#define HEAP_SLAB_CLASS_COUNT 33
+
 // The only allowed combination is LOCKED | SYSTEM.
 typedef enum HeapBlockState {
     HEAP_BLOCK_STATE_FREE = 0x00,
@@ -55,6 +73,39 @@ typedef struct HeapBlockFooter {
     int guard;
 } HeapBlockFooter;
 
+typedef struct HeapSlab {
+    struct HeapSlabClass* slabClass;
+
+    // Links in `HeapSlabClass::slabs`.
+    struct HeapSlab* prev;
+    struct HeapSlab* next;
+
+    // Intrusive list of released objects.
+    unsigned char* freeList;
+
+    // The number of objects at the beginning of `data` that were handed out
+    // at least once. Objects past this point are free and not in `freeList`.
+    int usedLength;
+
+    // The number of objects currently in use.
+    int usedCount;
+
+    unsigned char* data;
+} HeapSlab;
+
+typedef struct HeapSlabClass {
+    int objectSize;
+    int objectsPerSlab;
+
+    // Slabs of this class. Slabs having free objects come first, so that
+    // allocation only needs to look at the head.
+    HeapSlab* slabs;
+    HeapSlab* slabsTail;
+
+    int slabsLength;
+    int usedCount;
+} HeapSlabClass;
+
 typedef struct HeapMoveableExtent {
     // Pointer to the first block in the extent.
     unsigned char* data;
@@ -88,6 +139,19 @@ static bool heap_build_subblock_list(int extentIndex);
 static bool heap_sort_subblock_list(size_t count);
 static int heap_qsort_compare_subblock(const void* a1, const void* a2);
 static bool heap_build_fake_move_list(size_t count);
+static bool heap_slab_init(Heap* heap);
+static void heap_slab_exit(Heap* heap);
+static bool heap_slab_allocate(Heap* heap, int* handleIndexPtr, int size, int a4);
+static bool heap_slab_deallocate(Heap* heap, int handleIndex);
+static bool heap_slab_lock(Heap* heap, int handleIndex, unsigned char** bufferPtr);
+static bool heap_slab_unlock(Heap* heap, int handleIndex);
+static bool heap_slab_validate(Heap* heap);
+static bool heap_slab_stats(Heap* heap, char* dest, size_t size);
+static int heap_slab_class_index(int size);
+static bool heap_slab_is_full(HeapSlab* slab);
+static void heap_slab_unlink(HeapSlabClass* slabClass, HeapSlab* slab);
+static void heap_slab_link_head(HeapSlabClass* slabClass, HeapSlab* slab);
+static void heap_slab_link_tail(HeapSlabClass* slabClass, HeapSlab* slab);
 
 // An array of pointers to free heap blocks.
 //
@@ -138,9 +202,21 @@ static size_t heap_fake_move_list_size = 0;
 // 0x5054BC
 static int heap_count = 0;
 
+// Specifies that heaps created by subsequent `heap_init` calls use slab
+// backend.
+static bool slab_is_on = false;
+
+// CE: Serializes access to heaps and temporary lists above which are shared
+// by every heap. Heaps are used by both main thread and cache prefetch
+// threads. Recursive because fragmentation report calls `heap_stats` from
+// inside `heap_allocate`.
+static std::recursive_mutex heap_mutex;
+
 // 0x449F54
 bool heap_init(Heap* heap, int a2)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     if (heap == NULL) {
         return false;
     }
@@ -153,6 +229,25 @@ bool heap_init(Heap* heap, int a2)
 
     memset(heap, 0, sizeof(*heap));
 
+    if (slab_is_on) {
+        if (heap_init_handles(heap)) {
+            heap->size = (a2 >> 10) + a2;
+            if (heap_slab_init(heap)) {
+                heap_count++;
+                return true;
+            }
+
+            // NOTE: Uninline.
+            heap_exit_handles(heap);
+        }
+
+        if (heap_count == 0) {
+            heap_destroy_lists();
+        }
+
+        return false;
+    }
+
     if (heap_init_handles(heap)) {
         int size = (a2 >> 10) + a2;
         heap->data = (unsigned char*)mem_malloc(size);
@@ -186,10 +281,16 @@ bool heap_init(Heap* heap, int a2)
 // 0x44A01C
 bool heap_exit(Heap* heap)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     if (heap == NULL) {
         return false;
     }
 
+    if (heap->slabClasses != NULL) {
+        heap_slab_exit(heap);
+    }
+
     for (int index = 0; index < heap->handlesLength; index++) {
         HeapHandle* handle = &(heap->handles[index]);
         if (handle->state == 4 && handle->data != NULL) {
@@ -217,6 +318,8 @@ bool heap_exit(Heap* heap)
 // 0x44A0B0
 bool heap_allocate(Heap* heap, int* handleIndexPtr, int size, int a4)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     HeapBlockHeader* blockHeader;
     int state;
     int blockSize;
@@ -232,6 +335,13 @@ bool heap_allocate(Heap* heap, int* handleIndexPtr, int size, int a4)
         a4 = 0;
     }
 
+    if (heap->slabClasses != NULL) {
+        if (heap_slab_allocate(heap, handleIndexPtr, size, a4)) {
+            return true;
+        }
+        goto err;
+    }
+
     void* block;
     if (!heap_find_free_block(heap, size, &block, a4)) {
         goto err;
@@ -336,6 +446,8 @@ err:
 // 0x44A294
 bool heap_deallocate(Heap* heap, int* handleIndexPtr)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     if (heap == NULL || handleIndexPtr == NULL) {
         debug_printf("Heap Error: Could not deallocate block.\n");
         return false;
@@ -343,6 +455,10 @@ bool heap_deallocate(Heap* heap, int* handleIndexPtr)
 
     int handleIndex = *handleIndexPtr;
 
+    if (heap->slabClasses != NULL) {
+        return heap_slab_deallocate(heap, handleIndex);
+    }
+
     HeapHandle* handle = &(heap->handles[handleIndex]);
 
     HeapBlockHeader* blockHeader = (HeapBlockHeader*)handle->data;
@@ -405,11 +521,17 @@ bool heap_deallocate(Heap* heap, int* handleIndexPtr)
 // 0x44A3C0
 bool heap_lock(Heap* heap, int handleIndex, unsigned char** bufferPtr)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     if (heap == NULL) {
         debug_printf("Heap Error: Could not lock block");
         return false;
     }
 
+    if (heap->slabClasses != NULL) {
+        return heap_slab_lock(heap, handleIndex, bufferPtr);
+    }
+
     HeapHandle* handle = &(heap->handles[handleIndex]);
 
     HeapBlockHeader* blockHeader = (HeapBlockHeader*)handle->data;
@@ -466,11 +588,17 @@ bool heap_lock(Heap* heap, int handleIndex, unsigned char** bufferPtr)
 // 0x44A4C4
 bool heap_unlock(Heap* heap, int handleIndex)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     if (heap == NULL) {
         debug_printf("Heap Error: Could not unlock block.\n");
         return false;
     }
 
+    if (heap->slabClasses != NULL) {
+        return heap_slab_unlock(heap, handleIndex);
+    }
+
     HeapHandle* handle = &(heap->handles[handleIndex]);
 
     HeapBlockHeader* blockHeader = (HeapBlockHeader*)handle->data;
@@ -515,8 +643,14 @@ bool heap_unlock(Heap* heap, int handleIndex)
 // 0x44A5A4
 bool heap_validate(Heap* heap)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     debug_printf("Validating heap...\n");
 
+    if (heap->slabClasses != NULL) {
+        return heap_slab_validate(heap);
+    }
+
     int blocksCount = heap->freeBlocks + heap->moveableBlocks + heap->lockedBlocks;
     unsigned char* ptr = heap->data;
 
@@ -631,10 +765,40 @@ bool heap_validate(Heap* heap)
 // 0x44A888
 bool heap_stats(Heap* heap, char* dest, size_t size)
 {
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
     if (heap == NULL || dest == NULL) {
         return false;
     }
 
+    if (heap->slabClasses != NULL) {
+        return heap_slab_stats(heap, dest, size);
+    }
+
+    // Fragmentation is the share of free space which is not part of the
+    // largest free block, i.e. not usable for a single big allocation
+    // without compaction.
+    int largestFreeSize = 0;
+    unsigned char* ptr = heap->data;
+    unsigned char* end = heap->data + heap->size;
+    while (ptr + HEAP_BLOCK_OVERHEAD_SIZE <= end) {
+        HeapBlockHeader* blockHeader = (HeapBlockHeader*)ptr;
+        if (blockHeader->guard != HEAP_BLOCK_HEADER_GUARD) {
+            break;
+        }
+
+        if (blockHeader->state == HEAP_BLOCK_STATE_FREE && blockHeader->size > largestFreeSize) {
+            largestFreeSize = blockHeader->size;
+        }
+
+        ptr += blockHeader->size + HEAP_BLOCK_OVERHEAD_SIZE;
+    }
+
+    int fragmentation = 0;
+    if (heap->freeSize > 0) {
+        fragmentation = (int)(100.0 * (heap->freeSize - largestFreeSize) / heap->freeSize);
+    }
+
     const char* format = "[Heap]\n"
                          "Total free blocks: %d\n"
                          "Total free size: %d\n"
@@ -645,7 +809,9 @@ bool heap_stats(Heap* heap, char* dest, size_t size)
                          "Total system blocks: %d\n"
                          "Total system size: %d\n"
                          "Total handles: %d\n"
-                         "Total heaps: %d";
+                         "Total heaps: %d\n"
+                         "Largest free block: %d\n"
+                         "Fragmentation: %d%%";
 
     snprintf(dest, size, format,
         heap->freeBlocks,
@@ -657,7 +823,9 @@ bool heap_stats(Heap* heap, char* dest, size_t size)
         heap->systemBlocks,
         heap->systemSize,
         heap->handlesLength,
-        heap_count);
+        heap_count,
+        largestFreeSize,
+        fragmentation);
 
     return true;
 }
@@ -739,6 +907,13 @@ static bool heap_init_handles(Heap* heap)
         // NOTE: Uninline.
         if (heap_clear_handles(heap, heap->handles, HEAP_HANDLES_INITIAL_LENGTH) == true) {
             heap->handlesLength = HEAP_HANDLES_INITIAL_LENGTH;
+
+            for (int index = 0; index < HEAP_HANDLES_INITIAL_LENGTH; index++) {
+                heap->handles[index].next = index + 1;
+            }
+            heap->handles[HEAP_HANDLES_INITIAL_LENGTH - 1].next = -1;
+            heap->freeHandle = 0;
+
             return true;
         }
         debug_printf("Heap Error: Could not allocate handles.\n");
@@ -766,30 +941,30 @@ static bool heap_exit_handles(Heap* heap)
 // 0x44AA8C
 static bool heap_acquire_handle(Heap* heap, int* handleIndexPtr)
 {
-    // Loop thru already available handles and find first that is not currently
-    // used.
-    for (int index = 0; index < heap->handlesLength; index++) {
-        HeapHandle* handle = &(heap->handles[index]);
-        if (handle->state == HEAP_HANDLE_STATE_INVALID) {
-            *handleIndexPtr = index;
-            return true;
+    // CE: Original code scanned all handles for the first unused one. Unused
+    // handles are now kept in a list.
+    if (heap->freeHandle == -1) {
+        HeapHandle* handles = (HeapHandle*)mem_realloc(heap->handles, sizeof(*handles) * (heap->handlesLength + HEAP_HANDLES_INITIAL_LENGTH));
+        if (handles == NULL) {
+            return false;
         }
-    }
 
-    // If we're here the search above failed, we have to allocate more handles.
-    HeapHandle* handles = (HeapHandle*)mem_realloc(heap->handles, sizeof(*handles) * (heap->handlesLength + HEAP_HANDLES_INITIAL_LENGTH));
-    if (handles == NULL) {
-        return false;
-    }
+        heap->handles = handles;
 
-    heap->handles = handles;
+        // NOTE: Uninline.
+        heap_clear_handles(heap, &(heap->handles[heap->handlesLength]), HEAP_HANDLES_INITIAL_LENGTH);
 
-    // NOTE: Uninline.
-    heap_clear_handles(heap, &(heap->handles[heap->handlesLength]), HEAP_HANDLES_INITIAL_LENGTH);
+        for (int index = heap->handlesLength; index < heap->handlesLength + HEAP_HANDLES_INITIAL_LENGTH; index++) {
+            heap->handles[index].next = index + 1;
+        }
+        heap->handles[heap->handlesLength + HEAP_HANDLES_INITIAL_LENGTH - 1].next = -1;
+        heap->freeHandle = heap->handlesLength;
 
-    *handleIndexPtr = heap->handlesLength;
+        heap->handlesLength += HEAP_HANDLES_INITIAL_LENGTH;
+    }
 
-    heap->handlesLength += HEAP_HANDLES_INITIAL_LENGTH;
+    *handleIndexPtr = heap->freeHandle;
+    heap->freeHandle = heap->handles[heap->freeHandle].next;
 
     return true;
 }
@@ -799,6 +974,9 @@ static bool heap_release_handle(Heap* heap, int handleIndex)
 {
     heap->handles[handleIndex].state = HEAP_HANDLE_STATE_INVALID;
     heap->handles[handleIndex].data = NULL;
+    heap->handles[handleIndex].slab = NULL;
+    heap->handles[handleIndex].next = heap->freeHandle;
+    heap->freeHandle = handleIndex;
 
     return true;
 }
@@ -811,6 +989,9 @@ static bool heap_clear_handles(Heap* heap, HeapHandle* handles, unsigned int cou
     for (index = 0; index < count; index++) {
         handles[index].state = HEAP_HANDLE_STATE_INVALID;
         handles[index].data = NULL;
+        handles[index].slab = NULL;
+        handles[index].size = 0;
+        handles[index].next = -1;
     }
 
     return true;
@@ -1326,4 +1507,524 @@ static bool heap_build_fake_move_list(size_t count)
     return true;
 }
 
+// Enables slab backend for heaps created by subsequent `heap_init` calls.
+//
+// Unlike compacting backend slab heap never moves blocks, so locking is just
+// a state change. Blocks up to `HEAP_SLAB_MAX_OBJECT_SIZE` are served from
+// per size class slabs, bigger blocks are allocated individually. Heap size
+// passed to `heap_init` limits total memory obtained from the system.
+void heap_enable_slab()
+{
+    std::lock_guard<std::recursive_mutex> lock(heap_mutex);
+
+    slab_is_on = true;
+}
+
+static bool heap_slab_init(Heap* heap)
+{
+    heap->slabClasses = (HeapSlabClass*)mem_malloc(sizeof(*heap->slabClasses) * HEAP_SLAB_CLASS_COUNT);
+    if (heap->slabClasses == NULL) {
+        debug_printf("Heap Error: Could not allocate slab classes.\n");
+        return false;
+    }
+
+    for (int index = 0; index < HEAP_SLAB_CLASS_COUNT; index++) {
+        HeapSlabClass* slabClass = &(heap->slabClasses[index]);
+        if (index == 0) {
+            slabClass->objectSize = HEAP_SLAB_MIN_OBJECT_SIZE;
+        } else {
+            int power = 6 + (index - 1) / 4;
+            int quarter = (index - 1) % 4 + 1;
+            slabClass->objectSize = (1 << power) + quarter * (1 << (power - 2));
+        }
+        slabClass->objectsPerSlab = (HEAP_SLAB_SIZE - HEAP_SLAB_HEADER_SIZE) / slabClass->objectSize;
+        slabClass->slabs = NULL;
+        slabClass->slabsTail = NULL;
+        slabClass->slabsLength = 0;
+        slabClass->usedCount = 0;
+    }
+
+    heap->committedSize = 0;
+
+    return true;
+}
+
+static void heap_slab_exit(Heap* heap)
+{
+    for (int index = 0; index < HEAP_SLAB_CLASS_COUNT; index++) {
+        HeapSlab* slab = heap->slabClasses[index].slabs;
+        while (slab != NULL) {
+            HeapSlab* next = slab->next;
+            mem_free(slab);
+            slab = next;
+        }
+    }
+
+    for (int index = 0; index < heap->handlesLength; index++) {
+        HeapHandle* handle = &(heap->handles[index]);
+        if (handle->state != HEAP_HANDLE_STATE_INVALID && handle->slab == NULL) {
+            mem_free(handle->data);
+        }
+    }
+
+    // NOTE: Uninline.
+    heap_clear_handles(heap, heap->handles, heap->handlesLength);
+
+    mem_free(heap->slabClasses);
+    heap->slabClasses = NULL;
+    heap->committedSize = 0;
+}
+
+static bool heap_slab_allocate(Heap* heap, int* handleIndexPtr, int size, int a4)
+{
+    int handleIndex;
+    if (!heap_acquire_handle(heap, &handleIndex)) {
+        debug_printf("Heap Error: Could not acquire handle for new block.\n");
+        return false;
+    }
+
+    HeapHandle* handle = &(heap->handles[handleIndex]);
+
+    if (size > HEAP_SLAB_MAX_OBJECT_SIZE) {
+        bool system = heap->committedSize + size > heap->size;
+        if (system && a4 == 1) {
+            // NOTE: Uninline.
+            heap_release_handle(heap, handleIndex);
+            return false;
+        }
+
+        unsigned char* data = (unsigned char*)mem_malloc(size);
+        if (data == NULL) {
+            // NOTE: Uninline.
+            heap_release_handle(heap, handleIndex);
+            return false;
+        }
+
+        handle->data = data;
+        handle->slab = NULL;
+        handle->size = size;
+
+        if (system) {
+            handle->state = HEAP_BLOCK_STATE_SYSTEM;
+            heap->systemBlocks++;
+            heap->systemSize += size;
+        } else {
+            handle->state = HEAP_BLOCK_STATE_MOVABLE;
+            heap->moveableBlocks++;
+            heap->moveableSize += size;
+            heap->committedSize += size;
+        }
+
+        *handleIndexPtr = handleIndex;
+
+        return true;
+    }
+
+    HeapSlabClass* slabClass = &(heap->slabClasses[heap_slab_class_index(size)]);
+    HeapSlab* slab = slabClass->slabs;
+    if (slab == NULL || heap_slab_is_full(slab)) {
+        // Slabs are shared by future allocations, so `a4` = 0 lets the heap
+        // grow past its size rather than marking the block as system one.
+        if (heap->committedSize + HEAP_SLAB_SIZE > heap->size && a4 == 1) {
+            // NOTE: Uninline.
+            heap_release_handle(heap, handleIndex);
+            return false;
+        }
+
+        slab = (HeapSlab*)mem_malloc(HEAP_SLAB_SIZE);
+        if (slab == NULL) {
+            // NOTE: Uninline.
+            heap_release_handle(heap, handleIndex);
+            return false;
+        }
+
+        slab->slabClass = slabClass;
+        slab->freeList = NULL;
+        slab->usedLength = 0;
+        slab->usedCount = 0;
+        slab->data = (unsigned char*)slab + HEAP_SLAB_HEADER_SIZE;
+
+        heap_slab_link_head(slabClass, slab);
+        slabClass->slabsLength++;
+
+        heap->committedSize += HEAP_SLAB_SIZE;
+    }
+
+    unsigned char* data;
+    if (slab->freeList != NULL) {
+        data = slab->freeList;
+        slab->freeList = *(unsigned char**)data;
+    } else {
+        data = slab->data + slab->usedLength * slabClass->objectSize;
+        slab->usedLength++;
+    }
+
+    slab->usedCount++;
+    slabClass->usedCount++;
+
+    // Keep slabs with free objects in front.
+    if (heap_slab_is_full(slab)) {
+        heap_slab_unlink(slabClass, slab);
+        heap_slab_link_tail(slabClass, slab);
+    }
+
+    handle->state = HEAP_BLOCK_STATE_MOVABLE;
+    handle->data = data;
+    handle->slab = slab;
+    handle->size = size;
+
+    heap->moveableBlocks++;
+    heap->moveableSize += size;
+
+    *handleIndexPtr = handleIndex;
+
+    return true;
+}
+
+static bool heap_slab_deallocate(Heap* heap, int handleIndex)
+{
+    HeapHandle* handle = &(heap->handles[handleIndex]);
+
+    if (handle->state == HEAP_HANDLE_STATE_INVALID) {
+        debug_printf("Heap Error: Attempt to deallocate unused block.\n");
+        return false;
+    }
+
+    if ((handle->state & HEAP_BLOCK_STATE_LOCKED) != 0) {
+        debug_printf("Heap Error: Attempt to deallocate locked block.\n");
+        return false;
+    }
+
+    if (handle->state == HEAP_BLOCK_STATE_SYSTEM) {
+        heap->systemBlocks--;
+        heap->systemSize -= handle->size;
+    } else {
+        heap->moveableBlocks--;
+        heap->moveableSize -= handle->size;
+    }
+
+    HeapSlab* slab = handle->slab;
+    if (slab == NULL) {
+        if (handle->state != HEAP_BLOCK_STATE_SYSTEM) {
+            heap->committedSize -= handle->size;
+        }
+
+        mem_free(handle->data);
+    } else {
+        HeapSlabClass* slabClass = slab->slabClass;
+        bool wasFull = heap_slab_is_full(slab);
+
+        *(unsigned char**)handle->data = slab->freeList;
+        slab->freeList = handle->data;
+        slab->usedCount--;
+        slabClass->usedCount--;
+
+        if (slab->usedCount == 0) {
+            heap_slab_unlink(slabClass, slab);
+            slabClass->slabsLength--;
+            heap->committedSize -= HEAP_SLAB_SIZE;
+            mem_free(slab);
+        } else if (wasFull) {
+            heap_slab_unlink(slabClass, slab);
+            heap_slab_link_head(slabClass, slab);
+        }
+    }
+
+    // NOTE: Uninline.
+    heap_release_handle(heap, handleIndex);
+
+    return true;
+}
+
+static bool heap_slab_lock(Heap* heap, int handleIndex, unsigned char** bufferPtr)
+{
+    HeapHandle* handle = &(heap->handles[handleIndex]);
+
+    if (handle->state == HEAP_HANDLE_STATE_INVALID) {
+        debug_printf("Heap Error: Attempt to lock unused block.\n");
+        return false;
+    }
+
+    if ((handle->state & HEAP_BLOCK_STATE_LOCKED) != 0) {
+        debug_printf("Heap Error: Attempt to lock a previously locked block.");
+        return false;
+    }
+
+    if (handle->state == HEAP_BLOCK_STATE_MOVABLE) {
+        heap->moveableBlocks--;
+        heap->lockedBlocks++;
+        heap->moveableSize -= handle->size;
+        heap->lockedSize += handle->size;
+    }
+
+    handle->state |= HEAP_BLOCK_STATE_LOCKED;
+    handle->state &= ~HEAP_BLOCK_STATE_MOVABLE;
+
+    *bufferPtr = handle->data;
+
+    return true;
+}
+
+static bool heap_slab_unlock(Heap* heap, int handleIndex)
+{
+    HeapHandle* handle = &(heap->handles[handleIndex]);
+
+    if (handle->state == HEAP_HANDLE_STATE_INVALID || (handle->state & HEAP_BLOCK_STATE_LOCKED) == 0) {
+        debug_printf("Heap Error: Attempt to unlock a previously unlocked block.\n");
+        debug_printf("Heap Error: Could not unlock block.\n");
+        return false;
+    }
+
+    if ((handle->state & HEAP_BLOCK_STATE_SYSTEM) != 0) {
+        handle->state = HEAP_BLOCK_STATE_SYSTEM;
+        return true;
+    }
+
+    handle->state = HEAP_BLOCK_STATE_MOVABLE;
+
+    heap->moveableBlocks++;
+    heap->lockedBlocks--;
+    heap->moveableSize += handle->size;
+    heap->lockedSize -= handle->size;
+
+    return true;
+}
+
+static bool heap_slab_validate(Heap* heap)
+{
+    int moveableBlocks = 0;
+    int moveableSize = 0;
+    int lockedBlocks = 0;
+    int lockedSize = 0;
+    int systemBlocks = 0;
+    int systemSize = 0;
+    int largeSize = 0;
+
+    for (int index = 0; index < heap->handlesLength; index++) {
+        HeapHandle* handle = &(heap->handles[index]);
+        if (handle->state == HEAP_HANDLE_STATE_INVALID) {
+            continue;
+        }
+
+        if ((handle->state & HEAP_BLOCK_STATE_SYSTEM) != 0) {
+            systemBlocks++;
+            systemSize += handle->size;
+            continue;
+        }
+
+        if (handle->state == HEAP_BLOCK_STATE_MOVABLE) {
+            moveableBlocks++;
+            moveableSize += handle->size;
+        } else if (handle->state == HEAP_BLOCK_STATE_LOCKED) {
+            lockedBlocks++;
+            lockedSize += handle->size;
+        }
+
+        if (handle->slab == NULL) {
+            largeSize += handle->size;
+        } else if (handle->size > handle->slab->slabClass->objectSize) {
+            debug_printf("Block does not fit its slab class.\n");
+            return false;
+        }
+    }
+
+    if (moveableBlocks != heap->moveableBlocks || moveableSize != heap->moveableSize) {
+        debug_printf("Invalid number or size of moveable blocks.\n");
+        return false;
+    }
+
+    if (lockedBlocks != heap->lockedBlocks || lockedSize != heap->lockedSize) {
+        debug_printf("Invalid number or size of locked blocks.\n");
+        return false;
+    }
+
+    if (systemBlocks != heap->systemBlocks || systemSize != heap->systemSize) {
+        debug_printf("Invalid number or size of system blocks.\n");
+        return false;
+    }
+
+    int slabsLength = 0;
+    for (int index = 0; index < HEAP_SLAB_CLASS_COUNT; index++) {
+        HeapSlabClass* slabClass = &(heap->slabClasses[index]);
+
+        int length = 0;
+        int usedCount = 0;
+        HeapSlab* last = NULL;
+        for (HeapSlab* slab = slabClass->slabs; slab != NULL; slab = slab->next) {
+            if (slab->usedCount <= 0 || slab->usedCount > slab->usedLength || slab->usedLength > slabClass->objectsPerSlab) {
+                debug_printf("Invalid slab occupancy.\n");
+                return false;
+            }
+
+            length++;
+            usedCount += slab->usedCount;
+            last = slab;
+        }
+
+        if (length != slabClass->slabsLength || usedCount != slabClass->usedCount || last != slabClass->slabsTail) {
+            debug_printf("Invalid slab class bookkeeping.\n");
+            return false;
+        }
+
+        slabsLength += length;
+    }
+
+    if (heap->committedSize != slabsLength * HEAP_SLAB_SIZE + largeSize) {
+        debug_printf("Invalid committed size.\n");
+        return false;
+    }
+
+    debug_printf("Heap is O.K.\n");
+
+    return true;
+}
+
+static bool heap_slab_stats(Heap* heap, char* dest, size_t size)
+{
+    int slabsLength = 0;
+    int objectsCapacity = 0;
+    int objectsUsed = 0;
+    for (int index = 0; index < HEAP_SLAB_CLASS_COUNT; index++) {
+        HeapSlabClass* slabClass = &(heap->slabClasses[index]);
+        slabsLength += slabClass->slabsLength;
+        objectsCapacity += slabClass->slabsLength * slabClass->objectsPerSlab;
+        objectsUsed += slabClass->usedCount;
+    }
+
+    // Fragmentation is the share of committed memory not occupied by live
+    // blocks: rounding up to size class plus free objects in slabs.
+    int usedSize = heap->moveableSize + heap->lockedSize;
+    int fragmentation = 0;
+    if (heap->committedSize > 0) {
+        fragmentation = (int)(100.0 * (heap->committedSize - usedSize) / heap->committedSize);
+    }
+
+    int occupancy = 0;
+    if (objectsCapacity > 0) {
+        occupancy = (int)(100.0 * objectsUsed / objectsCapacity);
+    }
+
+    const char* format = "[Heap]\n"
+                         "Backend: slab\n"
+                         "Heap size: %d\n"
+                         "Committed size: %d\n"
+                         "Used size: %d\n"
+                         "Fragmentation: %d%%\n"
+                         "Total moveable blocks: %d\n"
+                         "Total moveable size: %d\n"
+                         "Total locked blocks: %d\n"
+                         "Total locked size: %d\n"
+                         "Total system blocks: %d\n"
+                         "Total system size: %d\n"
+                         "Total handles: %d\n"
+                         "Total heaps: %d\n"
+                         "Total slabs: %d\n"
+                         "Slab occupancy: %d%%";
+
+    int length = snprintf(dest, size, format,
+        heap->size,
+        heap->committedSize,
+        usedSize,
+        fragmentation,
+        heap->moveableBlocks,
+        heap->moveableSize,
+        heap->lockedBlocks,
+        heap->lockedSize,
+        heap->systemBlocks,
+        heap->systemSize,
+        heap->handlesLength,
+        heap_count,
+        slabsLength,
+        occupancy);
+
+    // Append per class occupancy while there is room.
+    for (int index = 0; index < HEAP_SLAB_CLASS_COUNT; index++) {
+        if (length < 0 || (size_t)length >= size) {
+            break;
+        }
+
+        HeapSlabClass* slabClass = &(heap->slabClasses[index]);
+        if (slabClass->slabsLength == 0) {
+            continue;
+        }
+
+        length += snprintf(dest + length, size - length,
+            "\n  %5d: %d slabs, %d/%d objects",
+            slabClass->objectSize,
+            slabClass->slabsLength,
+            slabClass->usedCount,
+            slabClass->slabsLength * slabClass->objectsPerSlab);
+    }
+
+    return true;
+}
+
+// Returns index of the smallest size class that fits block of given size.
+static int heap_slab_class_index(int size)
+{
+    if (size <= HEAP_SLAB_MIN_OBJECT_SIZE) {
+        return 0;
+    }
+
+    // Find power such that size is in (2^power, 2^(power + 1)].
+    int power = 6;
+    while ((1 << (power + 1)) < size) {
+        power++;
+    }
+
+    int quarter = ((size - 1 - (1 << power)) >> (power - 2)) + 1;
+    return 1 + (power - 6) * 4 + (quarter - 1);
+}
+
+static bool heap_slab_is_full(HeapSlab* slab)
+{
+    return slab->freeList == NULL && slab->usedLength == slab->slabClass->objectsPerSlab;
+}
+
+static void heap_slab_unlink(HeapSlabClass* slabClass, HeapSlab* slab)
+{
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        slabClass->slabs = slab->next;
+    }
+
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    } else {
+        slabClass->slabsTail = slab->prev;
+    }
+
+    slab->prev = NULL;
+    slab->next = NULL;
+}
+
+static void heap_slab_link_head(HeapSlabClass* slabClass, HeapSlab* slab)
+{
+    slab->prev = NULL;
+    slab->next = slabClass->slabs;
+
+    if (slabClass->slabs != NULL) {
+        slabClass->slabs->prev = slab;
+    } else {
+        slabClass->slabsTail = slab;
+    }
+
+    slabClass->slabs = slab;
+}
+
+static void heap_slab_link_tail(HeapSlabClass* slabClass, HeapSlab* slab)
+{
+    if (slabClass->slabsTail == NULL) {
+        heap_slab_link_head(slabClass, slab);
+        return;
+    }
+
+    slab->prev = slabClass->slabsTail;
+    slab->next = NULL;
+
+    slabClass->slabsTail->next = slab;
+    slabClass->slabsTail = slab;
+}
+
 } // namespace fallout
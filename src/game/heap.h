@@ -8,6 +8,15 @@ namespace fallout {
 typedef struct HeapHandle {
     unsigned int state;
     unsigned char* data;
+
+    // Slab owning `data`, or `NULL` for large objects (slab backend only).
+    struct HeapSlab* slab;
+
+    // Requested size of the block (slab backend only).
+    int size;
+
+    // Next unused handle (valid for unused handles only).
+    int next;
 } HeapHandle;
 
 typedef struct Heap {
@@ -23,6 +32,17 @@ typedef struct Heap {
     int systemSize;
     HeapHandle* handles;
     unsigned char* data;
+
+    // Head of unused handles list.
+    int freeHandle;
+
+    // Size classes of slab backend, `NULL` when heap uses compacting
+    // backend.
+    struct HeapSlabClass* slabClasses;
+
+    // Slab backend only: total memory obtained from the system (slabs and
+    // large objects).
+    int committedSize;
 } Heap;
 
 bool heap_init(Heap* heap, int a2);
@@ -33,6 +53,7 @@ bool heap_lock(Heap* heap, int handleIndex, unsigned char** bufferPtr);
 bool heap_unlock(Heap* heap, int handleIndex);
 bool heap_stats(Heap* heap, char* dest, size_t size);
 bool heap_validate(Heap* heap);
+void heap_enable_slab();
 
 } // namespace fallout
 
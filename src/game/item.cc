@@ -1076,7 +1076,7 @@ int item_w_damage(Object* critter, int hit_mode)
         max_damage = stat_level(critter, STAT_MELEE_DAMAGE) + 2;
     }
 
-    return roll_random(min_damage, bonus_damage + max_damage);
+    return roll_random_stream(ROLL_STREAM_COMBAT, min_damage, bonus_damage + max_damage);
 }
 
 // 0x46AD4C
@@ -1,5 +1,7 @@
 #include "game/light.h"
 
+#include <algorithm>
+
 #include "game/map_defs.h"
 #include "game/object.h"
 #include "game/perk.h"
@@ -13,6 +15,9 @@ static int ambient_light = LIGHT_LEVEL_MAX;
 // 0x59CF1C
 static int tile_intensity[ELEVATION_COUNT][HEX_GRID_SIZE];
 
+// CE: Incremented every time ambient light or light of any tile changes.
+static unsigned int light_generation;
+
 // 0x46CA70
 int light_init()
 {
@@ -57,6 +62,10 @@ void light_set_ambient(int new_ambient_light, bool refresh_screen)
     old_ambient_light = ambient_light;
     ambient_light = normalized;
 
+    if (old_ambient_light != normalized) {
+        light_generation++;
+    }
+
     if (refresh_screen) {
         if (old_ambient_light != normalized) {
             tile_refresh_display();
@@ -123,6 +132,7 @@ void light_set_tile(int elevation, int tile, int lightIntensity)
     }
 
     tile_intensity[elevation][tile] = lightIntensity;
+    light_generation++;
 }
 
 // 0x46CB78
@@ -137,6 +147,7 @@ void light_add_to_tile(int elevation, int tile, int lightIntensity)
     }
 
     tile_intensity[elevation][tile] += lightIntensity;
+    light_generation++;
 }
 
 // 0x46CBB0
@@ -151,6 +162,7 @@ void light_subtract_from_tile(int elevation, int tile, int lightIntensity)
     }
 
     tile_intensity[elevation][tile] -= lightIntensity;
+    light_generation++;
 }
 
 // 0x46CBEC
@@ -164,6 +176,78 @@ void light_reset_tiles()
             tile_intensity[elevation][tile] = 655;
         }
     }
+
+    light_generation++;
+}
+
+// CE: Returns a counter which changes whenever light returned by
+// `light_get_ambient` or `light_get_tile` may have changed.
+unsigned int light_get_generation()
+{
+    return light_generation;
+}
+
+static inline int light_visible_level(int intensity)
+{
+    if (intensity > LIGHT_LEVEL_MAX) {
+        intensity = LIGHT_LEVEL_MAX;
+    }
+
+    if (intensity < ambient_light) {
+        intensity = ambient_light;
+    }
+
+    return intensity;
+}
+
+// Applies a batch of light deltas. Deltas hitting the same tile are summed
+// first, so a light subtracted at one place and added at another only
+// touches each tile once. The array is reordered in place.
+//
+// Returns true if the light level visible on screen (clamped and lifted to
+// ambient light) changed on any tile.
+bool light_apply_deltas(LightDelta* deltas, int length)
+{
+    std::sort(deltas, deltas + length, [](const LightDelta& a, const LightDelta& b) {
+        if (a.elevation != b.elevation) {
+            return a.elevation < b.elevation;
+        }
+        return a.tile < b.tile;
+    });
+
+    bool changed = false;
+    int index = 0;
+    while (index < length) {
+        int elevation = deltas[index].elevation;
+        int tile = deltas[index].tile;
+        int intensity = 0;
+        do {
+            intensity += deltas[index].intensity;
+            index++;
+        } while (index < length && deltas[index].elevation == elevation && deltas[index].tile == tile);
+
+        if (intensity == 0) {
+            continue;
+        }
+
+        if (!elevationIsValid(elevation)) {
+            continue;
+        }
+
+        if (!hexGridTileIsValid(tile)) {
+            continue;
+        }
+
+        int* ptr = &(tile_intensity[elevation][tile]);
+        int oldLevel = light_visible_level(*ptr);
+        *ptr += intensity;
+        light_generation++;
+        if (light_visible_level(*ptr) != oldLevel) {
+            changed = true;
+        }
+    }
+
+    return changed;
 }
 
 } // namespace fallout
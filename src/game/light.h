@@ -11,6 +11,12 @@ namespace fallout {
 
 typedef void(AdjustLightIntensityProc)(int elevation, int tile, int intensity);
 
+typedef struct LightDelta {
+    int elevation;
+    int tile;
+    int intensity;
+} LightDelta;
+
 int light_init();
 void light_reset();
 void light_exit();
@@ -24,6 +30,8 @@ void light_set_tile(int elevation, int tile, int intensity);
 void light_add_to_tile(int elevation, int tile, int intensity);
 void light_subtract_from_tile(int elevation, int tile, int intensity);
 void light_reset_tiles();
+bool light_apply_deltas(LightDelta* deltas, int length);
+unsigned int light_get_generation();
 
 } // namespace fallout
 
@@ -53,7 +53,7 @@ namespace fallout {
 
 #define LOAD_SAVE_SIGNATURE "FALLOUT SAVE FILE"
 #define LOAD_SAVE_DESCRIPTION_LENGTH 30
-#define LOAD_SAVE_HANDLER_COUNT 27
+#define LOAD_SAVE_HANDLER_COUNT 28
 
 #define LSGAME_MSG_NAME "LSGAME.MSG"
 
@@ -216,6 +216,8 @@ static SaveGameHandler* master_save_list[LOAD_SAVE_HANDLER_COUNT] = {
     skill_use_slot_save,
     partyMemberSave,
     intface_save,
+    // CE: Must stay last, see `roll_stream_save`.
+    roll_stream_save,
     DummyFunc,
 };
 
@@ -247,6 +249,7 @@ static LoadGameHandler* master_load_list[LOAD_SAVE_HANDLER_COUNT] = {
     skill_use_slot_load,
     partyMemberLoad,
     intface_load,
+    roll_stream_load,
     EndLoad,
 };
 
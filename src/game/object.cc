@@ -1,6 +1,7 @@
 #include "game/object.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <algorithm>
@@ -15,6 +16,7 @@
 #include "game/item.h"
 #include "game/light.h"
 #include "game/map.h"
+#include "game/object_render.h"
 #include "game/party.h"
 #include "game/protinst.h"
 #include "game/proto.h"
@@ -31,6 +33,18 @@
 
 namespace fallout {
 
+// Maximum number of prepared objects waiting to be rasterized. Each of them
+// holds art locks, so the cache has to keep all their frames at once.
+#define OBJ_RENDER_MAX_BATCH 64
+
+// Tile of the update area in render order together with screen coordinates of
+// its center.
+typedef struct ObjectDrawTile {
+    int tile;
+    int x;
+    int y;
+} ObjectDrawTile;
+
 static int obj_read_obj(Object* obj, DB_FILE* stream);
 static int obj_load_func(DB_FILE* stream);
 static void obj_fix_combat_cid_for_dude();
@@ -55,11 +69,25 @@ static int obj_create_object_node(ObjectListNode** nodePtr);
 static void obj_destroy_object_node(ObjectListNode** nodePtr);
 static int obj_node_ptr(Object* obj, ObjectListNode** out_node, ObjectListNode** out_prev_node);
 static void obj_insert(ObjectListNode* ptr);
+static void obj_tile_index_add(Object* obj);
+static void obj_tile_index_refresh(int tile);
+static int obj_tile_index_next(const uint64_t* mask, int tile);
+static const uint64_t* obj_tile_index_elevation_mask(int elevation);
 static int obj_remove(ObjectListNode* a1, ObjectListNode* a2);
 static int obj_connect_to_tile(ObjectListNode* node, int tile_index, int elev, Rect* rect);
 static int obj_adjust_light(Object* obj, int a2, Rect* rect);
+static void obj_light_add_delta(int elevation, int tile, int intensity);
+static void obj_intensity_column(unsigned char* table, int light);
+static bool obj_light_flush();
+static void obj_light_batch_begin();
+static void obj_light_batch_end(Rect* rect);
 static void obj_render_outline(Object* object, Rect* rect);
 static void obj_render_object(Object* object, Rect* rect, int light);
+static int obj_render_prepare(Object* object, Rect* rect, int light, ObjectDrawCommand* command);
+static void obj_render_release(ObjectDrawCommand* command);
+static bool obj_draw_tiles_build(int elevation);
+static void obj_render_batch(Object* object, Rect* rect, int light);
+static void obj_render_flush(Rect* rect);
 static int obj_preload_sort(const void* a1, const void* a2);
 
 // 0x505B70
@@ -216,6 +244,20 @@ static int light_blocked[6][36];
 // 0x637A90
 static int light_offsets[2][6][36];
 
+#define LIGHT_DELTAS_CAPACITY 512
+
+// Tile light changes collected by obj_adjust_light. They are applied when a
+// light footprint is complete, or at the end of a batch, so that turning a
+// light off at one place and on at another changes each tile only once.
+static LightDelta lightDeltas[LIGHT_DELTAS_CAPACITY];
+static int lightDeltasLength = 0;
+static int lightBatchDepth = 0;
+static bool lightBatchChanged = false;
+
+// Union of the light rects of the footprints in the current batch.
+static Rect lightBatchRect;
+static bool lightBatchHasRect = false;
+
 // 0x638150
 static Object* outlinedObjects[100];
 
@@ -227,9 +269,33 @@ static Rect buf_rect;
 // 0x6382F0
 static ObjectListNode* objectTable[HEX_GRID_SIZE];
 
+#define OBJECT_TILE_MASK_WORDS ((HEX_GRID_SIZE + 63) / 64)
+#define OBJECT_TILE_MASK_TYPES 16
+
+// CE: Tile bitmaps of objectTable used to skip empty buckets in whole map
+// queries. A bit is set when an object is inserted into the bucket and is
+// cleared lazily by queries that find nothing there, so a set bit only means
+// the bucket may have matching objects.
+static uint64_t objectTileMask[OBJECT_TILE_MASK_WORDS];
+static uint64_t objectElevationTileMask[ELEVATION_COUNT][OBJECT_TILE_MASK_WORDS];
+static uint64_t objectTypeTileMask[ELEVATION_COUNT][OBJECT_TILE_MASK_TYPES][OBJECT_TILE_MASK_WORDS];
+
 // 0x65F3F0
 static Rect updateAreaPixelBounds;
 
+// CE: Tiles of the whole update area in render order. They only depend on
+// view center and elevation, so every dirty rect culls this list instead of
+// walking hex grid again.
+static ObjectDrawTile* drawTiles = NULL;
+static int drawTilesLength = 0;
+static bool drawTilesValid = false;
+static int drawTilesCenterTile = -1;
+static int drawTilesElevation = -1;
+
+// Objects of current dirty rect ready to be rasterized.
+static ObjectDrawCommand drawCommands[OBJ_RENDER_MAX_BATCH];
+static int drawCommandsLength = 0;
+
 // 0x65F400
 unsigned char glassGrayTable[256];
 
@@ -259,11 +325,20 @@ static int buf_width;
 // 0x65F618
 Object* obj_dude;
 
-// 0x65F61C
-static char obj_seen_check[5001];
+// CE: Seen tiles are tracked in blocks of eight (`tile >> 3`), one bit per
+// block, so that the view window around seen blocks can be computed with
+// word shifts instead of byte loops.
+#define OBJ_SEEN_BLOCKS 5001
+#define OBJ_SEEN_WORDS ((OBJ_SEEN_BLOCKS + 63) / 64)
 
 // 0x6609A5
-static char obj_seen[5001];
+static uint64_t obj_seen[OBJ_SEEN_WORDS];
+
+// CE: Blocks whose objects on the given elevation are known to be marked with
+// `OBJECT_SEEN`. The bit is cleared whenever an object is inserted into the
+// block, so `obj_process_seen` only has to visit objects in blocks that became
+// visible or received new objects since the last pass.
+static uint64_t obj_seen_done[ELEVATION_COUNT][OBJ_SEEN_WORDS];
 
 // 0x47A590
 int obj_init(unsigned char* buf, int width, int height, int pitch)
@@ -271,7 +346,8 @@ int obj_init(unsigned char* buf, int width, int height, int pitch)
     int dudeFid;
     int eggFid;
 
-    memset(obj_seen, 0, 5001);
+    memset(obj_seen, 0, sizeof(obj_seen));
+    memset(obj_seen_done, 0, sizeof(obj_seen_done));
     updateAreaPixelBounds.lrx = width + 320;
     updateAreaPixelBounds.ulx = -320;
     updateAreaPixelBounds.lry = height + 240;
@@ -360,7 +436,7 @@ void obj_reset()
     if (objInitialized) {
         text_object_reset();
         obj_remove_all();
-        memset(obj_seen, 0, 5001);
+        memset(obj_seen, 0, sizeof(obj_seen));
         light_reset();
     }
 }
@@ -383,6 +459,15 @@ void obj_exit()
         // NOTE: Uninline.
         obj_render_table_exit();
 
+        obj_render_threads_exit();
+
+        if (drawTiles != NULL) {
+            mem_free(drawTiles);
+            drawTiles = NULL;
+        }
+        drawTilesLength = 0;
+        drawTilesValid = false;
+
         // NOTE: Uninline.
         obj_order_table_exit();
 
@@ -527,6 +612,7 @@ static int obj_load_func(DB_FILE* stream)
             objectListNode->obj->elevation = elevation;
 
             obj_insert(objectListNode);
+            obj_blocking_update(objectListNode->obj, -1, elevation, objectListNode->obj->flags);
 
             if ((objectListNode->obj->flags & OBJECT_NO_REMOVE) && PID_TYPE(objectListNode->obj->pid) == OBJ_TYPE_CRITTER && objectListNode->obj->pid != 18000) {
                 objectListNode->obj->flags &= ~OBJECT_NO_REMOVE;
@@ -790,57 +876,60 @@ void obj_render_pre_roof(Rect* rect, int elevation)
     int minY = updatedRect.uly - 240;
     int maxX = updatedRect.lrx + 320;
     int maxY = updatedRect.lry + 240;
-    int upperLeftTile = tile_num(minX, minY, elevation, true);
-    int updateAreaHexWidth = (maxX - minX + 1) / 32;
-    int updateAreaHexHeight = (maxY - minY + 1) / 12;
-
-    int parity = tile_center_tile & 1;
-    int* orders = orderTable[parity];
-    int* offsets = offsetTable[parity];
 
     outlineCount = 0;
 
+    if (!obj_draw_tiles_build(elevation)) {
+        return;
+    }
+
+    // Original code visited tiles within hex box around the rect, tile
+    // centers can be up to a half hex outside of it.
+    minX -= 32;
+    minY -= 24;
+    maxX += 32;
+    maxY += 24;
+
     int renderCount = 0;
-    for (int i = 0; i < updateHexArea; i++) {
-        int offsetIndex = *orders++;
-        if (updateAreaHexHeight > offsetDivTable[offsetIndex] && updateAreaHexWidth > offsetModTable[offsetIndex]) {
-            int tile = upperLeftTile + offsetTable[parity][offsetIndex];
-            ObjectListNode* objectListNode = hexGridTileIsValid(tile)
-                ? objectTable[tile]
-                : NULL;
+    for (int i = 0; i < drawTilesLength; i++) {
+        ObjectDrawTile* drawTile = &(drawTiles[i]);
+        if (drawTile->x < minX || drawTile->x > maxX || drawTile->y < minY || drawTile->y > maxY) {
+            continue;
+        }
+
+        ObjectListNode* objectListNode = objectTable[drawTile->tile];
+
+        int lightIntensity;
+        if (objectListNode != NULL) {
+            lightIntensity = std::max(ambientIntensity, light_get_tile(elevation, objectListNode->obj->tile));
+        }
 
-            int lightIntensity;
-            if (objectListNode != NULL) {
-                lightIntensity = std::max(ambientIntensity, light_get_tile(elevation, objectListNode->obj->tile));
+        while (objectListNode != NULL) {
+            if (elevation < objectListNode->obj->elevation) {
+                break;
             }
 
-            while (objectListNode != NULL) {
-                if (elevation < objectListNode->obj->elevation) {
+            if (elevation == objectListNode->obj->elevation) {
+                if ((objectListNode->obj->flags & OBJECT_FLAT) == 0) {
                     break;
                 }
 
-                if (elevation == objectListNode->obj->elevation) {
-                    if ((objectListNode->obj->flags & OBJECT_FLAT) == 0) {
-                        break;
-                    }
-
-                    if ((objectListNode->obj->flags & OBJECT_HIDDEN) == 0) {
-                        obj_render_object(objectListNode->obj, &updatedRect, lightIntensity);
+                if ((objectListNode->obj->flags & OBJECT_HIDDEN) == 0) {
+                    obj_render_batch(objectListNode->obj, &updatedRect, lightIntensity);
 
-                        if ((objectListNode->obj->outline & OUTLINE_TYPE_MASK) != 0) {
-                            if ((objectListNode->obj->outline & OUTLINE_DISABLED) == 0 && outlineCount < 100) {
-                                outlinedObjects[outlineCount++] = objectListNode->obj;
-                            }
+                    if ((objectListNode->obj->outline & OUTLINE_TYPE_MASK) != 0) {
+                        if ((objectListNode->obj->outline & OUTLINE_DISABLED) == 0 && outlineCount < 100) {
+                            outlinedObjects[outlineCount++] = objectListNode->obj;
                         }
                     }
                 }
-
-                objectListNode = objectListNode->next;
             }
 
-            if (objectListNode != NULL) {
-                renderTable[renderCount++] = objectListNode;
-            }
+            objectListNode = objectListNode->next;
+        }
+
+        if (objectListNode != NULL) {
+            renderTable[renderCount++] = objectListNode;
         }
     }
 
@@ -858,13 +947,13 @@ void obj_render_pre_roof(Rect* rect, int elevation)
                 break;
             }
 
-            if (elevation == objectListNode->obj->elevation) {
-                if ((objectListNode->obj->flags & OBJECT_HIDDEN) == 0) {
-                    obj_render_object(object, &updatedRect, lightIntensity);
+            if (elevation == object->elevation) {
+                if ((object->flags & OBJECT_HIDDEN) == 0) {
+                    obj_render_batch(object, &updatedRect, lightIntensity);
 
-                    if ((objectListNode->obj->outline & OUTLINE_TYPE_MASK) != 0) {
-                        if ((objectListNode->obj->outline & OUTLINE_DISABLED) == 0 && outlineCount < 100) {
-                            outlinedObjects[outlineCount++] = objectListNode->obj;
+                    if ((object->outline & OUTLINE_TYPE_MASK) != 0) {
+                        if ((object->outline & OUTLINE_DISABLED) == 0 && outlineCount < 100) {
+                            outlinedObjects[outlineCount++] = object;
                         }
                     }
                 }
@@ -873,6 +962,91 @@ void obj_render_pre_roof(Rect* rect, int elevation)
             objectListNode = objectListNode->next;
         }
     }
+
+    obj_render_flush(&updatedRect);
+}
+
+// Collects valid tiles of the whole update area in the same order original
+// `obj_render_pre_roof` visited them.
+static bool obj_draw_tiles_build(int elevation)
+{
+    if (drawTilesValid
+        && drawTilesCenterTile == tile_center_tile
+        && drawTilesElevation == elevation) {
+        return true;
+    }
+
+    if (drawTiles == NULL) {
+        drawTiles = (ObjectDrawTile*)mem_malloc(sizeof(*drawTiles) * updateHexArea);
+        if (drawTiles == NULL) {
+            return false;
+        }
+    }
+
+    drawTilesLength = 0;
+
+    int minX = buf_rect.ulx - 320;
+    int minY = buf_rect.uly - 240;
+    int maxX = buf_rect.lrx + 320;
+    int maxY = buf_rect.lry + 240;
+    int upperLeftTile = tile_num(minX, minY, elevation, true);
+    int updateAreaHexWidth = (maxX - minX + 1) / 32;
+    int updateAreaHexHeight = (maxY - minY + 1) / 12;
+
+    int parity = tile_center_tile & 1;
+    int* orders = orderTable[parity];
+
+    for (int i = 0; i < updateHexArea; i++) {
+        int offsetIndex = *orders++;
+        if (updateAreaHexHeight > offsetDivTable[offsetIndex] && updateAreaHexWidth > offsetModTable[offsetIndex]) {
+            int tile = upperLeftTile + offsetTable[parity][offsetIndex];
+            if (hexGridTileIsValid(tile)) {
+                ObjectDrawTile* drawTile = &(drawTiles[drawTilesLength++]);
+                drawTile->tile = tile;
+                tile_coord(tile, &(drawTile->x), &(drawTile->y), elevation);
+                drawTile->x += 16;
+                drawTile->y += 8;
+            }
+        }
+    }
+
+    drawTilesValid = true;
+    drawTilesCenterTile = tile_center_tile;
+    drawTilesElevation = elevation;
+
+    return true;
+}
+
+// Prepares object to be rasterized together with the rest of the batch. The
+// batch is drawn first when it's full or when its art locks leave no room in
+// the cache for this object.
+static void obj_render_batch(Object* object, Rect* rect, int light)
+{
+    if (drawCommandsLength == OBJ_RENDER_MAX_BATCH) {
+        obj_render_flush(rect);
+    }
+
+    int rc = obj_render_prepare(object, rect, light, &(drawCommands[drawCommandsLength]));
+    if (rc == -1 && drawCommandsLength != 0) {
+        obj_render_flush(rect);
+        rc = obj_render_prepare(object, rect, light, &(drawCommands[drawCommandsLength]));
+    }
+
+    if (rc == 1) {
+        drawCommandsLength++;
+    }
+}
+
+// Draws prepared objects in order and releases their art.
+static void obj_render_flush(Rect* rect)
+{
+    obj_render_commands(drawCommands, drawCommandsLength, rect, back_buf, buf_full);
+
+    for (int index = 0; index < drawCommandsLength; index++) {
+        obj_render_release(&(drawCommands[index]));
+    }
+
+    drawCommandsLength = 0;
 }
 
 // 0x47B5EC
@@ -1052,6 +1226,7 @@ int obj_copy(Object** a1, Object* a2)
     }
 
     obj_insert(objectListNode);
+    obj_blocking_update(objectListNode->obj, -1, objectListNode->obj->elevation, objectListNode->obj->flags);
 
     objectListNode->obj->id = new_obj_id();
 
@@ -1124,8 +1299,11 @@ int obj_disconnect(Object* obj, Rect* rect)
         mem_free(node);
     }
 
+    int oldTile = obj->tile;
     obj->tile = -1;
 
+    obj_blocking_update(obj, oldTile, obj->elevation, obj->flags);
+
     return 0;
 }
 
@@ -1282,9 +1460,12 @@ int obj_move(Object* a1, int a2, int a3, int elevation, Rect* a5)
             }
         }
 
+        int oldElevation = a1->elevation;
         a1->tile = -1;
         a1->elevation = elevation;
         v22 = 1;
+
+        obj_blocking_update(a1, tile, oldElevation, a1->flags);
     } else {
         if (elevation == a1->elevation) {
             if (a5 != NULL) {
@@ -1367,6 +1548,8 @@ int obj_move_to_tile(Object* obj, int tile, int elevation, Rect* rect)
         return -1;
     }
 
+    obj_light_batch_begin();
+
     Rect v23;
     int v5 = obj_adjust_light(obj, 1, rect);
     if (rect != NULL) {
@@ -1390,6 +1573,7 @@ int obj_move_to_tile(Object* obj, int tile, int elevation, Rect* rect)
     }
 
     if (obj_connect_to_tile(node, tile, elevation, rect) == -1) {
+        obj_light_batch_end(rect);
         return -1;
     }
 
@@ -1397,6 +1581,8 @@ int obj_move_to_tile(Object* obj, int tile, int elevation, Rect* rect)
         rect_min_bound(rect, &v23, rect);
     }
 
+    obj_light_batch_end(rect);
+
     if (obj == obj_dude) {
         ObjectListNode* objectListNode = objectTable[tile];
         while (objectListNode != NULL) {
@@ -1516,6 +1702,11 @@ int obj_change_fid(Object* obj, int fid, Rect* dirtyRect)
         obj->fid = fid;
     }
 
+    // CE: Object type is part of the tile index key.
+    if (hexGridTileIsValid(obj->tile)) {
+        obj_tile_index_refresh(obj->tile);
+    }
+
     return 0;
 }
 
@@ -1692,6 +1883,8 @@ void obj_rebuild_all_light()
 {
     light_reset_tiles();
 
+    obj_light_batch_begin();
+
     for (int tile = 0; tile < HEX_GRID_SIZE; tile++) {
         ObjectListNode* objectListNode = objectTable[tile];
         while (objectListNode != NULL) {
@@ -1699,6 +1892,8 @@ void obj_rebuild_all_light()
             objectListNode = objectListNode->next;
         }
     }
+
+    obj_light_batch_end(NULL);
 }
 
 // 0x47C878
@@ -1711,6 +1906,8 @@ int obj_set_light(Object* obj, int lightDistance, int lightIntensity, Rect* rect
         return -1;
     }
 
+    obj_light_batch_begin();
+
     v7 = obj_turn_off_light(obj, rect);
     if (lightIntensity > 0) {
         if (lightDistance >= 8) {
@@ -1731,6 +1928,8 @@ int obj_set_light(Object* obj, int lightDistance, int lightIntensity, Rect* rect
         obj->lightDistance = 0;
     }
 
+    obj_light_batch_end(rect);
+
     return v7;
 }
 
@@ -1816,9 +2015,12 @@ int obj_turn_on(Object* obj, Rect* rect)
         return -1;
     }
 
+    int oldFlags = obj->flags;
     obj->flags &= ~OBJECT_HIDDEN;
     obj->outline &= ~OUTLINE_DISABLED;
 
+    obj_blocking_update(obj, obj->tile, obj->elevation, oldFlags);
+
     if (obj_adjust_light(obj, 0, rect) == -1) {
         if (rect != NULL) {
             obj_bound(obj, rect);
@@ -1853,12 +2055,15 @@ int obj_turn_off(Object* object, Rect* rect)
         }
     }
 
+    int oldFlags = object->flags;
     object->flags |= OBJECT_HIDDEN;
 
     if ((object->outline & OUTLINE_TYPE_MASK) != 0) {
         object->outline |= OUTLINE_DISABLED;
     }
 
+    obj_blocking_update(object, object->tile, object->elevation, oldFlags);
+
     if (object == obj_dude) {
         if (rect != NULL) {
             Rect eggRect;
@@ -2091,12 +2296,14 @@ Object* obj_find_first()
 {
     find_elev = 0;
 
-    ObjectListNode* objectListNode;
-    for (find_tile = 0; find_tile < HEX_GRID_SIZE; find_tile++) {
+    ObjectListNode* objectListNode = NULL;
+    for (find_tile = obj_tile_index_next(objectTileMask, 0); find_tile < HEX_GRID_SIZE; find_tile = obj_tile_index_next(objectTileMask, find_tile + 1)) {
         objectListNode = objectTable[find_tile];
         if (objectListNode) {
             break;
         }
+
+        obj_tile_index_refresh(find_tile);
     }
 
     if (find_tile == HEX_GRID_SIZE) {
@@ -2127,6 +2334,11 @@ Object* obj_find_next()
 
     while (find_tile < HEX_GRID_SIZE) {
         if (objectListNode == NULL) {
+            find_tile = obj_tile_index_next(objectTileMask, find_tile);
+            if (find_tile == HEX_GRID_SIZE) {
+                break;
+            }
+
             objectListNode = objectTable[find_tile++];
         }
 
@@ -2150,7 +2362,9 @@ Object* obj_find_first_at(int elevation)
     find_elev = elevation;
     find_tile = 0;
 
-    for (find_tile = 0; find_tile < HEX_GRID_SIZE; find_tile++) {
+    // CE: Skip tiles without objects on this elevation.
+    const uint64_t* mask = obj_tile_index_elevation_mask(elevation);
+    for (find_tile = obj_tile_index_next(mask, 0); find_tile < HEX_GRID_SIZE; find_tile = obj_tile_index_next(mask, find_tile + 1)) {
         ObjectListNode* objectListNode = objectTable[find_tile];
         while (objectListNode != NULL) {
             Object* object = objectListNode->obj;
@@ -2179,6 +2393,11 @@ Object* obj_find_next_at()
 
     while (find_tile < HEX_GRID_SIZE) {
         if (objectListNode == NULL) {
+            find_tile = obj_tile_index_next(obj_tile_index_elevation_mask(find_elev), find_tile);
+            if (find_tile == HEX_GRID_SIZE) {
+                break;
+            }
+
             objectListNode = objectTable[find_tile++];
         }
 
@@ -2409,19 +2628,36 @@ int obj_create_list(int tile, int elevation, int objectType, Object*** objectLis
         return -1;
     }
 
+    // CE: Whole map lists only visit tiles that may have objects of this
+    // elevation and type.
+    const uint64_t* mask = NULL;
+    if (tile == -1) {
+        if (objectType < 0 || objectType >= OBJECT_TILE_MASK_TYPES) {
+            return 0;
+        }
+
+        mask = elevationIsValid(elevation) ? objectTypeTileMask[elevation][objectType] : objectTileMask;
+    }
+
     int count = 0;
     if (tile == -1) {
-        for (int index = 0; index < HEX_GRID_SIZE; index++) {
+        for (int index = obj_tile_index_next(mask, 0); index < HEX_GRID_SIZE; index = obj_tile_index_next(mask, index + 1)) {
+            bool found = false;
             ObjectListNode* objectListNode = objectTable[index];
             while (objectListNode != NULL) {
                 Object* obj = objectListNode->obj;
-                if ((obj->flags & OBJECT_HIDDEN) == 0
-                    && obj->elevation == elevation
-                    && FID_TYPE(obj->fid) == objectType) {
-                    count++;
+                if (obj->elevation == elevation && FID_TYPE(obj->fid) == objectType) {
+                    found = true;
+                    if ((obj->flags & OBJECT_HIDDEN) == 0) {
+                        count++;
+                    }
                 }
                 objectListNode = objectListNode->next;
             }
+
+            if (!found && mask != objectTileMask) {
+                obj_tile_index_refresh(index);
+            }
         }
     } else {
         ObjectListNode* objectListNode = objectTable[tile];
@@ -2446,7 +2682,7 @@ int obj_create_list(int tile, int elevation, int objectType, Object*** objectLis
     }
 
     if (tile == -1) {
-        for (int index = 0; index < HEX_GRID_SIZE; index++) {
+        for (int index = obj_tile_index_next(mask, 0); index < HEX_GRID_SIZE; index = obj_tile_index_next(mask, index + 1)) {
             ObjectListNode* objectListNode = objectTable[index];
             while (objectListNode) {
                 Object* obj = objectListNode->obj;
@@ -2510,93 +2746,93 @@ void translucent_trans_buf_to_buf(unsigned char* src, int srcWidth, int srcHeigh
 // 0x47D758
 void dark_trans_buf_to_buf(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destX, int destY, int destPitch, int light)
 {
-    unsigned char* sp = src;
     unsigned char* dp = dest + destPitch * destY + destX;
 
-    int srcStep = srcPitch - srcWidth;
-    int destStep = destPitch - srcWidth;
     // TODO: Name might be confusing.
     int lightModifier = light >> 9;
 
-    for (int y = 0; y < srcHeight; y++) {
-        for (int x = 0; x < srcWidth; x++) {
-            unsigned char b = *sp;
-            if (b != 0) {
-                if (b < 0xE5) {
-                    b = intensityColorTable[b][lightModifier];
-                }
-
-                *dp = b;
-            }
+    // CE: Gather the intensity column of this light level once. The table is
+    // indexed by color first, so per pixel lookups touch a new cache line
+    // every time.
+    unsigned char table[256];
+    obj_intensity_column(table, lightModifier);
+    for (int index = 0xE5; index < 256; index++) {
+        table[index] = index;
+    }
 
-            sp++;
-            dp++;
-        }
+    lut_trans_buf_to_buf(src, srcWidth, srcHeight, srcPitch, dp, destPitch, table);
+}
 
-        sp += srcStep;
-        dp += destStep;
+static void obj_intensity_column(unsigned char* table, int light)
+{
+    for (int index = 0; index < 256; index++) {
+        table[index] = intensityColorTable[index][light];
     }
 }
 
 // 0x47D7E4
 void dark_translucent_trans_buf_to_buf(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destX, int destY, int destPitch, int light, unsigned char* a10, unsigned char* a11)
 {
-    int srcStep = srcPitch - srcWidth;
-    int destStep = destPitch - srcWidth;
     int lightModifier = light >> 9;
 
     dest += destPitch * destY + destX;
 
+    unsigned char table[256];
+    obj_intensity_column(table, lightModifier);
+
     for (int y = 0; y < srcHeight; y++) {
-        for (int x = 0; x < srcWidth; x++) {
-            unsigned char srcByte = *src;
-            if (srcByte != 0) {
-                unsigned char destByte = *dest;
-                unsigned int index = a11[srcByte] << 8;
-                index = a10[index + destByte];
-                *dest = intensityColorTable[index][lightModifier];
+        int x = 0;
+        while (x < srcWidth) {
+            unsigned char srcByte = src[x];
+            if (srcByte == 0) {
+                x += buf_count_zero(src + x, srcWidth - x);
+                continue;
             }
 
-            src++;
-            dest++;
+            unsigned char destByte = dest[x];
+            unsigned int index = a11[srcByte] << 8;
+            index = a10[index + destByte];
+            dest[x] = table[index];
+            x++;
         }
 
-        src += srcStep;
-        dest += destStep;
+        src += srcPitch;
+        dest += destPitch;
     }
 }
 
 // 0x47D898
 void intensity_mask_buf_to_buf(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destPitch, unsigned char* mask, int maskPitch, int light)
 {
-    int srcStep = srcPitch - srcWidth;
-    int destStep = destPitch - srcWidth;
-    int maskStep = maskPitch - srcWidth;
     light >>= 9;
 
+    unsigned char table[256];
+    obj_intensity_column(table, light);
+
     for (int y = 0; y < srcHeight; y++) {
-        for (int x = 0; x < srcWidth; x++) {
-            unsigned char b = *src;
-            if (b != 0) {
-                b = intensityColorTable[b][light];
-                unsigned char m = *mask;
-                if (m != 0) {
-                    unsigned char d = *dest;
-                    int q = intensityColorTable[d][128 - m];
-                    m = intensityColorTable[b][m];
-                    b = colorMixAddTable[m][q];
-                }
-                *dest = b;
+        int x = 0;
+        while (x < srcWidth) {
+            unsigned char b = src[x];
+            if (b == 0) {
+                x += buf_count_zero(src + x, srcWidth - x);
+                continue;
             }
 
-            src++;
-            dest++;
-            mask++;
+            b = table[b];
+            unsigned char m = mask[x];
+            if (m != 0) {
+                unsigned char d = dest[x];
+                int q = intensityColorTable[d][128 - m];
+                m = intensityColorTable[b][m];
+                b = colorMixAddTable[m][q];
+            }
+            dest[x] = b;
+            x++;
         }
 
-        src += srcStep;
-        dest += destStep;
-        mask += maskStep;
+        src += srcPitch;
+        dest += destPitch;
+        mask += maskPitch;
     }
 }
 
@@ -2795,67 +3031,103 @@ void obj_delete_intersect_list(ObjectWithFlags** entriesPtr)
 // 0x47DE68
 void obj_set_seen(int tile)
 {
-    obj_seen[tile >> 3] |= 1 << (tile & 7);
+    int block = tile >> 3;
+    obj_seen[block >> 6] |= (uint64_t)1 << (block & 63);
+}
+
+// Ors `src` shifted by `offset` bits (towards higher blocks when positive)
+// into `dest`.
+static void obj_seen_shift_or(uint64_t* dest, const uint64_t* src, int offset)
+{
+    int wordOffset = offset >= 0 ? offset / 64 : -((-offset + 63) / 64);
+    int bitOffset = offset - wordOffset * 64;
+
+    for (int index = 0; index < OBJ_SEEN_WORDS; index++) {
+        int from = index - wordOffset;
+        uint64_t value = 0;
+        if (from >= 0 && from < OBJ_SEEN_WORDS) {
+            value = bitOffset != 0 ? src[from] << bitOffset : src[from];
+        }
+        if (bitOffset != 0 && from - 1 >= 0 && from - 1 < OBJ_SEEN_WORDS) {
+            value |= src[from - 1] >> (64 - bitOffset);
+        }
+        dest[index] |= value;
+    }
+}
+
+static void obj_seen_clip(uint64_t* mask)
+{
+    mask[OBJ_SEEN_WORDS - 1] &= ~(uint64_t)0 >> (OBJ_SEEN_WORDS * 64 - OBJ_SEEN_BLOCKS);
 }
 
 // 0x47DE84
 void obj_process_seen()
 {
-    int i;
-    int v7;
-    int v8;
-    int v5;
-    int v0;
-    int v3;
-    ObjectListNode* obj_entry;
-
-    memset(obj_seen_check, 0, 5001);
-
-    v0 = 400;
-    for (i = 0; i < 5001; i++) {
-        if (obj_seen[i] != 0) {
-            for (v3 = i - 400; v3 != v0; v3 += 25) {
-                if (v3 >= 0 && v3 < 5001) {
-                    obj_seen_check[v3] = -1;
-                    if (v3 > 0) {
-                        obj_seen_check[v3 - 1] = -1;
-                    }
-                    if (v3 < 5000) {
-                        obj_seen_check[v3 + 1] = -1;
-                    }
-                    if (v3 > 1) {
-                        obj_seen_check[v3 - 2] = -1;
-                    }
-                    if (v3 < 4999) {
-                        obj_seen_check[v3 + 2] = -1;
-                    }
-                }
+    uint64_t any = 0;
+    for (int index = 0; index < OBJ_SEEN_WORDS; index++) {
+        any |= obj_seen[index];
+    }
+
+    if (any == 0) {
+        return;
+    }
+
+    // Every seen block marks a window of 32 block rows (25 blocks per row of
+    // the hex grid) above and below it...
+    uint64_t rows[OBJ_SEEN_WORDS] = { 0 };
+    for (int offset = -400; offset < 400; offset += 25) {
+        obj_seen_shift_or(rows, obj_seen, offset);
+    }
+    obj_seen_clip(rows);
+
+    // ...widened by two blocks to each side.
+    uint64_t check[OBJ_SEEN_WORDS] = { 0 };
+    for (int offset = -2; offset <= 2; offset++) {
+        obj_seen_shift_or(check, rows, offset);
+    }
+    obj_seen_clip(check);
+
+    memset(obj_seen, 0, sizeof(obj_seen));
+
+    int elevation = obj_dude->elevation;
+    if (!elevationIsValid(elevation)) {
+        return;
+    }
+
+    const uint64_t* occupied = objectElevationTileMask[elevation];
+
+    for (int index = 0; index < OBJ_SEEN_WORDS; index++) {
+        uint64_t blocks = check[index] & ~obj_seen_done[elevation][index];
+        obj_seen_done[elevation][index] |= blocks;
+
+        while (blocks != 0) {
+            int bit = 0;
+            while ((blocks & ((uint64_t)1 << bit)) == 0) {
+                bit++;
             }
-        }
-        v0++;
-    }
-
-    v7 = 0;
-    for (i = 0; i < 5001; i++) {
-        if (obj_seen_check[i] != 0) {
-            v8 = 1;
-            for (v5 = v7; v5 < v7 + 8; v5++) {
-                if (v8 & obj_seen_check[i]) {
-                    if (v5 < 40000) {
-                        for (obj_entry = objectTable[v5]; obj_entry != NULL; obj_entry = obj_entry->next) {
-                            if (obj_entry->obj->elevation == obj_dude->elevation) {
-                                obj_entry->obj->flags |= OBJECT_SEEN;
-                            }
-                        }
+            blocks &= ~((uint64_t)1 << bit);
+
+            int tile = (index * 64 + bit) * 8;
+            if (tile >= HEX_GRID_SIZE) {
+                continue;
+            }
+
+            // Blocks are eight aligned so all of their tiles share a word of
+            // the tile index.
+            unsigned int tiles = (unsigned int)(occupied[tile >> 6] >> (tile & 63)) & 0xFF;
+            for (; tiles != 0; tiles >>= 1, tile++) {
+                if ((tiles & 1) == 0) {
+                    continue;
+                }
+
+                for (ObjectListNode* objectListNode = objectTable[tile]; objectListNode != NULL; objectListNode = objectListNode->next) {
+                    if (objectListNode->obj->elevation == elevation) {
+                        objectListNode->obj->flags |= OBJECT_SEEN;
                     }
                 }
-                v8 *= 2;
             }
         }
-        v7 += 8;
     }
-
-    memset(obj_seen, 0, 5001);
 }
 
 // 0x47DFC8
@@ -2931,33 +3203,26 @@ void obj_preload_art_cache(int flags)
         v11++;
     }
 
-    CacheEntry* cache_handle;
-    if (art_ptr_lock(*preload_list, &cache_handle) != NULL) {
-        art_ptr_unlock(cache_handle);
-    }
+    // CE: Original code loaded every art synchronously. Art is now read on
+    // cache loader thread while the rest of the map is being set up.
+    art_ptr_prefetch(*preload_list);
 
     for (int i = 1; i < v11; i++) {
         if (preload_list[i - 1] != preload_list[i]) {
-            if (art_ptr_lock(preload_list[i], &cache_handle) != NULL) {
-                art_ptr_unlock(cache_handle);
-            }
+            art_ptr_prefetch(preload_list[i]);
         }
     }
 
     for (int i = 0; i < 4096; i++) {
         if (arr[i] != 0) {
             int fid = art_id(OBJ_TYPE_TILE, i, 0, 0, 0);
-            if (art_ptr_lock(fid, &cache_handle) != NULL) {
-                art_ptr_unlock(cache_handle);
-            }
+            art_ptr_prefetch(fid);
         }
     }
 
     for (int i = v11; i < preload_list_index; i++) {
         if (preload_list[i - 1] != preload_list[i]) {
-            if (art_ptr_lock(preload_list[i], &cache_handle) != NULL) {
-                art_ptr_unlock(cache_handle);
-            }
+            art_ptr_prefetch(preload_list[i]);
         }
     }
 
@@ -2976,6 +3241,10 @@ static int obj_object_table_init()
         objectTable[tile] = NULL;
     }
 
+    memset(objectTileMask, 0, sizeof(objectTileMask));
+    memset(objectElevationTileMask, 0, sizeof(objectElevationTileMask));
+    memset(objectTypeTileMask, 0, sizeof(objectTypeTileMask));
+
     return 0;
 }
 
@@ -3637,6 +3906,84 @@ static void obj_insert(ObjectListNode* objectListNode)
 
     objectListNode->next = *objectListNodePtr;
     *objectListNodePtr = objectListNode;
+
+    obj_tile_index_add(objectListNode->obj);
+
+    // CE: Newcomers are not marked as seen yet.
+    Object* obj = objectListNode->obj;
+    if (hexGridTileIsValid(obj->tile) && elevationIsValid(obj->elevation)) {
+        int block = obj->tile >> 3;
+        obj_seen_done[obj->elevation][block >> 6] &= ~((uint64_t)1 << (block & 63));
+    }
+}
+
+static void obj_tile_index_add(Object* obj)
+{
+    int tile = obj->tile;
+    if (!hexGridTileIsValid(tile)) {
+        return;
+    }
+
+    uint64_t bit = (uint64_t)1 << (tile & 63);
+    objectTileMask[tile >> 6] |= bit;
+
+    if (elevationIsValid(obj->elevation)) {
+        objectElevationTileMask[obj->elevation][tile >> 6] |= bit;
+        objectTypeTileMask[obj->elevation][FID_TYPE(obj->fid)][tile >> 6] |= bit;
+    }
+}
+
+// Recomputes index bits of the tile from the objects currently in its bucket.
+static void obj_tile_index_refresh(int tile)
+{
+    uint64_t bit = (uint64_t)1 << (tile & 63);
+    int word = tile >> 6;
+
+    objectTileMask[word] &= ~bit;
+
+    for (int elevation = 0; elevation < ELEVATION_COUNT; elevation++) {
+        objectElevationTileMask[elevation][word] &= ~bit;
+        for (int type = 0; type < OBJECT_TILE_MASK_TYPES; type++) {
+            objectTypeTileMask[elevation][type][word] &= ~bit;
+        }
+    }
+
+    for (ObjectListNode* objectListNode = objectTable[tile]; objectListNode != NULL; objectListNode = objectListNode->next) {
+        obj_tile_index_add(objectListNode->obj);
+    }
+}
+
+static const uint64_t* obj_tile_index_elevation_mask(int elevation)
+{
+    // Objects with bogus elevation are only tracked in the tile mask.
+    return elevationIsValid(elevation) ? objectElevationTileMask[elevation] : objectTileMask;
+}
+
+// Returns first tile starting from the given one that has its bit set in the
+// mask, or HEX_GRID_SIZE if there is none.
+static int obj_tile_index_next(const uint64_t* mask, int tile)
+{
+    if (tile >= HEX_GRID_SIZE) {
+        return HEX_GRID_SIZE;
+    }
+
+    int word = tile >> 6;
+    uint64_t bits = mask[word] & (~(uint64_t)0 << (tile & 63));
+    while (bits == 0) {
+        word++;
+        if (word == OBJECT_TILE_MASK_WORDS) {
+            return HEX_GRID_SIZE;
+        }
+        bits = mask[word];
+    }
+
+    tile = word << 6;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        tile++;
+    }
+
+    return tile < HEX_GRID_SIZE ? tile : HEX_GRID_SIZE;
 }
 
 // 0x47F13C
@@ -3657,6 +4004,8 @@ static int obj_remove(ObjectListNode* a1, ObjectListNode* a2)
         scr_remove(a1->obj->sid);
     }
 
+    obj_blocking_changed(a1->obj);
+
     if (a1 != a2) {
         if (a2 != NULL) {
             a2->next = a1->next;
@@ -3694,6 +4043,9 @@ static int obj_connect_to_tile(ObjectListNode* node, int tile, int elevation, Re
         return -1;
     }
 
+    int oldTile = node->obj->tile;
+    int oldElevation = node->obj->elevation;
+
     node->obj->tile = tile;
     node->obj->elevation = elevation;
     node->obj->x = 0;
@@ -3702,6 +4054,8 @@ static int obj_connect_to_tile(ObjectListNode* node, int tile, int elevation, Re
 
     obj_insert(node);
 
+    obj_blocking_update(node->obj, oldTile, oldElevation, node->obj->flags);
+
     if (obj_adjust_light(node->obj, 0, rect) == -1) {
         if (rect != NULL) {
             obj_bound(node->obj, rect);
@@ -3734,12 +4088,15 @@ static int obj_adjust_light(Object* obj, int a2, Rect* rect)
         return -1;
     }
 
-    AdjustLightIntensityProc* adjustLightIntensity = a2 ? light_subtract_from_tile : light_add_to_tile;
-    adjustLightIntensity(obj->elevation, obj->tile, obj->lightIntensity);
+    int sign = a2 ? -1 : 1;
+    obj_light_add_delta(obj->elevation, obj->tile, sign * obj->lightIntensity);
 
     Rect objectRect;
     obj_bound(obj, &objectRect);
 
+    Rect ownRect;
+    rectCopy(&ownRect, &objectRect);
+
     if (obj->lightDistance > 8) {
         obj->lightDistance = 8;
     }
@@ -4347,7 +4704,7 @@ static int obj_adjust_light(Object* obj, int a2, Rect* rect)
                         }
 
                         if (v12) {
-                            adjustLightIntensity(obj->elevation, tile, v28[index]);
+                            obj_light_add_delta(obj->elevation, tile, sign * v28[index]);
                         }
                     }
                 }
@@ -4357,26 +4714,99 @@ static int obj_adjust_light(Object* obj, int a2, Rect* rect)
         }
     }
 
-    if (rect != NULL) {
-        Rect* lightDistanceRect = &(light_rect[obj->lightDistance]);
-        memcpy(rect, lightDistanceRect, sizeof(*lightDistanceRect));
+    Rect lightRect;
+    Rect* lightDistanceRect = &(light_rect[obj->lightDistance]);
+    memcpy(&lightRect, lightDistanceRect, sizeof(*lightDistanceRect));
 
-        int x;
-        int y;
-        tile_coord(obj->tile, &x, &y, obj->elevation);
-        x += 16;
-        y += 8;
+    int x;
+    int y;
+    tile_coord(obj->tile, &x, &y, obj->elevation);
+    x += 16;
+    y += 8;
+
+    x -= lightRect.lrx / 2;
+    y -= lightRect.lry / 2;
 
-        x -= rect->lrx / 2;
-        y -= rect->lry / 2;
+    rectOffset(&lightRect, x, y);
+    rect_min_bound(&lightRect, &objectRect, &lightRect);
 
-        rectOffset(rect, x, y);
-        rect_min_bound(rect, &objectRect, rect);
+    if (lightBatchDepth != 0) {
+        if (lightBatchHasRect) {
+            rect_min_bound(&lightBatchRect, &lightRect, &lightBatchRect);
+        } else {
+            rectCopy(&lightBatchRect, &lightRect);
+            lightBatchHasRect = true;
+        }
+
+        if (rect != NULL) {
+            rectCopy(rect, &ownRect);
+        }
+
+        return 0;
+    }
+
+    // Redraw the lit area only when the light actually shows on screen, for
+    // example a lamp carried in daylight does not.
+    bool changed = obj_light_flush();
+    if (rect != NULL) {
+        rectCopy(rect, changed ? &lightRect : &ownRect);
     }
 
     return 0;
 }
 
+static void obj_light_add_delta(int elevation, int tile, int intensity)
+{
+    if (lightDeltasLength == LIGHT_DELTAS_CAPACITY) {
+        if (light_apply_deltas(lightDeltas, lightDeltasLength)) {
+            lightBatchChanged = true;
+        }
+        lightDeltasLength = 0;
+    }
+
+    LightDelta* delta = &(lightDeltas[lightDeltasLength++]);
+    delta->elevation = elevation;
+    delta->tile = tile;
+    delta->intensity = intensity;
+}
+
+// Applies pending light deltas, returns true if visible light changed since
+// the previous flush.
+static bool obj_light_flush()
+{
+    bool changed = lightBatchChanged;
+    if (light_apply_deltas(lightDeltas, lightDeltasLength)) {
+        changed = true;
+    }
+
+    lightDeltasLength = 0;
+    lightBatchChanged = false;
+
+    return changed;
+}
+
+// Starts collecting light changes of several obj_adjust_light calls. Inside a
+// batch obj_adjust_light only reports the object bounds, the lit area is added
+// to the rect passed to obj_light_batch_end if the light changed visibly.
+static void obj_light_batch_begin()
+{
+    lightBatchDepth++;
+}
+
+static void obj_light_batch_end(Rect* rect)
+{
+    if (--lightBatchDepth != 0) {
+        return;
+    }
+
+    bool changed = obj_light_flush();
+    if (changed && rect != NULL && lightBatchHasRect) {
+        rect_min_bound(rect, &lightBatchRect, rect);
+    }
+
+    lightBatchHasRect = false;
+}
+
 // 0x4801A0
 static void obj_render_outline(Object* object, Rect* rect)
 {
@@ -4623,16 +5053,31 @@ static void obj_render_outline(Object* object, Rect* rect)
 
 // 0x480868
 static void obj_render_object(Object* object, Rect* rect, int light)
+{
+    // CE: Split into preparation and rasterization so that objects collected
+    // by `obj_render_pre_roof` can be rasterized on several threads.
+    ObjectDrawCommand command;
+    if (obj_render_prepare(object, rect, light, &command) == 1) {
+        obj_render_command(&command, rect, back_buf, buf_full);
+        obj_render_release(&command);
+    }
+}
+
+// Resolves frame, screen rect and drawing mode of the object clipped to
+// `rect`. Returns 1 if `command` is ready, it holds art locks until
+// `obj_render_release`. Returns 0 if there is nothing to draw and -1 if art
+// could not be locked.
+static int obj_render_prepare(Object* object, Rect* rect, int light, ObjectDrawCommand* command)
 {
     int type = FID_TYPE(object->fid);
     if (art_get_disable(type)) {
-        return;
+        return 0;
     }
 
     CacheEntry* cacheEntry;
     Art* art = art_ptr_lock(object->fid, &cacheEntry);
     if (art == NULL) {
-        return;
+        return -1;
     }
 
     int frameWidth = art_frame_width(art, object->frame, object->rotation);
@@ -4666,28 +5111,28 @@ static void obj_render_object(Object* object, Rect* rect, int light)
         object->sy = objectRect.uly;
     }
 
+    command->frameRect.ulx = object->sx;
+    command->frameRect.uly = object->sy;
+    command->frameRect.lrx = object->sx + frameWidth - 1;
+    command->frameRect.lry = object->sy + frameHeight - 1;
+
     if (rect_inside_bound(&objectRect, rect, &objectRect) != 0) {
         art_ptr_unlock(cacheEntry);
-        return;
+        return 0;
     }
 
-    unsigned char* src = art_frame_data(art, object->frame, object->rotation);
-    unsigned char* src2 = src;
-    int v50 = objectRect.ulx - object->sx;
-    int v49 = objectRect.uly - object->sy;
-    src += frameWidth * v49 + v50;
-    int objectWidth = objectRect.lrx - objectRect.ulx + 1;
-    int objectHeight = objectRect.lry - objectRect.uly + 1;
+    command->cacheEntry = cacheEntry;
+    command->data = art_frame_data(art, object->frame, object->rotation);
+    command->pitch = frameWidth;
+    command->rect = objectRect;
+    command->light = light;
+    command->blendTable = NULL;
+    command->grayTable = NULL;
+    command->eggCacheEntry = NULL;
 
     if (type == 6) {
-        trans_buf_to_buf(src,
-            objectWidth,
-            objectHeight,
-            frameWidth,
-            back_buf + buf_full * objectRect.uly + objectRect.ulx,
-            buf_full);
-        art_ptr_unlock(cacheEntry);
-        return;
+        command->kind = OBJECT_DRAW_TRANS;
+        return 1;
     }
 
     if (type == 2 || type == 3) {
@@ -4727,7 +5172,9 @@ static void obj_render_object(Object* object, Rect* rect, int light)
                 CacheEntry* eggHandle;
                 Art* egg = art_ptr_lock(obj_egg->fid, &eggHandle);
                 if (egg == NULL) {
-                    return;
+                    // CE: Original code leaked object art lock here.
+                    art_ptr_unlock(cacheEntry);
+                    return -1;
                 }
 
                 int eggWidth;
@@ -4757,50 +5204,13 @@ static void obj_render_object(Object* object, Rect* rect, int light)
 
                 Rect updatedEggRect;
                 if (rect_inside_bound(&eggRect, &objectRect, &updatedEggRect) == 0) {
-                    Rect rects[4];
-
-                    rects[0].ulx = objectRect.ulx;
-                    rects[0].uly = objectRect.uly;
-                    rects[0].lrx = objectRect.lrx;
-                    rects[0].lry = updatedEggRect.uly - 1;
-
-                    rects[1].ulx = objectRect.ulx;
-                    rects[1].uly = updatedEggRect.uly;
-                    rects[1].lrx = updatedEggRect.ulx - 1;
-                    rects[1].lry = updatedEggRect.lry;
-
-                    rects[2].ulx = updatedEggRect.lrx + 1;
-                    rects[2].uly = updatedEggRect.uly;
-                    rects[2].lrx = objectRect.lrx;
-                    rects[2].lry = updatedEggRect.lry;
-
-                    rects[3].ulx = objectRect.ulx;
-                    rects[3].uly = updatedEggRect.lry + 1;
-                    rects[3].lrx = objectRect.lrx;
-                    rects[3].lry = objectRect.lry;
-
-                    for (int i = 0; i < 4; i++) {
-                        Rect* v21 = &(rects[i]);
-                        if (v21->ulx <= v21->lrx && v21->uly <= v21->lry) {
-                            unsigned char* sp = src + frameWidth * (v21->uly - objectRect.uly) + (v21->ulx - objectRect.ulx);
-                            dark_trans_buf_to_buf(sp, v21->lrx - v21->ulx + 1, v21->lry - v21->uly + 1, frameWidth, back_buf, v21->ulx, v21->uly, buf_full, light);
-                        }
-                    }
-
-                    unsigned char* mask = art_frame_data(egg, 0, 0);
-                    intensity_mask_buf_to_buf(
-                        src + frameWidth * (updatedEggRect.uly - objectRect.uly) + (updatedEggRect.ulx - objectRect.ulx),
-                        updatedEggRect.lrx - updatedEggRect.ulx + 1,
-                        updatedEggRect.lry - updatedEggRect.uly + 1,
-                        frameWidth,
-                        back_buf + buf_full * updatedEggRect.uly + updatedEggRect.ulx,
-                        buf_full,
-                        mask + eggWidth * (updatedEggRect.uly - eggRect.uly) + (updatedEggRect.ulx - eggRect.ulx),
-                        eggWidth,
-                        light);
-                    art_ptr_unlock(eggHandle);
-                    art_ptr_unlock(cacheEntry);
-                    return;
+                    command->kind = OBJECT_DRAW_EGG;
+                    command->eggCacheEntry = eggHandle;
+                    command->eggData = art_frame_data(egg, 0, 0);
+                    command->eggPitch = eggWidth;
+                    command->eggFrameRect = eggRect;
+                    command->eggRect = updatedEggRect;
+                    return 1;
                 }
 
                 art_ptr_unlock(eggHandle);
@@ -4810,26 +5220,46 @@ static void obj_render_object(Object* object, Rect* rect, int light)
 
     switch (object->flags & OBJECT_FLAG_0xFC000) {
     case OBJECT_TRANS_RED:
-        dark_translucent_trans_buf_to_buf(src, objectWidth, objectHeight, frameWidth, back_buf, objectRect.ulx, objectRect.uly, buf_full, light, redBlendTable, commonGrayTable);
+        command->kind = OBJECT_DRAW_TRANSLUCENT;
+        command->blendTable = redBlendTable;
+        command->grayTable = commonGrayTable;
         break;
     case OBJECT_TRANS_WALL:
-        dark_translucent_trans_buf_to_buf(src, objectWidth, objectHeight, frameWidth, back_buf, objectRect.ulx, objectRect.uly, buf_full, 0x10000, wallBlendTable, commonGrayTable);
+        command->kind = OBJECT_DRAW_TRANSLUCENT;
+        command->light = 0x10000;
+        command->blendTable = wallBlendTable;
+        command->grayTable = commonGrayTable;
         break;
     case OBJECT_TRANS_GLASS:
-        dark_translucent_trans_buf_to_buf(src, objectWidth, objectHeight, frameWidth, back_buf, objectRect.ulx, objectRect.uly, buf_full, light, glassBlendTable, glassGrayTable);
+        command->kind = OBJECT_DRAW_TRANSLUCENT;
+        command->blendTable = glassBlendTable;
+        command->grayTable = glassGrayTable;
         break;
     case OBJECT_TRANS_STEAM:
-        dark_translucent_trans_buf_to_buf(src, objectWidth, objectHeight, frameWidth, back_buf, objectRect.ulx, objectRect.uly, buf_full, light, steamBlendTable, commonGrayTable);
+        command->kind = OBJECT_DRAW_TRANSLUCENT;
+        command->blendTable = steamBlendTable;
+        command->grayTable = commonGrayTable;
         break;
     case OBJECT_TRANS_ENERGY:
-        dark_translucent_trans_buf_to_buf(src, objectWidth, objectHeight, frameWidth, back_buf, objectRect.ulx, objectRect.uly, buf_full, light, energyBlendTable, commonGrayTable);
+        command->kind = OBJECT_DRAW_TRANSLUCENT;
+        command->blendTable = energyBlendTable;
+        command->grayTable = commonGrayTable;
         break;
     default:
-        dark_trans_buf_to_buf(src, objectWidth, objectHeight, frameWidth, back_buf, objectRect.ulx, objectRect.uly, buf_full, light);
+        command->kind = OBJECT_DRAW_DARK;
         break;
     }
 
-    art_ptr_unlock(cacheEntry);
+    return 1;
+}
+
+static void obj_render_release(ObjectDrawCommand* command)
+{
+    if (command->eggCacheEntry != NULL) {
+        art_ptr_unlock(command->eggCacheEntry);
+    }
+
+    art_ptr_unlock(command->cacheEntry);
 }
 
 // Updates fid according to current violence level.
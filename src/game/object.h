@@ -3,6 +3,7 @@
 
 #include "game/inventry.h"
 #include "game/map_defs.h"
+#include "game/object_blocking.h"
 #include "game/object_types.h"
 #include "plib/db/db.h"
 #include "plib/gnw/rect.h"
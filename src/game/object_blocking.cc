@@ -0,0 +1,87 @@
+#include "game/object_blocking.h"
+
+namespace fallout {
+
+static bool obj_blocking_relevant(Object* object, int tile, int flags);
+
+// CE: Incremented every time objects on the map start or stop blocking
+// movement or sight. Lets path finder reuse results while nothing has
+// changed.
+//
+// Kept apart from the rest of object module, so that invalidation rules can
+// be tested without the game.
+static unsigned int blocking_generation = 0;
+
+unsigned int obj_blocking_generation()
+{
+    return blocking_generation;
+}
+
+// Sets object flags. Flags which affect path finding and line of sight
+// (hidden, no block, open door etc.) of objects on the map must be changed
+// with this function or `obj_unset_flag`, so that cached paths are rebuilt.
+void obj_set_flag(Object* object, int flag)
+{
+    int oldFlags = object->flags;
+    object->flags |= flag;
+    obj_blocking_update(object, object->tile, object->elevation, oldFlags);
+}
+
+void obj_unset_flag(Object* object, int flag)
+{
+    int oldFlags = object->flags;
+    object->flags &= ~flag;
+    obj_blocking_update(object, object->tile, object->elevation, oldFlags);
+}
+
+// Must be called after changing state of an object on the map other than
+// flags and position, which decides whether paths can go through it (i.e.
+// door lock).
+void obj_blocking_changed(Object* object)
+{
+    if (obj_blocking_relevant(object, object->tile, object->flags)) {
+        blocking_generation++;
+    }
+}
+
+// Returns `true` if object with given tile and flags is seen by
+// `obj_blocking_at` or `obj_sight_blocking_at`.
+static bool obj_blocking_relevant(Object* object, int tile, int flags)
+{
+    if (tile == -1 || (flags & OBJECT_HIDDEN) != 0) {
+        return false;
+    }
+
+    switch (FID_TYPE(object->fid)) {
+    case OBJ_TYPE_CRITTER:
+        return (flags & OBJECT_NO_BLOCK) == 0;
+    case OBJ_TYPE_SCENERY:
+    case OBJ_TYPE_WALL:
+        return (flags & OBJECT_NO_BLOCK) == 0 || (flags & OBJECT_LIGHT_THRU) == 0;
+    }
+
+    return false;
+}
+
+// Bumps blocking generation if `object` was moved, or its flags changed, in
+// a way visible to path finder. Must be called by code changing object
+// position with position and flags the object had before the change.
+void obj_blocking_update(Object* object, int oldTile, int oldElevation, int oldFlags)
+{
+    bool wasRelevant = obj_blocking_relevant(object, oldTile, oldFlags);
+    bool isRelevant = obj_blocking_relevant(object, object->tile, object->flags);
+    if (!wasRelevant && !isRelevant) {
+        return;
+    }
+
+    if (wasRelevant == isRelevant
+        && oldTile == object->tile
+        && oldElevation == object->elevation
+        && ((oldFlags ^ object->flags) & OBJECT_BLOCKING_FLAGS) == 0) {
+        return;
+    }
+
+    blocking_generation++;
+}
+
+} // namespace fallout
@@ -0,0 +1,16 @@
+#ifndef FALLOUT_GAME_OBJECT_BLOCKING_H_
+#define FALLOUT_GAME_OBJECT_BLOCKING_H_
+
+#include "game/object_types.h"
+
+namespace fallout {
+
+unsigned int obj_blocking_generation();
+void obj_set_flag(Object* object, int flag);
+void obj_unset_flag(Object* object, int flag);
+void obj_blocking_changed(Object* object);
+void obj_blocking_update(Object* object, int oldTile, int oldElevation, int oldFlags);
+
+} // namespace fallout
+
+#endif /* FALLOUT_GAME_OBJECT_BLOCKING_H_ */
@@ -0,0 +1,284 @@
+#include "game/object_render.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "game/object.h"
+#include "plib/gnw/grbuf.h"
+
+namespace fallout {
+
+// Maximum number of extra threads rasterizing objects.
+#define OBJ_RENDER_MAX_THREADS 3
+
+// Rasterization is split between threads only when there is enough work to
+// offset synchronization.
+#define OBJ_RENDER_PARALLEL_MIN_COMMANDS 16
+#define OBJ_RENDER_PARALLEL_MIN_BAND_HEIGHT 64
+
+static int obj_render_threads_count();
+static void obj_render_threads_start(int threadsLength);
+static void obj_render_thread_run(int index, unsigned int job);
+
+// Number of extra threads requested with `obj_render_set_threads`, -1 means
+// one less than number of cores.
+static int renderThreadsRequested = -1;
+
+// Workers rasterizing horizontal bands of dirty rect, band 0 is done by the
+// calling thread. Started on first rect which is worth splitting.
+static std::thread* renderThreads[OBJ_RENDER_MAX_THREADS];
+static int renderThreadsLength = 0;
+static bool renderThreadsStarted = false;
+static std::mutex renderMutex;
+static std::condition_variable renderStarted;
+static std::condition_variable renderFinished;
+static Rect renderBands[OBJ_RENDER_MAX_THREADS + 1];
+static ObjectDrawCommand* renderCommands = NULL;
+static int renderCommandsLength = 0;
+static unsigned char* renderDest = NULL;
+static int renderDestPitch = 0;
+static unsigned int renderJob = 0;
+static int renderPending = 0;
+static bool renderRunning = false;
+
+// Draws part of prepared object within `clip`. Only touches `dest` rows
+// covered by `clip`.
+void obj_render_command(ObjectDrawCommand* command, Rect* clip, unsigned char* dest, int destPitch)
+{
+    Rect rect;
+    if (rect_inside_bound(&(command->rect), clip, &rect) != 0) {
+        return;
+    }
+
+    unsigned char* src = command->data
+        + command->pitch * (rect.uly - command->frameRect.uly)
+        + (rect.ulx - command->frameRect.ulx);
+    int width = rect.lrx - rect.ulx + 1;
+    int height = rect.lry - rect.uly + 1;
+
+    switch (command->kind) {
+    case OBJECT_DRAW_TRANS:
+        trans_buf_to_buf(src,
+            width,
+            height,
+            command->pitch,
+            dest + destPitch * rect.uly + rect.ulx,
+            destPitch);
+        break;
+    case OBJECT_DRAW_DARK:
+        dark_trans_buf_to_buf(src, width, height, command->pitch, dest, rect.ulx, rect.uly, destPitch, command->light);
+        break;
+    case OBJECT_DRAW_TRANSLUCENT:
+        dark_translucent_trans_buf_to_buf(src, width, height, command->pitch, dest, rect.ulx, rect.uly, destPitch, command->light, command->blendTable, command->grayTable);
+        break;
+    case OBJECT_DRAW_EGG: {
+        Rect* objectRect = &(command->rect);
+        Rect* eggRect = &(command->eggRect);
+        Rect rects[4];
+
+        rects[0].ulx = objectRect->ulx;
+        rects[0].uly = objectRect->uly;
+        rects[0].lrx = objectRect->lrx;
+        rects[0].lry = eggRect->uly - 1;
+
+        rects[1].ulx = objectRect->ulx;
+        rects[1].uly = eggRect->uly;
+        rects[1].lrx = eggRect->ulx - 1;
+        rects[1].lry = eggRect->lry;
+
+        rects[2].ulx = eggRect->lrx + 1;
+        rects[2].uly = eggRect->uly;
+        rects[2].lrx = objectRect->lrx;
+        rects[2].lry = eggRect->lry;
+
+        rects[3].ulx = objectRect->ulx;
+        rects[3].uly = eggRect->lry + 1;
+        rects[3].lrx = objectRect->lrx;
+        rects[3].lry = objectRect->lry;
+
+        for (int i = 0; i < 4; i++) {
+            Rect* v21 = &(rects[i]);
+            if (v21->ulx <= v21->lrx && v21->uly <= v21->lry) {
+                Rect part;
+                if (rect_inside_bound(v21, clip, &part) == 0) {
+                    unsigned char* sp = command->data
+                        + command->pitch * (part.uly - command->frameRect.uly)
+                        + (part.ulx - command->frameRect.ulx);
+                    dark_trans_buf_to_buf(sp, part.lrx - part.ulx + 1, part.lry - part.uly + 1, command->pitch, dest, part.ulx, part.uly, destPitch, command->light);
+                }
+            }
+        }
+
+        Rect part;
+        if (rect_inside_bound(eggRect, clip, &part) == 0) {
+            intensity_mask_buf_to_buf(
+                command->data + command->pitch * (part.uly - command->frameRect.uly) + (part.ulx - command->frameRect.ulx),
+                part.lrx - part.ulx + 1,
+                part.lry - part.uly + 1,
+                command->pitch,
+                dest + destPitch * part.uly + part.ulx,
+                destPitch,
+                command->eggData + command->eggPitch * (part.uly - command->eggFrameRect.uly) + (part.ulx - command->eggFrameRect.ulx),
+                command->eggPitch,
+                command->light);
+        }
+        break;
+    }
+    }
+}
+
+// Rasterizes prepared draw commands in order, splitting rect into horizontal
+// bands between render threads when it's worth it.
+void obj_render_commands(ObjectDrawCommand* commands, int length, Rect* rect, unsigned char* dest, int destPitch)
+{
+    int threadsLength = obj_render_threads_count();
+    int bandsLength = threadsLength + 1;
+    int height = rect->lry - rect->uly + 1;
+
+    if (threadsLength == 0
+        || length < OBJ_RENDER_PARALLEL_MIN_COMMANDS
+        || height < bandsLength * OBJ_RENDER_PARALLEL_MIN_BAND_HEIGHT) {
+        for (int index = 0; index < length; index++) {
+            obj_render_command(&(commands[index]), rect, dest, destPitch);
+        }
+        return;
+    }
+
+    if (!renderThreadsStarted) {
+        obj_render_threads_start(threadsLength);
+    }
+
+    // Bands never share rows of `dest`, so drawing order only matters within
+    // each band.
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+
+        int uly = rect->uly;
+        for (int band = 0; band < bandsLength; band++) {
+            int lry = rect->uly + height * (band + 1) / bandsLength - 1;
+            renderBands[band].ulx = rect->ulx;
+            renderBands[band].uly = uly;
+            renderBands[band].lrx = rect->lrx;
+            renderBands[band].lry = lry;
+            uly = lry + 1;
+        }
+
+        renderCommands = commands;
+        renderCommandsLength = length;
+        renderDest = dest;
+        renderDestPitch = destPitch;
+        renderPending = renderThreadsLength;
+        renderJob++;
+    }
+    renderStarted.notify_all();
+
+    for (int index = 0; index < length; index++) {
+        obj_render_command(&(commands[index]), &(renderBands[0]), dest, destPitch);
+    }
+
+    std::unique_lock<std::mutex> lock(renderMutex);
+    renderFinished.wait(lock, []() { return renderPending == 0; });
+}
+
+// Sets number of extra threads rasterizing objects, 0 disables banding, -1
+// restores default.
+void obj_render_set_threads(int threads)
+{
+    obj_render_threads_exit();
+
+    if (threads > OBJ_RENDER_MAX_THREADS) {
+        threads = OBJ_RENDER_MAX_THREADS;
+    }
+
+    renderThreadsRequested = threads;
+}
+
+void obj_render_threads_exit()
+{
+    if (!renderThreadsStarted) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        renderRunning = false;
+    }
+    renderStarted.notify_all();
+
+    for (int index = 0; index < renderThreadsLength; index++) {
+        renderThreads[index]->join();
+        delete renderThreads[index];
+        renderThreads[index] = NULL;
+    }
+
+    renderThreadsLength = 0;
+    renderThreadsStarted = false;
+}
+
+static int obj_render_threads_count()
+{
+    if (renderThreadsStarted) {
+        return renderThreadsLength;
+    }
+
+    if (renderThreadsRequested != -1) {
+        return renderThreadsRequested;
+    }
+
+    unsigned int concurrency = std::thread::hardware_concurrency();
+    int threadsLength = concurrency > 1 ? (int)concurrency - 1 : 0;
+    if (threadsLength > OBJ_RENDER_MAX_THREADS) {
+        threadsLength = OBJ_RENDER_MAX_THREADS;
+    }
+
+    return threadsLength;
+}
+
+static void obj_render_threads_start(int threadsLength)
+{
+    renderRunning = true;
+
+    for (int index = 0; index < threadsLength; index++) {
+        renderThreads[index] = new std::thread(obj_render_thread_run, index, renderJob);
+    }
+
+    renderThreadsLength = threadsLength;
+    renderThreadsStarted = true;
+}
+
+// Threads are started right before their first job, so the last job seen is
+// passed by the starting thread.
+static void obj_render_thread_run(int index, unsigned int job)
+{
+    std::unique_lock<std::mutex> lock(renderMutex);
+
+    while (1) {
+        renderStarted.wait(lock, [&job]() { return !renderRunning || renderJob != job; });
+        if (!renderRunning) {
+            break;
+        }
+
+        job = renderJob;
+        Rect band = renderBands[index + 1];
+        ObjectDrawCommand* commands = renderCommands;
+        int length = renderCommandsLength;
+        unsigned char* dest = renderDest;
+        int destPitch = renderDestPitch;
+
+        lock.unlock();
+
+        for (int commandIndex = 0; commandIndex < length; commandIndex++) {
+            obj_render_command(&(commands[commandIndex]), &band, dest, destPitch);
+        }
+
+        lock.lock();
+
+        renderPending--;
+        if (renderPending == 0) {
+            renderFinished.notify_one();
+        }
+    }
+}
+
+} // namespace fallout
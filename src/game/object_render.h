@@ -0,0 +1,49 @@
+#ifndef FALLOUT_GAME_OBJECT_RENDER_H_
+#define FALLOUT_GAME_OBJECT_RENDER_H_
+
+#include "game/cache.h"
+#include "plib/gnw/rect.h"
+
+namespace fallout {
+
+typedef enum ObjectDrawKind {
+    OBJECT_DRAW_TRANS,
+    OBJECT_DRAW_DARK,
+    OBJECT_DRAW_TRANSLUCENT,
+    OBJECT_DRAW_EGG,
+} ObjectDrawKind;
+
+// Object frame resolved by `obj_render_prepare`. Can be rasterized without
+// looking at object state, so it's safe to do on several threads.
+typedef struct ObjectDrawCommand {
+    ObjectDrawKind kind;
+    CacheEntry* cacheEntry;
+    unsigned char* data;
+    int pitch;
+
+    // Whole frame on screen.
+    Rect frameRect;
+
+    // Part of the frame that needs to be drawn.
+    Rect rect;
+
+    int light;
+    unsigned char* blendTable;
+    unsigned char* grayTable;
+
+    // Egg mask (`OBJECT_DRAW_EGG` only).
+    CacheEntry* eggCacheEntry;
+    unsigned char* eggData;
+    int eggPitch;
+    Rect eggFrameRect;
+    Rect eggRect;
+} ObjectDrawCommand;
+
+void obj_render_command(ObjectDrawCommand* command, Rect* clip, unsigned char* dest, int destPitch);
+void obj_render_commands(ObjectDrawCommand* commands, int length, Rect* rect, unsigned char* dest, int destPitch);
+void obj_render_set_threads(int threads);
+void obj_render_threads_exit();
+
+} // namespace fallout
+
+#endif /* FALLOUT_GAME_OBJECT_RENDER_H_ */
@@ -92,6 +92,10 @@ typedef enum ObjectFlags {
     OBJECT_EQUIPPED = OBJECT_IN_ANY_HAND | OBJECT_WORN,
     OBJECT_FLAG_0xFC000 = OBJECT_TRANS_ENERGY | OBJECT_TRANS_STEAM | OBJECT_TRANS_GLASS | OBJECT_TRANS_WALL | OBJECT_TRANS_NONE | OBJECT_TRANS_RED,
     OBJECT_OPEN_DOOR = OBJECT_SHOOT_THRU | OBJECT_LIGHT_THRU | OBJECT_NO_BLOCK,
+
+    // CE: Flags which decide whether object on the map blocks movement or
+    // sight, see `obj_set_flag`.
+    OBJECT_BLOCKING_FLAGS = OBJECT_HIDDEN | OBJECT_NO_BLOCK | OBJECT_MULTIHEX | OBJECT_LIGHT_THRU | OBJECT_SHOOT_THRU,
 } ObjectFlags;
 
 typedef enum CritterFlags {
@@ -0,0 +1,293 @@
+#include "game/path.h"
+
+#include "game/map_defs.h"
+#include "game/tile.h"
+#include "plib/gnw/memory.h"
+
+namespace fallout {
+
+// Initial number of nodes in path finder arena. The arena grows on demand up
+// to the number of tiles on elevation, so long paths do not fail because of
+// fixed limits.
+#define PATH_NODE_LIST_INITIAL_CAPACITY 2000
+
+// Maximum number of nodes `path_find` expands before giving up. Bounds
+// the cost of queries to unreachable destinations, which otherwise explore
+// every reachable tile. Original code gave up after 2000 nodes.
+#define PATH_MAX_CLOSED_NODES 10000
+
+typedef struct PathNode {
+    int tile;
+
+    // CE: Index of node in `path_nodes` this node was reached from, or -1
+    // for the starting node. Original code stored tile and looked it up with
+    // linear search over closed list.
+    int from;
+    // actual type is likely char
+    int rotation;
+    int field_C;
+    int field_10;
+} PathNode;
+
+static bool path_nodes_reserve(int capacity);
+static bool path_node_less(int index1, int index2);
+static void path_open_push(int* lengthPtr, int index);
+static int path_open_pop(int* lengthPtr);
+
+// Tiles already discovered by path finder, one bit per tile.
+//
+// 0x56A1E4
+static unsigned char seen[HEX_GRID_SIZE / 8];
+
+// CE: Path finder nodes (both open and closed), reused between calls. Replaces
+// fixed `dad` and `child` arrays.
+static PathNode* path_nodes = NULL;
+
+// Binary min-heap of open node indices ordered by estimated total cost. Has
+// the same capacity as `path_nodes`.
+static int* path_open = NULL;
+
+static int path_nodes_capacity = 0;
+
+// Finds path from `from` to `to` with A* and stores rotations of every step
+// in `rotations`. Returns number of steps, or 0 if there is no path.
+//
+// `callback` reports objects blocking a tile, the path goes through such
+// tile only if `passProc` allows it. `turnPenalty` makes paths with fewer
+// turns preferable (used outside of combat).
+//
+// CE: Extracted from `make_path_func`.
+int path_find(Object* object, int from, int to, unsigned char* rotations, bool turnPenalty, PathBuilderCallback* callback, PathPassProc* passProc)
+{
+    if (!path_nodes_reserve(PATH_NODE_LIST_INITIAL_CAPACITY)) {
+        return 0;
+    }
+
+    seen[from / 8] |= 1 << (from & 7);
+
+    int fromScreenX;
+    int fromScreenY;
+    tile_coord(from, &fromScreenX, &fromScreenY, object->elevation);
+
+    int toScreenX;
+    int toScreenY;
+    tile_coord(to, &toScreenX, &toScreenY, object->elevation);
+
+    PathNode* start = &(path_nodes[0]);
+    start->tile = from;
+    start->from = -1;
+    start->rotation = 0;
+    start->field_C = idist(fromScreenX, fromScreenY, toScreenX, toScreenY);
+    start->field_10 = 0;
+
+    int nodesLength = 1;
+    int openLength = 0;
+    path_open_push(&openLength, 0);
+
+    // CE: Original code scanned whole open list for the cheapest node and
+    // gave up after 2000 open or closed nodes, failing long paths.
+    int found = -1;
+    int closedLength = 0;
+    while (openLength != 0) {
+        int index = path_open_pop(&openLength);
+
+        PathNode temp = path_nodes[index];
+        if (temp.tile == to) {
+            found = index;
+            break;
+        }
+
+        closedLength++;
+        if (closedLength == PATH_MAX_CLOSED_NODES) {
+            break;
+        }
+
+        for (int rotation = 0; rotation < ROTATION_COUNT; rotation++) {
+            int tile = tile_num_in_direction(temp.tile, rotation, 1);
+            int bit = 1 << (tile & 7);
+            if ((seen[tile / 8] & bit) != 0) {
+                continue;
+            }
+
+            if (tile != to) {
+                Object* v24 = callback(object, tile, object->elevation);
+                if (v24 != NULL) {
+                    if (!passProc(object, v24)) {
+                        continue;
+                    }
+                }
+            }
+
+            // There is at most one node per tile, so arena never needs to
+            // grow past number of tiles.
+            if (nodesLength == path_nodes_capacity) {
+                int capacity = path_nodes_capacity * 2;
+                if (capacity > HEX_GRID_SIZE) {
+                    capacity = HEX_GRID_SIZE;
+                }
+
+                if (!path_nodes_reserve(capacity)) {
+                    openLength = 0;
+                    break;
+                }
+            }
+
+            seen[tile / 8] |= bit;
+
+            PathNode* v27 = &(path_nodes[nodesLength]);
+            v27->tile = tile;
+            v27->from = index;
+            v27->rotation = rotation;
+
+            int newX;
+            int newY;
+            tile_coord(tile, &newX, &newY, object->elevation);
+
+            v27->field_C = idist(newX, newY, toScreenX, toScreenY);
+            v27->field_10 = temp.field_10 + 50;
+
+            if (turnPenalty && temp.rotation != rotation) {
+                v27->field_10 += 10;
+            }
+
+            path_open_push(&openLength, nodesLength);
+            nodesLength++;
+        }
+    }
+
+    int length = 0;
+    if (found != -1) {
+        for (int index = found; path_nodes[index].from != -1; index = path_nodes[index].from) {
+            length++;
+        }
+
+        // Like original code keep the last steps of too long path.
+        if (length > PATH_MAX_LENGTH) {
+            length = PATH_MAX_LENGTH;
+        }
+
+        // Walk back from the destination filling rotations from the end, so
+        // they come out in start-to-end order.
+        if (rotations != NULL) {
+            int step = length;
+            for (int index = found; step > 0; index = path_nodes[index].from) {
+                step--;
+                rotations[step] = path_nodes[index].rotation & 0xFF;
+            }
+        }
+    }
+
+    // Every seen tile has a node, so clearing them is cheaper than clearing
+    // whole bitset on the next call.
+    for (int index = 0; index < nodesLength; index++) {
+        int tile = path_nodes[index].tile;
+        seen[tile / 8] &= ~(1 << (tile & 7));
+    }
+
+    return length;
+}
+
+// Frees path finder nodes.
+void path_exit()
+{
+    if (path_nodes != NULL) {
+        mem_free(path_nodes);
+        path_nodes = NULL;
+    }
+
+    if (path_open != NULL) {
+        mem_free(path_open);
+        path_open = NULL;
+    }
+
+    path_nodes_capacity = 0;
+}
+
+static bool path_nodes_reserve(int capacity)
+{
+    if (capacity <= path_nodes_capacity) {
+        return true;
+    }
+
+    PathNode* nodes = (PathNode*)mem_realloc(path_nodes, sizeof(*nodes) * capacity);
+    if (nodes == NULL) {
+        return false;
+    }
+    path_nodes = nodes;
+
+    int* open = (int*)mem_realloc(path_open, sizeof(*open) * capacity);
+    if (open == NULL) {
+        return false;
+    }
+    path_open = open;
+
+    path_nodes_capacity = capacity;
+
+    return true;
+}
+
+// Orders open nodes by estimated total cost. Ties are resolved in favor of
+// earlier discovered node.
+static bool path_node_less(int index1, int index2)
+{
+    PathNode* node1 = &(path_nodes[index1]);
+    PathNode* node2 = &(path_nodes[index2]);
+    int cost1 = node1->field_C + node1->field_10;
+    int cost2 = node2->field_C + node2->field_10;
+    return cost1 < cost2 || (cost1 == cost2 && index1 < index2);
+}
+
+static void path_open_push(int* lengthPtr, int index)
+{
+    int pos = *lengthPtr;
+    *lengthPtr += 1;
+
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!path_node_less(index, path_open[parent])) {
+            break;
+        }
+
+        path_open[pos] = path_open[parent];
+        pos = parent;
+    }
+
+    path_open[pos] = index;
+}
+
+static int path_open_pop(int* lengthPtr)
+{
+    int top = path_open[0];
+    int length = *lengthPtr - 1;
+    *lengthPtr = length;
+
+    if (length == 0) {
+        return top;
+    }
+
+    int last = path_open[length];
+    int pos = 0;
+    while (1) {
+        int child = pos * 2 + 1;
+        if (child >= length) {
+            break;
+        }
+
+        if (child + 1 < length && path_node_less(path_open[child + 1], path_open[child])) {
+            child++;
+        }
+
+        if (!path_node_less(path_open[child], last)) {
+            break;
+        }
+
+        path_open[pos] = path_open[child];
+        pos = child;
+    }
+
+    path_open[pos] = last;
+
+    return top;
+}
+
+} // namespace fallout
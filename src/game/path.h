@@ -0,0 +1,20 @@
+#ifndef FALLOUT_GAME_PATH_H_
+#define FALLOUT_GAME_PATH_H_
+
+#include "game/anim.h"
+
+namespace fallout {
+
+// Maximum number of steps `path_find` can produce. Longer paths are
+// truncated to the last `PATH_MAX_LENGTH` steps.
+#define PATH_MAX_LENGTH 800
+
+// Decides whether `object` can walk through `blocker` found on its way.
+typedef bool PathPassProc(Object* object, Object* blocker);
+
+int path_find(Object* object, int from, int to, unsigned char* rotations, bool turnPenalty, PathBuilderCallback* callback, PathPassProc* passProc);
+void path_exit();
+
+} // namespace fallout
+
+#endif /* FALLOUT_GAME_PATH_H_ */
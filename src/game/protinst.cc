@@ -1204,7 +1204,7 @@ static int set_door_state_closed(Object* a1, Object* a2)
 static int check_door_state(Object* a1, Object* a2)
 {
     if ((a1->data.scenery.door.openFlags & 0x01) == 0) {
-        a1->flags &= ~OBJECT_OPEN_DOOR;
+        obj_unset_flag(a1, OBJECT_OPEN_DOOR);
 
         // NOTE: Uninline.
         rebuild_all_light();
@@ -1239,7 +1239,7 @@ static int check_door_state(Object* a1, Object* a2)
         art_ptr_unlock(artHandle);
         return 0;
     } else {
-        a1->flags |= OBJECT_OPEN_DOOR;
+        obj_set_flag(a1, OBJECT_OPEN_DOOR);
 
         // NOTE: Uninline.
         rebuild_all_light();
@@ -1553,6 +1553,7 @@ int obj_lock(Object* object)
         break;
     case OBJ_TYPE_SCENERY:
         object->data.scenery.door.openFlags |= OBJ_LOCKED;
+        obj_blocking_changed(object);
         break;
     default:
         return -1;
@@ -1574,6 +1575,7 @@ int obj_unlock(Object* object)
         return 0;
     case OBJ_TYPE_SCENERY:
         object->data.scenery.door.openFlags &= ~OBJ_LOCKED;
+        obj_blocking_changed(object);
         return 0;
     }
 
@@ -1784,7 +1786,7 @@ int obj_attempt_placement(Object* obj, int tile, int elevation, int a4)
         }
     }
 
-    obj->flags &= ~OBJECT_HIDDEN;
+    obj_unset_flag(obj, OBJECT_HIDDEN);
 
     Rect temp;
     if (obj_move_to_tile(obj, newTile, elevation, &temp) != -1) {
@@ -780,6 +780,7 @@ int proto_dude_init(const char* path)
     }
 
     proto->critter.data.baseStats[STAT_DAMAGE_RESISTANCE_EMP] = 100;
+    stat_cache_invalidate(&(proto->critter.data));
     proto->critter.data.bodyType = 0;
     proto->critter.data.experience = 0;
     proto->critter.data.killType = 0;
@@ -792,7 +793,7 @@ int proto_dude_init(const char* path)
     }
 
     if ((obj_dude->flags & OBJECT_NO_BLOCK) != 0) {
-        obj_dude->flags &= ~OBJECT_NO_BLOCK;
+        obj_unset_flag(obj_dude, OBJECT_NO_BLOCK);
     }
 
     stat_recalc_derived(obj_dude);
@@ -1712,6 +1713,9 @@ int proto_find_free_subnode(int type, Proto** protoPtr)
 // 0x490438
 void proto_remove_all()
 {
+    // Critter stats are about to be freed.
+    stat_cache_reset();
+
     for (int type = 0; type < 6; type++) {
         ProtoList* protoList = &(protolists[type]);
 
@@ -305,6 +305,9 @@ typedef struct CritterProtoData {
     int bodyType; // d.body
     int experience;
     int killType;
+
+    // CE: Changes every time stats above change, see `stat_cache_invalidate`.
+    unsigned int statsVersion;
 } CritterProtoData;
 
 typedef struct CritterProto {
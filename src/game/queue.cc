@@ -1,5 +1,10 @@
 #include "game/queue.h"
 
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
 #include "game/actions.h"
 #include "game/critter.h"
 #include "game/display.h"
@@ -17,15 +22,45 @@
 
 namespace fallout {
 
+// Number of events allocated at once.
+#define QUEUE_POOL_BLOCK_SIZE 256
+
+#define QUEUE_INITIAL_BUCKET_COUNT 64
+
 typedef struct QueueListNode {
     // TODO: Make unsigned.
     int time;
     int type;
     Object* owner;
     void* data;
+
+    // CE: Insertion order, breaks ties between events scheduled for the
+    // same time.
+    unsigned int order;
+
+    // CE: Position in `queue` heap, -1 if node is not scheduled.
+    int heapIndex;
+
+    // CE: Links in owner bucket (`next` also links free nodes).
+    struct QueueListNode* prev;
     struct QueueListNode* next;
 } QueueListNode;
 
+typedef struct QueuePoolBlock {
+    struct QueuePoolBlock* next;
+    QueueListNode nodes[QUEUE_POOL_BLOCK_SIZE];
+} QueuePoolBlock;
+
+static QueueListNode* queue_node_alloc();
+static void queue_node_free(QueueListNode* node);
+static bool queue_insert(QueueListNode* node);
+static void queue_unlink(QueueListNode* node);
+static void queue_sift_up(int index);
+static void queue_sift_down(int index);
+static bool queue_node_less(QueueListNode* a, QueueListNode* b);
+static int queue_bucket_index(Object* owner);
+static void queue_rehash(int bucketsLength);
+static QueueListNode** queue_sorted(int* lengthPtr);
 static int queue_destroy(Object* obj, void* data);
 static int queue_explode(Object* obj, void* data);
 static int queue_explode_exit(Object* obj, void* data);
@@ -49,13 +84,31 @@ EventTypeDescription q_func[EVENT_TYPE_COUNT] = {
     { scr_map_q_process, NULL, NULL, NULL, true, NULL },
 };
 
+// CE: Scheduled events as binary min-heap ordered by time and insertion
+// order, which is the same order original sorted list had.
+//
 // 0x662F4C
-static QueueListNode* queue;
+static QueueListNode** queue = NULL;
+static int queueLength = 0;
+static int queueCapacity = 0;
+
+// Next insertion order.
+static unsigned int queueOrder = 0;
+
+// CE: Scheduled events hashed by owner, so that owner's events can be found
+// without visiting the whole queue. Number of buckets is a power of two.
+static QueueListNode** queueBuckets = NULL;
+static int queueBucketsLength = 0;
+
+// CE: Events are allocated from blocks and recycled through free list.
+static QueuePoolBlock* queuePool = NULL;
+static QueueListNode* queueFreeNodes = NULL;
 
 // 0x490670
 void queue_init()
 {
-    queue = NULL;
+    queueLength = 0;
+    queueOrder = 0;
 }
 
 // 0x490680
@@ -69,6 +122,26 @@ int queue_reset()
 int queue_exit()
 {
     queue_clear();
+
+    if (queue != NULL) {
+        mem_free(queue);
+        queue = NULL;
+    }
+    queueCapacity = 0;
+
+    if (queueBuckets != NULL) {
+        mem_free(queueBuckets);
+        queueBuckets = NULL;
+    }
+    queueBucketsLength = 0;
+
+    while (queuePool != NULL) {
+        QueuePoolBlock* next = queuePool->next;
+        mem_free(queuePool);
+        queuePool = next;
+    }
+    queueFreeNodes = NULL;
+
     return 0;
 }
 
@@ -80,33 +153,33 @@ int queue_load(DB_FILE* stream)
         return -1;
     }
 
-    queue = NULL;
-
-    QueueListNode** nextPtr = &queue;
+    // Events are saved in processing order, so insertion order of loaded
+    // events keeps it.
+    queueOrder = 0;
 
     int rc = 0;
     for (int index = 0; index < count; index += 1) {
-        QueueListNode* queueListNode = (QueueListNode*)mem_malloc(sizeof(*queueListNode));
+        QueueListNode* queueListNode = queue_node_alloc();
         if (queueListNode == NULL) {
             rc = -1;
             break;
         }
 
         if (db_freadInt(stream, &(queueListNode->time)) == -1) {
-            mem_free(queueListNode);
+            queue_node_free(queueListNode);
             rc = -1;
             break;
         }
 
         if (db_freadInt(stream, &(queueListNode->type)) == -1) {
-            mem_free(queueListNode);
+            queue_node_free(queueListNode);
             rc = -1;
             break;
         }
 
         int objectId;
         if (db_freadInt(stream, &objectId) == -1) {
-            mem_free(queueListNode);
+            queue_node_free(queueListNode);
             rc = -1;
             break;
         }
@@ -130,7 +203,7 @@ int queue_load(DB_FILE* stream)
         EventTypeDescription* eventTypeDescription = &(q_func[queueListNode->type]);
         if (eventTypeDescription->readProc != NULL) {
             if (eventTypeDescription->readProc(stream, &(queueListNode->data)) == -1) {
-                mem_free(queueListNode);
+                queue_node_free(queueListNode);
                 rc = -1;
                 break;
             }
@@ -138,81 +211,80 @@ int queue_load(DB_FILE* stream)
             queueListNode->data = NULL;
         }
 
-        queueListNode->next = NULL;
-
-        *nextPtr = queueListNode;
-        nextPtr = &(queueListNode->next);
-    }
-
-    if (rc == -1) {
-        while (queue != NULL) {
-            QueueListNode* next = queue->next;
+        queueListNode->order = queueOrder++;
 
-            EventTypeDescription* eventTypeDescription = &(q_func[queue->type]);
+        if (!queue_insert(queueListNode)) {
             if (eventTypeDescription->freeProc != NULL) {
-                eventTypeDescription->freeProc(queue->data);
+                eventTypeDescription->freeProc(queueListNode->data);
             }
-
-            mem_free(queue);
-
-            queue = next;
+            queue_node_free(queueListNode);
+            rc = -1;
+            break;
         }
     }
 
+    if (rc == -1) {
+        queue_clear();
+    }
+
     return rc;
 }
 
 // 0x4907F4
 int queue_save(DB_FILE* stream)
 {
-    QueueListNode* queueListNode;
-
-    int count = 0;
-
-    queueListNode = queue;
-    while (queueListNode != NULL) {
-        count += 1;
-        queueListNode = queueListNode->next;
+    int count;
+    QueueListNode** nodes = queue_sorted(&count);
+    if (nodes == NULL && count != 0) {
+        return -1;
     }
 
+    int rc = 0;
+
     if (db_fwriteInt(stream, count) == -1) {
-        return -1;
+        rc = -1;
     }
 
-    queueListNode = queue;
-    while (queueListNode != NULL) {
+    for (int index = 0; index < count && rc == 0; index++) {
+        QueueListNode* queueListNode = nodes[index];
         Object* object = queueListNode->owner;
         int objectId = object != NULL ? object->id : -2;
 
         if (db_fwriteInt(stream, queueListNode->time) == -1) {
-            return -1;
+            rc = -1;
+            break;
         }
 
         if (db_fwriteInt(stream, queueListNode->type) == -1) {
-            return -1;
+            rc = -1;
+            break;
         }
 
         if (db_fwriteInt(stream, objectId) == -1) {
-            return -1;
+            rc = -1;
+            break;
         }
 
         EventTypeDescription* eventTypeDescription = &(q_func[queueListNode->type]);
         if (eventTypeDescription->writeProc != NULL) {
             if (eventTypeDescription->writeProc(stream, queueListNode->data) == -1) {
-                return -1;
+                rc = -1;
+                break;
             }
         }
+    }
 
-        queueListNode = queueListNode->next;
+    if (nodes != NULL) {
+        mem_free(nodes);
     }
 
-    return 0;
+    return rc;
 }
 
 // 0x4908A0
 int queue_add(int delay, Object* obj, void* data, int eventType)
 {
-    QueueListNode* newQueueListNode = (QueueListNode*)mem_malloc(sizeof(QueueListNode));
+    QueueListNode* newQueueListNode = queue_node_alloc();
     if (newQueueListNode == NULL) {
         return -1;
     }
@@ -228,49 +300,39 @@ int queue_add(int delay, Object* obj, void* data, int eventType)
         obj->flags |= OBJECT_USED;
     }
 
-    QueueListNode** v3 = &queue;
-
-    if (queue != NULL) {
-        QueueListNode* v4;
+    newQueueListNode->order = queueOrder++;
 
-        do {
-            v4 = *v3;
-            if (v2 < v4->time) {
-                break;
-            }
-            v3 = &(v4->next);
-        } while (v4->next != NULL);
+    if (!queue_insert(newQueueListNode)) {
+        queue_node_free(newQueueListNode);
+        return -1;
     }
 
-    newQueueListNode->next = *v3;
-    *v3 = newQueueListNode;
-
     return 0;
 }
 
 // 0x490908
 int queue_remove(Object* owner)
 {
-    QueueListNode* queueListNode = queue;
-    QueueListNode** queueListNodePtr = &queue;
+    if (queueBucketsLength == 0) {
+        return 0;
+    }
 
-    while (queueListNode) {
-        if (queueListNode->owner == owner) {
-            QueueListNode* temp = queueListNode;
+    QueueListNode* queueListNode = queueBuckets[queue_bucket_index(owner)];
+    while (queueListNode != NULL) {
+        QueueListNode* next = queueListNode->next;
 
-            queueListNode = queueListNode->next;
-            *queueListNodePtr = queueListNode;
+        if (queueListNode->owner == owner) {
+            queue_unlink(queueListNode);
 
-            EventTypeDescription* eventTypeDescription = &(q_func[temp->type]);
+            EventTypeDescription* eventTypeDescription = &(q_func[queueListNode->type]);
             if (eventTypeDescription->freeProc != NULL) {
-                eventTypeDescription->freeProc(temp->data);
+                eventTypeDescription->freeProc(queueListNode->data);
             }
 
-            mem_free(temp);
-        } else {
-            queueListNodePtr = &(queueListNode->next);
-            queueListNode = queueListNode->next;
+            queue_node_free(queueListNode);
         }
+
+        queueListNode = next;
     }
 
     return 0;
@@ -279,26 +341,26 @@ int queue_remove(Object* owner)
 // 0x490960
 int queue_remove_this(Object* owner, int eventType)
 {
-    QueueListNode* queueListNode = queue;
-    QueueListNode** queueListNodePtr = &queue;
+    if (queueBucketsLength == 0) {
+        return 0;
+    }
 
-    while (queueListNode) {
-        if (queueListNode->owner == owner && queueListNode->type == eventType) {
-            QueueListNode* temp = queueListNode;
+    QueueListNode* queueListNode = queueBuckets[queue_bucket_index(owner)];
+    while (queueListNode != NULL) {
+        QueueListNode* next = queueListNode->next;
 
-            queueListNode = queueListNode->next;
-            *queueListNodePtr = queueListNode;
+        if (queueListNode->owner == owner && queueListNode->type == eventType) {
+            queue_unlink(queueListNode);
 
-            EventTypeDescription* eventTypeDescription = &(q_func[temp->type]);
+            EventTypeDescription* eventTypeDescription = &(q_func[queueListNode->type]);
             if (eventTypeDescription->freeProc != NULL) {
-                eventTypeDescription->freeProc(temp->data);
+                eventTypeDescription->freeProc(queueListNode->data);
             }
 
-            mem_free(temp);
-        } else {
-            queueListNodePtr = &(queueListNode->next);
-            queueListNode = queueListNode->next;
+            queue_node_free(queueListNode);
         }
+
+        queueListNode = next;
     }
 
     return 0;
@@ -309,7 +371,11 @@ int queue_remove_this(Object* owner, int eventType)
 // 0x4909BC
 bool queue_find(Object* owner, int eventType)
 {
-    QueueListNode* queueListEvent = queue;
+    if (queueBucketsLength == 0) {
+        return false;
+    }
+
+    QueueListNode* queueListEvent = queueBuckets[queue_bucket_index(owner)];
     while (queueListEvent != NULL) {
         if (owner == queueListEvent->owner && eventType == queueListEvent->type) {
             return true;
@@ -327,13 +393,14 @@ int queue_process()
     int time = game_time();
     int v1 = 0;
 
-    while (queue != NULL) {
-        QueueListNode* queueListNode = queue;
+    while (queueLength != 0) {
+        QueueListNode* queueListNode = queue[0];
         if (time < queueListNode->time || v1 != 0) {
             break;
         }
 
-        queue = queueListNode->next;
+        // Handler is free to add or remove events.
+        queue_unlink(queueListNode);
 
         EventTypeDescription* eventTypeDescription = &(q_func[queueListNode->type]);
         v1 = eventTypeDescription->handlerProc(queueListNode->owner, queueListNode->data);
@@ -342,7 +409,7 @@ int queue_process()
             eventTypeDescription->freeProc(queueListNode->data);
         }
 
-        mem_free(queueListNode);
+        queue_node_free(queueListNode);
     }
 
     return v1;
@@ -351,52 +418,79 @@ int queue_process()
 // 0x490A5C
 void queue_clear()
 {
-    QueueListNode* queueListNode = queue;
-    while (queueListNode != NULL) {
-        QueueListNode* next = queueListNode->next;
+    for (int index = 0; index < queueLength; index++) {
+        QueueListNode* queueListNode = queue[index];
 
         EventTypeDescription* eventTypeDescription = &(q_func[queueListNode->type]);
         if (eventTypeDescription->freeProc != NULL) {
             eventTypeDescription->freeProc(queueListNode->data);
         }
 
-        mem_free(queueListNode);
-
-        queueListNode = next;
+        queue_node_free(queueListNode);
     }
 
-    queue = NULL;
+    queueLength = 0;
+
+    for (int index = 0; index < queueBucketsLength; index++) {
+        queueBuckets[index] = NULL;
+    }
 }
 
 // 0x490AA4
 void queue_clear_type(int eventType, QueueEventHandler* fn)
 {
-    QueueListNode** ptr = &queue;
-    QueueListNode* curr = *ptr;
-
-    while (curr != NULL) {
-        if (eventType == curr->type) {
-            QueueListNode* tmp = curr;
-
-            *ptr = curr->next;
-            curr = *ptr;
-
-            if (fn != NULL && fn(tmp->owner, tmp->data) != 1) {
-                *ptr = tmp;
-                ptr = &(tmp->next);
-            } else {
-                EventTypeDescription* eventTypeDescription = &(q_func[tmp->type]);
-                if (eventTypeDescription->freeProc != NULL) {
-                    eventTypeDescription->freeProc(tmp->data);
-                }
+    // Callbacks are called in processing order, same as original list walk.
+    // They can schedule or remove events, so every node is checked to still
+    // be the same scheduled event before it's touched.
+    int count;
+    QueueListNode** nodes = queue_sorted(&count);
+    if (nodes == NULL) {
+        return;
+    }
 
-                mem_free(tmp);
-            }
+    int length = 0;
+    for (int index = 0; index < count; index++) {
+        if (nodes[index]->type == eventType) {
+            nodes[length++] = nodes[index];
+        }
+    }
+
+    unsigned int* orders = (unsigned int*)mem_malloc(sizeof(*orders) * (length != 0 ? length : 1));
+    if (orders == NULL) {
+        mem_free(nodes);
+        return;
+    }
+
+    for (int index = 0; index < length; index++) {
+        orders[index] = nodes[index]->order;
+    }
+
+    for (int index = 0; index < length; index++) {
+        QueueListNode* tmp = nodes[index];
+        if (tmp->heapIndex == -1 || tmp->order != orders[index] || tmp->type != eventType) {
+            continue;
+        }
+
+        // Original code unlinked event before calling `fn` and put it back
+        // if it should be kept.
+        queue_unlink(tmp);
+
+        // NOTE: Kept event retains its insertion order, so it's processed
+        // at the same point as before. There is always room for it.
+        if (fn != NULL && fn(tmp->owner, tmp->data) != 1) {
+            queue_insert(tmp);
         } else {
-            ptr = &(curr->next);
-            curr = *ptr;
+            EventTypeDescription* eventTypeDescription = &(q_func[tmp->type]);
+            if (eventTypeDescription->freeProc != NULL) {
+                eventTypeDescription->freeProc(tmp->data);
+            }
+
+            queue_node_free(tmp);
         }
     }
+
+    mem_free(orders);
+    mem_free(nodes);
 }
 
 // TODO: Make unsigned.
@@ -404,11 +498,231 @@ void queue_clear_type(int eventType, QueueEventHandler* fn)
 // 0x490B1C
 int queue_next_time()
 {
-    if (queue == NULL) {
+    if (queueLength == 0) {
         return 0;
     }
 
-    return queue->time;
+    return queue[0]->time;
+}
+
+static QueueListNode* queue_node_alloc()
+{
+    if (queueFreeNodes == NULL) {
+        QueuePoolBlock* block = (QueuePoolBlock*)mem_malloc(sizeof(*block));
+        if (block == NULL) {
+            return NULL;
+        }
+
+        block->next = queuePool;
+        queuePool = block;
+
+        for (int index = QUEUE_POOL_BLOCK_SIZE - 1; index >= 0; index--) {
+            block->nodes[index].next = queueFreeNodes;
+            queueFreeNodes = &(block->nodes[index]);
+        }
+    }
+
+    QueueListNode* node = queueFreeNodes;
+    queueFreeNodes = node->next;
+
+    node->heapIndex = -1;
+    node->prev = NULL;
+    node->next = NULL;
+
+    return node;
+}
+
+static void queue_node_free(QueueListNode* node)
+{
+    node->heapIndex = -1;
+    node->prev = NULL;
+    node->next = queueFreeNodes;
+    queueFreeNodes = node;
+}
+
+// Schedules event according to its time. Events with equal time are
+// processed according to `order`, which must be set by caller.
+static bool queue_insert(QueueListNode* node)
+{
+    if (queueLength == queueCapacity) {
+        int capacity = queueCapacity != 0 ? queueCapacity * 2 : 256;
+        QueueListNode** nodes = (QueueListNode**)mem_realloc(queue, sizeof(*nodes) * capacity);
+        if (nodes == NULL) {
+            return false;
+        }
+
+        queue = nodes;
+        queueCapacity = capacity;
+    }
+
+    if (queueLength >= queueBucketsLength) {
+        queue_rehash(queueBucketsLength != 0 ? queueBucketsLength * 2 : QUEUE_INITIAL_BUCKET_COUNT);
+        if (queueBucketsLength == 0) {
+            return false;
+        }
+    }
+
+    node->heapIndex = queueLength;
+    queue[queueLength++] = node;
+    queue_sift_up(node->heapIndex);
+
+    QueueListNode** bucket = &(queueBuckets[queue_bucket_index(node->owner)]);
+    node->prev = NULL;
+    node->next = *bucket;
+    if (*bucket != NULL) {
+        (*bucket)->prev = node;
+    }
+    *bucket = node;
+
+    return true;
+}
+
+// Removes event from schedule without freeing it.
+static void queue_unlink(QueueListNode* node)
+{
+    int index = node->heapIndex;
+
+    queueLength--;
+    if (index != queueLength) {
+        QueueListNode* last = queue[queueLength];
+        queue[index] = last;
+        last->heapIndex = index;
+
+        if (index > 0 && queue_node_less(last, queue[(index - 1) / 2])) {
+            queue_sift_up(index);
+        } else {
+            queue_sift_down(index);
+        }
+    }
+
+    node->heapIndex = -1;
+
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        queueBuckets[queue_bucket_index(node->owner)] = node->next;
+    }
+
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    }
+
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+static void queue_sift_up(int index)
+{
+    QueueListNode* node = queue[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!queue_node_less(node, queue[parent])) {
+            break;
+        }
+
+        queue[index] = queue[parent];
+        queue[index]->heapIndex = index;
+        index = parent;
+    }
+
+    queue[index] = node;
+    node->heapIndex = index;
+}
+
+static void queue_sift_down(int index)
+{
+    QueueListNode* node = queue[index];
+    while (1) {
+        int child = index * 2 + 1;
+        if (child >= queueLength) {
+            break;
+        }
+
+        if (child + 1 < queueLength && queue_node_less(queue[child + 1], queue[child])) {
+            child++;
+        }
+
+        if (!queue_node_less(queue[child], node)) {
+            break;
+        }
+
+        queue[index] = queue[child];
+        queue[index]->heapIndex = index;
+        index = child;
+    }
+
+    queue[index] = node;
+    node->heapIndex = index;
+}
+
+static bool queue_node_less(QueueListNode* a, QueueListNode* b)
+{
+    if (a->time != b->time) {
+        return a->time < b->time;
+    }
+
+    return a->order < b->order;
+}
+
+static int queue_bucket_index(Object* owner)
+{
+    uintptr_t hash = (uintptr_t)owner;
+    hash ^= hash >> 16;
+    hash *= 0x45D9F3B;
+    hash ^= hash >> 16;
+    return (int)(hash & (queueBucketsLength - 1));
+}
+
+static void queue_rehash(int bucketsLength)
+{
+    QueueListNode** buckets = (QueueListNode**)mem_malloc(sizeof(*buckets) * bucketsLength);
+    if (buckets == NULL) {
+        // Keep old buckets, they are still valid, just longer.
+        return;
+    }
+
+    if (queueBuckets != NULL) {
+        mem_free(queueBuckets);
+    }
+
+    queueBuckets = buckets;
+    queueBucketsLength = bucketsLength;
+
+    for (int index = 0; index < bucketsLength; index++) {
+        queueBuckets[index] = NULL;
+    }
+
+    for (int index = 0; index < queueLength; index++) {
+        QueueListNode* node = queue[index];
+        QueueListNode** bucket = &(queueBuckets[queue_bucket_index(node->owner)]);
+        node->prev = NULL;
+        node->next = *bucket;
+        if (*bucket != NULL) {
+            (*bucket)->prev = node;
+        }
+        *bucket = node;
+    }
+}
+
+// Returns scheduled events in processing order. The result must be freed
+// with `mem_free`.
+static QueueListNode** queue_sorted(int* lengthPtr)
+{
+    *lengthPtr = queueLength;
+
+    if (queueLength == 0) {
+        return NULL;
+    }
+
+    QueueListNode** nodes = (QueueListNode**)mem_malloc(sizeof(*nodes) * queueLength);
+    if (nodes == NULL) {
+        return NULL;
+    }
+
+    memcpy(nodes, queue, sizeof(*nodes) * queueLength);
+    std::sort(nodes, nodes + queueLength, queue_node_less);
+
+    return nodes;
 }
 
 // 0x490B30
@@ -1,6 +1,8 @@
 #include "game/roll.h"
 
 #include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <random>
@@ -17,6 +19,9 @@ static int random_seed();
 static void seed_generator(int seed);
 static unsigned int timer_read();
 static void check_chi_squared();
+static void roll_stream_seed(int seed);
+static uint64_t roll_stream_next(RollStreamState* state);
+static int roll_stream_range(uint64_t value, int min, int max);
 
 // 0x507834
 static int iy = 0;
@@ -27,6 +32,19 @@ static int iv[32];
 // 0x662FD0
 static int idum;
 
+// CE: Marks stream positions at the end of saved games. Saves made without
+// them end right before this point.
+#define ROLL_STREAM_SAVE_MAGIC 0x524E4753
+
+// CE: Version of stream positions block, blocks written by newer versions are
+// ignored.
+#define ROLL_STREAM_SAVE_VERSION 1
+
+// SplitMix64 increment.
+#define ROLL_STREAM_GAMMA 0x9E3779B97F4A7C15ULL
+
+static RollStreamState roll_streams[ROLL_STREAM_COUNT];
+
 // 0x4913F0
 void roll_init()
 {
@@ -60,12 +78,64 @@ int roll_load(DB_FILE* stream)
     return 0;
 }
 
+// CE: Saves stream positions so that reloading replays the same outcomes.
+// Written after the rest of the game data, so builds which don't know about
+// streams can still read the save.
+int roll_stream_save(DB_FILE* stream)
+{
+    if (db_fwriteInt(stream, ROLL_STREAM_SAVE_MAGIC) == -1) return -1;
+    if (db_fwriteInt(stream, ROLL_STREAM_SAVE_VERSION) == -1) return -1;
+    if (db_fwriteInt(stream, ROLL_STREAM_COUNT) == -1) return -1;
+
+    for (int index = 0; index < ROLL_STREAM_COUNT; index++) {
+        RollStreamState* state = &(roll_streams[index]);
+        if (db_fwriteInt(stream, (int)(state->key >> 32)) == -1) return -1;
+        if (db_fwriteInt(stream, (int)state->key) == -1) return -1;
+        if (db_fwriteInt(stream, (int)(state->counter >> 32)) == -1) return -1;
+        if (db_fwriteInt(stream, (int)state->counter) == -1) return -1;
+    }
+
+    return 0;
+}
+
+// CE: Stream positions are optional, saves without them (or with unknown
+// version) keep streams seeded at startup.
+int roll_stream_load(DB_FILE* stream)
+{
+    int magic;
+    int version;
+    if (db_freadInt(stream, &magic) == -1
+        || magic != ROLL_STREAM_SAVE_MAGIC
+        || db_freadInt(stream, &version) == -1
+        || version != ROLL_STREAM_SAVE_VERSION) {
+        return 0;
+    }
+
+    int count;
+    if (db_freadInt(stream, &count) == -1) return -1;
+
+    for (int index = 0; index < count; index++) {
+        int values[4];
+        if (db_freadIntCount(stream, values, 4) == -1) return -1;
+
+        // Streams added by newer versions are skipped.
+        if (index < ROLL_STREAM_COUNT) {
+            RollStreamState* state = &(roll_streams[index]);
+            state->key = ((uint64_t)(unsigned int)values[0] << 32) | (unsigned int)values[1];
+            state->counter = ((uint64_t)(unsigned int)values[2] << 32) | (unsigned int)values[3];
+        }
+    }
+
+    return 0;
+}
+
 // Rolls d% against [difficulty].
 //
 // 0x491410
 int roll_check(int difficulty, int criticalSuccessModifier, int* howMuchPtr)
 {
-    int delta = difficulty - roll_random(1, 100);
+    // CE: Skill and attack rolls come from combat stream.
+    int delta = difficulty - roll_random_stream(ROLL_STREAM_COMBAT, 1, 100);
     int result = roll_check_critical(delta, criticalSuccessModifier);
 
     if (howMuchPtr != NULL) {
@@ -89,7 +159,7 @@ int roll_check_critical(int delta, int criticalSuccessModifier)
 
         if ((gameTime / GAME_TIME_TICKS_PER_DAY) >= 1) {
             // 10% to become critical failure.
-            if (roll_random(1, 100) <= -delta / 10) {
+            if (roll_random_stream(ROLL_STREAM_COMBAT, 1, 100) <= -delta / 10) {
                 roll = ROLL_CRITICAL_FAILURE;
             }
         }
@@ -98,7 +168,7 @@ int roll_check_critical(int delta, int criticalSuccessModifier)
 
         if ((gameTime / GAME_TIME_TICKS_PER_DAY) >= 1) {
             // 10% + modifier to become critical success.
-            if (roll_random(1, 100) <= delta / 10 + criticalSuccessModifier) {
+            if (roll_random_stream(ROLL_STREAM_COMBAT, 1, 100) <= delta / 10 + criticalSuccessModifier) {
                 roll = ROLL_CRITICAL_SUCCESS;
             }
         }
@@ -126,6 +196,100 @@ int roll_random(int min, int max)
     return result;
 }
 
+// CE: Returns random number in [min, max] range from the given stream.
+int roll_random_stream(int stream, int min, int max)
+{
+    if (stream < 0 || stream >= ROLL_STREAM_COUNT) {
+        return roll_random(min, max);
+    }
+
+    return roll_stream_random(&(roll_streams[stream]), min, max);
+}
+
+// CE: Fills `values` with `count` random numbers in [min, max] range from the
+// given stream, same as calling `roll_random_stream` `count` times.
+void roll_random_fill(int stream, int min, int max, int* values, int count)
+{
+    if (stream < 0 || stream >= ROLL_STREAM_COUNT) {
+        for (int index = 0; index < count; index++) {
+            values[index] = roll_random(min, max);
+        }
+        return;
+    }
+
+    roll_stream_fill(&(roll_streams[stream]), min, max, values, count);
+}
+
+// CE: Derives a new independent stream from the given one, which advances by
+// one value. The derived stream is owned by the caller and can be used off the
+// main thread with `roll_stream_random`.
+void roll_stream_split(int stream, RollStreamState* state)
+{
+    RollStreamState* parent = &(roll_streams[stream >= 0 && stream < ROLL_STREAM_COUNT ? stream : 0]);
+
+    state->key = roll_stream_next(parent) | 1;
+    state->counter = 0;
+}
+
+// CE: Returns random number in [min, max] range from the caller's stream.
+int roll_stream_random(RollStreamState* state, int min, int max)
+{
+    return roll_stream_range(roll_stream_next(state), min, max);
+}
+
+// CE: Fills `values` with `count` random numbers in [min, max] range from the
+// caller's stream, same as calling `roll_stream_random` `count` times.
+void roll_stream_fill(RollStreamState* state, int min, int max, int* values, int count)
+{
+    // Advance a local copy so the loop keeps state in registers.
+    RollStreamState local = *state;
+
+    for (int index = 0; index < count; index++) {
+        values[index] = roll_stream_range(roll_stream_next(&local), min, max);
+    }
+
+    *state = local;
+}
+
+// SplitMix64 output for the next counter value.
+static uint64_t roll_stream_next(RollStreamState* state)
+{
+    state->counter++;
+
+    uint64_t value = state->key + state->counter * ROLL_STREAM_GAMMA;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Maps high 32 bits of the value onto [min, max] with a multiply instead of
+// a modulo.
+static int roll_stream_range(uint64_t value, int min, int max)
+{
+    if (min > max) {
+        int tmp = min;
+        min = max;
+        max = tmp;
+    }
+
+    uint64_t range = (uint64_t)((int64_t)max - (int64_t)min + 1);
+    return (int)((int64_t)min + (int64_t)(((value >> 32) * range) >> 32));
+}
+
+// Seeds every stream from the same seed as the legacy generator, so fixed
+// seeds give reproducible streams too.
+static void roll_stream_seed(int seed)
+{
+    for (int index = 0; index < ROLL_STREAM_COUNT; index++) {
+        RollStreamState state;
+        state.key = (uint64_t)(unsigned int)seed;
+        state.counter = (uint64_t)index;
+
+        roll_streams[index].key = roll_stream_next(&state);
+        roll_streams[index].counter = 0;
+    }
+}
+
 // 0x49150C
 static int ran1(int max)
 {
@@ -194,6 +358,9 @@ static void seed_generator(int seed)
 
     iy = iv[0];
     idum = num;
+
+    // CE: Also reseed streams.
+    roll_stream_seed(seed);
 }
 
 // Provides seed for random number generator.
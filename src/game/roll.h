@@ -1,6 +1,8 @@
 #ifndef FALLOUT_GAME_ROLL_H_
 #define FALLOUT_GAME_ROLL_H_
 
+#include <stdint.h>
+
 #include "plib/db/db.h"
 
 namespace fallout {
@@ -12,6 +14,24 @@ typedef enum Roll {
     ROLL_CRITICAL_SUCCESS,
 } Roll;
 
+// CE: Independent random streams. Each one advances only when its own
+// subsystem draws from it, so outcomes in one do not depend on how many
+// numbers were taken by another.
+typedef enum RollStream {
+    ROLL_STREAM_COMBAT,
+    ROLL_STREAM_AI,
+    ROLL_STREAM_WORLDMAP,
+    ROLL_STREAM_SCRIPTS,
+    ROLL_STREAM_COUNT,
+} RollStream;
+
+// CE: Position of a counter-based stream. The n-th value is a pure function
+// of `key` and `n`, so a copy can be advanced on any thread and replayed.
+typedef struct RollStreamState {
+    uint64_t key;
+    uint64_t counter;
+} RollStreamState;
+
 void roll_init();
 int roll_reset();
 int roll_exit();
@@ -21,6 +41,13 @@ int roll_check(int difficulty, int criticalSuccessModifier, int* howMuchPtr);
 int roll_check_critical(int delta, int criticalSuccessModifier);
 int roll_random(int min, int max);
 void roll_set_seed(int seed);
+int roll_random_stream(int stream, int min, int max);
+void roll_random_fill(int stream, int min, int max, int* values, int count);
+void roll_stream_split(int stream, RollStreamState* state);
+int roll_stream_random(RollStreamState* state, int min, int max);
+void roll_stream_fill(RollStreamState* state, int min, int max, int* values, int count);
+int roll_stream_save(DB_FILE* stream);
+int roll_stream_load(DB_FILE* stream);
 
 } // namespace fallout
 
@@ -833,7 +833,7 @@ int scripts_check_state()
                     if (elevatorDoors != NULL) {
                         obj_set_frame(elevatorDoors, 0, NULL);
                         obj_move_to_tile(elevatorDoors, elevatorDoors->tile, elevatorDoors->elevation, NULL);
-                        elevatorDoors->flags &= ~OBJECT_OPEN_DOOR;
+                        obj_unset_flag(elevatorDoors, OBJECT_OPEN_DOOR);
                         elevatorDoors->data.scenery.door.openFlags &= ~0x01;
                         obj_rebuild_all_light();
                     } else {
@@ -855,7 +855,7 @@ int scripts_check_state()
                 if (elevatorDoors != NULL) {
                     obj_set_frame(elevatorDoors, 0, NULL);
                     obj_move_to_tile(elevatorDoors, elevatorDoors->tile, elevatorDoors->elevation, NULL);
-                    elevatorDoors->flags &= ~OBJECT_OPEN_DOOR;
+                    obj_unset_flag(elevatorDoors, OBJECT_OPEN_DOOR);
                     elevatorDoors->data.scenery.door.openFlags &= ~0x01;
                     obj_rebuild_all_light();
                 } else {
@@ -938,7 +938,7 @@ int scripts_check_state_in_combat()
                     if (elevatorDoors != NULL) {
                         obj_set_frame(elevatorDoors, 0, NULL);
                         obj_move_to_tile(elevatorDoors, elevatorDoors->tile, elevatorDoors->elevation, NULL);
-                        elevatorDoors->flags &= ~OBJECT_OPEN_DOOR;
+                        obj_unset_flag(elevatorDoors, OBJECT_OPEN_DOOR);
                         elevatorDoors->data.scenery.door.openFlags &= ~0x01;
                         obj_rebuild_all_light();
                     } else {
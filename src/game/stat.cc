@@ -1,9 +1,11 @@
 #include "game/stat.h"
 
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include <algorithm>
+#include <atomic>
 
 #include "game/combat.h"
 #include "game/critter.h"
@@ -22,11 +24,37 @@
 #include "game/tile.h"
 #include "game/trait.h"
 #include "platform_compat.h"
+#include "plib/gnw/debug.h"
 #include "plib/gnw/input.h"
 #include "plib/gnw/memory.h"
 
 namespace fallout {
 
+// Define to check every cached stat against values read from the proto.
+// #define STAT_CACHE_VERIFY
+
+#define STAT_CACHE_SIZE 64
+
+// CE: Cached `stat_level` results of a critter. Entries are valid only while
+// their epoch matches `stat_cache_epoch` and their version matches
+// `statsVersion` of the critter proto, which changes on every write to its
+// stats.
+typedef struct StatCacheEntry {
+    Object* critter;
+    int pid;
+    CritterProtoData* data;
+    unsigned int epoch;
+    unsigned int version;
+
+    // Final values, except for stats adjusted by `stat_level` on every call
+    // (see `stat_is_volatile`), which only have base, bonus and traits.
+    int values[SAVEABLE_STAT_COUNT];
+} StatCacheEntry;
+
+static StatCacheEntry* stat_cache_entry(Object* critter);
+static int stat_cache_value(Object* critter, CritterProtoData* data, int stat);
+static bool stat_is_volatile(int stat);
+
 // Provides metadata about stats.
 typedef struct StatDescription {
     char* name;
@@ -82,6 +110,18 @@ static StatDescription stat_data[STAT_COUNT] = {
     { NULL, NULL, 12, 0, 2000, 0 },
 };
 
+// CE: Every thread has its own cache, so `stat_level` can be called from AI
+// evaluator threads while the main thread waits for them.
+static thread_local StatCacheEntry stat_cache[STAT_CACHE_SIZE];
+
+// Bumped by `stat_cache_reset` to drop entries of every thread. Starts at 1
+// so zeroed entries never match.
+static std::atomic<unsigned int> stat_cache_epoch(1);
+
+// Next value of `statsVersion`, versions are never reused so that an entry
+// can't become valid again.
+static std::atomic<unsigned int> stat_cache_next_version(1);
+
 // 0x508258
 static StatDescription pc_stat_data[PC_STAT_COUNT] = {
     { NULL, NULL, 0, 0, INT_MAX, 0 },
@@ -182,33 +222,54 @@ int stat_save(DB_FILE* stream)
     return 0;
 }
 
+// CE: Safe to call from several threads as long as nothing modifies critters
+// or game state meanwhile.
+//
 // 0x49C4C8
 int stat_level(Object* critter, int stat)
 {
     int value;
     if (stat >= 0 && stat < SAVEABLE_STAT_COUNT) {
-        value = stat_get_base(critter, stat);
-        value += stat_get_bonus(critter, stat);
+        // CE: Stats which depend only on critter proto and traits come from
+        // the stat cache ready to use. The rest also depend on time or combat
+        // state and are adjusted below on every call.
+        StatCacheEntry* entry = stat_cache_entry(critter);
+        value = entry->values[stat];
+
+#ifdef STAT_CACHE_VERIFY
+        int expected = stat_cache_value(critter, entry->data, stat);
+        if (value != expected) {
+            debug_printf("\nError: stat_level: stale cached stat %d of %s: %d, expected %d", stat, critter_name(critter), value, expected);
+            value = expected;
+        }
+#endif
 
-        switch (stat) {
-        case STAT_PERCEPTION:
-            if ((critter->data.critter.combat.results & DAM_BLIND) != 0) {
-                value -= 5;
+        if (stat_is_volatile(stat)) {
+            // Night Person depends on time of day.
+            if (critter == obj_dude) {
+                value += trait_adjust_stat(stat);
             }
-            break;
-        case STAT_ARMOR_CLASS:
-            if (isInCombat()) {
-                if (combat_whose_turn() != critter) {
-                    value += critter->data.critter.combat.ap;
+
+            switch (stat) {
+            case STAT_PERCEPTION:
+                if ((critter->data.critter.combat.results & DAM_BLIND) != 0) {
+                    value -= 5;
+                }
+                break;
+            case STAT_ARMOR_CLASS:
+                if (isInCombat()) {
+                    if (combat_whose_turn() != critter) {
+                        value += critter->data.critter.combat.ap;
+                    }
                 }
+                break;
+            case STAT_AGE:
+                value += game_time() / GAME_TIME_TICKS_PER_YEAR;
+                break;
             }
-            break;
-        case STAT_AGE:
-            value += game_time() / GAME_TIME_TICKS_PER_YEAR;
-            break;
-        }
 
-        value = std::clamp(value, stat_data[stat].minimumValue, stat_data[stat].maximumValue);
+            value = std::clamp(value, stat_data[stat].minimumValue, stat_data[stat].maximumValue);
+        }
     } else {
         switch (stat) {
         case STAT_CURRENT_HIT_POINTS:
@@ -229,6 +290,82 @@ int stat_level(Object* critter, int stat)
     return value;
 }
 
+static StatCacheEntry* stat_cache_entry(Object* critter)
+{
+    uintptr_t hash = (uintptr_t)critter;
+    hash ^= hash >> 9;
+    StatCacheEntry* entry = &(stat_cache[(hash >> 4) % STAT_CACHE_SIZE]);
+
+    // Proto data never moves until `proto_remove_all`, which resets the
+    // cache, so it's safe to look at it once epoch matches.
+    unsigned int epoch = stat_cache_epoch.load(std::memory_order_relaxed);
+    if (entry->critter != critter
+        || entry->epoch != epoch
+        || entry->pid != critter->pid
+        || entry->version != entry->data->statsVersion) {
+        Proto* proto;
+        proto_ptr(critter->pid, &proto);
+
+        CritterProtoData* data = &(proto->critter.data);
+        for (int stat = 0; stat < SAVEABLE_STAT_COUNT; stat++) {
+            entry->values[stat] = stat_cache_value(critter, data, stat);
+        }
+
+        entry->critter = critter;
+        entry->pid = critter->pid;
+        entry->data = data;
+        entry->epoch = epoch;
+        entry->version = data->statsVersion;
+    }
+
+    return entry;
+}
+
+// Returns value of the stat as it's kept in the stat cache.
+static int stat_cache_value(Object* critter, CritterProtoData* data, int stat)
+{
+    int value = data->baseStats[stat] + data->bonusStats[stat];
+
+    if (!stat_is_volatile(stat)) {
+        if (critter == obj_dude) {
+            value += trait_adjust_stat(stat);
+        }
+
+        value = std::clamp(value, stat_data[stat].minimumValue, stat_data[stat].maximumValue);
+    }
+
+    return value;
+}
+
+// Returns `true` if `stat_level` of the stat depends on more than critter
+// proto and traits.
+static bool stat_is_volatile(int stat)
+{
+    switch (stat) {
+    case STAT_PERCEPTION:
+    case STAT_INTELLIGENCE:
+    case STAT_ARMOR_CLASS:
+    case STAT_AGE:
+        return true;
+    }
+
+    return false;
+}
+
+// Drops cached stats of critters using `data`, must be called after critter
+// proto stats are modified other than with `stat_set_base`/`stat_set_bonus`.
+void stat_cache_invalidate(CritterProtoData* data)
+{
+    data->statsVersion = stat_cache_next_version++;
+}
+
+// Drops all cached stats. Must be called when protos are freed or traits
+// change.
+void stat_cache_reset()
+{
+    stat_cache_epoch++;
+}
+
 // Returns base stat value (accounting for traits if critter is dude).
 //
 // 0x49C5B8
@@ -306,6 +443,7 @@ int stat_set_base(Object* critter, int stat, int value)
 
         proto_ptr(critter->pid, &proto);
         proto->critter.data.baseStats[stat] = value;
+        stat_cache_invalidate(&(proto->critter.data));
 
         if (stat >= STAT_STRENGTH && stat <= STAT_LUCK) {
             stat_recalc_derived(critter);
@@ -362,6 +500,7 @@ int stat_set_bonus(Object* critter, int stat, int value)
         Proto* proto;
         proto_ptr(critter->pid, &proto);
         proto->critter.data.bonusStats[stat] = value;
+        stat_cache_invalidate(&(proto->critter.data));
 
         if (stat >= STAT_STRENGTH && stat <= STAT_LUCK) {
             stat_recalc_derived(critter);
@@ -392,6 +531,8 @@ void stat_set_defaults(CritterProtoData* data)
         data->baseStats[stat] = stat_data[stat].defaultValue;
         data->bonusStats[stat] = 0;
     }
+
+    stat_cache_invalidate(data);
 }
 
 // 0x49C8D4
@@ -419,6 +560,8 @@ void stat_recalc_derived(Object* critter)
     data->baseStats[STAT_BETTER_CRITICALS] = 0;
     data->baseStats[STAT_RADIATION_RESISTANCE] = 2 * endurance;
     data->baseStats[STAT_POISON_RESISTANCE] = 5 * endurance;
+
+    stat_cache_invalidate(data);
 }
 
 // 0x49CA2C
@@ -18,11 +18,21 @@
 #include "plib/gnw/debug.h"
 #include "plib/gnw/grbuf.h"
 #include "plib/gnw/input.h"
+#include "plib/gnw/memory.h"
 
 namespace fallout {
 
 #define TILE_IS_VALID(tile) ((tile) >= 0 && (tile) < grid_size)
 
+// CE: Floor cache keeps lit floor squares in chunks of
+// `FLOOR_CACHE_CHUNK_SIZE` x `FLOOR_CACHE_CHUNK_SIZE` squares.
+#define FLOOR_CACHE_CHUNK_SIZE 8
+#define FLOOR_CACHE_CHUNK_SQUARES (FLOOR_CACHE_CHUNK_SIZE * FLOOR_CACHE_CHUNK_SIZE)
+#define FLOOR_CACHE_TILE_WIDTH 80
+#define FLOOR_CACHE_TILE_HEIGHT 36
+#define FLOOR_CACHE_TILE_SIZE (FLOOR_CACHE_TILE_WIDTH * FLOOR_CACHE_TILE_HEIGHT)
+#define FLOOR_CACHE_VERTEX_COUNT 10
+
 typedef struct RightsideUpTableEntry {
     int field_0;
     int field_4;
@@ -51,12 +61,41 @@ typedef struct UpsideDownTriangle {
     int field_8;
 } UpsideDownTriangle;
 
+typedef struct FloorCacheSquare {
+    // Tile art id (without flags) this square was lit with, or -1 if it's
+    // not lit.
+    int frmId;
+    int tile;
+    int lightElevation;
+    unsigned int lightGeneration;
+    int intensity[FLOOR_CACHE_VERTEX_COUNT];
+} FloorCacheSquare;
+
+typedef struct FloorCacheChunk {
+    // Elevation of this chunk, or -1 if the slot is free.
+    int elevation;
+    int chunk;
+    unsigned int lastUsed;
+    FloorCacheSquare squares[FLOOR_CACHE_CHUNK_SQUARES];
+    // Lit pixels followed by opacity mask for every square.
+    unsigned char* pixels;
+} FloorCacheChunk;
+
 static void refresh_mapper(Rect* rect, int elevation);
 static void refresh_game(Rect* rect, int elevation);
 static bool tile_on_edge(int tile);
 static void roof_fill_on(int x, int y, int elevation);
 static void roof_fill_off(int x, int y, int elevation);
 static void roof_draw(int fid, int x, int y, Rect* rect, int light);
+static bool floor_clip(int x, int y, int frameWidth, int frameHeight, Rect* rect, int* destXPtr, int* destYPtr, int* frameXPtr, int* frameYPtr, int* widthPtr, int* heightPtr);
+static void floor_light_verticies(int elev, int tile);
+static void floor_light_blit(unsigned char* frameData, int frameWidth, int frameX, int frameY, int width, int height, unsigned char* dest, int destPitch);
+static void floor_cache_init(int windowWidth, int windowHeight);
+static void floor_cache_reset();
+static void floor_cache_free();
+static int floor_cache_chunk_span(int minX, int minY, int maxX, int maxY);
+static FloorCacheChunk* floor_cache_find(int elevation, int chunk);
+static void floor_cache_draw(int elevation, int squareTile, int frmId, int x, int y, Rect* rect);
 
 // 0x508330
 static bool borderInitialized = false;
@@ -168,6 +207,22 @@ static UpsideDownTriangle upside_down_triangles[5] = {
 // 0x665274
 static int intensity_map[3280];
 
+// CE: Lit floor squares, see `floor_cache_draw`. Has enough slots for every
+// chunk visible in the window, see `floor_cache_init`.
+static FloorCacheChunk* floor_cache = NULL;
+static int floor_cache_slots = 0;
+
+// CE: Value of `colorGetTablesGeneration` floor cache was lit with.
+static unsigned int floor_cache_color_generation;
+
+static unsigned int floor_cache_clock;
+
+// CE: Number of floor squares drawn from the floor cache.
+static unsigned int floor_cache_hits;
+
+// CE: Number of floor squares lit into the floor cache.
+static unsigned int floor_cache_misses;
+
 // Deltas to perform tile calculations in given direction.
 //
 // 0x6685B4
@@ -278,6 +333,8 @@ int tile_init(TileData** a1, int squareGridWidth, int squareGridHeight, int hexG
     int v24;
     int v25;
 
+    floor_cache_init(windowWidth, windowHeight);
+
     square_width = squareGridWidth;
     squares = a1;
     grid_length = hexGridHeight;
@@ -460,6 +517,7 @@ void tile_reset()
 // 0x49DE80
 void tile_exit()
 {
+    floor_cache_free();
 }
 
 // 0x49DE8C
@@ -1418,6 +1476,18 @@ void square_render_floor(Rect* rect, int elevation)
 
     light_get_ambient();
 
+    // CE: Lit squares depend on intensity table, drop them all when palette
+    // changes.
+    if (floor_cache_color_generation != colorGetTablesGeneration()) {
+        floor_cache_reset();
+    }
+
+    // CE: Chunks of this rect would evict each other if they don't fit into
+    // floor cache, light squares directly then.
+    int spanMaxX = maxX < square_width ? maxX : square_width - 1;
+    int spanMaxY = maxY < square_length ? maxY : square_length - 1;
+    bool cached = floor_cache_chunk_span(minX, minY, spanMaxX, spanMaxY) <= floor_cache_slots;
+
     int baseSquareTile = square_width * minY;
 
     for (int y = minY; y <= maxY; y++) {
@@ -1428,8 +1498,11 @@ void square_render_floor(Rect* rect, int elevation)
                 int tileScreenX;
                 int tileScreenY;
                 square_coord(squareTile, &tileScreenX, &tileScreenY, elevation);
-                int fid = art_id(OBJ_TYPE_TILE, frmId & 0xFFF, 0, 0, 0);
-                floor_draw(fid, tileScreenX, tileScreenY, &constrainedRect);
+                if (cached) {
+                    floor_cache_draw(elevation, squareTile, frmId & 0xFFF, tileScreenX, tileScreenY, &constrainedRect);
+                } else {
+                    floor_draw(art_id(OBJ_TYPE_TILE, frmId & 0xFFF, 0, 0, 0), tileScreenX, tileScreenY, &constrainedRect);
+                }
             }
         }
         baseSquareTile += square_width;
@@ -1585,35 +1658,184 @@ void draw_grid(int tile, int elevation, Rect* rect)
         commonGrayTable);
 }
 
-// 0x49FB64
-void floor_draw(int fid, int x, int y, Rect* rect)
+// Computes light of the vertices of the floor square drawn at `tile`.
+static void floor_light_verticies(int elev, int tile)
 {
-    if (art_get_disable(FID_TYPE(fid)) != 0) {
-        return;
+    int parity = tile & 1;
+    int ambientIntensity = light_get_ambient();
+    for (int i = 0; i < 10; i++) {
+        // NOTE: calling light_get_tile two times, probably a result of using __min kind macro
+        int tileIntensity = light_get_tile(elev, tile + verticies[i].offsets[parity]);
+        if (tileIntensity <= ambientIntensity) {
+            tileIntensity = ambientIntensity;
+        }
+
+        verticies[i].intensity = tileIntensity;
     }
+}
 
-    CacheEntry* cacheEntry;
-    Art* art = art_ptr_lock(fid, &cacheEntry);
-    if (art == NULL) {
+// Draws `width` x `height` pixels of floor frame starting at `frameX`,
+// `frameY` to `dest`, lit by `verticies`.
+static void floor_light_blit(unsigned char* frameData, int frameWidth, int frameX, int frameY, int width, int height, unsigned char* dest, int destPitch)
+{
+    int v23 = 0;
+    for (int i = 0; i < 9; i++) {
+        if (verticies[i + 1].intensity != verticies[i].intensity) {
+            break;
+        }
+
+        v23++;
+    }
+
+    if (v23 == 9) {
+        dark_trans_buf_to_buf(frameData + frameWidth * frameY + frameX, width, height, frameWidth, dest, 0, 0, destPitch, verticies[0].intensity);
         return;
     }
 
-    int elev = map_elevation;
+    for (int i = 0; i < 5; i++) {
+        RightsideUpTriangle* triangle = &(rightside_up_triangles[i]);
+        int v32 = verticies[triangle->field_8].intensity;
+        int v33 = verticies[triangle->field_8].field_0;
+        int v34 = verticies[triangle->field_4].intensity - verticies[triangle->field_0].intensity;
+        // TODO: Probably wrong.
+        int v35 = v34 / 32;
+        int v36 = (verticies[triangle->field_0].intensity - v32) / 13;
+        int* v37 = &(intensity_map[v33]);
+        if (v35 != 0) {
+            if (v36 != 0) {
+                for (int i = 0; i < 13; i++) {
+                    int v41 = v32;
+                    int v42 = rightside_up_table[i].field_4;
+                    v37 += rightside_up_table[i].field_0;
+                    for (int j = 0; j < v42; j++) {
+                        *v37++ = v41;
+                        v41 += v35;
+                    }
+                    v32 += v36;
+                }
+            } else {
+                for (int i = 0; i < 13; i++) {
+                    int v38 = v32;
+                    int v39 = rightside_up_table[i].field_4;
+                    v37 += rightside_up_table[i].field_0;
+                    for (int j = 0; j < v39; j++) {
+                        *v37++ = v38;
+                        v38 += v35;
+                    }
+                }
+            }
+        } else {
+            if (v36 != 0) {
+                for (int i = 0; i < 13; i++) {
+                    int v46 = rightside_up_table[i].field_4;
+                    v37 += rightside_up_table[i].field_0;
+                    for (int j = 0; j < v46; j++) {
+                        *v37++ = v32;
+                    }
+                    v32 += v36;
+                }
+            } else {
+                for (int i = 0; i < 13; i++) {
+                    int v44 = rightside_up_table[i].field_4;
+                    v37 += rightside_up_table[i].field_0;
+                    for (int j = 0; j < v44; j++) {
+                        *v37++ = v32;
+                    }
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 5; i++) {
+        UpsideDownTriangle* triangle = &(upside_down_triangles[i]);
+        int v50 = verticies[triangle->field_0].intensity;
+        int v51 = verticies[triangle->field_0].field_0;
+        int v52 = verticies[triangle->field_8].intensity - v50;
+        // TODO: Probably wrong.
+        int v53 = v52 / 32;
+        int v54 = (verticies[triangle->field_4].intensity - v50) / 13;
+        int* v55 = &(intensity_map[v51]);
+        if (v53 != 0) {
+            if (v54 != 0) {
+                for (int i = 0; i < 13; i++) {
+                    int v59 = v50;
+                    int v60 = upside_down_table[i].field_4;
+                    v55 += upside_down_table[i].field_0;
+                    for (int j = 0; j < v60; j++) {
+                        *v55++ = v59;
+                        v59 += v53;
+                    }
+                    v50 += v54;
+                }
+            } else {
+                for (int i = 0; i < 13; i++) {
+                    int v56 = v50;
+                    int v57 = upside_down_table[i].field_4;
+                    v55 += upside_down_table[i].field_0;
+                    for (int j = 0; j < v57; j++) {
+                        *v55++ = v56;
+                        v56 += v53;
+                    }
+                }
+            }
+        } else {
+            if (v54 != 0) {
+                for (int i = 0; i < 13; i++) {
+                    int v64 = upside_down_table[i].field_4;
+                    v55 += upside_down_table[i].field_0;
+                    for (int j = 0; j < v64; j++) {
+                        *v55++ = v50;
+                    }
+                    v50 += v54;
+                }
+            } else {
+                for (int i = 0; i < 13; i++) {
+                    int v62 = upside_down_table[i].field_4;
+                    v55 += upside_down_table[i].field_0;
+                    for (int j = 0; j < v62; j++) {
+                        *v55++ = v50;
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned char* v66 = dest;
+    unsigned char* v67 = frameData + frameWidth * frameY + frameX;
+    int* v68 = &(intensity_map[160 + 80 * frameY]) + frameX;
+    int v86 = frameWidth - width;
+    int v85 = destPitch - width;
+    int v87 = 80 - width;
+
+    while (--height != -1) {
+        for (int kk = 0; kk < width; kk++) {
+            if (*v67 != 0) {
+                *v66 = intensityColorTable[*v67][*v68 >> 9];
+            }
+            v67++;
+            v68++;
+            v66++;
+        }
+        v66 += v85;
+        v68 += v87;
+        v67 += v86;
+    }
+}
+
+// Clips floor frame drawn at `x`, `y` to `rect` and window buffer.
+//
+// Returns `false` if nothing is visible.
+static bool floor_clip(int x, int y, int frameWidth, int frameHeight, Rect* rect, int* destXPtr, int* destYPtr, int* frameXPtr, int* frameYPtr, int* widthPtr, int* heightPtr)
+{
     int left = rect->ulx;
     int top = rect->uly;
     int width = rect->lrx - rect->ulx + 1;
     int height = rect->lry - rect->uly + 1;
-    int frameWidth;
-    int frameHeight;
-    int tile;
     int v76;
     int v77;
     int v78;
     int v79;
 
-    int savedX = x;
-    int savedY = y;
-
     if (left < 0) {
         left = 0;
     }
@@ -1630,10 +1852,9 @@ void floor_draw(int fid, int x, int y, Rect* rect)
         height = buf_length - top;
     }
 
-    if (x >= buf_width || x > rect->lrx || y >= buf_length || y > rect->lry) goto out;
-
-    frameWidth = art_frame_width(art, 0, 0);
-    frameHeight = art_frame_length(art, 0, 0);
+    if (x >= buf_width || x > rect->lrx || y >= buf_length || y > rect->lry) {
+        return false;
+    }
 
     if (left < x) {
         v79 = 0;
@@ -1661,170 +1882,286 @@ void floor_draw(int fid, int x, int y, Rect* rect)
         }
     }
 
-    if (v77 <= 0 || v76 <= 0) goto out;
+    if (v77 <= 0 || v76 <= 0) {
+        return false;
+    }
+
+    *destXPtr = x;
+    *destYPtr = y;
+    *frameXPtr = v79;
+    *frameYPtr = v78;
+    *widthPtr = v77;
+    *heightPtr = v76;
 
-    tile = tile_num(savedX, savedY + 13, map_elevation);
-    if (tile != -1) {
-        int parity = tile & 1;
-        int ambientIntensity = light_get_ambient();
-        for (int i = 0; i < 10; i++) {
-            // NOTE: calling light_get_tile two times, probably a result of using __min kind macro
-            int tileIntensity = light_get_tile(elev, tile + verticies[i].offsets[parity]);
-            if (tileIntensity <= ambientIntensity) {
-                tileIntensity = ambientIntensity;
-            }
+    return true;
+}
+
+// 0x49FB64
+void floor_draw(int fid, int x, int y, Rect* rect)
+{
+    if (art_get_disable(FID_TYPE(fid)) != 0) {
+        return;
+    }
+
+    CacheEntry* cacheEntry;
+    Art* art = art_ptr_lock(fid, &cacheEntry);
+    if (art == NULL) {
+        return;
+    }
 
-            verticies[i].intensity = tileIntensity;
+    int frameWidth = art_frame_width(art, 0, 0);
+    int frameHeight = art_frame_length(art, 0, 0);
+    int destX;
+    int destY;
+    int frameX;
+    int frameY;
+    int width;
+    int height;
+    if (floor_clip(x, y, frameWidth, frameHeight, rect, &destX, &destY, &frameX, &frameY, &width, &height)) {
+        int tile = tile_num(x, y + 13, map_elevation);
+        if (tile != -1) {
+            floor_light_verticies(map_elevation, tile);
+            floor_light_blit(art_frame_data(art, 0, 0), frameWidth, frameX, frameY, width, height, buf + buf_full * destY + destX, buf_full);
         }
+    }
 
-        int v23 = 0;
-        for (int i = 0; i < 9; i++) {
-            if (verticies[i + 1].intensity != verticies[i].intensity) {
-                break;
-            }
+    art_ptr_unlock(cacheEntry);
+}
+
+// CE: Allocates floor cache slots for every chunk a window of given size
+// can show.
+static void floor_cache_init(int windowWidth, int windowHeight)
+{
+    floor_cache_free();
+
+    // Screen position of a square is `48 * x` and `12 * x` pixels away
+    // along mirrored column `x`, and `32 * y` and `24 * y` along row `y`.
+    // Inverting that gives number of columns and rows window spans, plus one
+    // on each side for squares partially covering its edges.
+    int columns = (3 * windowWidth + 4 * windowHeight) / 192 + 2;
+    int rows = (windowWidth + 4 * windowHeight) / 128 + 2;
+
+    // Spans are not aligned to chunks, so they can touch one more chunk
+    // than they cover.
+    int slots = ((columns - 1) / FLOOR_CACHE_CHUNK_SIZE + 2) * ((rows - 1) / FLOOR_CACHE_CHUNK_SIZE + 2);
+
+    floor_cache = (FloorCacheChunk*)mem_malloc(sizeof(*floor_cache) * slots);
+    if (floor_cache == NULL) {
+        // Every square is drawn with `floor_draw`.
+        return;
+    }
+
+    for (int index = 0; index < slots; index++) {
+        floor_cache[index].elevation = -1;
+        floor_cache[index].pixels = NULL;
+    }
+
+    floor_cache_slots = slots;
+    floor_cache_clock = 0;
+    floor_cache_color_generation = colorGetTablesGeneration();
+}
+
+// CE: Resets floor cache, keeping memory of its slots.
+static void floor_cache_reset()
+{
+    for (int index = 0; index < floor_cache_slots; index++) {
+        floor_cache[index].elevation = -1;
+    }
+
+    floor_cache_color_generation = colorGetTablesGeneration();
+}
+
+static void floor_cache_free()
+{
+    if (floor_cache == NULL) {
+        return;
+    }
 
-            v23++;
+    for (int index = 0; index < floor_cache_slots; index++) {
+        if (floor_cache[index].pixels != NULL) {
+            mem_free(floor_cache[index].pixels);
         }
+    }
+
+    mem_free(floor_cache);
+    floor_cache = NULL;
+    floor_cache_slots = 0;
+}
+
+// CE: Returns number of floor cache chunks covering squares in given range.
+static int floor_cache_chunk_span(int minX, int minY, int maxX, int maxY)
+{
+    if (maxX < minX || maxY < minY) {
+        return 0;
+    }
+
+    int columns = maxX / FLOOR_CACHE_CHUNK_SIZE - minX / FLOOR_CACHE_CHUNK_SIZE + 1;
+    int rows = maxY / FLOOR_CACHE_CHUNK_SIZE - minY / FLOOR_CACHE_CHUNK_SIZE + 1;
+    return columns * rows;
+}
+
+// CE: Returns slot of given chunk, reusing the least recently used one if
+// the chunk is not cached.
+static FloorCacheChunk* floor_cache_find(int elevation, int chunk)
+{
+    FloorCacheChunk* victim = NULL;
+
+    floor_cache_clock++;
 
-        if (v23 == 9) {
-            unsigned char* frame_data = art_frame_data(art, 0, 0);
-            dark_trans_buf_to_buf(frame_data + frameWidth * v78 + v79, v77, v76, frameWidth, buf, x, y, buf_full, verticies[0].intensity);
-            goto out;
+    for (int index = 0; index < floor_cache_slots; index++) {
+        FloorCacheChunk* slot = &(floor_cache[index]);
+        if (slot->elevation == elevation && slot->chunk == chunk) {
+            slot->lastUsed = floor_cache_clock;
+            return slot;
         }
 
-        for (int i = 0; i < 5; i++) {
-            RightsideUpTriangle* triangle = &(rightside_up_triangles[i]);
-            int v32 = verticies[triangle->field_8].intensity;
-            int v33 = verticies[triangle->field_8].field_0;
-            int v34 = verticies[triangle->field_4].intensity - verticies[triangle->field_0].intensity;
-            // TODO: Probably wrong.
-            int v35 = v34 / 32;
-            int v36 = (verticies[triangle->field_0].intensity - v32) / 13;
-            int* v37 = &(intensity_map[v33]);
-            if (v35 != 0) {
-                if (v36 != 0) {
-                    for (int i = 0; i < 13; i++) {
-                        int v41 = v32;
-                        int v42 = rightside_up_table[i].field_4;
-                        v37 += rightside_up_table[i].field_0;
-                        for (int j = 0; j < v42; j++) {
-                            *v37++ = v41;
-                            v41 += v35;
-                        }
-                        v32 += v36;
-                    }
-                } else {
-                    for (int i = 0; i < 13; i++) {
-                        int v38 = v32;
-                        int v39 = rightside_up_table[i].field_4;
-                        v37 += rightside_up_table[i].field_0;
-                        for (int j = 0; j < v39; j++) {
-                            *v37++ = v38;
-                            v38 += v35;
-                        }
-                    }
-                }
-            } else {
-                if (v36 != 0) {
-                    for (int i = 0; i < 13; i++) {
-                        int v46 = rightside_up_table[i].field_4;
-                        v37 += rightside_up_table[i].field_0;
-                        for (int j = 0; j < v46; j++) {
-                            *v37++ = v32;
-                        }
-                        v32 += v36;
-                    }
-                } else {
-                    for (int i = 0; i < 13; i++) {
-                        int v44 = rightside_up_table[i].field_4;
-                        v37 += rightside_up_table[i].field_0;
-                        for (int j = 0; j < v44; j++) {
-                            *v37++ = v32;
-                        }
-                    }
-                }
+        if (victim == NULL) {
+            victim = slot;
+        } else if (victim->elevation != -1) {
+            if (slot->elevation == -1 || slot->lastUsed < victim->lastUsed) {
+                victim = slot;
             }
         }
+    }
 
-        for (int i = 0; i < 5; i++) {
-            UpsideDownTriangle* triangle = &(upside_down_triangles[i]);
-            int v50 = verticies[triangle->field_0].intensity;
-            int v51 = verticies[triangle->field_0].field_0;
-            int v52 = verticies[triangle->field_8].intensity - v50;
-            // TODO: Probably wrong.
-            int v53 = v52 / 32;
-            int v54 = (verticies[triangle->field_4].intensity - v50) / 13;
-            int* v55 = &(intensity_map[v51]);
-            if (v53 != 0) {
-                if (v54 != 0) {
-                    for (int i = 0; i < 13; i++) {
-                        int v59 = v50;
-                        int v60 = upside_down_table[i].field_4;
-                        v55 += upside_down_table[i].field_0;
-                        for (int j = 0; j < v60; j++) {
-                            *v55++ = v59;
-                            v59 += v53;
-                        }
-                        v50 += v54;
-                    }
-                } else {
-                    for (int i = 0; i < 13; i++) {
-                        int v56 = v50;
-                        int v57 = upside_down_table[i].field_4;
-                        v55 += upside_down_table[i].field_0;
-                        for (int j = 0; j < v57; j++) {
-                            *v55++ = v56;
-                            v56 += v53;
-                        }
-                    }
-                }
-            } else {
-                if (v54 != 0) {
-                    for (int i = 0; i < 13; i++) {
-                        int v64 = upside_down_table[i].field_4;
-                        v55 += upside_down_table[i].field_0;
-                        for (int j = 0; j < v64; j++) {
-                            *v55++ = v50;
-                        }
-                        v50 += v54;
-                    }
-                } else {
-                    for (int i = 0; i < 13; i++) {
-                        int v62 = upside_down_table[i].field_4;
-                        v55 += upside_down_table[i].field_0;
-                        for (int j = 0; j < v62; j++) {
-                            *v55++ = v50;
-                        }
-                    }
-                }
-            }
+    if (victim->pixels == NULL) {
+        victim->pixels = (unsigned char*)mem_malloc(FLOOR_CACHE_CHUNK_SQUARES * FLOOR_CACHE_TILE_SIZE * 2);
+        if (victim->pixels == NULL) {
+            return NULL;
         }
+    }
+
+    victim->elevation = elevation;
+    victim->chunk = chunk;
+    victim->lastUsed = floor_cache_clock;
+
+    for (int index = 0; index < FLOOR_CACHE_CHUNK_SQUARES; index++) {
+        victim->squares[index].frmId = -1;
+    }
+
+    return victim;
+}
+
+// CE: Draws floor square the same way `floor_draw` does, but from lit
+// pixels kept in floor cache. The square is lit again only when its tile
+// art or light at any of its vertices has changed.
+static void floor_cache_draw(int elevation, int squareTile, int frmId, int x, int y, Rect* rect)
+{
+    if (art_get_disable(OBJ_TYPE_TILE) != 0) {
+        return;
+    }
+
+    // Nothing is drawn for squares outside of hex grid.
+    int tile = tile_num(x, y + 13, map_elevation);
+    if (tile == -1) {
+        return;
+    }
 
-        unsigned char* v66 = buf + buf_full * y + x;
-        unsigned char* v67 = art_frame_data(art, 0, 0) + frameWidth * v78 + v79;
-        int* v68 = &(intensity_map[160 + 80 * v78]) + v79;
-        int v86 = frameWidth - v77;
-        int v85 = buf_full - v77;
-        int v87 = 80 - v77;
-
-        while (--v76 != -1) {
-            for (int kk = 0; kk < v77; kk++) {
-                if (*v67 != 0) {
-                    *v66 = intensityColorTable[*v67][*v68 >> 9];
+    int destX;
+    int destY;
+    int frameX;
+    int frameY;
+    int width;
+    int height;
+
+    // Floor tiles are of standard size, so squares outside of the rect are
+    // skipped before they take a slot from visible ones.
+    if (!floor_clip(x, y, FLOOR_CACHE_TILE_WIDTH, FLOOR_CACHE_TILE_HEIGHT, rect, &destX, &destY, &frameX, &frameY, &width, &height)) {
+        return;
+    }
+
+    int squareX = squareTile % square_width;
+    int squareY = squareTile / square_width;
+    int chunk = (squareY / FLOOR_CACHE_CHUNK_SIZE) * ((square_width + FLOOR_CACHE_CHUNK_SIZE - 1) / FLOOR_CACHE_CHUNK_SIZE) + squareX / FLOOR_CACHE_CHUNK_SIZE;
+
+    FloorCacheChunk* slot = floor_cache_find(elevation, chunk);
+    if (slot == NULL) {
+        floor_draw(art_id(OBJ_TYPE_TILE, frmId, 0, 0, 0), x, y, rect);
+        return;
+    }
+
+    int index = (squareY % FLOOR_CACHE_CHUNK_SIZE) * FLOOR_CACHE_CHUNK_SIZE + squareX % FLOOR_CACHE_CHUNK_SIZE;
+    FloorCacheSquare* square = &(slot->squares[index]);
+    unsigned char* lit = slot->pixels + index * FLOOR_CACHE_TILE_SIZE * 2;
+    unsigned char* mask = lit + FLOOR_CACHE_TILE_SIZE;
+
+    unsigned int lightGeneration = light_get_generation();
+    bool valid = square->frmId == frmId && square->tile == tile && square->lightElevation == map_elevation;
+    if (valid) {
+        if (square->lightGeneration != lightGeneration) {
+            floor_light_verticies(map_elevation, tile);
+            for (int vertex = 0; vertex < FLOOR_CACHE_VERTEX_COUNT; vertex++) {
+                if (verticies[vertex].intensity != square->intensity[vertex]) {
+                    valid = false;
+                    break;
                 }
-                v67++;
-                v68++;
-                v66++;
             }
-            v66 += v85;
-            v68 += v87;
-            v67 += v86;
+
+            if (valid) {
+                square->lightGeneration = lightGeneration;
+            }
         }
     }
 
-out:
+    if (!valid) {
+        int fid = art_id(OBJ_TYPE_TILE, frmId, 0, 0, 0);
 
-    art_ptr_unlock(cacheEntry);
+        CacheEntry* cacheEntry;
+        Art* art = art_ptr_lock(fid, &cacheEntry);
+        if (art == NULL) {
+            return;
+        }
+
+        int frameWidth = art_frame_width(art, 0, 0);
+        int frameHeight = art_frame_length(art, 0, 0);
+        if (frameWidth != FLOOR_CACHE_TILE_WIDTH || frameHeight != FLOOR_CACHE_TILE_HEIGHT) {
+            art_ptr_unlock(cacheEntry);
+            square->frmId = -1;
+            floor_draw(fid, x, y, rect);
+            return;
+        }
+
+        unsigned char* frameData = art_frame_data(art, 0, 0);
+        floor_light_verticies(map_elevation, tile);
+        floor_light_blit(frameData, frameWidth, 0, 0, frameWidth, frameHeight, lit, FLOOR_CACHE_TILE_WIDTH);
+
+        // Lighting only writes opaque pixels, even if they end up lit to
+        // color 0.
+        for (int pixel = 0; pixel < FLOOR_CACHE_TILE_SIZE; pixel++) {
+            mask[pixel] = frameData[pixel] != 0 ? 0xFF : 0;
+        }
+
+        art_ptr_unlock(cacheEntry);
+
+        square->frmId = frmId;
+        square->tile = tile;
+        square->lightElevation = map_elevation;
+        square->lightGeneration = lightGeneration;
+        for (int vertex = 0; vertex < FLOOR_CACHE_VERTEX_COUNT; vertex++) {
+            square->intensity[vertex] = verticies[vertex].intensity;
+        }
+
+        floor_cache_misses++;
+    } else {
+        floor_cache_hits++;
+    }
+
+    mask_buf_to_buf(lit + FLOOR_CACHE_TILE_WIDTH * frameY + frameX,
+        width,
+        height,
+        FLOOR_CACHE_TILE_WIDTH,
+        mask + FLOOR_CACHE_TILE_WIDTH * frameY + frameX,
+        FLOOR_CACHE_TILE_WIDTH,
+        buf + buf_full * destY + destX,
+        buf_full);
+}
+
+// CE: Reports how many floor squares were drawn from floor cache and how
+// many had to be lit.
+void floor_cache_stats(unsigned int* hitsPtr, unsigned int* missesPtr)
+{
+    *hitsPtr = floor_cache_hits;
+    *missesPtr = floor_cache_misses;
 }
 
 // 0x4A01CC
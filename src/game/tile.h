@@ -60,6 +60,7 @@ void grid_render(Rect* rect, int elevation);
 void grid_draw(int tile, int elevation);
 void draw_grid(int tile, int elevation, Rect* rect);
 void floor_draw(int fid, int x, int y, Rect* rect);
+void floor_cache_stats(unsigned int* hitsPtr, unsigned int* missesPtr);
 int tile_make_line(int currentCenterTile, int newCenterTile, int* tiles, int tilesCapacity);
 int tile_scroll_to(int tile, int flags);
 
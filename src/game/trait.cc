@@ -98,6 +98,9 @@ void trait_reset()
     for (index = 0; index < PC_TRAIT_MAX; index++) {
         pc_trait[index] = -1;
     }
+
+    // CE: Traits adjust cached dude stats.
+    stat_cache_reset();
 }
 
 // 0x4A0598
@@ -111,6 +114,8 @@ void trait_exit()
 // 0x4A05A8
 int trait_load(DB_FILE* stream)
 {
+    stat_cache_reset();
+
     return db_freadIntCount(stream, pc_trait, PC_TRAIT_MAX);
 }
 
@@ -129,6 +134,8 @@ void trait_set(int trait1, int trait2)
 {
     pc_trait[0] = trait1;
     pc_trait[1] = trait2;
+
+    stat_cache_reset();
 }
 
 // Returns selected traits.
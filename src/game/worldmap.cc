@@ -1563,9 +1563,9 @@ int world_map(WorldMapContext ctx)
                         wmap_mile = 0;
                         partyMemberRestingHeal(24);
 
-                        random_enc_chance = roll_random(1, 6);
-                        random_enc_chance += roll_random(1, 6);
-                        random_enc_chance += roll_random(1, 6);
+                        random_enc_chance = roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 6);
+                        random_enc_chance += roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 6);
+                        random_enc_chance += roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 6);
                         if (InCity(world_xpos, world_ypos) == -1) {
                             switch (WorldEcountChanceTable[world_ypos / 50][world_xpos / 50]) {
                             case 0:
@@ -1594,9 +1594,9 @@ int world_map(WorldMapContext ctx)
                         if (is_entering_random_encounter) {
                             v142 = 0;
                             while (v142 == 0) {
-                                special_enc_chance = roll_random(1, 6);
-                                special_enc_chance += roll_random(1, 6);
-                                special_enc_chance += roll_random(1, 6);
+                                special_enc_chance = roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 6);
+                                special_enc_chance += roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 6);
+                                special_enc_chance += roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 6);
                                 special_enc_chance -= 5;
                                 special_enc_chance += stat_level(obj_dude, STAT_LUCK);
                                 special_enc_chance += 2 * perk_level(PERK_EXPLORER);
@@ -1605,7 +1605,7 @@ int world_map(WorldMapContext ctx)
                                     break;
                                 }
 
-                                special_enc_chance = roll_random(1, 100);
+                                special_enc_chance = roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 100);
                                 for (v109 = 0; v109 < 6 && v142 == 0; v109++) {
                                     if (special_enc_chance >= SpclEncRange[v109].start && special_enc_chance <= SpclEncRange[v109].end) {
                                         if ((encounter_specials & (1 << v109)) != 0) {
@@ -2100,7 +2100,7 @@ int world_map(WorldMapContext ctx)
 
             terrain = WorldTerraTable[world_ypos / 50][world_xpos / 50];
             while (1) {
-                map_index = roll_random(0, 2);
+                map_index = roll_random_stream(ROLL_STREAM_WORLDMAP, 0, 2);
                 if (RandEnctNames[terrain][map_index] != NULL) {
                     break;
                 }
@@ -2139,7 +2139,7 @@ int world_map(WorldMapContext ctx)
 
                 terrain = WorldTerraTable[world_ypos / 50][world_xpos / 50];
                 while (1) {
-                    map_index = roll_random(0, 2);
+                    map_index = roll_random_stream(ROLL_STREAM_WORLDMAP, 0, 2);
                     if (RandEnctNames[terrain][map_index] != NULL) {
                         break;
                     }
@@ -2591,15 +2591,15 @@ static void TargetTown(int city)
     target_xpos = 50 * city_location[city].column + 50 / 2;
     target_ypos = 50 * city_location[city].row + 50 / 2;
 
-    offset = roll_random(0, 16);
-    if (roll_random(0, 1)) {
+    offset = roll_random_stream(ROLL_STREAM_WORLDMAP, 0, 16);
+    if (roll_random_stream(ROLL_STREAM_WORLDMAP, 0, 1)) {
         target_xpos += offset;
     } else {
         target_xpos -= offset;
     }
 
-    offset = roll_random(0, 16);
-    if (roll_random(0, 1)) {
+    offset = roll_random_stream(ROLL_STREAM_WORLDMAP, 0, 16);
+    if (roll_random_stream(ROLL_STREAM_WORLDMAP, 0, 1)) {
         target_ypos += offset;
     } else {
         target_ypos -= offset;
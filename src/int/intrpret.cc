@@ -24,6 +24,135 @@ namespace fallout {
 // Size of internal stack in bytes (per program).
 #define STACK_SIZE 0x800
 
+// CE: Compilers supporting labels as values dispatch decoded instructions with
+// computed goto, others fall back to switch.
+#if defined(__GNUC__)
+#define INTERPRET_COMPUTED_GOTO
+#endif
+
+#ifdef INTERPRET_COMPUTED_GOTO
+#define INTERPRET_LABEL(kind) label_##kind
+#define INTERPRET_CASE(kind) INTERPRET_LABEL(kind):
+
+// Every instruction ends with its own copy of dispatch, so that each indirect
+// jump is predicted from the instruction it follows.
+#define INTERPRET_NEXT() \
+    do { \
+        instruction = interpretNextInstruction(program, &a2, &unalignedInstruction); \
+        if (instruction == NULL) { \
+            return; \
+        } \
+        goto* dispatchTable[instruction->kind]; \
+    } while (0)
+
+#define INTERPRET_LOOP() INTERPRET_NEXT();
+#else
+#define INTERPRET_CASE(kind) case kind:
+#define INTERPRET_NEXT() continue
+#define INTERPRET_LOOP() \
+    while ((instruction = interpretNextInstruction(program, &a2, &unalignedInstruction)) != NULL) \
+        switch (instruction->kind)
+#endif
+
+// Determines how `interpret` executes decoded instruction.
+typedef enum InstructionKind {
+    INSTRUCTION_KIND_BAD_OPCODE,
+    INSTRUCTION_KIND_UNDEFINED_OPCODE,
+    INSTRUCTION_KIND_HANDLER,
+    INSTRUCTION_KIND_PUSH,
+    INSTRUCTION_KIND_NOOP,
+    INSTRUCTION_KIND_JUMP,
+    INSTRUCTION_KIND_IF,
+    INSTRUCTION_KIND_WHILE,
+    INSTRUCTION_KIND_STORE,
+    INSTRUCTION_KIND_FETCH,
+    INSTRUCTION_KIND_POP,
+    INSTRUCTION_KIND_DUP,
+    INSTRUCTION_KIND_FETCH_GLOBAL,
+    INSTRUCTION_KIND_STORE_GLOBAL,
+    INSTRUCTION_KIND_COUNT,
+} InstructionKind;
+
+// Kind of instruction which was not executed yet.
+#define INSTRUCTION_KIND_UNDECODED 0xFF
+
+typedef struct ProgramInstruction {
+    // Native endian opcode.
+    opcode_t opcode;
+
+    // See `InstructionKind`.
+    unsigned char kind;
+} ProgramInstruction;
+
+// Dynamic strings up to this size (including terminator) are allocated from
+// chunks, larger ones are allocated individually.
+#define DYNAMIC_STRINGS_MAX_SLOT_SIZE 256
+
+// Dynamic string sizes are rounded up to this granularity.
+#define DYNAMIC_STRINGS_SLOT_ALIGNMENT 8
+
+#define DYNAMIC_STRINGS_SLOT_CLASS_COUNT (DYNAMIC_STRINGS_MAX_SLOT_SIZE / DYNAMIC_STRINGS_SLOT_ALIGNMENT)
+
+#define DYNAMIC_STRINGS_CHUNK_SIZE 8192
+
+#define DYNAMIC_STRINGS_INITIAL_BUCKET_COUNT 64
+
+// Minimum number of bytes allocated for new strings before unreferenced
+// strings are collected.
+#define DYNAMIC_STRINGS_MIN_COLLECT_SIZE 16384
+
+typedef struct DynamicString {
+    // Stable pointer to the string, `NULL` if entry is free.
+    char* string;
+    int length;
+    unsigned int hash;
+
+    // Last collection generation in which string was created or found
+    // referenced.
+    unsigned int generation;
+
+    // Next entry in hash bucket, or next free entry.
+    int next;
+} DynamicString;
+
+typedef struct DynamicStringsChunk {
+    struct DynamicStringsChunk* next;
+} DynamicStringsChunk;
+
+// CE: Interned dynamic strings of the program.
+//
+// String values refer to strings by entry index, which is what
+// `interpretAddString` returns and `interpretGetString` expects. Equal strings
+// always share the same entry. String memory is never moved, so pointers
+// returned by `interpretGetString` stay valid until the string is collected.
+typedef struct DynamicStrings {
+    DynamicString* entries;
+    int entriesLength;
+    int entriesCapacity;
+    int freeEntry;
+
+    // Heads of hash chains, number of buckets is a power of two.
+    int* buckets;
+    int bucketsLength;
+    int count;
+
+    DynamicStringsChunk* chunks;
+    char* chunkTop;
+    char* chunkEnd;
+
+    // Free lists of chunk slots of each size class, linked through the
+    // first bytes of the slot.
+    char* freeSlots[DYNAMIC_STRINGS_SLOT_CLASS_COUNT];
+
+    unsigned int generation;
+
+    // Bytes allocated for strings since last collection.
+    int allocatedSize;
+
+    // Bytes occupied by all strings after last collection.
+    int liveSize;
+} DynamicStrings;
+
 typedef struct ProgramListNode {
     Program* program;
     struct ProgramListNode* next; // next
@@ -47,6 +176,17 @@ static void detachProgram(Program* program);
 static void purgeProgram(Program* program);
 static opcode_t getOp(Program* program);
 static void checkProgramStrings(Program* program);
+static unsigned int dynamicStringsHash(const char* string, int length);
+static char* dynamicStringsAllocate(DynamicStrings* strings, int size);
+static void dynamicStringsRelease(DynamicStrings* strings, char* string, int size);
+static void dynamicStringsRehash(DynamicStrings* strings, int bucketsLength);
+static void dynamicStringsMark(DynamicStrings* strings, ProgramStack* stack);
+static void dynamicStringsFree(DynamicStrings* strings);
+static void interpretDecodeProgram(Program* program);
+static void interpretRun(Program* program, int a2);
+static void interpretDecodeInstruction(Program* program, int pos, ProgramInstruction* instruction);
+static inline ProgramInstruction* interpretNextInstruction(Program* program, int* a2, ProgramInstruction* unalignedInstruction);
+static InstructionKind interpretInstructionKind(OpcodeHandler* handler);
 static void op_noop(Program* program);
 static void op_const(Program* program);
 static void op_push_base(Program* program);
@@ -163,6 +303,13 @@ static ProgramListNode* head;
 // 0x59E794
 static int suspendEvents;
 
+// 0x59E798
+static int busy;
+
+// CE: Number of `interpret` calls in progress. Dynamic strings are only
+// collected when it's zero, so that no opcode handler holds string pointers.
+static int interpretDepth = 0;
+
 // 0x45B400
 static unsigned int defaultTimerFunc()
 {
@@ -408,6 +555,7 @@ void interpretFreeProgram(Program* program)
     purgeProgram(program);
 
     if (program->dynamicStrings != NULL) {
+        dynamicStringsFree(program->dynamicStrings);
         myfree(program->dynamicStrings, __FILE__, __LINE__); // "..\int\INTRPRET.C", 371
     }
 
@@ -419,6 +567,10 @@ void interpretFreeProgram(Program* program)
         myfree(program->name, __FILE__, __LINE__); // "..\int\INTRPRET.C", 373
     }
 
+    if (program->instructions != NULL) {
+        myfree(program->instructions, __FILE__, __LINE__);
+    }
+
     delete program->stackValues;
     delete program->returnStackValues;
 
@@ -455,6 +607,7 @@ Program* allocateProgram(const char* path)
     program->basePointer = -1;
     program->framePointer = -1;
     program->data = data;
+    program->dataSize = fileSize;
     program->procedures = data + 42;
     program->identifiers = sizeof(Procedure) * fetchLong(program->procedures, 0) + program->procedures + 4;
     program->staticStrings = program->identifiers + fetchLong(program->identifiers, 0) + 4;
@@ -462,9 +615,100 @@ Program* allocateProgram(const char* path)
     program->stackValues = new ProgramStack();
     program->returnStackValues = new ProgramStack();
 
+    // CE: Decode instructions once instead of on every execution.
+    interpretDecodeProgram(program);
+
     return program;
 }
 
+// Prepares table of decoded instructions, one entry for every even offset of
+// program data. Entries are decoded when the instruction is executed for the
+// first time, so data areas (procedure table, names, strings) are skipped.
+// Code is never modified, so decoded entries stay valid for the lifetime of
+// the program.
+static void interpretDecodeProgram(Program* program)
+{
+    int length = program->dataSize / 2;
+    if (length == 0) {
+        return;
+    }
+
+    ProgramInstruction* instructions = (ProgramInstruction*)mymalloc(sizeof(*instructions) * length, __FILE__, __LINE__);
+    if (instructions == NULL) {
+        // Every instruction will be decoded on the fly.
+        return;
+    }
+
+    memset(instructions, INSTRUCTION_KIND_UNDECODED, sizeof(*instructions) * length);
+
+    program->instructions = instructions;
+    program->instructionsLength = length;
+}
+
+// Decodes instruction at `pos`, resolving its handler and operands the same
+// way `interpret` and `op_const` do.
+static void interpretDecodeInstruction(Program* program, int pos, ProgramInstruction* instruction)
+{
+    if (pos < 0 || pos + 2 > program->dataSize) {
+        instruction->opcode = 0;
+        instruction->kind = INSTRUCTION_KIND_BAD_OPCODE;
+        return;
+    }
+
+    instruction->opcode = fetchWord(program->data, pos);
+
+    if (!((instruction->opcode >> 8) & 0x80)) {
+        instruction->kind = INSTRUCTION_KIND_BAD_OPCODE;
+        return;
+    }
+
+    // CE: Original code does not check index against table size.
+    unsigned int opcodeIndex = instruction->opcode & 0x3FF;
+    if (opcodeIndex >= OPCODE_MAX_COUNT || opTable[opcodeIndex] == NULL) {
+        instruction->kind = INSTRUCTION_KIND_UNDEFINED_OPCODE;
+        return;
+    }
+
+    instruction->kind = interpretInstructionKind(opTable[opcodeIndex]);
+
+    // Let `op_const` deal with truncated operand.
+    if (instruction->kind == INSTRUCTION_KIND_PUSH && pos + 6 > program->dataSize) {
+        instruction->kind = INSTRUCTION_KIND_HANDLER;
+    }
+}
+
+// Returns how `interpret` should execute opcode with given handler. Core
+// stack and flow opcodes are executed inline, everything else is called
+// through resolved handler.
+static InstructionKind interpretInstructionKind(OpcodeHandler* handler)
+{
+    if (handler == op_const) {
+        return INSTRUCTION_KIND_PUSH;
+    } else if (handler == op_noop) {
+        return INSTRUCTION_KIND_NOOP;
+    } else if (handler == op_jmp) {
+        return INSTRUCTION_KIND_JUMP;
+    } else if (handler == op_if) {
+        return INSTRUCTION_KIND_IF;
+    } else if (handler == op_while) {
+        return INSTRUCTION_KIND_WHILE;
+    } else if (handler == op_store) {
+        return INSTRUCTION_KIND_STORE;
+    } else if (handler == op_fetch) {
+        return INSTRUCTION_KIND_FETCH;
+    } else if (handler == op_pop) {
+        return INSTRUCTION_KIND_POP;
+    } else if (handler == op_dup) {
+        return INSTRUCTION_KIND_DUP;
+    } else if (handler == op_fetch_global) {
+        return INSTRUCTION_KIND_FETCH_GLOBAL;
+    } else if (handler == op_store_global) {
+        return INSTRUCTION_KIND_STORE_GLOBAL;
+    }
+
+    return INSTRUCTION_KIND_HANDLER;
+}
+
 // 0x45BC08
 static opcode_t getOp(Program* program)
 {
@@ -484,7 +728,7 @@ char* interpretGetString(Program* program, opcode_t opcode, int offset)
     // always used with static string flag.
 
     if ((opcode & RAW_VALUE_TYPE_DYNAMIC_STRING) != 0) {
-        return (char*)(program->dynamicStrings + 4 + offset);
+        return program->dynamicStrings->entries[offset].string;
     }
 
     if ((opcode & RAW_VALUE_TYPE_STATIC_STRING) != 0) {
@@ -500,82 +744,226 @@ char* interpretGetName(Program* program, int offset)
     return (char*)(program->identifiers + offset);
 }
 
+// Returns index of interned copy of `string`.
+//
 // 0x45BC64
 int interpretAddString(Program* program, char* string)
 {
-    int v27;
-    unsigned char* v20;
-    unsigned char* v23;
-
     if (program == NULL) {
         return 0;
     }
 
-    v27 = strlen(string) + 1;
+    DynamicStrings* strings = program->dynamicStrings;
+    if (strings == NULL) {
+        strings = (DynamicStrings*)mymalloc(sizeof(*strings), __FILE__, __LINE__); // "..\int\INTRPRET.C", 459
+        memset(strings, 0, sizeof(*strings));
+        strings->freeEntry = -1;
+        dynamicStringsRehash(strings, DYNAMIC_STRINGS_INITIAL_BUCKET_COUNT);
+        program->dynamicStrings = strings;
+    }
+
+    int length = strlen(string);
+    unsigned int hash = dynamicStringsHash(string, length);
 
-    // Align memory
-    if (v27 & 1) {
-        v27++;
+    int index = strings->buckets[hash & (strings->bucketsLength - 1)];
+    while (index != -1) {
+        DynamicString* entry = &(strings->entries[index]);
+        if (entry->hash == hash && entry->length == length && memcmp(entry->string, string, length) == 0) {
+            entry->generation = strings->generation;
+            return index;
+        }
+        index = entry->next;
     }
 
-    if (program->dynamicStrings != NULL) {
-        // TODO: Needs testing, lots of pointer stuff.
-        unsigned char* heap = program->dynamicStrings + 4;
-        while (*(unsigned short*)heap != 0x8000) {
-            short v2 = *(short*)heap;
-            if (v2 >= 0) {
-                if (v2 == v27) {
-                    if (strcmp(string, (char*)(heap + 4)) == 0) {
-                        return (heap + 4) - (program->dynamicStrings + 4);
-                    }
-                }
-            } else {
-                v2 = -v2;
-                if (v2 > v27) {
-                    if (v2 - v27 <= 4) {
-                        *(short*)heap = v2;
-                    } else {
-                        *(short*)(heap + v27 + 6) = 0;
-                        *(short*)(heap + v27 + 4) = -(v2 - v27 - 4);
-                        *(short*)(heap) = v27;
-                    }
+    if (strings->freeEntry != -1) {
+        index = strings->freeEntry;
+        strings->freeEntry = strings->entries[index].next;
+    } else {
+        if (strings->entriesLength == strings->entriesCapacity) {
+            strings->entriesCapacity = strings->entriesCapacity != 0 ? strings->entriesCapacity * 2 : 64;
+            strings->entries = (DynamicString*)myrealloc(strings->entries, sizeof(*strings->entries) * strings->entriesCapacity, __FILE__, __LINE__); // "..\int\INTRPRET.C", 466
+        }
+        index = strings->entriesLength++;
+    }
 
-                    *(short*)(heap + 2) = 0;
-                    strcpy((char*)(heap + 4), string);
+    if (strings->count >= strings->bucketsLength) {
+        dynamicStringsRehash(strings, strings->bucketsLength * 2);
+    }
 
-                    *(heap + v27 + 3) = '\0';
-                    return (heap + 4) - (program->dynamicStrings + 4);
-                }
+    DynamicString* entry = &(strings->entries[index]);
+    entry->string = dynamicStringsAllocate(strings, length + 1);
+    memcpy(entry->string, string, length + 1);
+    entry->length = length;
+    entry->hash = hash;
+    entry->generation = strings->generation;
+
+    int* bucket = &(strings->buckets[hash & (strings->bucketsLength - 1)]);
+    entry->next = *bucket;
+    *bucket = index;
+
+    strings->count++;
+
+    return index;
+}
+
+// Frees dynamic strings which were not referenced from program stacks
+// during the last two collections.
+//
+// Strings created or looked up since previous collection survive one more
+// collection even if unreferenced, so that callers which have just popped a
+// string can still use it.
+static void checkProgramStrings(Program* program)
+{
+    DynamicStrings* strings = program->dynamicStrings;
+    if (strings == NULL) {
+        return;
+    }
+
+    strings->generation++;
+
+    dynamicStringsMark(strings, program->stackValues);
+    dynamicStringsMark(strings, program->returnStackValues);
+
+    int liveSize = 0;
+    for (int bucketIndex = 0; bucketIndex < strings->bucketsLength; bucketIndex++) {
+        int* link = &(strings->buckets[bucketIndex]);
+        while (*link != -1) {
+            int index = *link;
+            DynamicString* entry = &(strings->entries[index]);
+            if (strings->generation - entry->generation >= 2) {
+                *link = entry->next;
+
+                dynamicStringsRelease(strings, entry->string, entry->length + 1);
+                entry->string = NULL;
+                entry->next = strings->freeEntry;
+                strings->freeEntry = index;
+                strings->count--;
+            } else {
+                liveSize += entry->length + 1;
+                link = &(entry->next);
             }
-            heap += v2 + 4;
         }
-    } else {
-        program->dynamicStrings = (unsigned char*)mymalloc(8, __FILE__, __LINE__); // "..\int\INTRPRET.C", 459
-        *(int*)(program->dynamicStrings) = 0;
-        *(unsigned short*)(program->dynamicStrings + 4) = 0x8000;
-        *(short*)(program->dynamicStrings + 6) = 1;
     }
 
-    program->dynamicStrings = (unsigned char*)myrealloc(program->dynamicStrings, *(int*)(program->dynamicStrings) + 8 + 4 + v27, __FILE__, __LINE__); // "..\int\INTRPRET.C", 466
+    strings->liveSize = liveSize;
+    strings->allocatedSize = 0;
+}
 
-    v20 = program->dynamicStrings + *(int*)(program->dynamicStrings) + 4;
-    if ((*(short*)v20 & 0xFFFF) != 0x8000) {
-        interpretError("Internal consistancy error, string table mangled");
+// FNV-1a.
+static unsigned int dynamicStringsHash(const char* string, int length)
+{
+    unsigned int hash = 2166136261U;
+    for (int index = 0; index < length; index++) {
+        hash ^= (unsigned char)string[index];
+        hash *= 16777619U;
     }
+    return hash;
+}
 
-    *(int*)(program->dynamicStrings) += v27 + 4;
+static char* dynamicStringsAllocate(DynamicStrings* strings, int size)
+{
+    size = (size + DYNAMIC_STRINGS_SLOT_ALIGNMENT - 1) & ~(DYNAMIC_STRINGS_SLOT_ALIGNMENT - 1);
+    strings->allocatedSize += size;
 
-    *(short*)(v20) = v27;
-    *(short*)(v20 + 2) = 0;
+    if (size > DYNAMIC_STRINGS_MAX_SLOT_SIZE) {
+        return (char*)mymalloc(size, __FILE__, __LINE__);
+    }
 
-    strcpy((char*)(v20 + 4), string);
+    int slotClass = size / DYNAMIC_STRINGS_SLOT_ALIGNMENT - 1;
+    char* slot = strings->freeSlots[slotClass];
+    if (slot != NULL) {
+        memcpy(&(strings->freeSlots[slotClass]), slot, sizeof(slot));
+        return slot;
+    }
 
-    v23 = v20 + v27;
-    *(v23 + 3) = '\0';
-    *(unsigned short*)(v23 + 4) = 0x8000;
-    *(short*)(v23 + 6) = 1;
+    if (strings->chunkEnd - strings->chunkTop < size) {
+        // Remainder of the current chunk is wasted, it's never larger than a
+        // single slot.
+        DynamicStringsChunk* chunk = (DynamicStringsChunk*)mymalloc(sizeof(*chunk) + DYNAMIC_STRINGS_CHUNK_SIZE, __FILE__, __LINE__);
+        chunk->next = strings->chunks;
+        strings->chunks = chunk;
+        strings->chunkTop = (char*)(chunk + 1);
+        strings->chunkEnd = strings->chunkTop + DYNAMIC_STRINGS_CHUNK_SIZE;
+    }
 
-    return v20 + 4 - (program->dynamicStrings + 4);
+    slot = strings->chunkTop;
+    strings->chunkTop += size;
+    return slot;
+}
+
+static void dynamicStringsRelease(DynamicStrings* strings, char* string, int size)
+{
+    size = (size + DYNAMIC_STRINGS_SLOT_ALIGNMENT - 1) & ~(DYNAMIC_STRINGS_SLOT_ALIGNMENT - 1);
+
+    if (size > DYNAMIC_STRINGS_MAX_SLOT_SIZE) {
+        myfree(string, __FILE__, __LINE__);
+        return;
+    }
+
+    int slotClass = size / DYNAMIC_STRINGS_SLOT_ALIGNMENT - 1;
+    memcpy(string, &(strings->freeSlots[slotClass]), sizeof(string));
+    strings->freeSlots[slotClass] = string;
+}
+
+static void dynamicStringsRehash(DynamicStrings* strings, int bucketsLength)
+{
+    if (strings->buckets != NULL) {
+        myfree(strings->buckets, __FILE__, __LINE__);
+    }
+
+    strings->buckets = (int*)mymalloc(sizeof(*strings->buckets) * bucketsLength, __FILE__, __LINE__);
+    strings->bucketsLength = bucketsLength;
+
+    for (int index = 0; index < bucketsLength; index++) {
+        strings->buckets[index] = -1;
+    }
+
+    for (int index = 0; index < strings->entriesLength; index++) {
+        DynamicString* entry = &(strings->entries[index]);
+        if (entry->string != NULL) {
+            int* bucket = &(strings->buckets[entry->hash & (bucketsLength - 1)]);
+            entry->next = *bucket;
+            *bucket = index;
+        }
+    }
+}
+
+static void dynamicStringsMark(DynamicStrings* strings, ProgramStack* stack)
+{
+    for (size_t index = 0; index < stack->size(); index++) {
+        ProgramValue& value = stack->at(index);
+        if ((value.opcode & VALUE_TYPE_MASK) == VALUE_TYPE_STRING
+            && (value.opcode & RAW_VALUE_TYPE_DYNAMIC_STRING) != 0
+            && value.integerValue >= 0
+            && value.integerValue < strings->entriesLength) {
+            strings->entries[value.integerValue].generation = strings->generation;
+        }
+    }
+}
+
+static void dynamicStringsFree(DynamicStrings* strings)
+{
+    // Releasing frees large strings, slots are freed with their chunks.
+    for (int index = 0; index < strings->entriesLength; index++) {
+        DynamicString* entry = &(strings->entries[index]);
+        if (entry->string != NULL) {
+            dynamicStringsRelease(strings, entry->string, entry->length + 1);
+        }
+    }
+
+    while (strings->chunks != NULL) {
+        DynamicStringsChunk* next = strings->chunks->next;
+        myfree(strings->chunks, __FILE__, __LINE__);
+        strings->chunks = next;
+    }
+
+    if (strings->entries != NULL) {
+        myfree(strings->entries, __FILE__, __LINE__);
+    }
+
+    if (strings->buckets != NULL) {
+        myfree(strings->buckets, __FILE__, __LINE__);
+    }
 }
 
 // 0x45BDB4
@@ -769,6 +1157,12 @@ static void op_not_equal(Program* program)
         value[arg] = programStackPopValue(program);
     }
 
+    // CE: Dynamic strings are interned, equal strings have equal indexes.
+    if (value[1].opcode == VALUE_TYPE_DYNAMIC_STRING && value[0].opcode == VALUE_TYPE_DYNAMIC_STRING) {
+        programStackPushInteger(program, value[1].integerValue != value[0].integerValue);
+        return;
+    }
+
     switch (value[1].opcode) {
     case VALUE_TYPE_STRING:
     case VALUE_TYPE_DYNAMIC_STRING:
@@ -865,6 +1259,12 @@ static void op_equal(Program* program)
         value[arg] = programStackPopValue(program);
     }
 
+    // CE: Dynamic strings are interned, equal strings have equal indexes.
+    if (value[1].opcode == VALUE_TYPE_DYNAMIC_STRING && value[0].opcode == VALUE_TYPE_DYNAMIC_STRING) {
+        programStackPushInteger(program, value[1].integerValue == value[0].integerValue);
+        return;
+    }
+
     switch (value[1].opcode) {
     case VALUE_TYPE_STRING:
     case VALUE_TYPE_DYNAMIC_STRING:
@@ -2532,14 +2932,165 @@ void interpretEnableInterpreter(int value)
     }
 }
 
-// 0x460658
-void interpret(Program* program, int a2)
+// Returns next instruction of the program to execute and moves instruction
+// pointer past its opcode, or returns `NULL` when program should stop for now.
+// `a2` is the number of instructions left to execute.
+static inline ProgramInstruction* interpretNextInstruction(Program* program, int* a2, ProgramInstruction* unalignedInstruction)
 {
-    // 0x59E798
-    static int busy;
+    while ((program->flags & PROGRAM_FLAG_CRITICAL_SECTION) != 0 || --(*a2) != -1) {
+        if ((program->flags & (PROGRAM_FLAG_EXITED | PROGRAM_FLAG_0x04 | PROGRAM_FLAG_STOPPED | PROGRAM_FLAG_0x20 | PROGRAM_FLAG_0x40 | PROGRAM_FLAG_0x0100)) != 0) {
+            return NULL;
+        }
 
+        if (program->exited) {
+            return NULL;
+        }
+
+        if ((program->flags & PROGRAM_IS_WAITING) != 0) {
+            busy = 1;
+
+            if (program->checkWaitFunc != NULL) {
+                if (!program->checkWaitFunc(program)) {
+                    busy = 0;
+                    continue;
+                }
+            }
+
+            busy = 0;
+            program->checkWaitFunc = NULL;
+            program->flags &= ~PROGRAM_IS_WAITING;
+        }
+
+        // CE: Instructions are decoded once on first execution, only
+        // unaligned or out of bounds instruction pointer needs to be decoded
+        // every time.
+        ProgramInstruction* instruction;
+        int pos = program->instructionPointer;
+        if (pos >= 0 && (pos & 1) == 0 && (pos >> 1) < program->instructionsLength) {
+            instruction = &(program->instructions[pos >> 1]);
+            if (instruction->kind == INSTRUCTION_KIND_UNDECODED) {
+                interpretDecodeInstruction(program, pos, instruction);
+            }
+        } else {
+            interpretDecodeInstruction(program, pos, unalignedInstruction);
+            instruction = unalignedInstruction;
+        }
+
+        program->instructionPointer = pos + 2;
+
+        // TODO: Replace with field_82 and field_80?
+        program->flags &= 0xFFFF;
+        program->flags |= (instruction->opcode << 16);
+
+        return instruction;
+    }
+
+    return NULL;
+}
+
+// Executes up to `a2` instructions (or until critical section ends) of
+// current program.
+//
+// CE: Extracted from `interpret`, so that the dispatch loop does not share
+// the frame with `setjmp`, which forces compilers to keep locals in memory.
+static void interpretRun(Program* program, int a2)
+{
     char err[260];
+    ProgramInstruction* instruction;
+    ProgramInstruction unalignedInstruction;
+
+#ifdef INTERPRET_COMPUTED_GOTO
+    // NOTE: Must be in the same order as `InstructionKind`.
+    static void* const dispatchTable[] = {
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_BAD_OPCODE),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_UNDEFINED_OPCODE),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_HANDLER),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_PUSH),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_NOOP),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_JUMP),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_IF),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_WHILE),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_STORE),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_FETCH),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_POP),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_DUP),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_FETCH_GLOBAL),
+        &&INTERPRET_LABEL(INSTRUCTION_KIND_STORE_GLOBAL),
+    };
+    static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == INSTRUCTION_KIND_COUNT, "wrong dispatch table size");
+#endif
 
+    if ((program->flags & PROGRAM_FLAG_CRITICAL_SECTION) != 0 && a2 < 3) {
+        a2 = 3;
+    }
+
+    INTERPRET_LOOP()
+    {
+        INTERPRET_CASE(INSTRUCTION_KIND_BAD_OPCODE)
+            snprintf(err, sizeof(err), "Bad opcode %x %c %d.", instruction->opcode, instruction->opcode, instruction->opcode);
+            interpretError(err);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_UNDEFINED_OPCODE)
+            {
+                // Handler might have been added after program was loaded.
+                unsigned int opcodeIndex = instruction->opcode & 0x3FF;
+                OpcodeHandler* handler = opcodeIndex < OPCODE_MAX_COUNT ? opTable[opcodeIndex] : NULL;
+                if (handler == NULL) {
+                    snprintf(err, sizeof(err), "Undefined opcode %x.", instruction->opcode);
+                    interpretError(err);
+                }
+
+                handler(program);
+            }
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_HANDLER)
+            opTable[instruction->opcode & 0x3FF](program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_PUSH)
+            {
+                // NOTE: Inlined `op_const`.
+                ProgramValue value;
+                value.opcode = instruction->opcode;
+                value.integerValue = fetchLong(program->data, program->instructionPointer);
+                program->instructionPointer += 4;
+                programStackPushValue(program, value);
+            }
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_NOOP)
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_JUMP)
+            op_jmp(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_IF)
+            op_if(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_WHILE)
+            op_while(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_STORE)
+            op_store(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_FETCH)
+            op_fetch(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_POP)
+            op_pop(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_DUP)
+            op_dup(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_FETCH_GLOBAL)
+            op_fetch_global(program);
+            INTERPRET_NEXT();
+        INTERPRET_CASE(INSTRUCTION_KIND_STORE_GLOBAL)
+            op_store_global(program);
+            INTERPRET_NEXT();
+    }
+}
+
+// 0x460658
+void interpret(Program* program, int a2)
+{
     Program* oldCurrentProgram = currentProgram;
 
     if (!enabled) {
@@ -2560,60 +3111,26 @@ void interpret(Program* program, int a2)
 
     currentProgram = program;
 
+    int oldInterpretDepth = interpretDepth;
+
     if (setjmp(program->env)) {
+        interpretDepth = oldInterpretDepth;
         currentProgram = oldCurrentProgram;
         program->flags |= PROGRAM_FLAG_EXITED | PROGRAM_FLAG_0x04;
         return;
     }
 
-    if ((program->flags & PROGRAM_FLAG_CRITICAL_SECTION) != 0 && a2 < 3) {
-        a2 = 3;
-    }
-
-    while ((program->flags & PROGRAM_FLAG_CRITICAL_SECTION) != 0 || --a2 != -1) {
-        if ((program->flags & (PROGRAM_FLAG_EXITED | PROGRAM_FLAG_0x04 | PROGRAM_FLAG_STOPPED | PROGRAM_FLAG_0x20 | PROGRAM_FLAG_0x40 | PROGRAM_FLAG_0x0100)) != 0) {
-            break;
-        }
-
-        if (program->exited) {
-            break;
-        }
-
-        if ((program->flags & PROGRAM_IS_WAITING) != 0) {
-            busy = 1;
+    interpretDepth++;
+    interpretRun(program, a2);
+    interpretDepth--;
 
-            if (program->checkWaitFunc != NULL) {
-                if (!program->checkWaitFunc(program)) {
-                    busy = 0;
-                    continue;
-                }
-            }
-
-            busy = 0;
-            program->checkWaitFunc = NULL;
-            program->flags &= ~PROGRAM_IS_WAITING;
+    // CE: Collect unreferenced dynamic strings once enough new strings were
+    // created since last collection.
+    if (interpretDepth == 0 && program->dynamicStrings != NULL) {
+        DynamicStrings* strings = program->dynamicStrings;
+        if (strings->allocatedSize >= DYNAMIC_STRINGS_MIN_COLLECT_SIZE && strings->allocatedSize >= strings->liveSize) {
+            checkProgramStrings(program);
         }
-
-        // NOTE: Uninline.
-        opcode_t opcode = getOp(program);
-
-        // TODO: Replace with field_82 and field_80?
-        program->flags &= 0xFFFF;
-        program->flags |= (opcode << 16);
-
-        if (!((opcode >> 8) & 0x80)) {
-            snprintf(err, sizeof(err), "Bad opcode %x %c %d.", opcode, opcode, opcode);
-            interpretError(err);
-        }
-
-        unsigned int opcodeIndex = opcode & 0x3FF;
-        OpcodeHandler* handler = opTable[opcodeIndex];
-        if (handler == NULL) {
-            snprintf(err, sizeof(err), "Undefined opcode %x.", opcode);
-            interpretError(err);
-        }
-
-        handler(program);
     }
 
     if ((program->flags & PROGRAM_FLAG_EXITED) != 0) {
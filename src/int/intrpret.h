@@ -149,6 +149,8 @@ typedef struct ProgramValue {
 typedef std::vector<ProgramValue> ProgramStack;
 
 typedef struct Program Program;
+typedef struct ProgramInstruction ProgramInstruction;
+typedef struct DynamicStrings DynamicStrings;
 typedef int(InterpretCheckWaitFunc)(Program* program);
 
 // It's size in original code is 144 (0x8C) bytes due to the different
@@ -162,7 +164,7 @@ typedef struct Program {
     int framePointer; // saved stack 1 pos - probably beginning of local variables - probably called base
     int basePointer; // saved stack 1 pos - probably beginning of global variables
     unsigned char* staticStrings; // static strings table
-    unsigned char* dynamicStrings; // dynamic strings table
+    DynamicStrings* dynamicStrings; // dynamic strings table
     unsigned char* identifiers;
     unsigned char* procedures;
     jmp_buf env;
@@ -175,6 +177,15 @@ typedef struct Program {
     bool exited;
     ProgramStack* stackValues;
     ProgramStack* returnStackValues;
+
+    // CE: Size of `data` in bytes.
+    int dataSize;
+
+    // CE: Instructions decoded on first execution, one for every even offset
+    // in `data`, so that instruction at `instructionPointer` is found at
+    // `instructionPointer / 2`.
+    ProgramInstruction* instructions;
+    int instructionsLength;
 } Program;
 
 typedef char*(InterpretMangleFunc)(char* fileName);
@@ -317,7 +317,7 @@ static void movie_MVE_ShowFrame(SDL_Surface* surface, int srcWidth, int srcHeigh
     SDL_Surface* screenSurface = render_get_surface();
     SDL_SetSurfacePalette(surface, screenSurface->format->palette);
     SDL_BlitSurface(surface, &srcRect, screenSurface, &destRect);
-    SDL_BlitSurface(screenSurface, NULL, render_get_texture_surface(), NULL);
+    render_invalidate_rect(&destRect);
     renderPresent();
 }
 
@@ -510,7 +510,7 @@ static void op_random(Program* program)
 
     int result;
     if (vcr_status() == VCR_STATE_TURNED_OFF) {
-        result = roll_random(data[1], data[0]);
+        result = roll_random_stream(ROLL_STREAM_SCRIPTS, data[1], data[0]);
     } else {
         result = (data[0] - data[1]) / 2;
     }
@@ -704,7 +704,7 @@ static void op_destroy_object(Program* program)
 
         if (isSelf) {
             object->sid = -1;
-            object->flags |= (OBJECT_HIDDEN | OBJECT_NO_SAVE);
+            obj_set_flag(object, OBJECT_HIDDEN | OBJECT_NO_SAVE);
         } else {
             register_clear(object);
             obj_erase_object(object, NULL);
@@ -1646,9 +1646,9 @@ static void objs_area_turn_on_off(int a1, int a2, int a3, int a4, int enabled)
                 if (object->tile >= a3 && object->tile <= a4 && (object->tile - a3) / 200 <= a4 / 200 - a3 / 200) {
                     obj_bound(object, &object_bounds);
                     if (enabled) {
-                        object->flags &= ~OBJECT_HIDDEN;
+                        obj_unset_flag(object, OBJECT_HIDDEN);
                     } else {
-                        object->flags |= OBJECT_HIDDEN;
+                        obj_set_flag(object, OBJECT_HIDDEN);
                     }
                     rect_min_bound(&rect, &object_bounds, &rect);
                 }
@@ -1709,9 +1709,9 @@ static void op_set_obj_visibility(Program* program)
             Rect rect;
             obj_bound(obj, &rect);
 
-            obj->flags |= OBJECT_HIDDEN;
+            obj_set_flag(obj, OBJECT_HIDDEN);
             if (PID_TYPE(obj->pid) == OBJ_TYPE_CRITTER) {
-                obj->flags |= OBJECT_NO_BLOCK;
+                obj_set_flag(obj, OBJECT_NO_BLOCK);
             }
 
             tile_refresh_rect(&rect, obj->elevation);
@@ -1719,10 +1719,10 @@ static void op_set_obj_visibility(Program* program)
     } else {
         if ((obj->flags & OBJECT_HIDDEN) != 0) {
             if (PID_TYPE(obj->pid) == OBJ_TYPE_CRITTER) {
-                obj->flags &= ~OBJECT_NO_BLOCK;
+                obj_unset_flag(obj, OBJECT_NO_BLOCK);
             }
 
-            obj->flags &= ~OBJECT_HIDDEN;
+            obj_unset_flag(obj, OBJECT_HIDDEN);
 
             Rect rect;
             obj_bound(obj, &rect);
@@ -3782,7 +3782,7 @@ static void op_destroy_mult_objs(Program* program)
 
         if (isSelf) {
             object->sid = -1;
-            object->flags |= (OBJECT_HIDDEN | OBJECT_NO_SAVE);
+            obj_set_flag(object, OBJECT_HIDDEN | OBJECT_NO_SAVE);
         } else {
             register_clear(object);
             obj_erase_object(object, NULL);
@@ -7,13 +7,54 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MOVIE_LIB_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MOVIE_LIB_NEON 1
+#endif
+
 #include "audio_engine.h"
 #include "platform_compat.h"
 
 namespace fallout {
 
+// CE: Number of records kept in memory by the read-ahead thread, including
+// the one `_MVE_rmStepMovie` is currently walking through.
+#define MOVIE_LIB_READ_AHEAD_RECORDS 4
+
+typedef enum MovieDecodeJobState {
+    MOVIE_DECODE_JOB_NONE,
+    MOVIE_DECODE_JOB_QUEUED,
+    MOVIE_DECODE_JOB_RUNNING,
+    MOVIE_DECODE_JOB_DONE,
+} MovieDecodeJobState;
+
+// CE: Video chunk decoded by the read-ahead thread while the previous frame
+// is being presented.
+typedef struct MovieDecodeJob {
+    MovieDecodeJobState state;
+    // Chunk the job was made for, matched against the one reached by
+    // `_MVE_rmStepMovie` when the job is committed.
+    unsigned char* chunk;
+    unsigned char* map;
+    unsigned char* data;
+    unsigned char* dest;
+    unsigned char* prev;
+    int x;
+    int y;
+    int width;
+    int height;
+} MovieDecodeJob;
+
 typedef struct STRUCT_6B3690 {
     void* field_0;
     unsigned int field_4;
@@ -95,7 +136,19 @@ static void _MVE_frClose(STRUCT_4F6930* a1);
 static int _MVE_sndDecompM16(unsigned short* a1, unsigned char* a2, int a3, int a4);
 static int _MVE_sndDecompS16(unsigned short* a1, unsigned char* a2, int a3, int a4);
 static void _nfPkConfig();
-static void _nfPkDecomp(unsigned char* buf, unsigned char* a2, int a3, int a4, int a5, int a6);
+static void _nfPkDecomp(unsigned char* buf1, unsigned char* buf2, unsigned char* a1, unsigned char* a2, int a3, int a4, int a5, int a6);
+static void movieSetFrameRect(int a3, int a4, int a5, int a6);
+static void movieBlockCopy(unsigned char* dest, const unsigned char* src, int srcPitch, int destPitch);
+static void movieBlockScale2x(unsigned char* dest, const unsigned char* src, int pitch);
+static void movieBlockFillQuads(unsigned char* dest, const unsigned char* colors, int pitch);
+static void movieBlockFill(unsigned char* dest, int color, int pitch);
+static void movieBlockFillDither(unsigned char* dest, int colors, int pitch);
+static void movieLibThreadStart();
+static void movieLibThreadStop();
+static void movieLibThreadRun();
+static bool movieLibReadRecord(int index);
+static void movieLibDecodeAhead(unsigned char* p, int len);
+static bool movieLibFinishDecode(unsigned char* chunk);
 
 static constexpr uint16_t loadUInt16LE(const uint8_t* b);
 static constexpr uint32_t loadUInt32LE(const uint8_t* b);
@@ -516,6 +569,42 @@ static SDL_Surface* gMovieSdlSurface2;
 static int gMveSoundBuffer = -1;
 static unsigned int gMveBufferBytes;
 
+// CE: Set to false to decode as fast as possible, without waiting for frame
+// time (headless benchmarks).
+static bool gMovieLibSync = true;
+
+// CE: Enables `gMovieLibThread`.
+static bool gMovieLibReadAhead = true;
+
+// CE: Reads records ahead of `_MVE_rmStepMovie` and runs `gMovieLibDecodeJob`.
+// Heap-allocated so that static destructors do not terminate the process if a
+// movie is not properly released.
+static std::thread* gMovieLibThread = NULL;
+
+// Guards read-ahead state and `gMovieLibDecodeJob`.
+static std::mutex gMovieLibMutex;
+
+// Signalled on any change of read-ahead state or `gMovieLibDecodeJob`.
+static std::condition_variable gMovieLibCondition;
+
+static bool gMovieLibThreadStopping = false;
+
+// Ring of records, `gMovieLibRecordCount` of them starting at
+// `gMovieLibRecordFirst` are read. These are allocated with `malloc` since
+// memory procs set by the game are not safe to call from another thread.
+static unsigned char* gMovieLibRecords[MOVIE_LIB_READ_AHEAD_RECORDS];
+static unsigned int gMovieLibRecordCapacities[MOVIE_LIB_READ_AHEAD_RECORDS];
+static int gMovieLibRecordFirst;
+static int gMovieLibRecordCount;
+
+// True when the first record was handed out by `_ioNextRecord`.
+static bool gMovieLibRecordTaken;
+
+// True when there is nothing more to read (end of file or read error).
+static bool gMovieLibReadDone;
+
+static MovieDecodeJob gMovieLibDecodeJob;
+
 // 0x4F4800
 void movieLibSetMemoryProcs(MveMallocFunc* mallocProc, MveFreeFunc* freeProc)
 {
@@ -529,6 +618,19 @@ void movieLibSetReadProc(MovieReadProc* readProc)
     gMovieLibReadProc = readProc;
 }
 
+// CE: Enables or disables waiting for frame time.
+void movieLibSetSync(bool enabled)
+{
+    gMovieLibSync = enabled;
+}
+
+// CE: Enables or disables reading and decoding ahead on a separate thread.
+// Takes effect with the next `_MVE_rmPrepMovie`.
+void movieLibSetReadAhead(bool enabled)
+{
+    gMovieLibReadAhead = enabled;
+}
+
 // 0x4F4890
 static void _MVE_MemInit(STRUCT_6B3690* a1, int a2, void* a3)
 {
@@ -661,6 +763,11 @@ int _MVE_rmPrepMovie(void* handle, int a2, int a3, char a4)
         return -8;
     }
 
+    // CE: Read the rest of the file on a separate thread.
+    if (gMovieLibReadAhead) {
+        movieLibThreadStart();
+    }
+
     _rm_p = _ioNextRecord();
     _rm_len = 0;
 
@@ -757,6 +864,34 @@ static unsigned char* _ioNextRecord()
 {
     unsigned char* buf;
 
+    // CE: Take the next record from the read-ahead thread.
+    if (gMovieLibThread != NULL) {
+        std::unique_lock<std::mutex> lock(gMovieLibMutex);
+
+        if (gMovieLibRecordTaken) {
+            // The decode job can refer to the record being released.
+            while (gMovieLibDecodeJob.state == MOVIE_DECODE_JOB_QUEUED || gMovieLibDecodeJob.state == MOVIE_DECODE_JOB_RUNNING) {
+                gMovieLibCondition.wait(lock);
+            }
+
+            gMovieLibRecordFirst = (gMovieLibRecordFirst + 1) % MOVIE_LIB_READ_AHEAD_RECORDS;
+            gMovieLibRecordCount--;
+            gMovieLibRecordTaken = false;
+            gMovieLibCondition.notify_all();
+        }
+
+        while (gMovieLibRecordCount == 0 && !gMovieLibReadDone) {
+            gMovieLibCondition.wait(lock);
+        }
+
+        if (gMovieLibRecordCount == 0) {
+            return NULL;
+        }
+
+        gMovieLibRecordTaken = true;
+        return gMovieLibRecords[gMovieLibRecordFirst];
+    }
+
     buf = (unsigned char*)_ioRead((_io_next_hdr & 0xFFFF) + 4);
     if (buf == NULL) {
         return NULL;
@@ -767,6 +902,228 @@ static unsigned char* _ioNextRecord()
     return buf;
 }
 
+// CE: Starts read-ahead thread, the movie header must already be read by
+// `_ioReset`.
+static void movieLibThreadStart()
+{
+    movieLibThreadStop();
+
+    gMovieLibRecordFirst = 0;
+    gMovieLibRecordCount = 0;
+    gMovieLibRecordTaken = false;
+    gMovieLibReadDone = false;
+    gMovieLibThreadStopping = false;
+    gMovieLibDecodeJob.state = MOVIE_DECODE_JOB_NONE;
+
+    gMovieLibThread = new std::thread(movieLibThreadRun);
+}
+
+// CE: Stops read-ahead thread, waiting for decode job in progress. Records
+// which were read but not handed out are dropped.
+static void movieLibThreadStop()
+{
+    if (gMovieLibThread == NULL) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(gMovieLibMutex);
+        gMovieLibThreadStopping = true;
+        gMovieLibCondition.notify_all();
+    }
+
+    gMovieLibThread->join();
+    delete gMovieLibThread;
+    gMovieLibThread = NULL;
+
+    gMovieLibRecordCount = 0;
+    gMovieLibRecordTaken = false;
+    gMovieLibDecodeJob.state = MOVIE_DECODE_JOB_NONE;
+}
+
+// CE: Read-ahead thread, decode job has priority over reading since the main
+// thread is waiting for it sooner.
+static void movieLibThreadRun()
+{
+    std::unique_lock<std::mutex> lock(gMovieLibMutex);
+
+    while (!gMovieLibThreadStopping) {
+        if (gMovieLibDecodeJob.state == MOVIE_DECODE_JOB_QUEUED) {
+            MovieDecodeJob job = gMovieLibDecodeJob;
+            gMovieLibDecodeJob.state = MOVIE_DECODE_JOB_RUNNING;
+            lock.unlock();
+
+            _nfPkDecomp(job.dest, job.prev, job.map, job.data, job.x, job.y, job.width, job.height);
+
+            lock.lock();
+            gMovieLibDecodeJob.state = MOVIE_DECODE_JOB_DONE;
+            gMovieLibCondition.notify_all();
+            continue;
+        }
+
+        if (!gMovieLibReadDone && gMovieLibRecordCount < MOVIE_LIB_READ_AHEAD_RECORDS) {
+            // The slot past the last read record stays free while we read,
+            // releasing records moves first and count in step.
+            int index = (gMovieLibRecordFirst + gMovieLibRecordCount) % MOVIE_LIB_READ_AHEAD_RECORDS;
+            lock.unlock();
+
+            bool read = movieLibReadRecord(index);
+
+            lock.lock();
+            if (read) {
+                gMovieLibRecordCount++;
+            } else {
+                gMovieLibReadDone = true;
+            }
+            gMovieLibCondition.notify_all();
+            continue;
+        }
+
+        gMovieLibCondition.wait(lock);
+    }
+}
+
+// CE: Reads next record into the given slot, same as `_ioNextRecord`.
+static bool movieLibReadRecord(int index)
+{
+    unsigned int size = (_io_next_hdr & 0xFFFF) + 4;
+
+    if (gMovieLibRecordCapacities[index] < size) {
+        unsigned char* buf = (unsigned char*)realloc(gMovieLibRecords[index], size + 100);
+        if (buf == NULL) {
+            return false;
+        }
+
+        gMovieLibRecords[index] = buf;
+        gMovieLibRecordCapacities[index] = size + 100;
+    }
+
+    unsigned char* buf = gMovieLibRecords[index];
+    if (gMovieLibReadProc(_io_handle, buf, size) < 1) {
+        return false;
+    }
+
+    _io_next_hdr = loadUInt32LE(buf + (_io_next_hdr & 0xFFFF));
+
+    return true;
+}
+
+// CE: Walks chunks following the frame being shown the same way
+// `_MVE_rmStepMovie` is going to, and queues decoding of the next video chunk
+// on the read-ahead thread.
+//
+// Only chunks which swap surfaces are decoded ahead: they are decoded into
+// the back surface, so the current frame can be presented at the same time.
+// The walk gives up on chunks which change surfaces or would stop the movie.
+static void movieLibDecodeAhead(unsigned char* p, int len)
+{
+    if (gMovieLibThread == NULL) {
+        return;
+    }
+
+    if (dword_6B4027 || (dword_51EBD8 & 3) != 0) {
+        return;
+    }
+
+    if (gMovieSdlSurface1 == NULL || gMovieSdlSurface2 == NULL) {
+        return;
+    }
+
+    if (SDL_MUSTLOCK(gMovieSdlSurface1) || SDL_MUSTLOCK(gMovieSdlSurface2)) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(gMovieLibMutex);
+
+    if (gMovieLibDecodeJob.state != MOVIE_DECODE_JOB_NONE || !gMovieLibRecordTaken) {
+        return;
+    }
+
+    unsigned char* map = NULL;
+    int ahead = 0;
+
+    while (1) {
+        unsigned int header = loadUInt32LE(p + len);
+        p += len + 4;
+        len = header & 0xFFFF;
+
+        switch ((header >> 16) & 0xFF) {
+        case 1:
+            ahead++;
+            if (ahead >= MOVIE_LIB_READ_AHEAD_RECORDS) {
+                return;
+            }
+
+            while (gMovieLibRecordCount <= ahead && !gMovieLibReadDone && !gMovieLibThreadStopping) {
+                gMovieLibCondition.wait(lock);
+            }
+
+            if (gMovieLibRecordCount <= ahead) {
+                return;
+            }
+
+            p = gMovieLibRecords[(gMovieLibRecordFirst + ahead) % MOVIE_LIB_READ_AHEAD_RECORDS];
+            len = 0;
+            map = NULL;
+            continue;
+        case 15:
+            map = p;
+            continue;
+        case 17:
+            if ((header >> 24) < 3 || map == NULL) {
+                return;
+            }
+
+            if ((loadUInt16LE(p + 12) & 0x01) == 0) {
+                return;
+            }
+
+            gMovieLibDecodeJob.chunk = p;
+            gMovieLibDecodeJob.map = map;
+            gMovieLibDecodeJob.data = p + 14;
+            gMovieLibDecodeJob.dest = (unsigned char*)gMovieSdlSurface2->pixels;
+            gMovieLibDecodeJob.prev = (unsigned char*)gMovieSdlSurface1->pixels;
+            gMovieLibDecodeJob.x = loadUInt16LE(p + 4);
+            gMovieLibDecodeJob.y = loadUInt16LE(p + 6);
+            gMovieLibDecodeJob.width = loadUInt16LE(p + 8);
+            gMovieLibDecodeJob.height = loadUInt16LE(p + 10);
+            gMovieLibDecodeJob.state = MOVIE_DECODE_JOB_QUEUED;
+            gMovieLibCondition.notify_all();
+            return;
+        case 0:
+        case 5:
+        case 7:
+            return;
+        default:
+            continue;
+        }
+    }
+}
+
+// CE: Waits for decode job to complete. Returns true if the job decoded
+// given chunk, which is then ready to be shown after surfaces are swapped.
+static bool movieLibFinishDecode(unsigned char* chunk)
+{
+    if (gMovieLibThread == NULL) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(gMovieLibMutex);
+
+    if (gMovieLibDecodeJob.state == MOVIE_DECODE_JOB_NONE) {
+        return false;
+    }
+
+    while (gMovieLibDecodeJob.state != MOVIE_DECODE_JOB_DONE && gMovieLibDecodeJob.state != MOVIE_DECODE_JOB_NONE) {
+        gMovieLibCondition.wait(lock);
+    }
+
+    bool decoded = gMovieLibDecodeJob.state == MOVIE_DECODE_JOB_DONE && gMovieLibDecodeJob.chunk == chunk;
+    gMovieLibDecodeJob.state = MOVIE_DECODE_JOB_NONE;
+
+    return decoded;
+}
+
 // 0x4F4DD0
 static void _sub_4F4DD()
 {
@@ -947,6 +1304,9 @@ LABEL_5:
         case 7:
             ++_rm_FrameCount;
 
+            // CE: Decode next video chunk while this frame is presented.
+            movieLibDecodeAhead((unsigned char*)v1, v0);
+
             v18 = 0;
             if ((v5 >> 24) >= 1) {
                 v18 = v1[2];
@@ -1019,6 +1379,22 @@ LABEL_5:
                 break;
             }
 
+            // CE: The chunk has already been decoded by the read-ahead
+            // thread into the surface that becomes current after the swap.
+            if (movieLibFinishDecode((unsigned char*)v1)) {
+                movieSwapSurfaces();
+
+                if (!movieLockSurfaces()) {
+                    v6 = -12;
+                    break;
+                }
+
+                movieSetFrameRect(v1[2], v1[3], v1[4], v1[5]);
+
+                movieUnlockSurfaces();
+                continue;
+            }
+
             // swap movie surfaces
             if (v1[6] & 0x01) {
                 movieSwapSurfaces();
@@ -1083,7 +1459,8 @@ LABEL_5:
                 break;
             }
 
-            _nfPkDecomp((unsigned char*)v3, (unsigned char*)&v1[7], v1[2], v1[3], v1[4], v1[5]);
+            movieSetFrameRect(v1[2], v1[3], v1[4], v1[5]);
+            _nfPkDecomp(gMovieDirectDrawSurfaceBuffer1, gMovieDirectDrawSurfaceBuffer2, (unsigned char*)v3, (unsigned char*)&v1[7], v1[2], v1[3], v1[4], v1[5]);
 
             // unlock
             movieUnlockSurfaces();
@@ -1103,6 +1480,11 @@ static int _syncInit(int a1, int a2)
 {
     int v2;
 
+    // CE: Headless decoding does not wait for frame time.
+    if (!gMovieLibSync) {
+        return 1;
+    }
+
     v2 = -((a2 >> 1) + a1 * a2);
 
     if (_sync_active && _sync_wait_quanta == v2) {
@@ -1469,6 +1851,10 @@ static void _MVE_sndResume()
 // 0x4F5CB0
 static int _nfConfig(int a1, int a2, int a3, int a4)
 {
+    // CE: Surfaces are about to be recreated, make sure the read-ahead thread
+    // is not decoding into them.
+    movieLibFinishDecode(NULL);
+
     if (gMovieSdlSurface1 != NULL) {
         SDL_FreeSurface(gMovieSdlSurface1);
         gMovieSdlSurface1 = NULL;
@@ -1535,13 +1921,15 @@ static int _nfConfig(int a1, int a2, int a3, int a4)
 static bool movieLockSurfaces()
 {
     if (gMovieSdlSurface1 != NULL && gMovieSdlSurface2 != NULL) {
-        if (SDL_LockSurface(gMovieSdlSurface1) != 0) {
+        // CE: Movie surfaces are plain software surfaces, which do not need
+        // to be locked to access pixels.
+        if (SDL_MUSTLOCK(gMovieSdlSurface1) && SDL_LockSurface(gMovieSdlSurface1) != 0) {
             return false;
         }
 
         gMovieDirectDrawSurfaceBuffer1 = (unsigned char*)gMovieSdlSurface1->pixels;
 
-        if (SDL_LockSurface(gMovieSdlSurface2) != 0) {
+        if (SDL_MUSTLOCK(gMovieSdlSurface2) && SDL_LockSurface(gMovieSdlSurface2) != 0) {
             return false;
         }
 
@@ -1554,8 +1942,13 @@ static bool movieLockSurfaces()
 // 0x4F5EF0
 static void movieUnlockSurfaces()
 {
-    SDL_UnlockSurface(gMovieSdlSurface1);
-    SDL_UnlockSurface(gMovieSdlSurface2);
+    if (SDL_MUSTLOCK(gMovieSdlSurface1)) {
+        SDL_UnlockSurface(gMovieSdlSurface1);
+    }
+
+    if (SDL_MUSTLOCK(gMovieSdlSurface2)) {
+        SDL_UnlockSurface(gMovieSdlSurface2);
+    }
 }
 
 // 0x4F5F20
@@ -1672,6 +2065,8 @@ static void _palLoadPalette(unsigned char* palette, int a2, int a3)
 // 0x4F6240
 void _MVE_rmEndMovie()
 {
+    movieLibThreadStop();
+
     if (_rm_active) {
         _syncWait();
         _syncRelease();
@@ -1699,6 +2094,15 @@ void _MVE_ReleaseMem()
 static void _ioRelease()
 {
     _MVE_MemFree(&_io_mem_buf);
+
+    // CE: Release read-ahead records.
+    movieLibThreadStop();
+
+    for (int index = 0; index < MOVIE_LIB_READ_AHEAD_RECORDS; index++) {
+        free(gMovieLibRecords[index]);
+        gMovieLibRecords[index] = NULL;
+        gMovieLibRecordCapacities[index] = 0;
+    }
 }
 
 // 0x4F6380
@@ -1863,8 +2267,21 @@ static void _nfPkConfig()
     } while (v5);
 }
 
+// CE: Sets rect of the last decoded video chunk for `_sfShowFrame`, which
+// used to be done by `_nfPkDecomp`.
+static void movieSetFrameRect(int a3, int a4, int a5, int a6)
+{
+    dword_6B401B = 8 * a3;
+    dword_6B4017 = 8 * a5;
+    dword_6B401F = 8 * a4 * byte_6B4016;
+    dword_6B4023 = 8 * a6 * byte_6B4016;
+}
+
 // 0x4F7359
-static void _nfPkDecomp(unsigned char* a1, unsigned char* a2, int a3, int a4, int a5, int a6)
+//
+// CE: Decodes into `buf1` with `buf2` holding previous frame, instead of
+// surface buffers, so that it can run on the read-ahead thread.
+static void _nfPkDecomp(unsigned char* buf1, unsigned char* buf2, unsigned char* a1, unsigned char* a2, int a3, int a4, int a5, int a6)
 {
     int v49;
     unsigned char* dest;
@@ -1884,18 +2301,13 @@ static void _nfPkDecomp(unsigned char* a1, unsigned char* a2, int a3, int a4, in
     unsigned int* dest_ptr;
     unsigned int nibbles[2];
 
-    dword_6B401B = 8 * a3;
-    dword_6B4017 = 8 * a5;
-    dword_6B401F = 8 * a4 * byte_6B4016;
-    dword_6B4023 = 8 * a6 * byte_6B4016;
-
-    var_8 = dword_6B3D00 - dword_6B4017;
-    dest = gMovieDirectDrawSurfaceBuffer1;
+    var_8 = dword_6B3D00 - 8 * a5;
+    dest = buf1;
 
     var_10 = dword_6B3CEC - 8;
 
     if (a3 || a4) {
-        dest = gMovieDirectDrawSurfaceBuffer1 + dword_6B401B + _mveBW * dword_6B401F;
+        dest = buf1 + 8 * a3 + _mveBW * (8 * a4 * byte_6B4016);
     }
 
     while (a6--) {
@@ -1918,7 +2330,7 @@ static void _nfPkDecomp(unsigned char* a1, unsigned char* a2, int a3, int a4, in
                 case 5:
                     switch (v7) {
                     case 0:
-                        v10 = gMovieDirectDrawSurfaceBuffer2 - gMovieDirectDrawSurfaceBuffer1;
+                        v10 = buf2 - buf1;
                         break;
                     case 2:
                     case 3:
@@ -1943,19 +2355,13 @@ static void _nfPkDecomp(unsigned char* a1, unsigned char* a2, int a3, int a4, in
                                 a2 += 2;
                             }
 
-                            v10 = getOffset(offset) + (gMovieDirectDrawSurfaceBuffer2 - gMovieDirectDrawSurfaceBuffer1);
+                            v10 = getOffset(offset) + (buf2 - buf1);
                         }
                         break;
                     }
 
-                    value2 = _mveBW;
-
-                    for (i = 0; i < 8; ++i) {
-                        memcpy(dest, dest + v10, 8);
-                        dest += value2;
-                    }
-
-                    dest -= value2;
+                    movieBlockCopy(dest, dest + v10, _mveBW, _mveBW);
+                    dest += _mveBW * 7;
 
                     dest -= var_10;
 
@@ -2668,119 +3074,36 @@ static void _nfPkDecomp(unsigned char* a1, unsigned char* a2, int a3, int a4, in
                     }
                     break;
                 case 11:
-                    value2 = _mveBW;
-
-                    for (i = 0; i < 32; i += 4) {
-                        memcpy(dest, &a2[i * 2], 8);
-                        dest += value2;
-                    }
-
-                    dest -= value2;
+                    movieBlockCopy(dest, a2, 8, _mveBW);
+                    dest += _mveBW * 7;
 
                     a2 += 64;
                     dest -= var_10;
                     break;
                 case 12:
-                    value2 = _mveBW;
-
-                    for (i = 0; i < 4; i++) {
-                        byte = a2[i * 4 + 0];
-                        value1 = byte | (byte << 8);
-
-                        byte = a2[i * 4 + 1];
-                        value1 |= (byte << 16) | (byte << 24);
-
-                        byte = a2[i * 4 + 2];
-                        value2 = byte | (byte << 8);
-
-                        byte = a2[i * 4 + 3];
-                        value2 |= (byte << 16) | (byte << 24);
-
-                        dest_ptr = (unsigned int*)dest;
-                        dest_ptr[0] = value1;
-                        dest_ptr[1] = value2;
-
-                        dest_ptr = (unsigned int*)(dest + _mveBW);
-                        dest_ptr[0] = value1;
-                        dest_ptr[1] = value2;
-
-                        dest += _mveBW * 2;
-                    }
-
-                    dest -= _mveBW;
+                    movieBlockScale2x(dest, a2, _mveBW);
+                    dest += _mveBW * 7;
 
                     a2 += 16;
                     dest -= var_10;
                     break;
                 case 13:
-                    byte = a2[0];
-                    value1 = byte | (byte << 8) | (byte << 16) | (byte << 24);
-
-                    byte = a2[1];
-                    value2 = byte | (byte << 8) | (byte << 16) | (byte << 24);
-
-                    for (i = 0; i < 2; i++) {
-                        dest_ptr = (unsigned int*)dest;
-                        dest_ptr[0] = value1;
-                        dest_ptr[1] = value2;
-
-                        dest_ptr = (unsigned int*)(dest + _mveBW);
-                        dest_ptr[0] = value1;
-                        dest_ptr[1] = value2;
-
-                        dest += _mveBW * 2;
-                    }
-
-                    byte = a2[2];
-                    value1 = byte | (byte << 8) | (byte << 16) | (byte << 24);
-
-                    byte = a2[3];
-                    value2 = byte | (byte << 8) | (byte << 16) | (byte << 24);
-
-                    for (i = 0; i < 2; i++) {
-                        dest_ptr = (unsigned int*)dest;
-                        dest_ptr[0] = value1;
-                        dest_ptr[1] = value2;
-
-                        dest_ptr = (unsigned int*)(dest + _mveBW);
-                        dest_ptr[0] = value1;
-                        dest_ptr[1] = value2;
-
-                        dest += _mveBW * 2;
-                    }
-
-                    dest -= _mveBW;
+                    movieBlockFillQuads(dest, a2, _mveBW);
+                    dest += _mveBW * 7;
 
                     a2 += 4;
                     dest -= var_10;
                     break;
                 case 14:
-                case 15:
-                    if (v7 == 14) {
-                        byte = *a2++;
-                        value1 = byte | (byte << 8) | (byte << 16) | (byte << 24);
-                        value2 = value1;
-                    } else {
-                        byte = loadUInt16LE(a2);
-                        a2 += 2;
-                        value1 = byte | (byte << 16);
-                        value2 = value1;
-                        value2 = (value2 << 8) | (value2 >> (32 - 8));
-                    }
+                    movieBlockFill(dest, *a2++, _mveBW);
+                    dest += _mveBW * 7;
 
-                    for (i = 0; i < 4; i++) {
-                        dest_ptr = (unsigned int*)dest;
-                        dest_ptr[0] = value1;
-                        dest_ptr[1] = value1;
-                        dest += _mveBW;
-
-                        dest_ptr = (unsigned int*)dest;
-                        dest_ptr[0] = value2;
-                        dest_ptr[1] = value2;
-                        dest += _mveBW;
-                    }
-
-                    dest -= _mveBW;
+                    dest -= var_10;
+                    break;
+                case 15:
+                    movieBlockFillDither(dest, loadUInt16LE(a2), _mveBW);
+                    a2 += 2;
+                    dest += _mveBW * 7;
 
                     dest -= var_10;
                     break;
@@ -2792,6 +3115,150 @@ static void _nfPkDecomp(unsigned char* a1, unsigned char* a2, int a3, int a4, in
     }
 }
 
+// CE: Copies 8x8 block. Opcodes 2 and 3 copy from the frame being decoded,
+// so source can overlap destination, every row is loaded before it's stored,
+// same as `memcpy` of 8 bytes used to do, and rows are copied top to bottom.
+static void movieBlockCopy(unsigned char* dest, const unsigned char* src, int srcPitch, int destPitch)
+{
+    for (int row = 0; row < 8; row++) {
+#if MOVIE_LIB_SSE2
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+#elif MOVIE_LIB_NEON
+        vst1_u8(dest, vld1_u8(src));
+#else
+        uint64_t value;
+        memcpy(&value, src, sizeof(value));
+        memcpy(dest, &value, sizeof(value));
+#endif
+        src += srcPitch;
+        dest += destPitch;
+    }
+}
+
+// CE: Fills 8x8 block with 4x4 colors, each doubled in both directions
+// (opcode 12).
+static void movieBlockScale2x(unsigned char* dest, const unsigned char* src, int pitch)
+{
+#if MOVIE_LIB_SSE2
+    __m128i colors = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i rows[2] = {
+        _mm_unpacklo_epi8(colors, colors),
+        _mm_unpackhi_epi8(colors, colors),
+    };
+
+    for (int index = 0; index < 2; index++) {
+        __m128i high = _mm_unpackhi_epi64(rows[index], rows[index]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), rows[index]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + pitch), rows[index]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + pitch * 2), high);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + pitch * 3), high);
+        dest += pitch * 4;
+    }
+#elif MOVIE_LIB_NEON
+    for (int index = 0; index < 2; index++) {
+        uint8x8_t colors = vld1_u8(src + index * 8);
+        uint8x8x2_t rows = vzip_u8(colors, colors);
+        vst1_u8(dest, rows.val[0]);
+        vst1_u8(dest + pitch, rows.val[0]);
+        vst1_u8(dest + pitch * 2, rows.val[1]);
+        vst1_u8(dest + pitch * 3, rows.val[1]);
+        dest += pitch * 4;
+    }
+#else
+    for (int index = 0; index < 4; index++) {
+        uint64_t value = 0;
+        for (int x = 0; x < 4; x++) {
+            value |= (uint64_t)src[index * 4 + x] * 0x0101 << (x * 16);
+        }
+
+        memcpy(dest, &value, sizeof(value));
+        memcpy(dest + pitch, &value, sizeof(value));
+        dest += pitch * 2;
+    }
+#endif
+}
+
+// CE: Fills 8x8 block with 4x4 quadrants of given colors, top left, top
+// right, bottom left, bottom right (opcode 13).
+static void movieBlockFillQuads(unsigned char* dest, const unsigned char* colors, int pitch)
+{
+    for (int index = 0; index < 2; index++) {
+#if MOVIE_LIB_SSE2
+        __m128i value = _mm_unpacklo_epi32(_mm_set1_epi8(static_cast<char>(colors[index * 2])), _mm_set1_epi8(static_cast<char>(colors[index * 2 + 1])));
+#elif MOVIE_LIB_NEON
+        uint8x8_t value = vext_u8(vdup_n_u8(colors[index * 2]), vdup_n_u8(colors[index * 2 + 1]), 4);
+#else
+        uint64_t value = (uint64_t)colors[index * 2] * 0x01010101 | (uint64_t)colors[index * 2 + 1] * 0x01010101 << 32;
+#endif
+
+        for (int row = 0; row < 4; row++) {
+#if MOVIE_LIB_SSE2
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), value);
+#elif MOVIE_LIB_NEON
+            vst1_u8(dest, value);
+#else
+            memcpy(dest, &value, sizeof(value));
+#endif
+            dest += pitch;
+        }
+    }
+}
+
+// CE: Fills 8x8 block with a single color (opcode 14).
+static void movieBlockFill(unsigned char* dest, int color, int pitch)
+{
+#if MOVIE_LIB_SSE2
+    __m128i value = _mm_set1_epi8(static_cast<char>(color));
+#elif MOVIE_LIB_NEON
+    uint8x8_t value = vdup_n_u8(static_cast<uint8_t>(color));
+#else
+    uint64_t value = (uint64_t)(color & 0xFF) * 0x0101010101010101ULL;
+#endif
+
+    for (int row = 0; row < 8; row++) {
+#if MOVIE_LIB_SSE2
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), value);
+#elif MOVIE_LIB_NEON
+        vst1_u8(dest, value);
+#else
+        memcpy(dest, &value, sizeof(value));
+#endif
+        dest += pitch;
+    }
+}
+
+// CE: Fills 8x8 block with a checkerboard of two colors, low byte of `colors`
+// comes first on even rows (opcode 15).
+static void movieBlockFillDither(unsigned char* dest, int colors, int pitch)
+{
+    int swapped = ((colors & 0xFF) << 8) | ((colors >> 8) & 0xFF);
+
+#if MOVIE_LIB_SSE2
+    __m128i even = _mm_set1_epi16(static_cast<short>(colors));
+    __m128i odd = _mm_set1_epi16(static_cast<short>(swapped));
+#elif MOVIE_LIB_NEON
+    uint8x8_t even = vreinterpret_u8_u16(vdup_n_u16(static_cast<uint16_t>(colors)));
+    uint8x8_t odd = vreinterpret_u8_u16(vdup_n_u16(static_cast<uint16_t>(swapped)));
+#else
+    uint64_t even = (uint64_t)(colors & 0xFFFF) * 0x0001000100010001ULL;
+    uint64_t odd = (uint64_t)swapped * 0x0001000100010001ULL;
+#endif
+
+    for (int row = 0; row < 8; row += 2) {
+#if MOVIE_LIB_SSE2
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), even);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + pitch), odd);
+#elif MOVIE_LIB_NEON
+        vst1_u8(dest, even);
+        vst1_u8(dest + pitch, odd);
+#else
+        memcpy(dest, &even, sizeof(even));
+        memcpy(dest + pitch, &odd, sizeof(odd));
+#endif
+        dest += pitch * 2;
+    }
+}
+
 constexpr uint16_t loadUInt16LE(const uint8_t* b)
 {
     return (b[1] << 8) | b[0];
@@ -12,6 +12,8 @@ typedef void(MovieShowFrameProc)(SDL_Surface*, int, int, int, int, int, int, int
 
 void movieLibSetMemoryProcs(MveMallocFunc* mallocProc, MveFreeFunc* freeProc);
 void movieLibSetReadProc(MovieReadProc* readProc);
+void movieLibSetSync(bool enabled);
+void movieLibSetReadAhead(bool enabled);
 void movieLibSetVolume(int volume);
 void movieLibSetPan(int pan);
 void _MVE_sfSVGA(int a1, int a2, int a3, int a4, int a5, int a6, int a7, int a8, int a9);
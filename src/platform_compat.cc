@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #else
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
@@ -356,4 +357,57 @@ long getFileSize(FILE* stream)
     return filesize;
 }
 
+// Maps the whole file behind `stream` read-only into the address space. The
+// mapping stays valid after the stream is closed and must be released with
+// `compat_munmap_file`.
+void* compat_mmap_file(FILE* stream, size_t* sizePtr)
+{
+    long size = getFileSize(stream);
+    if (size <= 0) {
+        return NULL;
+    }
+
+#ifdef _WIN32
+    HANDLE file = (HANDLE)_get_osfhandle(_fileno(stream));
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        return NULL;
+    }
+
+    // The view keeps the mapping object alive.
+    void* ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (ptr == NULL) {
+        return NULL;
+    }
+#else
+    void* ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(stream), 0);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+#endif
+
+    *sizePtr = size;
+
+    return ptr;
+}
+
+void compat_munmap_file(void* ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(ptr);
+#else
+    munmap(ptr, size);
+#endif
+}
+
 } // namespace fallout
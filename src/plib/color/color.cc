@@ -42,6 +42,9 @@ static char* errorStr = _aColor_cNoError;
 // 0x539EE4
 static bool colorsInited = false;
 
+// CE: Incremented every time color tables are rebuilt.
+static unsigned int colorTablesGeneration;
+
 // 0x539EE8
 static double currentGamma = 1.0;
 
@@ -606,6 +609,10 @@ static void rebuildColorBlendTables()
 {
     int i;
 
+    // CE: Every palette change ends up here, let users of the color tables
+    // know they are stale.
+    colorTablesGeneration++;
+
     for (i = 0; i < 256; i++) {
         if (blendTable[i]) {
             buildBlendTable(blendTable[i], i);
@@ -782,4 +789,11 @@ unsigned char* getColorPalette()
     return cmap;
 }
 
+// CE: Returns a counter which changes whenever `intensityColorTable` and
+// other color tables are rebuilt.
+unsigned int colorGetTablesGeneration()
+{
+    return colorTablesGeneration;
+}
+
 } // namespace fallout
@@ -65,6 +65,7 @@ bool colorPopColorPalette();
 bool initColors();
 void colorsClose();
 unsigned char* getColorPalette();
+unsigned int colorGetTablesGeneration();
 
 } // namespace fallout
 
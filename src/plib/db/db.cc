@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <mutex>
+#include <thread>
+
 #if defined(_WIN32)
 #include <windows.h>
 #else
@@ -21,7 +24,13 @@ namespace fallout {
 
 #define DB_DATABASE_LIST_CAPACITY 10
 #define DB_DATABASE_FILE_LIST_CAPACITY 32
-#define DB_HASH_TABLE_SIZE 4095
+
+// CE: Initial capacity of the patches file name set, grows by doubling.
+#define DB_HASH_TABLE_INITIAL_CAPACITY 1024
+
+// Set on memory-backed `DB_FILE`s pointing directly into the mapped datafile.
+// Such buffers are borrowed and must not be freed on close.
+#define DB_FILE_MAPPED 0x100
 
 #if defined(_WIN32)
 #define PATH_SEP '\\'
@@ -44,6 +53,22 @@ typedef struct DB_FILE {
     unsigned char* field_20;
 } DB_FILE;
 
+// CE: Slot of the datafile index - an open addressing table of all files in
+// the datafile keyed by their case-folded `DIR\FILE` path.
+typedef struct DB_INDEX_SLOT {
+    // Zero marks empty slot.
+    unsigned int hash;
+    const char* path;
+    dir_entry* de;
+} DB_INDEX_SLOT;
+
+// CE: Slot of the patches file name set.
+typedef struct DB_HASH_SLOT {
+    // Zero marks empty slot.
+    unsigned int hash;
+    char* name;
+} DB_HASH_SLOT;
+
 typedef struct DB_DATABASE {
     char* datafile;
     FILE* stream;
@@ -54,7 +79,14 @@ typedef struct DB_DATABASE {
     assoc_array* entries;
     int files_length;
     DB_FILE files[DB_DATABASE_FILE_LIST_CAPACITY];
-    unsigned char* hash_table;
+    DB_HASH_SLOT* hash_table;
+    unsigned int hash_table_mask;
+    int hash_table_length;
+    unsigned char* mapped_data;
+    size_t mapped_size;
+    DB_INDEX_SLOT* index;
+    unsigned int index_mask;
+    char* index_paths;
 } DB_DATABASE;
 
 typedef struct DB_FIND_DATA {
@@ -84,14 +116,22 @@ static int db_init_hash_table(DB_DATABASE* database);
 static int db_reset_hash_table(DB_DATABASE* database);
 static int db_fill_hash_table(DB_DATABASE* database, const char* path);
 static int db_add_hash_entry_to_database(DB_DATABASE* database, const char* path, int sep);
-static int db_set_hash_value(DB_DATABASE* database, unsigned int key, unsigned char enabled);
+static int db_set_hash_value(DB_DATABASE* database, const char* name, unsigned int hash);
 static int db_get_hash_value(DB_DATABASE* database, const char* path, int sep, int* value_ptr);
-static int db_hash_string_to_key(const char* path, int sep, unsigned int* key_ptr);
+static const char* db_hash_string_to_key(const char* path, int sep, unsigned int* key_ptr);
 static void db_exit_hash_table(DB_DATABASE* database);
+static void db_clear_hash_table(DB_DATABASE* database);
+static unsigned int db_index_hash(const char* path);
+static bool db_index_equals(const char* key, const char* path);
+static int db_init_index(DB_DATABASE* database);
+static void db_exit_index(DB_DATABASE* database);
 static DB_FILE* db_add_fp_rec(FILE* stream, unsigned char* a2, int a3, int flags);
 static int db_delete_fp_rec(DB_FILE* stream);
 static int db_find_empty_position(int* position_ptr);
-static int db_find_dir_entry(char* path, dir_entry* de);
+static int db_find_dir_entry(DB_DATABASE* database, char* path, dir_entry* de);
+static const unsigned char* db_mapped_entry_data(DB_DATABASE* database, const dir_entry* de);
+static bool db_patch_exists(DB_DATABASE* database, char* path);
+static bool db_read_callback_allowed();
 static int db_findfirst(const char* path, DB_FIND_DATA* find_data);
 static int db_findnext(DB_FIND_DATA* find_data);
 static int db_findclose(DB_FIND_DATA* find_data);
@@ -128,6 +168,8 @@ static db_free_func* db_free = db_default_free;
 // 0x539D48
 static bool hash_is_on = false;
 
+static bool mmap_is_on = false;
+
 // NOTE: Original type is `unsigned long`.
 //
 // 0x539D4C
@@ -141,12 +183,45 @@ static size_t read_threshold = 16384;
 // 0x539D54
 static db_read_callback* read_callback = NULL;
 
+// The thread which registered `read_callback`. The callback usually pumps UI,
+// so reads performed on other threads do not invoke it.
+static std::thread::id read_callback_thread;
+
+// Recursive mutex which also tracks how many times calling thread holds it,
+// see `db_lock_held`.
+typedef struct DbMutex {
+    std::recursive_mutex mutex;
+
+    void lock()
+    {
+        mutex.lock();
+        db_lock_depth++;
+    }
+
+    void unlock()
+    {
+        db_lock_depth--;
+        mutex.unlock();
+    }
+
+    static thread_local int db_lock_depth;
+} DbMutex;
+
+thread_local int DbMutex::db_lock_depth = 0;
+
+// Serializes access to databases, current database selection and open files
+// between the main thread and cache loader threads. Public functions lock it
+// on entry, it's recursive because they call each other.
+static DbMutex db_mutex;
+
 // 0x6713C8
 static DB_DATABASE* database_list[DB_DATABASE_LIST_CAPACITY];
 
 // 0x4AEE90
 DB_DATABASE* db_init(const char* datafile, const char* datafile_path, const char* patches_path, int show_cursor)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     DB_DATABASE* database;
 
     if (db_create_database(&database) != 0) {
@@ -169,7 +244,7 @@ DB_DATABASE* db_init(const char* datafile, const char* datafile_path, const char
 
     if (hash_is_on) {
         if (db_init_hash_table(database) != 0) {
-            database->hash_table = NULL;
+            db_exit_hash_table(database);
         }
     }
 
@@ -179,6 +254,8 @@ DB_DATABASE* db_init(const char* datafile, const char* datafile_path, const char
 // 0x4AEF10
 int db_select(DB_DATABASE* db_handle)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int index;
 
     if (db_handle == INVALID_DATABASE_HANDLE) {
@@ -198,6 +275,8 @@ int db_select(DB_DATABASE* db_handle)
 // 0x4AEF54
 DB_DATABASE* db_current()
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (current_database != NULL) {
         return current_database;
     }
@@ -208,6 +287,8 @@ DB_DATABASE* db_current()
 // 0x4AEF6C
 int db_total()
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int index;
     int count;
 
@@ -224,6 +305,8 @@ int db_total()
 // 0x4AEF88
 int db_close(DB_DATABASE* db_handle)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int index;
 
     if (db_handle == NULL || db_handle == INVALID_DATABASE_HANDLE) {
@@ -251,6 +334,8 @@ int db_close(DB_DATABASE* db_handle)
 // 0x4AF048
 void db_exit()
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int index;
 
     for (index = 0; index < DB_DATABASE_LIST_CAPACITY; index++) {
@@ -263,6 +348,8 @@ void db_exit()
 // 0x4AF068
 int db_dir_entry(const char* name, dir_entry* de)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     char path[COMPAT_MAX_PATH];
     bool v2;
     bool v3;
@@ -325,7 +412,7 @@ int db_dir_entry(const char* name, dir_entry* de)
 
     compat_strupr(path);
 
-    if (db_find_dir_entry(path, de) != 0) {
+    if (db_find_dir_entry(current_database, path, de) != 0) {
         return -1;
     }
 
@@ -341,6 +428,8 @@ int db_dir_entry(const char* name, dir_entry* de)
 // 0x4AF4F8
 int db_read_to_buf(const char* filename, unsigned char* buf)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     bool v1;
     char path[COMPAT_MAX_PATH];
     bool v3;
@@ -353,6 +442,7 @@ int db_read_to_buf(const char* filename, unsigned char* buf)
     dir_entry de;
     unsigned char* end;
     unsigned short v4;
+    const unsigned char* data;
 
     if (current_database == NULL) {
         return -1;
@@ -392,7 +482,7 @@ int db_read_to_buf(const char* filename, unsigned char* buf)
 
         if (stream != NULL) {
             size = getFileSize(stream);
-            if (read_callback != NULL) {
+            if (read_callback != NULL && db_read_callback_allowed()) {
                 remaining_size = size;
                 chunk_size = read_threshold - read_count;
 
@@ -431,10 +521,27 @@ int db_read_to_buf(const char* filename, unsigned char* buf)
 
     compat_strupr(path);
 
-    if (db_find_dir_entry(path, &de) == -1) {
+    if (db_find_dir_entry(current_database, path, &de) == -1) {
         return -1;
     }
 
+    data = db_mapped_entry_data(current_database, &de);
+    if (data != NULL) {
+        if (db_decode_entry(&de, data, buf) != 0) {
+            return -1;
+        }
+
+        if (read_callback != NULL && db_read_callback_allowed()) {
+            read_count += de.length;
+            while (read_count >= read_threshold) {
+                read_count -= read_threshold;
+                read_callback();
+            }
+        }
+
+        return 0;
+    }
+
     if (current_database->stream == NULL) {
         return -1;
     }
@@ -452,7 +559,7 @@ int db_read_to_buf(const char* filename, unsigned char* buf)
         lzss_decode_to_buf(current_database->stream, buf, de.field_C);
         break;
     case 32:
-        if (read_callback != NULL) {
+        if (read_callback != NULL && db_read_callback_allowed()) {
             remaining_size = de.length;
             chunk_size = read_threshold - read_count;
 
@@ -477,7 +584,7 @@ int db_read_to_buf(const char* filename, unsigned char* buf)
         break;
     case 64:
         end = buf + de.length;
-        if (read_callback != NULL) {
+        if (read_callback != NULL && db_read_callback_allowed()) {
             while (buf < end) {
                 if (fread_short(current_database->stream, &v4) == 0) {
                     if ((v4 & 0x8000) != 0) {
@@ -492,7 +599,11 @@ int db_read_to_buf(const char* filename, unsigned char* buf)
                             read_callback();
                         }
                     } else {
-                        read_count += lzss_decode_to_buf(current_database->stream, buf, v4);
+                        // CE: Advance output buffer, original code decodes
+                        // every compressed chunk at the same position.
+                        bytes_read = lzss_decode_to_buf(current_database->stream, buf, v4);
+                        buf += bytes_read;
+                        read_count += bytes_read;
                         while (read_count >= read_threshold) {
                             read_count -= read_threshold;
                             read_callback();
@@ -521,6 +632,8 @@ int db_read_to_buf(const char* filename, unsigned char* buf)
 // 0x4AF9C4
 DB_FILE* db_fopen(const char* filename, const char* mode)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     bool v1;
     char path[COMPAT_MAX_PATH];
     FILE* stream;
@@ -532,6 +645,7 @@ DB_FILE* db_fopen(const char* filename, const char* mode)
     int k;
     dir_entry de;
     unsigned char* buf;
+    const unsigned char* data;
 
     if (current_database == NULL) {
         return NULL;
@@ -624,10 +738,31 @@ DB_FILE* db_fopen(const char* filename, const char* mode)
 
     compat_strupr(path);
 
-    if (db_find_dir_entry(path, &de) == -1) {
+    if (db_find_dir_entry(current_database, path, &de) == -1) {
         return NULL;
     }
 
+    // With the datafile mapped every entry is served from memory: stored
+    // entries are used in place, compressed ones are expanded up front.
+    data = db_mapped_entry_data(current_database, &de);
+    if (data != NULL) {
+        if ((de.flags & 0xF0) == 32) {
+            return db_add_fp_rec(NULL, (unsigned char*)data, de.length, flags | 0x10 | 0x8 | DB_FILE_MAPPED);
+        }
+
+        buf = (unsigned char*)internal_malloc(de.length);
+        if (buf == NULL) {
+            return NULL;
+        }
+
+        if (db_decode_entry(&de, data, buf) != 0) {
+            internal_free(buf);
+            return NULL;
+        }
+
+        return db_add_fp_rec(NULL, buf, de.length, flags | 0x10 | 0x8);
+    }
+
     if (current_database->stream == NULL) {
         return NULL;
     }
@@ -664,12 +799,16 @@ DB_FILE* db_fopen(const char* filename, const char* mode)
 // 0x4B2664
 int db_fclose(DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     return db_delete_fp_rec(stream);
 }
 
 // 0x4AFD50
 size_t db_fread(void* ptr, size_t size, size_t count, DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int remaining_size;
     int chunk_size;
     size_t bytes_read;
@@ -682,7 +821,7 @@ size_t db_fread(void* ptr, size_t size, size_t count, DB_FILE* stream)
 
     if (stream != NULL) {
         if ((stream->flags & 0x4) != 0) {
-            if (read_callback != NULL) {
+            if (read_callback != NULL && db_read_callback_allowed()) {
                 remaining_size = size * count;
                 chunk_size = read_threshold - read_count;
 
@@ -719,7 +858,7 @@ size_t db_fread(void* ptr, size_t size, size_t count, DB_FILE* stream)
 
                         if (elements_read != 0) {
                             remaining_size = elements_read * size;
-                            if (read_callback != NULL) {
+                            if (read_callback != NULL && db_read_callback_allowed()) {
                                 chunk_size = read_threshold - read_count;
                                 while (remaining_size >= chunk_size) {
                                     remaining_size -= chunk_size;
@@ -758,7 +897,7 @@ size_t db_fread(void* ptr, size_t size, size_t count, DB_FILE* stream)
 
                         if (elements_read != 0) {
                             if (fseek(stream->database->stream, stream->field_18, SEEK_SET) == 0) {
-                                if (read_callback != NULL) {
+                                if (read_callback != NULL && db_read_callback_allowed()) {
                                     remaining_size = elements_read * size;
                                     chunk_size = read_threshold - read_count;
 
@@ -805,7 +944,7 @@ size_t db_fread(void* ptr, size_t size, size_t count, DB_FILE* stream)
 
                         if (elements_read != 0) {
                             remaining_size = elements_read * size;
-                            if (read_callback != NULL) {
+                            if (read_callback != NULL && db_read_callback_allowed()) {
                                 chunk_size = read_threshold - read_count;
                                 while (remaining_size > chunk_size) {
                                     db_preload_buffer(stream);
@@ -884,6 +1023,8 @@ size_t db_fread(void* ptr, size_t size, size_t count, DB_FILE* stream)
 // 0x4B02A0
 int db_fgetc(DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int ch = -1;
     int next_ch;
 
@@ -949,7 +1090,7 @@ int db_fgetc(DB_FILE* stream)
         }
     }
 
-    if (read_callback != NULL) {
+    if (read_callback != NULL && db_read_callback_allowed()) {
         read_count++;
         if (read_count >= read_threshold) {
             read_callback();
@@ -963,6 +1104,8 @@ int db_fgetc(DB_FILE* stream)
 // 0x4B03F0
 int db_ungetc(int ch, DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream != NULL) {
         if ((stream->flags & 0x4) != 0) {
             return ungetc(ch, stream->uncompressed_file_stream);
@@ -1002,6 +1145,8 @@ int db_ungetc(int ch, DB_FILE* stream)
 // 0x4B04A4
 char* db_fgets(char* string, size_t size, DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     char* res = NULL;
     size_t index;
     int ch;
@@ -1040,6 +1185,8 @@ char* db_fgets(char* string, size_t size, DB_FILE* stream)
 // 0x4B051C
 int db_fseek(DB_FILE* stream, long offset, int origin)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int rc = -1;
     long current_offset;
     unsigned char* v1;
@@ -1123,6 +1270,8 @@ int db_fseek(DB_FILE* stream, long offset, int origin)
 // 0x4B06A8
 long db_ftell(DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream != NULL) {
         if ((stream->flags & 0x4) != 0) {
             return ftell(stream->uncompressed_file_stream);
@@ -1143,6 +1292,8 @@ long db_ftell(DB_FILE* stream)
 // 0x4B06F4
 void db_rewind(DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream != NULL) {
         if ((stream->flags & 0x4) != 0) {
             rewind(stream->uncompressed_file_stream);
@@ -1170,6 +1321,8 @@ void db_rewind(DB_FILE* stream)
 // 0x4B0764
 size_t db_fwrite(const void* buf, size_t size, size_t count, DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream != NULL && (stream->flags & 0x4) != 0) {
         return fwrite(buf, size, count, stream->uncompressed_file_stream);
     }
@@ -1180,6 +1333,8 @@ size_t db_fwrite(const void* buf, size_t size, size_t count, DB_FILE* stream)
 // 0x4B077C
 int db_fputc(int ch, DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream != NULL && (stream->flags & 0x4) != 0) {
         return fputc(ch, stream->uncompressed_file_stream);
     }
@@ -1190,6 +1345,8 @@ int db_fputc(int ch, DB_FILE* stream)
 // 0x4B0794
 int db_fputs(const char* string, DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream != NULL && (stream->flags & 0x4) != 0) {
         return fputs(string, stream->uncompressed_file_stream);
     }
@@ -1558,6 +1715,8 @@ int db_fprintf(DB_FILE* stream, const char* format, ...)
 // 0x4B0E98
 int db_feof(DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream == NULL) {
         return -1;
     }
@@ -1580,6 +1739,8 @@ int db_feof(DB_FILE* stream)
 // 0x4B0EF0
 int db_get_file_list(const char* filespec, char*** filelist, char*** desclist, int desclen)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     bool v1;
     char path[COMPAT_MAX_PATH];
     char* sep;
@@ -1755,6 +1916,8 @@ int db_get_file_list(const char* filespec, char*** filelist, char*** desclist, i
 // 0x4B1518
 void db_free_file_list(char*** file_list, char*** desclist)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (file_list != NULL) {
         if (*file_list != NULL) {
             internal_free(*file_list);
@@ -1843,6 +2006,8 @@ static int db_assoc_save_db_dir_entry(DB_FILE* stream, void* buffer, size_t size
 // 0x4B1A98
 long db_filelength(DB_FILE* stream)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (stream == NULL) {
         return -1;
     }
@@ -1873,8 +2038,11 @@ void db_register_mem(db_malloc_func* malloc_func, db_strdup_func* strdup_func, d
 // 0x4B1B14
 void db_register_callback(db_read_callback* callback, size_t threshold)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (callback != NULL && threshold != 0) {
         read_callback = callback;
+        read_callback_thread = std::this_thread::get_id();
         read_threshold = threshold;
     } else {
         read_callback = NULL;
@@ -2027,6 +2195,15 @@ static int db_init_database(DB_DATABASE* database, const char* datafile, const c
         database->datafile_path[v2 + 1] = '\0';
     }
 
+    // CE: Failing to build the index is not fatal, lookups fall back to
+    // searching directory tree.
+    db_init_index(database);
+
+    // Failing to map the datafile is not fatal, reads fall back to `stream`.
+    if (mmap_is_on) {
+        database->mapped_data = (unsigned char*)compat_mmap_file(database->stream, &(database->mapped_size));
+    }
+
     return 0;
 }
 
@@ -2039,6 +2216,12 @@ static void db_exit_database(DB_DATABASE* database)
         return;
     }
 
+    if (database->mapped_data != NULL) {
+        compat_munmap_file(database->mapped_data, database->mapped_size);
+        database->mapped_data = NULL;
+        database->mapped_size = 0;
+    }
+
     if (database->stream != NULL) {
         fclose(database->stream);
         database->stream = NULL;
@@ -2049,6 +2232,8 @@ static void db_exit_database(DB_DATABASE* database)
         database->datafile = NULL;
     }
 
+    db_exit_index(database);
+
     if (database->entries != NULL) {
         for (index = 0; index < database->root.size; index++) {
             assoc_free(&(database->entries[index]));
@@ -2129,11 +2314,15 @@ static int db_init_hash_table(DB_DATABASE* database)
         return -1;
     }
 
-    database->hash_table = (unsigned char*)internal_malloc(DB_HASH_TABLE_SIZE);
+    database->hash_table = (DB_HASH_SLOT*)internal_malloc(sizeof(*database->hash_table) * DB_HASH_TABLE_INITIAL_CAPACITY);
     if (database->hash_table == NULL) {
         return -1;
     }
 
+    memset(database->hash_table, 0, sizeof(*database->hash_table) * DB_HASH_TABLE_INITIAL_CAPACITY);
+    database->hash_table_mask = DB_HASH_TABLE_INITIAL_CAPACITY - 1;
+    database->hash_table_length = 0;
+
     return db_reset_hash_table(database);
 }
 
@@ -2143,6 +2332,170 @@ void db_enable_hash_table()
     hash_is_on = true;
 }
 
+// Locks database module for the calling thread. Used to make a sequence of
+// calls (such as temporary `db_select` followed by reads) atomic with respect
+// to other threads. Calls can be nested.
+void db_lock()
+{
+    db_mutex.lock();
+}
+
+void db_unlock()
+{
+    db_mutex.unlock();
+}
+
+// Returns `true` if calling thread holds database lock, either explicitly or
+// because it's inside a database function (i.e. in read callback). Such
+// thread must not wait for other threads which might need the database.
+bool db_lock_held()
+{
+    return DbMutex::db_lock_depth != 0;
+}
+
+// Requests datafiles opened by subsequent `db_init` calls to be mapped into
+// memory.
+void db_enable_mmap()
+{
+    mmap_is_on = true;
+}
+
+// Looks up `filePath` in the datafile of `db_handle` and returns pointer to
+// its raw (possibly compressed) bytes inside the mapped datafile.
+//
+// Lookups run under the database lock since patches hash table can grow at
+// runtime, but the mapping itself stays put until `db_close`, so returned
+// bytes can be expanded with `db_decode_entry` without holding the lock.
+// Does not depend on the current database. Returns -1 when the datafile is
+// not mapped or when the file is overridden in patches directory - the caller
+// is expected to fall back to `db_read_to_buf` in this case.
+int db_map_entry(DB_DATABASE* db_handle, const char* filePath, dir_entry* de, const unsigned char** data_ptr)
+{
+    std::lock_guard<DbMutex> guard(db_mutex);
+
+    char path[COMPAT_MAX_PATH];
+    bool v1;
+    const unsigned char* data;
+
+    if (db_handle == NULL || db_handle == INVALID_DATABASE_HANDLE) {
+        return -1;
+    }
+
+    if (filePath == NULL || de == NULL || data_ptr == NULL) {
+        return -1;
+    }
+
+    if (db_handle->mapped_data == NULL) {
+        return -1;
+    }
+
+    v1 = true;
+    if (filePath[0] == '@') {
+        strcpy(path, filePath + 1);
+        v1 = false;
+    }
+
+    if (db_handle->patches_path != NULL) {
+        if (v1) {
+            snprintf(path, sizeof(path), "%s%s", db_handle->patches_path, filePath);
+        }
+
+        if (db_patch_exists(db_handle, path)) {
+            return -1;
+        }
+    }
+
+    if (v1) {
+        snprintf(path, sizeof(path), "%s%s", db_handle->datafile_path, filePath);
+    }
+
+    compat_strupr(path);
+
+    if (db_find_dir_entry(db_handle, path, de) != 0) {
+        return -1;
+    }
+
+    data = db_mapped_entry_data(db_handle, de);
+    if (data == NULL) {
+        return -1;
+    }
+
+    if (de->flags == 0) {
+        de->flags = 16;
+    }
+
+    if (read_callback != NULL && db_read_callback_allowed()) {
+        read_count += de->length;
+        while (read_count >= read_threshold) {
+            read_count -= read_threshold;
+            read_callback();
+        }
+    }
+
+    *data_ptr = data;
+
+    return 0;
+}
+
+// Expands entry obtained with `db_map_entry` into `buf`, which must be at
+// least `de->length` bytes long. Reads at most `de->field_C` bytes of `data`
+// for compressed entries. Returns -1 if the entry is corrupt or truncated.
+// Reentrant.
+int db_decode_entry(const dir_entry* de, const unsigned char* data, unsigned char* buf)
+{
+    unsigned char* end;
+    const unsigned char* data_end;
+    unsigned short chunk_size;
+    int decoded;
+
+    switch (de->flags & 0xF0) {
+    case 0:
+    case 16:
+        if (lzss_decode_span(data, de->field_C, buf, de->length) != de->length) {
+            return -1;
+        }
+        return 0;
+    case 32:
+        memcpy(buf, data, de->length);
+        return 0;
+    case 64:
+        end = buf + de->length;
+        data_end = data + de->field_C;
+        while (buf < end) {
+            if (data_end - data < 2) {
+                return -1;
+            }
+
+            chunk_size = (data[0] << 8) | data[1];
+            data += 2;
+
+            if ((chunk_size & 0x8000) != 0) {
+                chunk_size &= ~0x8000;
+                if (chunk_size > end - buf || chunk_size > data_end - data) {
+                    return -1;
+                }
+                memcpy(buf, data, chunk_size);
+                decoded = chunk_size;
+            } else {
+                if (chunk_size > data_end - data) {
+                    return -1;
+                }
+                decoded = lzss_decode_span(data, chunk_size, buf, end - buf);
+            }
+
+            if (decoded == 0) {
+                return -1;
+            }
+
+            buf += decoded;
+            data += chunk_size;
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
 // 0x4B1F9C
 static int db_reset_hash_table(DB_DATABASE* database)
 {
@@ -2159,13 +2512,10 @@ static int db_reset_hash_table(DB_DATABASE* database)
     }
 
     if (database->hash_table == NULL) {
-        database->hash_table = (unsigned char*)internal_malloc(DB_HASH_TABLE_SIZE);
-        if (database->hash_table == NULL) {
-            return -1;
-        }
+        return db_init_hash_table(database);
     }
 
-    memset(database->hash_table, 0, DB_HASH_TABLE_SIZE);
+    db_clear_hash_table(database);
 
     return db_fill_hash_table(database, database->patches_path);
 }
@@ -2224,6 +2574,8 @@ static int db_fill_hash_table(DB_DATABASE* database, const char* path)
 // 0x4B2154
 int db_reset_hash_tables()
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     int index;
 
     if (!hash_is_on) {
@@ -2242,6 +2594,8 @@ int db_reset_hash_tables()
 // 0x4B218C
 int db_add_hash_entry(const char* path, int sep)
 {
+    std::lock_guard<DbMutex> guard(db_mutex);
+
     if (!hash_is_on) {
         return -1;
     }
@@ -2264,6 +2618,7 @@ int db_add_hash_entry(const char* path, int sep)
 // 0x4B21E0
 static int db_add_hash_entry_to_database(DB_DATABASE* database, const char* path, int sep)
 {
+    const char* name;
     unsigned int key;
 
     if (!hash_is_on) {
@@ -2278,16 +2633,24 @@ static int db_add_hash_entry_to_database(DB_DATABASE* database, const char* path
         return -1;
     }
 
-    if (db_hash_string_to_key(path, sep, &key) != 0) {
+    name = db_hash_string_to_key(path, sep, &key);
+    if (name == NULL) {
         return -1;
     }
 
-    return db_set_hash_value(database, key, 1);
+    return db_set_hash_value(database, name, key);
 }
 
+// CE: The patches hash table used to be a 32768 bit filter keyed by file
+// name, so every hit still had to be confirmed by opening the file. It's now
+// an exact set of case-folded file names, misses never touch the filesystem.
+//
 // 0x4B2258
-static int db_set_hash_value(DB_DATABASE* database, unsigned int key, unsigned char enabled)
+static int db_set_hash_value(DB_DATABASE* database, const char* name, unsigned int hash)
 {
+    unsigned int index;
+    DB_HASH_SLOT* slot;
+
     if (!hash_is_on) {
         return -1;
     }
@@ -2296,23 +2659,64 @@ static int db_set_hash_value(DB_DATABASE* database, unsigned int key, unsigned c
         return -1;
     }
 
-    if (key >= 0x7FFF) {
-        return -1;
+    // Keep load factor under 1/2.
+    if ((unsigned int)(database->hash_table_length + 1) * 2 > database->hash_table_mask + 1) {
+        unsigned int capacity = (database->hash_table_mask + 1) * 2;
+        DB_HASH_SLOT* slots = (DB_HASH_SLOT*)internal_malloc(sizeof(*slots) * capacity);
+        if (slots == NULL) {
+            return -1;
+        }
+
+        memset(slots, 0, sizeof(*slots) * capacity);
+
+        for (index = 0; index <= database->hash_table_mask; index++) {
+            DB_HASH_SLOT* old_slot = &(database->hash_table[index]);
+            if (old_slot->hash != 0) {
+                unsigned int pos = old_slot->hash & (capacity - 1);
+                while (slots[pos].hash != 0) {
+                    pos = (pos + 1) & (capacity - 1);
+                }
+                slots[pos] = *old_slot;
+            }
+        }
+
+        internal_free(database->hash_table);
+        database->hash_table = slots;
+        database->hash_table_mask = capacity - 1;
     }
 
-    if (enabled == true) {
-        database->hash_table[key / 8] |= 1 << (key % 8);
-    } else {
-        database->hash_table[key / 8] = 0;
+    index = hash & database->hash_table_mask;
+    while (1) {
+        slot = &(database->hash_table[index]);
+        if (slot->hash == 0) {
+            break;
+        }
+
+        if (slot->hash == hash && db_index_equals(slot->name, name)) {
+            return 0;
+        }
+
+        index = (index + 1) & database->hash_table_mask;
     }
 
+    slot->name = internal_strdup(name);
+    if (slot->name == NULL) {
+        return -1;
+    }
+
+    compat_strupr(slot->name);
+    slot->hash = hash;
+    database->hash_table_length++;
+
     return 0;
 }
 
 // 0x4B2304
 static int db_get_hash_value(DB_DATABASE* database, const char* path, int sep, int* value_ptr)
 {
+    const char* name;
     unsigned int key;
+    unsigned int index;
 
     if (!hash_is_on) {
         return -1;
@@ -2326,63 +2730,207 @@ static int db_get_hash_value(DB_DATABASE* database, const char* path, int sep, i
         return -1;
     }
 
-    if (db_hash_string_to_key(path, sep, &key) != 0) {
+    name = db_hash_string_to_key(path, sep, &key);
+    if (name == NULL) {
         return -1;
     }
 
-    if (key >= 0x7FFF) {
-        return -1;
-    }
+    *value_ptr = 0;
 
-    *value_ptr = (database->hash_table[key / 8] >> (key % 8)) & 1;
+    index = key & database->hash_table_mask;
+    while (database->hash_table[index].hash != 0) {
+        if (database->hash_table[index].hash == key && db_index_equals(database->hash_table[index].name, name)) {
+            *value_ptr = 1;
+            break;
+        }
+        index = (index + 1) & database->hash_table_mask;
+    }
 
     return 0;
 }
 
+// Returns file name part of `path` and its case-folded hash in `key_ptr`.
+//
 // 0x4B2394
-static int db_hash_string_to_key(const char* path, int sep, unsigned int* key_ptr)
+static const char* db_hash_string_to_key(const char* path, int sep, unsigned int* key_ptr)
 {
-    char* copy;
-    char* pch;
-    char* filename;
-    size_t index;
-    unsigned int key;
-
-    key = 1;
+    const char* filename;
 
     if (path == NULL) {
-        return -1;
+        return NULL;
     }
 
-    copy = (char*)internal_strdup(path);
-    compat_strupr(copy);
-
-    pch = strrchr(copy, sep);
-    if (pch != NULL) {
-        filename = pch + 1;
+    filename = strrchr(path, sep);
+    if (filename != NULL) {
+        filename++;
     } else {
-        filename = copy;
-    }
-
-    for (index = 0; index < strlen(filename); index++) {
-        key *= *filename++;
-        key &= 0x7FFFFFFF;
+        filename = path;
     }
 
-    *key_ptr = key & 0x7FFF;
-
-    internal_free(copy);
+    *key_ptr = db_index_hash(filename);
 
-    return 0;
+    return filename;
 }
 
 // 0x4B2420
 static void db_exit_hash_table(DB_DATABASE* database)
 {
     if (database->hash_table != NULL) {
+        db_clear_hash_table(database);
         internal_free(database->hash_table);
     }
     database->hash_table = NULL;
+    database->hash_table_mask = 0;
+}
+
+static void db_clear_hash_table(DB_DATABASE* database)
+{
+    unsigned int index;
+
+    for (index = 0; index <= database->hash_table_mask; index++) {
+        if (database->hash_table[index].name != NULL) {
+            internal_free(database->hash_table[index].name);
+        }
+    }
+
+    memset(database->hash_table, 0, sizeof(*database->hash_table) * (database->hash_table_mask + 1));
+    database->hash_table_length = 0;
+}
+
+// CE: Case-folded FNV-1a hash of `path`, never zero.
+static unsigned int db_index_hash(const char* path)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *path != '\0'; path++) {
+        unsigned char ch = (unsigned char)*path;
+        if (ch >= 'a' && ch <= 'z') {
+            ch -= 'a' - 'A';
+        }
+
+        hash ^= ch;
+        hash *= 16777619u;
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+// CE: Compares upper case `key` with `path` ignoring case of the latter.
+static bool db_index_equals(const char* key, const char* path)
+{
+    for (; *key != '\0'; key++, path++) {
+        unsigned char ch = (unsigned char)*path;
+        if (ch >= 'a' && ch <= 'z') {
+            ch -= 'a' - 'A';
+        }
+
+        if ((unsigned char)*key != ch) {
+            return false;
+        }
+    }
+
+    return *path == '\0';
+}
+
+// CE: Builds the datafile index from its directory tree. Every file is keyed
+// by `DIR\FILE`, files of the first directory are also keyed by bare name as
+// this is how `db_find_dir_entry` resolves paths without separator.
+static int db_init_index(DB_DATABASE* database)
+{
+    int count;
+    size_t paths_size;
+    unsigned int capacity;
+    int dir_index;
+    int entry_index;
+    char* paths;
+
+    count = 0;
+    paths_size = 0;
+    for (dir_index = 0; dir_index < database->root.size; dir_index++) {
+        size_t dir_length = strlen(database->root.list[dir_index].name);
+        for (entry_index = 0; entry_index < database->entries[dir_index].size; entry_index++) {
+            size_t name_length = strlen(database->entries[dir_index].list[entry_index].name);
+            paths_size += dir_length + 1 + name_length + 1;
+            count++;
+
+            if (dir_index == 0) {
+                paths_size += name_length + 1;
+                count++;
+            }
+        }
+    }
+
+    capacity = 16;
+    while (capacity < (unsigned int)count * 2) {
+        capacity *= 2;
+    }
+
+    database->index = (DB_INDEX_SLOT*)internal_malloc(sizeof(*database->index) * capacity);
+    if (database->index == NULL) {
+        return -1;
+    }
+
+    database->index_paths = (char*)internal_malloc(paths_size + 1);
+    if (database->index_paths == NULL) {
+        internal_free(database->index);
+        database->index = NULL;
+        return -1;
+    }
+
+    memset(database->index, 0, sizeof(*database->index) * capacity);
+    database->index_mask = capacity - 1;
+
+    paths = database->index_paths;
+    for (dir_index = 0; dir_index < database->root.size; dir_index++) {
+        const char* dir = database->root.list[dir_index].name;
+        for (entry_index = 0; entry_index < database->entries[dir_index].size; entry_index++) {
+            assoc_pair* pair = &(database->entries[dir_index].list[entry_index]);
+            int variant;
+
+            for (variant = 0; variant < (dir_index == 0 ? 2 : 1); variant++) {
+                char* path = paths;
+                if (variant == 0) {
+                    paths += sprintf(paths, "%s\\%s", dir, pair->name) + 1;
+                } else {
+                    paths += sprintf(paths, "%s", pair->name) + 1;
+                }
+                compat_strupr(path);
+
+                unsigned int hash = db_index_hash(path);
+                unsigned int pos = hash & database->index_mask;
+                while (database->index[pos].hash != 0) {
+                    if (database->index[pos].hash == hash && strcmp(database->index[pos].path, path) == 0) {
+                        break;
+                    }
+                    pos = (pos + 1) & database->index_mask;
+                }
+
+                // First match wins, same as binary search over unique keys.
+                if (database->index[pos].hash == 0) {
+                    database->index[pos].hash = hash;
+                    database->index[pos].path = path;
+                    database->index[pos].de = (dir_entry*)pair->data;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void db_exit_index(DB_DATABASE* database)
+{
+    if (database->index != NULL) {
+        internal_free(database->index);
+        database->index = NULL;
+    }
+
+    if (database->index_paths != NULL) {
+        internal_free(database->index_paths);
+        database->index_paths = NULL;
+    }
+
+    database->index_mask = 0;
 }
 
 // 0x4B2444
@@ -2448,7 +2996,7 @@ static int db_delete_fp_rec(DB_FILE* stream)
     } else {
         switch (stream->flags & 0xF0) {
         case 16:
-            if (stream->field_1C != NULL) {
+            if (stream->field_1C != NULL && (stream->flags & DB_FILE_MAPPED) == 0) {
                 internal_free(stream->field_1C);
             }
             break;
@@ -2492,7 +3040,7 @@ static int db_find_empty_position(int* position_ptr)
 }
 
 // 0x4B2714
-static int db_find_dir_entry(char* path, dir_entry* de)
+static int db_find_dir_entry(DB_DATABASE* database, char* path, dir_entry* de)
 {
     char* normalized_path;
     int pos;
@@ -2501,7 +3049,7 @@ static int db_find_dir_entry(char* path, dir_entry* de)
 
     normalized_path = path;
 
-    if (current_database->datafile == NULL) {
+    if (database->datafile == NULL) {
         return -1;
     }
 
@@ -2520,6 +3068,20 @@ static int db_find_dir_entry(char* path, dir_entry* de)
         }
     }
 
+    // CE: One hash and one compare instead of two binary searches.
+    if (database->index != NULL) {
+        unsigned int hash = db_index_hash(normalized_path);
+        unsigned int index = hash & database->index_mask;
+        while (database->index[index].hash != 0) {
+            if (database->index[index].hash == hash && db_index_equals(database->index[index].path, normalized_path)) {
+                *de = *(database->index[index].de);
+                return 0;
+            }
+            index = (index + 1) & database->index_mask;
+        }
+        return -1;
+    }
+
     pos = strlen(normalized_path) - 1;
     while (pos >= 0) {
         if (normalized_path[pos] == '\\') {
@@ -2530,7 +3092,7 @@ static int db_find_dir_entry(char* path, dir_entry* de)
 
     if (pos >= 0) {
         normalized_path[pos] = '\0';
-        dir_index = assoc_search(&(current_database->root), normalized_path);
+        dir_index = assoc_search(&(database->root), normalized_path);
     } else {
         dir_index = 0;
     }
@@ -2542,7 +3104,7 @@ static int db_find_dir_entry(char* path, dir_entry* de)
         return -1;
     }
 
-    entry_index = assoc_search(&(current_database->entries[dir_index]), normalized_path + pos + 1);
+    entry_index = assoc_search(&(database->entries[dir_index]), normalized_path + pos + 1);
     if (entry_index == -1) {
         if (pos >= 0) {
             normalized_path[pos] = '\\';
@@ -2554,11 +3116,69 @@ static int db_find_dir_entry(char* path, dir_entry* de)
         normalized_path[pos] = '\\';
     }
 
-    *de = *((dir_entry*)current_database->entries[dir_index].list[entry_index].data);
+    *de = *((dir_entry*)database->entries[dir_index].list[entry_index].data);
 
     return 0;
 }
 
+// Returns pointer to the raw bytes of `de` inside the mapped datafile, or
+// `NULL` if the datafile is not mapped or the entry does not fit in it.
+static const unsigned char* db_mapped_entry_data(DB_DATABASE* database, const dir_entry* de)
+{
+    size_t packed_size;
+
+    if (database->mapped_data == NULL) {
+        return NULL;
+    }
+
+    switch (de->flags & 0xF0) {
+    case 32:
+        packed_size = de->length;
+        break;
+    default:
+        packed_size = de->field_C;
+        break;
+    }
+
+    if (de->offset < 0 || de->length < 0 || de->field_C < 0) {
+        return NULL;
+    }
+
+    if ((size_t)de->offset > database->mapped_size || packed_size > database->mapped_size - de->offset) {
+        return NULL;
+    }
+
+    return database->mapped_data + de->offset;
+}
+
+// Checks if `path` (prefixed with patches path) is present on disk, consulting
+// patches hash table first when it's available.
+static bool db_patch_exists(DB_DATABASE* database, char* path)
+{
+    int hash_value;
+    FILE* stream;
+
+    compat_windows_path_to_native(path);
+
+    if (db_get_hash_value(database, path, PATH_SEP, &hash_value) == 0 && hash_value != 1) {
+        return false;
+    }
+
+    stream = compat_fopen(path, "rb");
+    if (stream == NULL) {
+        return false;
+    }
+
+    fclose(stream);
+
+    return true;
+}
+
+static bool db_read_callback_allowed()
+{
+    return std::this_thread::get_id() == read_callback_thread;
+}
+
 // 0x4B2810
 static int db_findfirst(const char* path, DB_FIND_DATA* findData)
 {
@@ -70,6 +70,12 @@ long db_filelength(DB_FILE* stream);
 void db_register_mem(db_malloc_func* malloc_func, db_strdup_func* strdup_func, db_free_func* free_func);
 void db_register_callback(db_read_callback* callback, size_t threshold);
 void db_enable_hash_table();
+void db_lock();
+void db_unlock();
+bool db_lock_held();
+void db_enable_mmap();
+int db_map_entry(DB_DATABASE* db_handle, const char* filePath, dir_entry* de, const unsigned char** data_ptr);
+int db_decode_entry(const dir_entry* de, const unsigned char* data, unsigned char* buf);
 int db_reset_hash_tables();
 int db_add_hash_entry(const char* path, int sep);
 
@@ -4,276 +4,402 @@
 // same manner zlib deals with bits. The pattern is so common in this module so
 // I made an exception and extracted it into separate functions to increase
 // readability.
+//
+// CE: Original implementation kept decoder state in file-static variables
+// which made it non-reentrant. The state now lives in `LzssDecoder` (memory
+// decoding) and `LzssFileState` (decoding to file).
 
 #include "plib/db/lzss.h"
 
+#include <limits.h>
 #include <string.h>
 
 namespace fallout {
 
-static inline void lzss_fill_decode_buffer(FILE* stream);
-static inline void lzss_decode_chunk_to_buf(unsigned int type, unsigned char** dest, unsigned int* length);
-static inline void lzss_decode_chunk_to_file(unsigned int type, FILE* stream, unsigned int* length);
-
-// 0x6B0860
-static unsigned char decode_buffer[1024];
-
-// 0x6B0C60
-static unsigned char* decode_buffer_position;
-
-// 0x6B0C64
-static unsigned int decode_bytes_left;
-
-// 0x6B0C68
-static int ring_buffer_index;
-
-// 0x6B0C6C
-static unsigned char* decode_buffer_end;
-
-// 0x6B0C70
-static unsigned char ring_buffer[4116];
-
-// 0x4CA260
-int lzss_decode_to_buf(FILE* in, unsigned char* dest, unsigned int length)
+#define LZSS_RING_BUFFER_SIZE 4096
+#define LZSS_RING_BUFFER_START 4078
+#define LZSS_MAX_MATCH_LENGTH 18
+
+// Maximum number of bytes a single group of 8 items can produce.
+#define LZSS_MAX_GROUP_OUTPUT (8 * LZSS_MAX_MATCH_LENGTH)
+
+// Set above flag bits so that bit 8 stays set until all 8 items of the group
+// are consumed.
+#define LZSS_FLAGS_PENDING 0xFF00
+
+typedef struct LzssFileState {
+    unsigned char decode_buffer[1024];
+    unsigned char* decode_buffer_position;
+    unsigned int decode_bytes_left;
+    int ring_buffer_index;
+    unsigned char* decode_buffer_end;
+    unsigned char ring_buffer[4116];
+} LzssFileState;
+
+static inline unsigned char* lzss_copy_match(LzssDecoder* decoder, unsigned char* dest, const unsigned char* in);
+static bool lzss_decoder_step(LzssDecoder* decoder, const unsigned char** in_ptr, const unsigned char* end);
+static inline void lzss_fill_decode_buffer(LzssFileState* state, FILE* stream);
+static inline void lzss_decode_chunk_to_file(LzssFileState* state, unsigned int type, FILE* stream, unsigned int* length);
+
+// Number of compressed bytes consumed by a group of 8 items for every flags
+// byte: 1 byte per literal (bit set), 2 bytes per match (bit clear).
+static const unsigned char lzss_group_length[256] = {
+    16, 15, 15, 14, 15, 14, 14, 13, 15, 14, 14, 13, 14, 13, 13, 12,
+    15, 14, 14, 13, 14, 13, 13, 12, 14, 13, 13, 12, 13, 12, 12, 11,
+    15, 14, 14, 13, 14, 13, 13, 12, 14, 13, 13, 12, 13, 12, 12, 11,
+    14, 13, 13, 12, 13, 12, 12, 11, 13, 12, 12, 11, 12, 11, 11, 10,
+    15, 14, 14, 13, 14, 13, 13, 12, 14, 13, 13, 12, 13, 12, 12, 11,
+    14, 13, 13, 12, 13, 12, 12, 11, 13, 12, 12, 11, 12, 11, 11, 10,
+    14, 13, 13, 12, 13, 12, 12, 11, 13, 12, 12, 11, 12, 11, 11, 10,
+    13, 12, 12, 11, 12, 11, 11, 10, 12, 11, 11, 10, 11, 10, 10, 9,
+    15, 14, 14, 13, 14, 13, 13, 12, 14, 13, 13, 12, 13, 12, 12, 11,
+    14, 13, 13, 12, 13, 12, 12, 11, 13, 12, 12, 11, 12, 11, 11, 10,
+    14, 13, 13, 12, 13, 12, 12, 11, 13, 12, 12, 11, 12, 11, 11, 10,
+    13, 12, 12, 11, 12, 11, 11, 10, 12, 11, 11, 10, 11, 10, 10, 9,
+    14, 13, 13, 12, 13, 12, 12, 11, 13, 12, 12, 11, 12, 11, 11, 10,
+    13, 12, 12, 11, 12, 11, 11, 10, 12, 11, 11, 10, 11, 10, 10, 9,
+    13, 12, 12, 11, 12, 11, 11, 10, 12, 11, 11, 10, 11, 10, 10, 9,
+    12, 11, 11, 10, 11, 10, 10, 9, 11, 10, 10, 9, 10, 9, 9, 8,
+};
+
+void lzss_decoder_init(LzssDecoder* decoder, unsigned char* dest, unsigned int dest_length)
 {
-    unsigned char* curr;
-    unsigned char byte;
-
-    curr = dest;
-    memset(ring_buffer, ' ', 4078);
-    ring_buffer_index = 4078;
-    decode_buffer_end = decode_buffer;
-    decode_buffer_position = decode_buffer;
-    decode_bytes_left = length;
-
-    while (length > 16) {
-        lzss_fill_decode_buffer(in);
+    decoder->dest_start = dest;
+    decoder->dest = dest;
+    decoder->dest_left = dest_length;
+    decoder->flags = 0;
+}
 
-        length -= 1;
-        byte = *decode_buffer_position++;
-        lzss_decode_chunk_to_buf(byte & 0x01, &curr, &length);
-        lzss_decode_chunk_to_buf(byte & 0x02, &curr, &length);
-        lzss_decode_chunk_to_buf(byte & 0x04, &curr, &length);
-        lzss_decode_chunk_to_buf(byte & 0x08, &curr, &length);
-        lzss_decode_chunk_to_buf(byte & 0x10, &curr, &length);
-        lzss_decode_chunk_to_buf(byte & 0x20, &curr, &length);
-        lzss_decode_chunk_to_buf(byte & 0x40, &curr, &length);
-        lzss_decode_chunk_to_buf(byte & 0x80, &curr, &length);
+// Decodes as much of `in` as possible and returns the number of consumed
+// bytes. Decoding stops early when the output buffer is full, or when `in`
+// ends in the middle of a match - the unconsumed tail must be passed again
+// (followed by more data) to the next call.
+unsigned int lzss_decoder_feed(LzssDecoder* decoder, const unsigned char* in, unsigned int length)
+{
+    const unsigned char* start;
+    const unsigned char* end;
+    unsigned char* dest;
+    unsigned int dest_left;
+    unsigned int flags;
+    int bit;
+
+    start = in;
+    end = in + length;
+
+    // Finish the group left incomplete by the previous call.
+    while ((decoder->flags & 0x100) != 0) {
+        if (!lzss_decoder_step(decoder, &in, end)) {
+            return in - start;
+        }
     }
 
-    do {
-        if (length == 0) break;
-
-        lzss_fill_decode_buffer(in);
-
-        length -= 1;
-        byte = *decode_buffer_position++;
-
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x01, &curr, &length);
-
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x02, &curr, &length);
+    dest = decoder->dest;
+    dest_left = decoder->dest_left;
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x04, &curr, &length);
-
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x08, &curr, &length);
-
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x10, &curr, &length);
+    // Fast path: the whole group (flags byte plus 8 items) is available and
+    // there is enough room for the longest possible output, so no per-item
+    // checks are needed.
+    while (in < end && dest_left >= LZSS_MAX_GROUP_OUTPUT) {
+        flags = in[0];
+        if (end - in - 1 < lzss_group_length[flags]) {
+            break;
+        }
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x20, &curr, &length);
+        in++;
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x40, &curr, &length);
+        if (flags == 0xFF) {
+            memcpy(dest, in, 8);
+            dest += 8;
+            dest_left -= 8;
+            in += 8;
+            continue;
+        }
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x80, &curr, &length);
+        for (bit = 0; bit < 8; bit++) {
+            if ((flags & (1 << bit)) != 0) {
+                *dest++ = *in++;
+                dest_left--;
+            } else {
+                unsigned char* match_end = lzss_copy_match(decoder, dest, in);
+                dest_left -= match_end - dest;
+                dest = match_end;
+                in += 2;
+            }
+        }
+    }
 
-        if (length == 0) break;
+    decoder->dest = dest;
+    decoder->dest_left = dest_left;
 
-        length -= 1;
-        byte = *decode_buffer_position++;
+    while (lzss_decoder_step(decoder, &in, end)) {
+    }
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x01, &curr, &length);
+    return in - start;
+}
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x02, &curr, &length);
+// Decodes `length` bytes of compressed data into `dest`. Returns the number of
+// bytes written, which never exceeds `dest_length`.
+int lzss_decode_span(const unsigned char* in, unsigned int length, unsigned char* dest, unsigned int dest_length)
+{
+    LzssDecoder decoder;
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x04, &curr, &length);
+    lzss_decoder_init(&decoder, dest, dest_length);
+    lzss_decoder_feed(&decoder, in, length);
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x08, &curr, &length);
+    return decoder.dest - dest;
+}
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x10, &curr, &length);
+// 0x4CA260
+int lzss_decode_to_buf(FILE* in, unsigned char* dest, unsigned int length)
+{
+    LzssDecoder decoder;
+    unsigned char buffer[1024];
+    unsigned int pending;
+    unsigned int bytes_to_read;
+    unsigned int bytes_read;
+    unsigned int consumed;
+
+    lzss_decoder_init(&decoder, dest, UINT_MAX);
+
+    pending = 0;
+    while (length != 0) {
+        bytes_to_read = sizeof(buffer) - pending;
+        if (bytes_to_read > length) {
+            bytes_to_read = length;
+        }
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x20, &curr, &length);
+        bytes_read = fread(buffer + pending, 1, bytes_to_read, in);
+        if (bytes_read == 0) {
+            break;
+        }
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x40, &curr, &length);
+        length -= bytes_read;
+        pending += bytes_read;
 
-        if (length == 0) break;
-        lzss_decode_chunk_to_buf(byte & 0x80, &curr, &length);
-    } while (0);
+        consumed = lzss_decoder_feed(&decoder, buffer, pending);
+        pending -= consumed;
+        memmove(buffer, buffer + consumed, pending);
+    }
 
-    return curr - dest;
+    return decoder.dest - dest;
 }
 
 // 0x4CB570
 void lzss_decode_to_file(FILE* in, FILE* out, unsigned int length)
 {
+    LzssFileState state;
+    LzssFileState* s = &state;
     unsigned char byte;
 
-    memset(ring_buffer, ' ', 4078);
-    ring_buffer_index = 4078;
-    decode_buffer_end = decode_buffer;
-    decode_buffer_position = decode_buffer;
-    decode_bytes_left = length;
+    memset(s->ring_buffer, ' ', 4078);
+    s->ring_buffer_index = 4078;
+    s->decode_buffer_end = s->decode_buffer;
+    s->decode_buffer_position = s->decode_buffer;
+    s->decode_bytes_left = length;
 
     while (length > 16) {
-        lzss_fill_decode_buffer(in);
+        lzss_fill_decode_buffer(s, in);
 
         length -= 1;
-        byte = *decode_buffer_position++;
-        lzss_decode_chunk_to_file(byte & 0x01, out, &length);
-        lzss_decode_chunk_to_file(byte & 0x02, out, &length);
-        lzss_decode_chunk_to_file(byte & 0x04, out, &length);
-        lzss_decode_chunk_to_file(byte & 0x08, out, &length);
-        lzss_decode_chunk_to_file(byte & 0x10, out, &length);
-        lzss_decode_chunk_to_file(byte & 0x20, out, &length);
-        lzss_decode_chunk_to_file(byte & 0x40, out, &length);
-        lzss_decode_chunk_to_file(byte & 0x80, out, &length);
+        byte = *s->decode_buffer_position++;
+        lzss_decode_chunk_to_file(s, byte & 0x01, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x02, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x04, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x08, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x10, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x20, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x40, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x80, out, &length);
     }
 
     do {
         if (length == 0) break;
 
-        lzss_fill_decode_buffer(in);
+        lzss_fill_decode_buffer(s, in);
 
         length -= 1;
-        byte = *decode_buffer_position++;
+        byte = *s->decode_buffer_position++;
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x01, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x01, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x02, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x02, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x04, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x04, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x08, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x08, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x10, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x10, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x20, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x20, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x40, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x40, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x80, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x80, out, &length);
 
         if (length == 0) break;
 
         length -= 1;
-        byte = *decode_buffer_position++;
+        byte = *s->decode_buffer_position++;
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x01, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x01, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x02, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x02, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x04, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x04, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x08, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x08, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x10, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x10, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x20, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x20, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x40, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x40, out, &length);
 
         if (length == 0) break;
-        lzss_decode_chunk_to_file(byte & 0x80, out, &length);
+        lzss_decode_chunk_to_file(s, byte & 0x80, out, &length);
     } while (0);
 }
 
-static inline void lzss_fill_decode_buffer(FILE* stream)
+// Expands match encoded at `in` to `dest` and returns new output position.
+//
+// The dictionary is the output itself: ring buffer offset is translated into
+// a distance back from the current output position. Parts of the match which
+// reach before the start of the output come from the initial ring buffer
+// contents (spaces).
+static inline unsigned char* lzss_copy_match(LzssDecoder* decoder, unsigned char* dest, const unsigned char* in)
 {
-    size_t bytes_to_read;
-    size_t bytes_read;
+    unsigned int position;
+    unsigned int offset;
+    unsigned int distance;
+    unsigned int length;
+    unsigned int index;
+    const unsigned char* src;
+
+    offset = in[0] | ((in[1] & 0xF0) << 4);
+    length = (in[1] & 0x0F) + 3;
+
+    position = dest - decoder->dest_start;
+    distance = (position + LZSS_RING_BUFFER_START - offset) & (LZSS_RING_BUFFER_SIZE - 1);
+    if (distance == 0) {
+        distance = LZSS_RING_BUFFER_SIZE;
+    }
 
-    if (decode_bytes_left != 0 && decode_buffer_end - decode_buffer_position <= 16) {
-        if (decode_buffer_position == decode_buffer_end) {
-            decode_buffer_end = decode_buffer;
+    if (distance <= position) {
+        src = dest - distance;
+        if (distance >= length) {
+            memcpy(dest, src, length);
         } else {
-            memmove(decode_buffer, decode_buffer_position, decode_buffer_end - decode_buffer_position);
-            decode_buffer_end = decode_buffer + (decode_buffer_end - decode_buffer_position);
+            // Overlapping match repeats the last `distance` bytes.
+            for (index = 0; index < length; index++) {
+                dest[index] = src[index];
+            }
+        }
+    } else {
+        for (index = 0; index < length; index++) {
+            if (index + position >= distance) {
+                dest[index] = decoder->dest_start[position + index - distance];
+            } else {
+                dest[index] = ' ';
+            }
         }
+    }
+
+    return dest + length;
+}
 
-        decode_buffer_position = decode_buffer;
+// Decodes single item with bounds checks, reading next flags byte when
+// needed. Returns `false` when input or output space is exhausted.
+static bool lzss_decoder_step(LzssDecoder* decoder, const unsigned char** in_ptr, const unsigned char* end)
+{
+    const unsigned char* in;
+    unsigned int length;
+
+    in = *in_ptr;
+
+    if (decoder->dest_left == 0) {
+        return false;
+    }
 
-        bytes_to_read = 1024 - (decode_buffer_end - decode_buffer);
-        if (bytes_to_read > decode_bytes_left) {
-            bytes_to_read = decode_bytes_left;
+    if ((decoder->flags & 0x100) == 0) {
+        if (in == end) {
+            return false;
         }
 
-        bytes_read = fread(decode_buffer_end, 1, bytes_to_read, stream);
-        decode_buffer_end += bytes_read;
-        decode_bytes_left -= bytes_read;
+        decoder->flags = *in++ | LZSS_FLAGS_PENDING;
+        *in_ptr = in;
     }
+
+    if ((decoder->flags & 0x01) != 0) {
+        if (in == end) {
+            return false;
+        }
+
+        *decoder->dest++ = *in++;
+        decoder->dest_left--;
+    } else {
+        if (end - in < 2) {
+            return false;
+        }
+
+        length = (in[1] & 0x0F) + 3;
+        if (length > decoder->dest_left) {
+            decoder->dest_left = 0;
+            return false;
+        }
+
+        decoder->dest = lzss_copy_match(decoder, decoder->dest, in);
+        decoder->dest_left -= length;
+        in += 2;
+    }
+
+    decoder->flags >>= 1;
+    *in_ptr = in;
+
+    return true;
 }
 
-static inline void lzss_decode_chunk_to_buf(unsigned int type, unsigned char** dest, unsigned int* length)
+static inline void lzss_fill_decode_buffer(LzssFileState* state, FILE* stream)
 {
-    unsigned char low;
-    unsigned char high;
-    int dict_offset;
-    int dict_index;
-    int chunk_length;
-    int index;
+    size_t bytes_to_read;
+    size_t bytes_read;
 
-    if (type != 0) {
-        *length -= 1;
-        *(*dest) = *decode_buffer_position++;
-        ring_buffer[ring_buffer_index] = *(*dest)++;
-        ring_buffer_index += 1;
-        ring_buffer_index &= 0xFFF;
-    } else {
-        *length -= 2;
-        low = *decode_buffer_position++;
-        high = *decode_buffer_position++;
-        dict_offset = low | ((high & 0xF0) << 4);
-        chunk_length = (high & 0x0F) + 3;
+    if (state->decode_bytes_left != 0 && state->decode_buffer_end - state->decode_buffer_position <= 16) {
+        if (state->decode_buffer_position == state->decode_buffer_end) {
+            state->decode_buffer_end = state->decode_buffer;
+        } else {
+            memmove(state->decode_buffer, state->decode_buffer_position, state->decode_buffer_end - state->decode_buffer_position);
+            state->decode_buffer_end = state->decode_buffer + (state->decode_buffer_end - state->decode_buffer_position);
+        }
 
-        for (index = 0; index < chunk_length; index++) {
-            dict_index = (dict_offset + index) & 0xFFF;
-            *(*dest) = ring_buffer[dict_index];
-            ring_buffer[ring_buffer_index] = *(*dest)++;
-            ring_buffer_index += 1;
-            ring_buffer_index &= 0xFFF;
+        state->decode_buffer_position = state->decode_buffer;
+
+        bytes_to_read = 1024 - (state->decode_buffer_end - state->decode_buffer);
+        if (bytes_to_read > state->decode_bytes_left) {
+            bytes_to_read = state->decode_bytes_left;
         }
+
+        bytes_read = fread(state->decode_buffer_end, 1, bytes_to_read, stream);
+        state->decode_buffer_end += bytes_read;
+        state->decode_bytes_left -= bytes_read;
     }
 }
 
-static inline void lzss_decode_chunk_to_file(unsigned int type, FILE* stream, unsigned int* length)
+static inline void lzss_decode_chunk_to_file(LzssFileState* state, unsigned int type, FILE* stream, unsigned int* length)
 {
     unsigned char low;
     unsigned char high;
@@ -284,23 +410,23 @@ static inline void lzss_decode_chunk_to_file(unsigned int type, FILE* stream, un
 
     if (type != 0) {
         *length -= 1;
-        fputc(*decode_buffer_position, stream);
-        ring_buffer[ring_buffer_index] = *decode_buffer_position++;
-        ring_buffer_index += 1;
-        ring_buffer_index &= 0xFFF;
+        fputc(*state->decode_buffer_position, stream);
+        state->ring_buffer[state->ring_buffer_index] = *state->decode_buffer_position++;
+        state->ring_buffer_index += 1;
+        state->ring_buffer_index &= 0xFFF;
     } else {
         *length -= 2;
-        low = *decode_buffer_position++;
-        high = *decode_buffer_position++;
+        low = *state->decode_buffer_position++;
+        high = *state->decode_buffer_position++;
         dict_offset = low | ((high & 0xF0) << 4);
         chunk_length = (high & 0x0F) + 3;
 
         for (index = 0; index < chunk_length; index++) {
             dict_index = (dict_offset + index) & 0xFFF;
-            fputc(ring_buffer[dict_index], stream);
-            ring_buffer[ring_buffer_index] = ring_buffer[dict_index];
-            ring_buffer_index += 1;
-            ring_buffer_index &= 0xFFF;
+            fputc(state->ring_buffer[dict_index], stream);
+            state->ring_buffer[state->ring_buffer_index] = state->ring_buffer[dict_index];
+            state->ring_buffer_index += 1;
+            state->ring_buffer_index &= 0xFFF;
         }
     }
 }
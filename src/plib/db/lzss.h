@@ -5,6 +5,25 @@
 
 namespace fallout {
 
+// Decoder state for memory-to-memory decompression.
+//
+// The output buffer doubles as the dictionary, so the decoder does not need a
+// ring buffer and several decoders can run on different threads at the same
+// time. Compressed data can be fed in arbitrary pieces.
+typedef struct LzssDecoder {
+    unsigned char* dest_start;
+    unsigned char* dest;
+    unsigned int dest_left;
+
+    // Flag bits of the current group shifted into the low byte, with a
+    // sentinel bit marking when the next flags byte must be read.
+    unsigned int flags;
+} LzssDecoder;
+
+void lzss_decoder_init(LzssDecoder* decoder, unsigned char* dest, unsigned int dest_length);
+unsigned int lzss_decoder_feed(LzssDecoder* decoder, const unsigned char* in, unsigned int length);
+int lzss_decode_span(const unsigned char* in, unsigned int length, unsigned char* dest, unsigned int dest_length);
+
 int lzss_decode_to_buf(FILE* in, unsigned char* dest, unsigned int length);
 void lzss_decode_to_file(FILE* in, FILE* out, unsigned int length);
 
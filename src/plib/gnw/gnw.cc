@@ -923,31 +923,28 @@ void GNW_win_refresh(Window* w, Rect* rect, unsigned char* a3)
                 while (v16 != NULL) {
                     int width = v16->rect.lrx - v16->rect.ulx + 1;
                     int height = v16->rect.lry - v16->rect.uly + 1;
-                    unsigned char* buf = (unsigned char*)mem_malloc(width * height);
-                    if (buf != NULL) {
-                        buf_fill(buf, width, height, width, bk_color);
-                        if (dest_pitch != 0) {
-                            buf_to_buf(
-                                buf,
-                                width,
-                                height,
-                                width,
-                                a3 + dest_pitch * (v16->rect.uly - rect->uly) + v16->rect.ulx - rect->ulx,
-                                dest_pitch);
-                        } else {
-                            if (buffering) {
-                                buf_to_buf(buf,
-                                    width,
-                                    height,
-                                    width,
-                                    screen_buffer + v16->rect.uly * (scr_size.lrx - scr_size.ulx + 1) + v16->rect.ulx,
-                                    scr_size.lrx - scr_size.ulx + 1);
-                            } else {
-                                scr_blit(buf, width, height, 0, 0, width, height, v16->rect.ulx, v16->rect.uly);
-                            }
-                        }
 
-                        mem_free(buf);
+                    // CE: Fill destination buffers in place, a scratch
+                    // buffer is only needed to blit straight to the screen.
+                    if (dest_pitch != 0) {
+                        buf_fill(a3 + dest_pitch * (v16->rect.uly - rect->uly) + v16->rect.ulx - rect->ulx,
+                            width,
+                            height,
+                            dest_pitch,
+                            bk_color);
+                    } else if (buffering) {
+                        buf_fill(screen_buffer + v16->rect.uly * (scr_size.lrx - scr_size.ulx + 1) + v16->rect.ulx,
+                            width,
+                            height,
+                            scr_size.lrx - scr_size.ulx + 1,
+                            bk_color);
+                    } else {
+                        unsigned char* buf = (unsigned char*)mem_malloc(width * height);
+                        if (buf != NULL) {
+                            buf_fill(buf, width, height, width, bk_color);
+                            scr_blit(buf, width, height, 0, 0, width, height, v16->rect.ulx, v16->rect.uly);
+                            mem_free(buf);
+                        }
                     }
                     v16 = v16->next;
                 }
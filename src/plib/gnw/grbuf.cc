@@ -2,10 +2,25 @@
 
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GRBUF_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GRBUF_NEON 1
+#endif
+
 #include "plib/color/color.h"
 
 namespace fallout {
 
+// Widest destination row trans_cscale scales through its scratch row.
+#define TRANS_CSCALE_ROW_MAX 2048
+
+static void trans_row(unsigned char* dest, const unsigned char* src, int width);
+static void mask_row(unsigned char* dest, const unsigned char* src, const unsigned char* mask, int width);
+static void trans_cscale_slow(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destWidth, int destHeight, int destPitch);
+
 // 0x4BD850
 void draw_line(unsigned char* buf, int pitch, int x1, int y1, int x2, int y2, int color)
 {
@@ -176,6 +191,41 @@ void cscale(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsig
 
 // 0x4BDDF0
 void trans_cscale(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destWidth, int destHeight, int destPitch)
+{
+    int stepX = (destWidth << 16) / srcWidth;
+    int stepY = (destHeight << 16) / srcHeight;
+    int rowWidth = (srcWidth * stepX) >> 16;
+
+    if (rowWidth > TRANS_CSCALE_ROW_MAX) {
+        trans_cscale_slow(src, srcWidth, srcHeight, srcPitch, dest, destWidth, destHeight, destPitch);
+        return;
+    }
+
+    // CE: Scale every source row once into a scratch row (transparent pixels
+    // stay 0) and copy it to each destination row it covers.
+    unsigned char row[TRANS_CSCALE_ROW_MAX];
+
+    for (int srcY = 0; srcY < srcHeight; srcY += 1) {
+        int startDestY = (srcY * stepY) >> 16;
+        int endDestY = ((srcY + 1) * stepY) >> 16;
+        if (startDestY == endDestY) {
+            continue;
+        }
+
+        unsigned char* currSrc = src + srcPitch * srcY;
+        for (int srcX = 0; srcX < srcWidth; srcX += 1) {
+            int startDestX = (srcX * stepX) >> 16;
+            int endDestX = ((srcX + 1) * stepX) >> 16;
+            memset(row + startDestX, *currSrc++, endDestX - startDestX);
+        }
+
+        for (int destY = startDestY; destY < endDestY; destY += 1) {
+            trans_row(dest + destPitch * destY, row, rowWidth);
+        }
+    }
+}
+
+static void trans_cscale_slow(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destWidth, int destHeight, int destPitch)
 {
     int stepX = (destWidth << 16) / srcWidth;
     int stepY = (destHeight << 16) / srcHeight;
@@ -219,21 +269,66 @@ void trans_buf_to_buf(unsigned char* src, int width, int height, int srcPitch, u
 void mask_buf_to_buf(unsigned char* src, int width, int height, int srcPitch, unsigned char* mask, int maskPitch, unsigned char* dest, int destPitch)
 {
     int y;
-    int x;
 
     for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-            if (*mask != 0) {
-                *dest = *src;
+        mask_row(dest, src, mask, width);
+        src += srcPitch;
+        mask += maskPitch;
+        dest += destPitch;
+    }
+}
+
+// Copies pixels through 256-entry table, skipping transparent (0) pixels.
+void lut_trans_buf_to_buf(unsigned char* src, int width, int height, int srcPitch, unsigned char* dest, int destPitch, const unsigned char* table)
+{
+    for (int y = 0; y < height; y++) {
+        int x = 0;
+        while (x < width) {
+            unsigned char b = src[x];
+            if (b == 0) {
+                x += buf_count_zero(src + x, width - x);
+                continue;
             }
-            src++;
-            mask++;
-            dest++;
+
+            dest[x] = table[b];
+            x++;
+        }
+
+        src += srcPitch;
+        dest += destPitch;
+    }
+}
+
+// Returns number of leading zero (transparent) bytes in the buffer.
+int buf_count_zero(const unsigned char* buf, int length)
+{
+    int x = 0;
+
+#if GRBUF_SSE2
+    __m128i zero = _mm_setzero_si128();
+    while (x + 16 <= length) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buf + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xFFFF) {
+            break;
+        }
+        x += 16;
+    }
+#elif GRBUF_NEON
+    while (x + 16 <= length) {
+        uint8x16_t v = vld1q_u8(buf + x);
+        uint64x2_t any = vreinterpretq_u64_u8(v);
+        if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) != 0) {
+            break;
         }
-        src += srcPitch - width;
-        mask += maskPitch - width;
-        dest += destPitch - width;
+        x += 16;
+    }
+#endif
+
+    while (x < length && buf[x] == 0) {
+        x++;
     }
+
+    return x;
 }
 
 // 0x4BE10C
@@ -343,19 +438,87 @@ void srcCopy(unsigned char* dest, int destPitch, unsigned char* src, int srcPitc
 // 0x4CDC75
 void transSrcCopy(unsigned char* dest, int destPitch, unsigned char* src, int srcPitch, int width, int height)
 {
-    int destSkip = destPitch - width;
-    int srcSkip = srcPitch - width;
-
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            unsigned char c = *src++;
-            if (c != 0) {
-                *dest = c;
-            }
-            dest++;
+        trans_row(dest, src, width);
+        src += srcPitch;
+        dest += destPitch;
+    }
+}
+
+// Copies non-zero pixels of the row, 16 at a time where possible. Blocks that
+// are fully transparent are skipped and fully opaque ones are stored as is.
+static void trans_row(unsigned char* dest, const unsigned char* src, int width)
+{
+    int x = 0;
+
+#if GRBUF_SSE2
+    __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i keep = _mm_cmpeq_epi8(s, zero);
+        int bits = _mm_movemask_epi8(keep);
+        if (bits == 0xFFFF) {
+            continue;
+        }
+
+        if (bits != 0) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dest + x));
+            s = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, s));
+        }
+
+        _mm_storeu_si128((__m128i*)(dest + x), s);
+    }
+#elif GRBUF_NEON
+    uint8x16_t zero = vdupq_n_u8(0);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t s = vld1q_u8(src + x);
+        uint8x16_t keep = vceqq_u8(s, zero);
+        vst1q_u8(dest + x, vbslq_u8(keep, vld1q_u8(dest + x), s));
+    }
+#endif
+
+    for (; x < width; x++) {
+        unsigned char c = src[x];
+        if (c != 0) {
+            dest[x] = c;
+        }
+    }
+}
+
+// Copies pixels of the row where mask is non-zero.
+static void mask_row(unsigned char* dest, const unsigned char* src, const unsigned char* mask, int width)
+{
+    int x = 0;
+
+#if GRBUF_SSE2
+    __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16) {
+        __m128i keep = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + x)), zero);
+        int bits = _mm_movemask_epi8(keep);
+        if (bits == 0xFFFF) {
+            continue;
+        }
+
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + x));
+        if (bits != 0) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dest + x));
+            s = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, s));
+        }
+
+        _mm_storeu_si128((__m128i*)(dest + x), s);
+    }
+#elif GRBUF_NEON
+    uint8x16_t zero = vdupq_n_u8(0);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t keep = vceqq_u8(vld1q_u8(mask + x), zero);
+        vst1q_u8(dest + x, vbslq_u8(keep, vld1q_u8(dest + x), vld1q_u8(src + x)));
+    }
+#endif
+
+    for (; x < width; x++) {
+        if (mask[x] != 0) {
+            dest[x] = src[x];
         }
-        src += srcSkip;
-        dest += destSkip;
     }
 }
 
@@ -11,6 +11,8 @@ void trans_cscale(unsigned char* src, int srcWidth, int srcHeight, int srcPitch,
 void buf_to_buf(unsigned char* src, int width, int height, int srcPitch, unsigned char* dest, int destPitch);
 void trans_buf_to_buf(unsigned char* src, int width, int height, int srcPitch, unsigned char* dest, int destPitch);
 void mask_buf_to_buf(unsigned char* src, int width, int height, int srcPitch, unsigned char* mask, int maskPitch, unsigned char* dest, int destPitch);
+void lut_trans_buf_to_buf(unsigned char* src, int width, int height, int srcPitch, unsigned char* dest, int destPitch, const unsigned char* table);
+int buf_count_zero(const unsigned char* buf, int length);
 void buf_fill(unsigned char* buf, int width, int height, int pitch, int a5);
 void buf_texture(unsigned char* buf, int width, int height, int pitch, void* a5, int a6, int a7);
 void lighten_buf(unsigned char* buf, int width, int height, int pitch);
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <mutex>
+
 #include "plib/gnw/debug.h"
 #include "plib/gnw/gnw.h"
 
@@ -57,6 +59,10 @@ static size_t mem_allocated = 0;
 // 0x539D30
 static size_t max_allocated = 0;
 
+// CE: Guards allocation counters above, memory is also allocated by cache
+// prefetch threads.
+static std::mutex mem_stats_mutex;
+
 // 0x4AEBE0
 char* mem_strdup(const char* string)
 {
@@ -88,6 +94,8 @@ static void* my_malloc(size_t size)
             // NOTE: Uninline.
             ptr = mem_prep_block(block, size);
 
+            std::lock_guard<std::mutex> lock(mem_stats_mutex);
+
             num_blocks++;
             if (num_blocks > max_blocks) {
                 max_blocks = num_blocks;
@@ -118,8 +126,6 @@ static void* my_realloc(void* ptr, size_t size)
         MemoryBlockHeader* header = (MemoryBlockHeader*)block;
         size_t oldSize = header->size;
 
-        mem_allocated -= oldSize;
-
         mem_check_block(block);
 
         if (size != 0) {
@@ -128,6 +134,11 @@ static void* my_realloc(void* ptr, size_t size)
         }
 
         unsigned char* newBlock = (unsigned char*)realloc(block, size);
+
+        std::lock_guard<std::mutex> lock(mem_stats_mutex);
+
+        mem_allocated -= oldSize;
+
         if (newBlock != NULL) {
             mem_allocated += size;
             if (mem_allocated > max_allocated) {
@@ -169,8 +180,11 @@ static void my_free(void* ptr)
 
         mem_check_block(block);
 
-        mem_allocated -= header->size;
-        num_blocks--;
+        {
+            std::lock_guard<std::mutex> lock(mem_stats_mutex);
+            mem_allocated -= header->size;
+            num_blocks--;
+        }
 
         free(block);
     }
@@ -180,6 +194,7 @@ static void my_free(void* ptr)
 void mem_check()
 {
     if (p_malloc == my_malloc) {
+        std::lock_guard<std::mutex> lock(mem_stats_mutex);
         debug_printf("Current memory allocated: %6d blocks, %9u bytes total\n", num_blocks, mem_allocated);
         debug_printf("Max memory allocated:     %6d blocks, %9u bytes total\n", max_blocks, max_allocated);
     }
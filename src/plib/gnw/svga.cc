@@ -1,5 +1,7 @@
 #include "plib/gnw/svga.h"
 
+#include <string.h>
+
 #include "plib/gnw/gnw.h"
 #include "plib/gnw/grbuf.h"
 #include "plib/gnw/mouse.h"
@@ -9,6 +11,10 @@ namespace fallout {
 
 static bool createRenderer(int width, int height);
 static void destroyRenderer();
+static void screenAddDirtyRect(const Rect* rect);
+static void screenFlushDirtyRects();
+
+#define SCREEN_DIRTY_RECTS_MAX 32
 
 // screen rect
 Rect scr_size;
@@ -25,6 +31,18 @@ SDL_Surface* gSdlTextureSurface = NULL;
 // TODO: Remove once migration to update-render cycle is completed.
 FpsLimiter sharedFpsLimiter;
 
+// CE: Areas of gSdlSurface changed since the last present. They are converted
+// to gSdlTextureSurface once per frame instead of on every blit.
+static Rect dirtyRects[SCREEN_DIRTY_RECTS_MAX];
+static int dirtyRectsLength = 0;
+
+// Set when gSdlTextureSurface was rewritten as a whole (palette change) and
+// the entire texture must be uploaded.
+static bool textureInvalid = true;
+
+static ScreenDamageStats damageStats;
+static ScreenDamageStats lastFrameDamageStats;
+
 // 0x4CB310
 void GNW95_SetPaletteEntries(unsigned char* palette, int start, int count)
 {
@@ -42,6 +60,8 @@ void GNW95_SetPaletteEntries(unsigned char* palette, int start, int count)
 
         SDL_SetPaletteColors(gSdlSurface->format->palette, colors, start, count);
         SDL_BlitSurface(gSdlSurface, NULL, gSdlTextureSurface, NULL);
+        dirtyRectsLength = 0;
+        textureInvalid = true;
     }
 }
 
@@ -60,24 +80,144 @@ void GNW95_SetPalette(unsigned char* palette)
 
         SDL_SetPaletteColors(gSdlSurface->format->palette, colors, 0, 256);
         SDL_BlitSurface(gSdlSurface, NULL, gSdlTextureSurface, NULL);
+        dirtyRectsLength = 0;
+        textureInvalid = true;
     }
 }
 
 // 0x4CB850
 void GNW95_ShowRect(unsigned char* src, unsigned int srcPitch, unsigned int a3, unsigned int srcX, unsigned int srcY, unsigned int srcWidth, unsigned int srcHeight, unsigned int destX, unsigned int destY)
 {
-    buf_to_buf(src + srcPitch * srcY + srcX, srcWidth, srcHeight, srcPitch, (unsigned char*)gSdlSurface->pixels + gSdlSurface->pitch * destY + destX, gSdlSurface->pitch);
-
-    SDL_Rect srcRect;
-    srcRect.x = destX;
-    srcRect.y = destY;
-    srcRect.w = srcWidth;
-    srcRect.h = srcHeight;
-
-    SDL_Rect destRect;
-    destRect.x = destX;
-    destRect.y = destY;
-    SDL_BlitSurface(gSdlSurface, &srcRect, gSdlTextureSurface, &destRect);
+    // CE: Only rows that differ are copied and reported as damage, windows
+    // refreshed several times per frame usually repeat the same pixels.
+    unsigned char* sp = src + srcPitch * srcY + srcX;
+    unsigned char* dp = (unsigned char*)gSdlSurface->pixels + gSdlSurface->pitch * destY + destX;
+    int firstChangedRow = -1;
+    int lastChangedRow = -1;
+    unsigned int changedRows = 0;
+    for (unsigned int y = 0; y < srcHeight; y++) {
+        if (memcmp(dp, sp, srcWidth) != 0) {
+            memcpy(dp, sp, srcWidth);
+            if (firstChangedRow == -1) {
+                firstChangedRow = y;
+            }
+            lastChangedRow = y;
+            changedRows++;
+        }
+        sp += srcPitch;
+        dp += gSdlSurface->pitch;
+    }
+
+    damageStats.pixelsCopied += srcWidth * srcHeight;
+    damageStats.pixelsChanged += srcWidth * changedRows;
+
+    if (firstChangedRow != -1) {
+        Rect rect;
+        rect.ulx = destX;
+        rect.uly = destY + firstChangedRow;
+        rect.lrx = destX + srcWidth - 1;
+        rect.lry = destY + lastChangedRow;
+        screenAddDirtyRect(&rect);
+    }
+}
+
+// Merges rect into the damage list. Overlapping or touching rects are
+// coalesced, when the list is full the rect goes to the entry whose bounds
+// grow the least.
+static void screenAddDirtyRect(const Rect* rect)
+{
+    Rect merged;
+    rectCopy(&merged, rect);
+
+    int index = 0;
+    while (index < dirtyRectsLength) {
+        Rect* other = &(dirtyRects[index]);
+        if (merged.ulx <= other->lrx + 1 && other->ulx <= merged.lrx + 1
+            && merged.uly <= other->lry + 1 && other->uly <= merged.lry + 1) {
+            rect_min_bound(&merged, other, &merged);
+
+            // The grown rect may now touch entries checked before.
+            dirtyRects[index] = dirtyRects[--dirtyRectsLength];
+            index = 0;
+            continue;
+        }
+        index++;
+    }
+
+    if (dirtyRectsLength < SCREEN_DIRTY_RECTS_MAX) {
+        dirtyRects[dirtyRectsLength++] = merged;
+        return;
+    }
+
+    int best = 0;
+    long long bestGrowth = -1;
+    for (index = 0; index < dirtyRectsLength; index++) {
+        Rect bound;
+        rect_min_bound(&merged, &(dirtyRects[index]), &bound);
+        long long growth = (long long)rectGetWidth(&bound) * rectGetHeight(&bound)
+            - (long long)rectGetWidth(&(dirtyRects[index])) * rectGetHeight(&(dirtyRects[index]));
+        if (bestGrowth == -1 || growth < bestGrowth) {
+            best = index;
+            bestGrowth = growth;
+        }
+    }
+
+    rect_min_bound(&merged, &(dirtyRects[best]), &(dirtyRects[best]));
+}
+
+// Converts damaged areas to the texture surface and uploads them to the
+// texture, unless the whole texture is going to be uploaded anyway.
+static void screenFlushDirtyRects()
+{
+    int bytesPerPixel = gSdlTextureSurface->format->BytesPerPixel;
+
+    for (int index = 0; index < dirtyRectsLength; index++) {
+        Rect* rect = &(dirtyRects[index]);
+
+        SDL_Rect srcRect;
+        srcRect.x = rect->ulx;
+        srcRect.y = rect->uly;
+        srcRect.w = rectGetWidth(rect);
+        srcRect.h = rectGetHeight(rect);
+
+        SDL_Rect destRect = srcRect;
+        SDL_BlitSurface(gSdlSurface, &srcRect, gSdlTextureSurface, &destRect);
+
+        if (!textureInvalid) {
+            unsigned char* pixels = (unsigned char*)gSdlTextureSurface->pixels
+                + gSdlTextureSurface->pitch * srcRect.y
+                + bytesPerPixel * srcRect.x;
+            SDL_UpdateTexture(gSdlTexture, &srcRect, pixels, gSdlTextureSurface->pitch);
+        }
+
+        damageStats.pixelsPresented += srcRect.w * srcRect.h;
+    }
+
+    dirtyRectsLength = 0;
+}
+
+// Marks area of gSdlSurface written without scr_blit (e.g. movie frames).
+void renderInvalidateRect(const SDL_Rect* rect)
+{
+    if (rect->w <= 0 || rect->h <= 0) {
+        return;
+    }
+
+    Rect dirtyRect;
+    dirtyRect.ulx = rect->x;
+    dirtyRect.uly = rect->y;
+    dirtyRect.lrx = rect->x + rect->w - 1;
+    dirtyRect.lry = rect->y + rect->h - 1;
+
+    if (rect_inside_bound(&dirtyRect, &scr_size, &dirtyRect) == 0) {
+        screenAddDirtyRect(&dirtyRect);
+    }
+}
+
+// Returns blit counters of the last presented frame.
+void screenGetDamageStats(ScreenDamageStats* stats)
+{
+    *stats = lastFrameDamageStats;
 }
 
 bool svga_init(VideoOptions* video_options)
@@ -223,11 +363,28 @@ void handleWindowSizeChanged()
 {
     destroyRenderer();
     createRenderer(screenGetWidth(), screenGetHeight());
+
+    // New texture surface is blank.
+    dirtyRectsLength = 0;
+    screenAddDirtyRect(&scr_size);
+    textureInvalid = true;
 }
 
 void renderPresent()
 {
-    SDL_UpdateTexture(gSdlTexture, NULL, gSdlTextureSurface->pixels, gSdlTextureSurface->pitch);
+    // CE: Upload only what changed since the last present. Idle screens
+    // skip conversion and upload entirely.
+    screenFlushDirtyRects();
+
+    if (textureInvalid) {
+        SDL_UpdateTexture(gSdlTexture, NULL, gSdlTextureSurface->pixels, gSdlTextureSurface->pitch);
+        damageStats.pixelsPresented = (long long)gSdlTextureSurface->w * gSdlTextureSurface->h;
+        textureInvalid = false;
+    }
+
+    lastFrameDamageStats = damageStats;
+    memset(&damageStats, 0, sizeof(damageStats));
+
     SDL_RenderClear(gSdlRenderer);
     SDL_RenderCopy(gSdlRenderer, gSdlTexture, NULL, NULL);
     SDL_RenderPresent(gSdlRenderer);
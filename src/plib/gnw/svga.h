@@ -9,6 +9,18 @@
 
 namespace fallout {
 
+// Per frame blit counters of the SDL screen.
+typedef struct ScreenDamageStats {
+    // Pixels passed to scr_blit.
+    long long pixelsCopied;
+
+    // Pixels in rows that differed from what was already on screen.
+    long long pixelsChanged;
+
+    // Pixels converted and uploaded to the texture after merging damage.
+    long long pixelsPresented;
+} ScreenDamageStats;
+
 extern Rect scr_size;
 extern ScreenBlitFunc* scr_blit;
 
@@ -29,6 +41,8 @@ int screenGetWidth();
 int screenGetHeight();
 void handleWindowSizeChanged();
 void renderPresent();
+void renderInvalidateRect(const SDL_Rect* rect);
+void screenGetDamageStats(ScreenDamageStats* stats);
 
 } // namespace fallout
 
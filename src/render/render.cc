@@ -74,6 +74,18 @@ void render_set_window_title(const char* title)
     }
 }
 
+void render_invalidate_rect(const SDL_Rect* rect)
+{
+    switch (gBackend) {
+    case RenderBackend::SDL:
+        renderInvalidateRect(rect);
+        break;
+    case RenderBackend::VULKAN_BATCH:
+        SDL_BlitSurface(vulkan_render_get_surface(), NULL, vulkan_render_get_texture_surface(), NULL);
+        break;
+    }
+}
+
 SDL_Surface* render_get_surface()
 {
     switch (gBackend) {
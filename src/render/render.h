@@ -20,6 +20,7 @@ int render_get_height();
 
 void render_handle_window_size_changed();
 void render_present();
+void render_invalidate_rect(const SDL_Rect* rect);
 
 void render_set_window_title(const char* title);
 
@@ -0,0 +1,204 @@
+#include "plib/gnw/grbuf.h"
+#include "test_harness.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Checks the vectorized 8-bit blitters of grbuf against plain per-pixel
+// reference loops for bit-exact output and reports throughput of each.
+//
+// Usage: blit_benchmark [passes]
+
+namespace fallout {
+
+// grbuf.cc only needs the intensity table for lighten_buf.
+unsigned char intensityColorTable[256][256];
+
+} // namespace fallout
+
+using namespace fallout;
+
+namespace {
+
+const int kWidth = 640;
+const int kHeight = 480;
+const int kPitch = kWidth + 13;
+
+// Sprite-like data: runs of transparent pixels between opaque runs.
+void fillSprite(std::vector<unsigned char>& buf, unsigned int seed)
+{
+    srand(seed);
+    size_t index = 0;
+    while (index < buf.size()) {
+        size_t run = 1 + rand() % 40;
+        bool opaque = rand() % 2 == 0;
+        for (size_t i = 0; i < run && index < buf.size(); i++) {
+            buf[index++] = opaque ? (unsigned char)(1 + rand() % 255) : 0;
+        }
+    }
+}
+
+void referenceTrans(const unsigned char* src, int width, int height, int srcPitch, unsigned char* dest, int destPitch)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (src[y * srcPitch + x] != 0) {
+                dest[y * destPitch + x] = src[y * srcPitch + x];
+            }
+        }
+    }
+}
+
+void referenceMask(const unsigned char* src, int width, int height, int srcPitch, const unsigned char* mask, int maskPitch, unsigned char* dest, int destPitch)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (mask[y * maskPitch + x] != 0) {
+                dest[y * destPitch + x] = src[y * srcPitch + x];
+            }
+        }
+    }
+}
+
+void referenceLut(const unsigned char* src, int width, int height, int srcPitch, unsigned char* dest, int destPitch, const unsigned char* table)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char b = src[y * srcPitch + x];
+            if (b != 0) {
+                dest[y * destPitch + x] = table[b];
+            }
+        }
+    }
+}
+
+void referenceTransScale(const unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destWidth, int destHeight, int destPitch)
+{
+    int stepX = (destWidth << 16) / srcWidth;
+    int stepY = (destHeight << 16) / srcHeight;
+    for (int srcY = 0; srcY < srcHeight; srcY++) {
+        for (int srcX = 0; srcX < srcWidth; srcX++) {
+            unsigned char b = src[srcY * srcPitch + srcX];
+            if (b == 0) {
+                continue;
+            }
+            for (int destY = (srcY * stepY) >> 16; destY < (((srcY + 1) * stepY) >> 16); destY++) {
+                for (int destX = (srcX * stepX) >> 16; destX < (((srcX + 1) * stepX) >> 16); destX++) {
+                    dest[destY * destPitch + destX] = b;
+                }
+            }
+        }
+    }
+}
+
+template <typename Fn>
+double megapixelsPerSecond(int passes, size_t pixels, Fn fn)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        fn();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return seconds > 0 ? pixels * passes / seconds / 1e6 : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 200;
+
+    std::vector<unsigned char> src(kPitch * kHeight);
+    std::vector<unsigned char> mask(kPitch * kHeight);
+    std::vector<unsigned char> background(kPitch * kHeight);
+    fillSprite(src, 1);
+    fillSprite(mask, 2);
+    fillSprite(background, 3);
+
+    unsigned char table[256];
+    for (int index = 0; index < 256; index++) {
+        table[index] = (unsigned char)(255 - index);
+    }
+
+    std::vector<unsigned char> expected;
+    std::vector<unsigned char> actual;
+
+    int failed = 0;
+
+    // Odd sizes exercise the scalar tails next to the 16 byte blocks.
+    const int sizes[][2] = { { kWidth, kHeight }, { 1, 1 }, { 15, 7 }, { 17, 33 }, { 333, 101 } };
+
+    failed += run_test("TransBufToBufMatchesReference", [&]() {
+        for (const auto& size : sizes) {
+            expected = background;
+            actual = background;
+            referenceTrans(src.data(), size[0], size[1], kPitch, expected.data(), kPitch);
+            trans_buf_to_buf(src.data(), size[0], size[1], kPitch, actual.data(), kPitch);
+            EXPECT_TRUE(expected == actual);
+        }
+    });
+
+    failed += run_test("MaskBufToBufMatchesReference", [&]() {
+        for (const auto& size : sizes) {
+            expected = background;
+            actual = background;
+            referenceMask(src.data(), size[0], size[1], kPitch, mask.data(), kPitch, expected.data(), kPitch);
+            mask_buf_to_buf(src.data(), size[0], size[1], kPitch, mask.data(), kPitch, actual.data(), kPitch);
+            EXPECT_TRUE(expected == actual);
+        }
+    });
+
+    failed += run_test("LutTransBufToBufMatchesReference", [&]() {
+        for (const auto& size : sizes) {
+            expected = background;
+            actual = background;
+            referenceLut(src.data(), size[0], size[1], kPitch, expected.data(), kPitch, table);
+            lut_trans_buf_to_buf(src.data(), size[0], size[1], kPitch, actual.data(), kPitch, table);
+            EXPECT_TRUE(expected == actual);
+        }
+    });
+
+    failed += run_test("TransCscaleMatchesReference", [&]() {
+        const int scales[][4] = { { 64, 48, 640, 480 }, { 640, 480, 320, 240 }, { 33, 17, 100, 51 }, { 300, 200, 650, 470 } };
+        for (const auto& scale : scales) {
+            expected = background;
+            actual = background;
+            referenceTransScale(src.data(), scale[0], scale[1], kPitch, expected.data(), scale[2], scale[3], kPitch);
+            trans_cscale(src.data(), scale[0], scale[1], kPitch, actual.data(), scale[2], scale[3], kPitch);
+            EXPECT_TRUE(expected == actual);
+        }
+    });
+
+    failed += run_test("BufCountZero", [&]() {
+        std::vector<unsigned char> buf(100, 0);
+        EXPECT_EQ(buf_count_zero(buf.data(), 100), 100);
+        for (int index = 0; index < 100; index++) {
+            buf[index] = 1;
+            EXPECT_EQ(buf_count_zero(buf.data(), 100), index);
+            buf[index] = 0;
+        }
+    });
+
+    size_t pixels = (size_t)kWidth * kHeight;
+    actual = background;
+
+    double reference = megapixelsPerSecond(passes, pixels, [&]() { referenceTrans(src.data(), kWidth, kHeight, kPitch, actual.data(), kPitch); });
+    double optimized = megapixelsPerSecond(passes, pixels, [&]() { trans_buf_to_buf(src.data(), kWidth, kHeight, kPitch, actual.data(), kPitch); });
+    std::cout << "trans_buf_to_buf:     " << reference << " -> " << optimized << " Mpx/s" << std::endl;
+
+    reference = megapixelsPerSecond(passes, pixels, [&]() { referenceMask(src.data(), kWidth, kHeight, kPitch, mask.data(), kPitch, actual.data(), kPitch); });
+    optimized = megapixelsPerSecond(passes, pixels, [&]() { mask_buf_to_buf(src.data(), kWidth, kHeight, kPitch, mask.data(), kPitch, actual.data(), kPitch); });
+    std::cout << "mask_buf_to_buf:      " << reference << " -> " << optimized << " Mpx/s" << std::endl;
+
+    reference = megapixelsPerSecond(passes, pixels, [&]() { referenceLut(src.data(), kWidth, kHeight, kPitch, actual.data(), kPitch, table); });
+    optimized = megapixelsPerSecond(passes, pixels, [&]() { lut_trans_buf_to_buf(src.data(), kWidth, kHeight, kPitch, actual.data(), kPitch, table); });
+    std::cout << "lut_trans_buf_to_buf: " << reference << " -> " << optimized << " Mpx/s" << std::endl;
+
+    reference = megapixelsPerSecond(passes, pixels, [&]() { referenceTransScale(src.data(), kWidth / 2, kHeight / 2, kPitch, actual.data(), kWidth, kHeight, kPitch); });
+    optimized = megapixelsPerSecond(passes, pixels, [&]() { trans_cscale(src.data(), kWidth / 2, kHeight / 2, kPitch, actual.data(), kWidth, kHeight, kPitch); });
+    std::cout << "trans_cscale:         " << reference << " -> " << optimized << " Mpx/s" << std::endl;
+
+    return failed;
+}
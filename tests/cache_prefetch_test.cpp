@@ -0,0 +1,172 @@
+#include "game/cache.h"
+#include "game/heap.h"
+#include "test_harness.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace fallout;
+
+// Runs cache prefetch thread against allocations made on the calling thread
+// from another cache and a standalone heap, and checks that every entry holds
+// the data it was read with.
+//
+// Usage: cache_prefetch_test [rounds]
+
+namespace fallout {
+
+// Stubs for the rest of the game, the cache does not need them here.
+
+bool GNW_win_init_flag = false;
+
+int debug_printf(const char* format, ...)
+{
+    return 0;
+}
+
+void soundUpdate()
+{
+}
+
+bool db_lock_held()
+{
+    return false;
+}
+
+} // namespace fallout
+
+namespace {
+
+std::atomic<int> reads(0);
+
+int entrySize(int key)
+{
+    return 512 + (key * 97) % 4096;
+}
+
+unsigned char entryByte(int key, int offset)
+{
+    return static_cast<unsigned char>(key * 31 + offset);
+}
+
+int sizeProc(int key, int* sizePtr)
+{
+    *sizePtr = entrySize(key);
+    return 0;
+}
+
+int readProc(int key, int* sizePtr, unsigned char* buffer)
+{
+    int size = entrySize(key);
+    for (int offset = 0; offset < size; offset++) {
+        buffer[offset] = entryByte(key, offset);
+    }
+
+    *sizePtr = size;
+    reads++;
+    return 0;
+}
+
+void freeProc(void* ptr)
+{
+}
+
+bool entryValid(int key, void* data)
+{
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    for (int offset = 0; offset < entrySize(key); offset++) {
+        if (bytes[offset] != entryByte(key, offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Waits until prefetch thread reads all keys in [0, count).
+bool waitPrefetched(Cache* cache, int count)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (int key = 0; key < count; key++) {
+        while (cache_query(cache, key) == 0) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 20;
+
+    int failed = 0;
+    failed += run_test("PrefetchWithConcurrentAllocations", [&]() {
+        Cache prefetched;
+        Cache busy;
+        Heap heap;
+        EXPECT_TRUE(cache_init(&prefetched, sizeProc, readProc, freeProc, 1 << 20));
+        EXPECT_TRUE(cache_init(&busy, sizeProc, readProc, freeProc, 64 << 10));
+        EXPECT_TRUE(heap_init(&heap, 64 << 10));
+
+        for (int round = 0; round < rounds; round++) {
+            // Only a part of the keys fits, so prefetch thread also evicts.
+            for (int key = 0; key < 512; key++) {
+                cache_prefetch(&prefetched, key);
+            }
+
+            for (int key = 0; key < 256; key++) {
+                void* data;
+                CacheEntry* entry;
+                EXPECT_TRUE(cache_lock(&busy, key, &data, &entry));
+                EXPECT_TRUE(entryValid(key, data));
+                cache_unlock(&busy, entry);
+
+                int handle;
+                if (heap_allocate(&heap, &handle, entrySize(key), key & 1)) {
+                    heap_deallocate(&heap, &handle);
+                }
+            }
+
+            for (int key = 0; key < 512; key++) {
+                void* data;
+                CacheEntry* entry;
+                EXPECT_TRUE(cache_lock(&prefetched, key, &data, &entry));
+                EXPECT_TRUE(entryValid(key, data));
+                cache_unlock(&prefetched, entry);
+            }
+        }
+
+        EXPECT_TRUE(heap_validate(&prefetched.heap));
+        EXPECT_TRUE(heap_validate(&busy.heap));
+        EXPECT_TRUE(heap_validate(&heap));
+
+        heap_exit(&heap);
+        cache_exit(&busy);
+        cache_exit(&prefetched);
+    });
+
+    failed += run_test("CacheExitKeepsOtherPrefetches", [&]() {
+        Cache first;
+        Cache second;
+        EXPECT_TRUE(cache_init(&first, sizeProc, readProc, freeProc, 1 << 20));
+        EXPECT_TRUE(cache_init(&second, sizeProc, readProc, freeProc, 1 << 20));
+
+        for (int key = 0; key < 64; key++) {
+            cache_prefetch(&first, key);
+            cache_prefetch(&second, key);
+        }
+
+        cache_exit(&second);
+
+        EXPECT_TRUE(waitPrefetched(&first, 64));
+
+        cache_exit(&first);
+    });
+
+    return failed;
+}
@@ -0,0 +1,189 @@
+#include "plib/db/lzss.h"
+#include "test_harness.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace fallout;
+
+// Decodes every LZSS-compressed entry of a Fallout 1 DAT archive with the
+// stream decoder and the span decoder, checks that both produce identical
+// output and reports throughput of each.
+//
+// Usage: lzss_benchmark <path to master.dat or critter.dat> [passes]
+
+namespace {
+
+struct DatEntry {
+    std::string name;
+    int flags;
+    int offset;
+    int length;
+    int packedLength;
+};
+
+bool readLong(FILE* stream, int* value)
+{
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, stream) != 4) {
+        return false;
+    }
+    *value = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+    return true;
+}
+
+bool readName(FILE* stream, std::string* name)
+{
+    int length = fgetc(stream);
+    if (length == EOF) {
+        return false;
+    }
+    name->resize(length);
+    return fread(&(*name)[0], 1, length, stream) == (size_t)length;
+}
+
+bool readDirectory(FILE* stream, std::vector<DatEntry>* entries)
+{
+    int dirCount;
+    int unused;
+    if (!readLong(stream, &dirCount) || !readLong(stream, &unused) || !readLong(stream, &unused) || !readLong(stream, &unused)) {
+        return false;
+    }
+
+    std::vector<std::string> dirs(dirCount);
+    for (int index = 0; index < dirCount; index++) {
+        if (!readName(stream, &dirs[index])) {
+            return false;
+        }
+    }
+
+    for (int dirIndex = 0; dirIndex < dirCount; dirIndex++) {
+        int fileCount;
+        if (!readLong(stream, &fileCount) || !readLong(stream, &unused) || !readLong(stream, &unused) || !readLong(stream, &unused)) {
+            return false;
+        }
+
+        for (int index = 0; index < fileCount; index++) {
+            DatEntry entry;
+            std::string name;
+            if (!readName(stream, &name)) {
+                return false;
+            }
+
+            if (!readLong(stream, &entry.flags) || !readLong(stream, &entry.offset) || !readLong(stream, &entry.length) || !readLong(stream, &entry.packedLength)) {
+                return false;
+            }
+
+            entry.name = dirs[dirIndex] + "\\" + name;
+            entries->push_back(entry);
+        }
+    }
+
+    return true;
+}
+
+double megabytesPerSecond(size_t bytes, std::chrono::high_resolution_clock::duration elapsed)
+{
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <datafile> [passes]" << std::endl;
+        return 0;
+    }
+
+    int passes = argc > 2 ? atoi(argv[2]) : 5;
+
+    FILE* stream = fopen(argv[1], "rb");
+    if (stream == nullptr) {
+        std::cerr << "Could not open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<DatEntry> entries;
+    if (!readDirectory(stream, &entries)) {
+        std::cerr << "Could not read directory of " << argv[1] << std::endl;
+        fclose(stream);
+        return 1;
+    }
+
+    // Keep only compressed entries, with their packed data preloaded so that
+    // the span decoder is measured without I/O.
+    std::vector<DatEntry> compressed;
+    std::vector<std::vector<unsigned char>> packed;
+    size_t totalUnpacked = 0;
+    for (const DatEntry& entry : entries) {
+        if ((entry.flags & 0xF0) != 16 && entry.flags != 0) {
+            continue;
+        }
+
+        std::vector<unsigned char> data(entry.packedLength);
+        fseek(stream, entry.offset, SEEK_SET);
+        if (fread(data.data(), 1, data.size(), stream) != data.size()) {
+            continue;
+        }
+
+        compressed.push_back(entry);
+        packed.push_back(std::move(data));
+        totalUnpacked += entry.length;
+    }
+
+    std::cout << compressed.size() << " compressed entries, " << totalUnpacked / 1024 << " KiB unpacked" << std::endl;
+
+    int failed = 0;
+    failed += run_test("LzssSpanMatchesStream", [&]() {
+        std::vector<unsigned char> expected;
+        std::vector<unsigned char> actual;
+        for (size_t index = 0; index < compressed.size(); index++) {
+            const DatEntry& entry = compressed[index];
+            expected.assign(entry.length, 0);
+            actual.assign(entry.length, 0);
+
+            fseek(stream, entry.offset, SEEK_SET);
+            int streamLength = lzss_decode_to_buf(stream, expected.data(), entry.packedLength);
+            int spanLength = lzss_decode_span(packed[index].data(), entry.packedLength, actual.data(), entry.length);
+
+            if (streamLength != spanLength || expected != actual) {
+                std::cerr << "Mismatch in " << entry.name << std::endl;
+            }
+            EXPECT_EQ(streamLength, spanLength);
+            EXPECT_TRUE(expected == actual);
+        }
+    });
+
+    std::vector<unsigned char> buffer;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (const DatEntry& entry : compressed) {
+            buffer.resize(entry.length);
+            fseek(stream, entry.offset, SEEK_SET);
+            lzss_decode_to_buf(stream, buffer.data(), entry.packedLength);
+        }
+    }
+    auto streamElapsed = std::chrono::high_resolution_clock::now() - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t index = 0; index < compressed.size(); index++) {
+            const DatEntry& entry = compressed[index];
+            buffer.resize(entry.length);
+            lzss_decode_span(packed[index].data(), entry.packedLength, buffer.data(), entry.length);
+        }
+    }
+    auto spanElapsed = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << "stream: " << megabytesPerSecond(totalUnpacked * passes, streamElapsed) << " MB/s" << std::endl;
+    std::cout << "span:   " << megabytesPerSecond(totalUnpacked * passes, spanElapsed) << " MB/s" << std::endl;
+
+    fclose(stream);
+
+    return failed;
+}
@@ -0,0 +1,160 @@
+#include "audio_engine.h"
+#include "movie_lib.h"
+#include "test_harness.h"
+#include <SDL.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace fallout;
+
+// Decodes an Interplay MVE movie to a null sink, without waiting for frame
+// time, checks that decoding with the read-ahead thread produces the same
+// frames as decoding on the calling thread and reports frames per second of
+// each.
+//
+// Usage: mve_benchmark <path to .MVE> [passes]
+
+namespace {
+
+// Hashes of every shown frame when not null.
+std::vector<unsigned long long>* frameHashes = nullptr;
+
+int frameCount = 0;
+
+bool readMovie(void* handle, void* buf, int count)
+{
+    return fread(buf, 1, count, reinterpret_cast<FILE*>(handle)) == static_cast<size_t>(count);
+}
+
+void showFrame(SDL_Surface* surface, int srcWidth, int srcHeight, int srcX, int srcY, int destWidth, int destHeight, int a8, int a9)
+{
+    frameCount++;
+
+    if (frameHashes == nullptr) {
+        return;
+    }
+
+    unsigned long long hash = 1469598103934665603ULL;
+    unsigned char* pixels = static_cast<unsigned char*>(surface->pixels);
+    for (int y = 0; y < surface->h; y++) {
+        for (int x = 0; x < surface->w; x++) {
+            hash = (hash ^ pixels[y * surface->pitch + x]) * 1099511628211ULL;
+        }
+    }
+    frameHashes->push_back(hash);
+}
+
+void setPalette(unsigned char* palette, int start, int end)
+{
+}
+
+void* movieMalloc(size_t size)
+{
+    return malloc(size);
+}
+
+void movieFree(void* ptr)
+{
+    free(ptr);
+}
+
+// Plays the whole movie, returns number of shown frames or -1 on error.
+int decodeMovie(const char* path, bool readAhead)
+{
+    FILE* stream = fopen(path, "rb");
+    if (stream == nullptr) {
+        return -1;
+    }
+
+    movieLibSetReadAhead(readAhead);
+    frameCount = 0;
+
+    int rc = _MVE_rmPrepMovie(stream, -1, -1, 0);
+    if (rc == 0) {
+        while ((rc = _MVE_rmStepMovie()) == 0) {
+        }
+    }
+
+    _MVE_rmEndMovie();
+    _MVE_ReleaseMem();
+    fclose(stream);
+
+    // -1 is a regular end of movie.
+    return rc == -1 ? frameCount : -1;
+}
+
+double framesPerSecond(int frames, std::chrono::high_resolution_clock::duration elapsed)
+{
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? frames / seconds : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " <movie> [passes]" << std::endl;
+        return 0;
+    }
+
+    int passes = argc > 2 ? atoi(argv[2]) : 5;
+
+    // Movies fail to start without a sound buffer, use an audio device that
+    // does not need any hardware.
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    if (!audioEngineInit()) {
+        std::cerr << "Could not initialize audio engine" << std::endl;
+        return 1;
+    }
+
+    movieLibSetMemoryProcs(movieMalloc, movieFree);
+    movieLibSetReadProc(readMovie);
+    movieLibSetPaletteEntriesProc(setPalette);
+    movieLibSetSync(false);
+    _MVE_sfSVGA(640, 480, 480, 0, 0, 0, 0, 0, 0);
+    _MVE_sfCallbacks(showFrame);
+
+    int failed = 0;
+    failed += run_test("ReadAheadMatchesSynchronous", [&]() {
+        std::vector<unsigned long long> expected;
+        std::vector<unsigned long long> actual;
+
+        frameHashes = &expected;
+        int expectedFrames = decodeMovie(argv[1], false);
+
+        frameHashes = &actual;
+        int actualFrames = decodeMovie(argv[1], true);
+
+        frameHashes = nullptr;
+
+        EXPECT_TRUE(expectedFrames > 0);
+        EXPECT_EQ(expectedFrames, actualFrames);
+        EXPECT_TRUE(expected == actual);
+    });
+
+    int frames = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        int decoded = decodeMovie(argv[1], false);
+        if (decoded > 0) {
+            frames += decoded;
+        }
+    }
+    auto synchronousElapsed = std::chrono::high_resolution_clock::now() - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        decodeMovie(argv[1], true);
+    }
+    auto readAheadElapsed = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << "synchronous: " << framesPerSecond(frames, synchronousElapsed) << " fps" << std::endl;
+    std::cout << "read-ahead:  " << framesPerSecond(frames, readAheadElapsed) << " fps" << std::endl;
+
+    audioEngineExit();
+
+    return failed;
+}
@@ -0,0 +1,104 @@
+#include "game/object_blocking.h"
+#include "test_harness.h"
+#include <cstring>
+
+using namespace fallout;
+
+// Checks which object changes invalidate cached paths.
+
+namespace {
+
+Object makeObject(int type, int tile, int flags)
+{
+    Object object;
+    memset(&object, 0, sizeof(object));
+    object.fid = type << 24;
+    object.tile = tile;
+    object.flags = flags;
+    return object;
+}
+
+// Moves object like `obj_move_to_tile` does.
+void moveObject(Object* object, int tile)
+{
+    int oldTile = object->tile;
+    object->tile = tile;
+    obj_blocking_update(object, oldTile, object->elevation, object->flags);
+}
+
+// Returns `true` if `change` bumped blocking generation.
+template <typename Change>
+bool invalidates(Change change)
+{
+    unsigned int generation = obj_blocking_generation();
+    change();
+    return obj_blocking_generation() != generation;
+}
+
+} // namespace
+
+int main()
+{
+    int failed = 0;
+    failed += run_test("BlockingFlagsInvalidate", []() {
+        Object critter = makeObject(OBJ_TYPE_CRITTER, 100, 0);
+        EXPECT_TRUE(invalidates([&]() { obj_set_flag(&critter, OBJECT_NO_BLOCK); }));
+        EXPECT_TRUE(invalidates([&]() { obj_unset_flag(&critter, OBJECT_NO_BLOCK); }));
+        EXPECT_TRUE(invalidates([&]() { obj_set_flag(&critter, OBJECT_HIDDEN); }));
+        EXPECT_TRUE(invalidates([&]() { obj_unset_flag(&critter, OBJECT_HIDDEN); }));
+
+        // Sight callbacks see scenery regardless of blocking.
+        Object wall = makeObject(OBJ_TYPE_WALL, 200, OBJECT_NO_BLOCK);
+        EXPECT_TRUE(invalidates([&]() { obj_set_flag(&wall, OBJECT_LIGHT_THRU); }));
+        EXPECT_TRUE(invalidates([&]() { obj_unset_flag(&wall, OBJECT_LIGHT_THRU); }));
+
+        Object door = makeObject(OBJ_TYPE_SCENERY, 300, 0);
+        EXPECT_TRUE(invalidates([&]() { obj_set_flag(&door, OBJECT_OPEN_DOOR); }));
+        EXPECT_TRUE(invalidates([&]() { obj_unset_flag(&door, OBJECT_OPEN_DOOR); }));
+        EXPECT_TRUE(invalidates([&]() { obj_blocking_changed(&door); }));
+    });
+
+    failed += run_test("UnrelatedChangesKeepPaths", []() {
+        Object critter = makeObject(OBJ_TYPE_CRITTER, 100, 0);
+        EXPECT_TRUE(!invalidates([&]() { obj_set_flag(&critter, OBJECT_FLAT); }));
+        EXPECT_TRUE(!invalidates([&]() { obj_unset_flag(&critter, OBJECT_FLAT); }));
+
+        // Setting flag which is already set.
+        obj_set_flag(&critter, OBJECT_MULTIHEX);
+        EXPECT_TRUE(!invalidates([&]() { obj_set_flag(&critter, OBJECT_MULTIHEX); }));
+
+        // Animation step within the same tile.
+        EXPECT_TRUE(!invalidates([&]() { moveObject(&critter, critter.tile); }));
+
+        // Items never block.
+        Object item = makeObject(OBJ_TYPE_ITEM, 400, 0);
+        EXPECT_TRUE(!invalidates([&]() { moveObject(&item, 401); }));
+        EXPECT_TRUE(!invalidates([&]() { obj_set_flag(&item, OBJECT_HIDDEN); }));
+
+        // Mouse cursor objects.
+        Object cursor = makeObject(OBJ_TYPE_INTERFACE, 500, OBJECT_LIGHT_THRU | OBJECT_SHOOT_THRU | OBJECT_NO_BLOCK);
+        EXPECT_TRUE(!invalidates([&]() { moveObject(&cursor, 501); }));
+
+        // Hidden objects.
+        Object hidden = makeObject(OBJ_TYPE_SCENERY, 600, OBJECT_HIDDEN);
+        EXPECT_TRUE(!invalidates([&]() { moveObject(&hidden, 601); }));
+        EXPECT_TRUE(!invalidates([&]() { obj_blocking_changed(&hidden); }));
+
+        // Objects off the map.
+        Object carried = makeObject(OBJ_TYPE_CRITTER, -1, 0);
+        EXPECT_TRUE(!invalidates([&]() { obj_set_flag(&carried, OBJECT_NO_BLOCK); }));
+    });
+
+    failed += run_test("MovesInvalidate", []() {
+        Object critter = makeObject(OBJ_TYPE_CRITTER, 100, 0);
+        EXPECT_TRUE(invalidates([&]() { moveObject(&critter, 101); }));
+        EXPECT_TRUE(invalidates([&]() { moveObject(&critter, -1); }));
+        EXPECT_TRUE(invalidates([&]() { moveObject(&critter, 102); }));
+
+        int oldElevation = critter.elevation;
+        critter.elevation = 1;
+        EXPECT_TRUE(invalidates([&]() { obj_blocking_update(&critter, critter.tile, oldElevation, critter.flags); }));
+    });
+
+    return failed;
+}
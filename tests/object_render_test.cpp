@@ -0,0 +1,227 @@
+#include "game/object_render.h"
+#include "test_harness.h"
+#include <cstring>
+#include <vector>
+
+using namespace fallout;
+
+// Rasterizes random object frames into a screen sized buffer on the calling
+// thread only and split into bands between render threads, and checks that
+// both produce the same picture.
+
+namespace fallout {
+
+// Stubs for the rest of the game. Lit blitters are replaced with simpler ones
+// which still depend on what is already in the buffer, so drawing objects out
+// of order changes the result.
+
+bool GNW_win_init_flag = false;
+
+unsigned char intensityColorTable[256][256];
+
+int debug_printf(const char* format, ...)
+{
+    return 0;
+}
+
+void dark_trans_buf_to_buf(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destX, int destY, int destPitch, int light)
+{
+    dest += destPitch * destY + destX;
+    for (int y = 0; y < srcHeight; y++) {
+        for (int x = 0; x < srcWidth; x++) {
+            if (src[x] != 0) {
+                dest[x] = static_cast<unsigned char>(src[x] + (light >> 9));
+            }
+        }
+        src += srcPitch;
+        dest += destPitch;
+    }
+}
+
+void dark_translucent_trans_buf_to_buf(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destX, int destY, int destPitch, int light, unsigned char* a10, unsigned char* a11)
+{
+    dest += destPitch * destY + destX;
+    for (int y = 0; y < srcHeight; y++) {
+        for (int x = 0; x < srcWidth; x++) {
+            if (src[x] != 0) {
+                dest[x] = a10[(a11[src[x]] << 8) + dest[x]];
+            }
+        }
+        src += srcPitch;
+        dest += destPitch;
+    }
+}
+
+void intensity_mask_buf_to_buf(unsigned char* src, int srcWidth, int srcHeight, int srcPitch, unsigned char* dest, int destPitch, unsigned char* mask, int maskPitch, int light)
+{
+    for (int y = 0; y < srcHeight; y++) {
+        for (int x = 0; x < srcWidth; x++) {
+            if (src[x] != 0) {
+                dest[x] = static_cast<unsigned char>(src[x] * 3 + mask[x] + dest[x]);
+            }
+        }
+        src += srcPitch;
+        dest += destPitch;
+        mask += maskPitch;
+    }
+}
+
+} // namespace fallout
+
+namespace {
+
+const int screenWidth = 640;
+const int screenHeight = 380;
+
+unsigned int seed = 0x2468ace;
+
+int nextRandom(int max)
+{
+    seed = seed * 1103515245 + 12345;
+    return static_cast<int>((seed >> 8) % max);
+}
+
+std::vector<unsigned char> blendTable(256 * 256);
+std::vector<unsigned char> grayTable(256);
+
+// Frames are kept alive until the end of the test, commands point into them.
+std::vector<std::vector<unsigned char>> frames;
+
+std::vector<unsigned char>* makeFrame(int width, int height)
+{
+    frames.emplace_back(width * height);
+    std::vector<unsigned char>* frame = &(frames.back());
+    for (size_t index = 0; index < frame->size(); index++) {
+        // About a third of transparent pixels.
+        (*frame)[index] = nextRandom(3) == 0 ? 0 : static_cast<unsigned char>(1 + nextRandom(255));
+    }
+    return frame;
+}
+
+std::vector<ObjectDrawCommand> makeCommands(int length, Rect* clip)
+{
+    frames.clear();
+    frames.reserve(length * 2);
+
+    std::vector<ObjectDrawCommand> commands(length);
+    for (ObjectDrawCommand& command : commands) {
+        memset(&command, 0, sizeof(command));
+
+        int width = 8 + nextRandom(120);
+        int height = 8 + nextRandom(160);
+        command.frameRect.ulx = nextRandom(screenWidth + 100) - 50;
+        command.frameRect.uly = nextRandom(screenHeight + 100) - 50;
+        command.frameRect.lrx = command.frameRect.ulx + width - 1;
+        command.frameRect.lry = command.frameRect.uly + height - 1;
+        command.data = makeFrame(width, height)->data();
+        command.pitch = width;
+        command.light = nextRandom(0x10000);
+        rect_inside_bound(&(command.frameRect), clip, &(command.rect));
+
+        switch (nextRandom(4)) {
+        case 0:
+            command.kind = OBJECT_DRAW_TRANS;
+            break;
+        case 1:
+            command.kind = OBJECT_DRAW_DARK;
+            break;
+        case 2:
+            command.kind = OBJECT_DRAW_TRANSLUCENT;
+            command.blendTable = blendTable.data();
+            command.grayTable = grayTable.data();
+            break;
+        case 3: {
+            command.kind = OBJECT_DRAW_EGG;
+
+            int eggWidth = 4 + nextRandom(64);
+            int eggHeight = 4 + nextRandom(64);
+            command.eggFrameRect.ulx = command.frameRect.ulx + nextRandom(width);
+            command.eggFrameRect.uly = command.frameRect.uly + nextRandom(height);
+            command.eggFrameRect.lrx = command.eggFrameRect.ulx + eggWidth - 1;
+            command.eggFrameRect.lry = command.eggFrameRect.uly + eggHeight - 1;
+            command.eggData = makeFrame(eggWidth, eggHeight)->data();
+            command.eggPitch = eggWidth;
+
+            // Like `obj_render_prepare`, egg is only used when it covers
+            // visible part of the object.
+            if (rect_inside_bound(&(command.eggFrameRect), &(command.rect), &(command.eggRect)) != 0) {
+                command.kind = OBJECT_DRAW_DARK;
+            }
+            break;
+        }
+        }
+
+        // Objects outside of the clip are never prepared.
+        if (command.rect.ulx > command.rect.lrx || command.rect.uly > command.rect.lry) {
+            command.kind = OBJECT_DRAW_TRANS;
+            command.rect = command.frameRect;
+        }
+    }
+    return commands;
+}
+
+std::vector<unsigned char> render(std::vector<ObjectDrawCommand>& commands, Rect* rect, int threads)
+{
+    std::vector<unsigned char> buffer(screenWidth * screenHeight);
+    for (size_t index = 0; index < buffer.size(); index++) {
+        buffer[index] = static_cast<unsigned char>(index * 7);
+    }
+
+    obj_render_set_threads(threads);
+    obj_render_commands(commands.data(), static_cast<int>(commands.size()), rect, buffer.data(), screenWidth);
+    return buffer;
+}
+
+} // namespace
+
+int main()
+{
+    for (size_t index = 0; index < blendTable.size(); index++) {
+        blendTable[index] = static_cast<unsigned char>(index * 13 + (index >> 8));
+    }
+    for (size_t index = 0; index < grayTable.size(); index++) {
+        grayTable[index] = static_cast<unsigned char>(255 - index);
+    }
+
+    int failed = 0;
+    failed += run_test("BandsMatchSerial", []() {
+        Rect screen = { 0, 0, screenWidth - 1, screenHeight - 1 };
+        for (int round = 0; round < 20; round++) {
+            std::vector<ObjectDrawCommand> commands = makeCommands(200, &screen);
+
+            std::vector<unsigned char> serial = render(commands, &screen, 0);
+            for (int threads = 1; threads <= 3; threads++) {
+                EXPECT_TRUE(render(commands, &screen, threads) == serial);
+            }
+        }
+    });
+
+    failed += run_test("BandsStayInsideDirtyRect", []() {
+        Rect screen = { 0, 0, screenWidth - 1, screenHeight - 1 };
+        Rect dirty = { 100, 37, 501, 330 };
+        std::vector<ObjectDrawCommand> commands = makeCommands(100, &screen);
+
+        std::vector<unsigned char> untouched = render(commands, &screen, 0);
+        std::vector<unsigned char> empty;
+        {
+            std::vector<ObjectDrawCommand> none;
+            empty = render(none, &screen, 0);
+        }
+
+        std::vector<unsigned char> serial = render(commands, &dirty, 0);
+        std::vector<unsigned char> banded = render(commands, &dirty, 3);
+        EXPECT_TRUE(banded == serial);
+
+        for (int y = 0; y < screenHeight; y++) {
+            for (int x = 0; x < screenWidth; x++) {
+                bool inside = x >= dirty.ulx && x <= dirty.lrx && y >= dirty.uly && y <= dirty.lry;
+                int index = y * screenWidth + x;
+                EXPECT_TRUE(banded[index] == (inside ? untouched[index] : empty[index]));
+            }
+        }
+    });
+
+    obj_render_threads_exit();
+
+    return failed;
+}
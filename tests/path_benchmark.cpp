@@ -0,0 +1,248 @@
+#include "game/map_defs.h"
+#include "game/path.h"
+#include "test_harness.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace fallout;
+
+// Checks paths built by path finder on synthetic maps and reports time per
+// query between random open tiles.
+//
+// Usage: path_benchmark [queries]
+
+namespace {
+
+// Map geometry matches `tile_coord` and `tile_num_in_direction` with view at
+// the origin.
+const int dirTile[2][6] = {
+    { -1, HEX_GRID_WIDTH - 1, HEX_GRID_WIDTH, HEX_GRID_WIDTH + 1, 1, -HEX_GRID_WIDTH },
+    { -HEX_GRID_WIDTH - 1, -1, HEX_GRID_WIDTH, 1, 1 - HEX_GRID_WIDTH, -HEX_GRID_WIDTH },
+};
+
+bool blocked[HEX_GRID_SIZE];
+
+Object blocker;
+
+Object* blockingAt(Object* object, int tile, int elevation)
+{
+    return blocked[tile] ? &blocker : nullptr;
+}
+
+bool cannotPass(Object* object, Object* blocker)
+{
+    return false;
+}
+
+bool onEdge(int tile)
+{
+    int x = tile % HEX_GRID_WIDTH;
+    int y = tile / HEX_GRID_WIDTH;
+    return x == 0 || y == 0 || x == HEX_GRID_WIDTH - 1 || y == HEX_GRID_HEIGHT - 1;
+}
+
+int step(int tile, int rotation)
+{
+    if (onEdge(tile)) {
+        return tile;
+    }
+    return tile + dirTile[(tile % HEX_GRID_WIDTH) & 1][rotation];
+}
+
+// Returns true if following `rotations` from `from` ends at `to` through
+// open tiles only.
+bool followPath(int from, int to, const unsigned char* rotations, int length)
+{
+    int tile = from;
+    for (int index = 0; index < length; index++) {
+        tile = step(tile, rotations[index]);
+        if (blocked[tile]) {
+            return false;
+        }
+    }
+    return tile == to;
+}
+
+// Returns number of steps of the shortest path between every open tile and
+// `from`, or -1 for unreachable tiles.
+std::vector<int> distancesFrom(int from)
+{
+    std::vector<int> distances(HEX_GRID_SIZE, -1);
+    std::vector<int> queue;
+    distances[from] = 0;
+    queue.push_back(from);
+    for (size_t index = 0; index < queue.size(); index++) {
+        int tile = queue[index];
+        for (int rotation = 0; rotation < 6; rotation++) {
+            int next = step(tile, rotation);
+            if (!blocked[next] && distances[next] == -1) {
+                distances[next] = distances[tile] + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+    return distances;
+}
+
+void clearMap(bool value)
+{
+    for (int tile = 0; tile < HEX_GRID_SIZE; tile++) {
+        blocked[tile] = value || onEdge(tile);
+    }
+}
+
+} // namespace
+
+namespace fallout {
+
+// Stubs for the rest of the game, path finder only needs map geometry.
+
+bool GNW_win_init_flag = false;
+
+int debug_printf(const char* format, ...)
+{
+    return 0;
+}
+
+int tile_coord(int tile, int* screenX, int* screenY, int elevation)
+{
+    int v3 = HEX_GRID_WIDTH - 1 - tile % HEX_GRID_WIDTH;
+    int v4 = tile / HEX_GRID_WIDTH;
+
+    *screenX = 48 * (v3 / 2);
+    *screenY = 12 * (v3 / -2);
+
+    if (v3 & 1) {
+        if (v3 <= 0) {
+            *screenX -= 16;
+            *screenY += 12;
+        } else {
+            *screenX += 32;
+        }
+    }
+
+    *screenX += 16 * v4;
+    *screenY += 12 * v4;
+
+    return 0;
+}
+
+int tile_num_in_direction(int tile, int rotation, int distance)
+{
+    for (int index = 0; index < distance; index++) {
+        tile = step(tile, rotation);
+    }
+    return tile;
+}
+
+int idist(int x1, int y1, int x2, int y2)
+{
+    int dx = abs(x2 - x1);
+    int dy = abs(y2 - y1);
+    int dm = (dx <= dy) ? dx : dy;
+    return dx + dy - (dm / 2);
+}
+
+} // namespace fallout
+
+int main(int argc, char** argv)
+{
+    int queries = argc > 1 ? atoi(argv[1]) : 2000;
+
+    Object critter;
+    memset(&critter, 0, sizeof(critter));
+
+    int failed = 0;
+    failed += run_test("LongPathKeepsLastSteps", [&]() {
+        // Snake shaped corridor, much longer than path limit.
+        clearMap(true);
+
+        std::vector<int> corridor;
+        for (int row = 0; row < 6; row++) {
+            int y = 10 + row * 2;
+            for (int index = 0; index < 180; index++) {
+                int x = (row & 1) == 0 ? 10 + index : 189 - index;
+                corridor.push_back(y * HEX_GRID_WIDTH + x);
+            }
+
+            if (row != 5) {
+                int x = (row & 1) == 0 ? 189 : 10;
+                corridor.push_back((y + 1) * HEX_GRID_WIDTH + x);
+            }
+        }
+
+        for (int tile : corridor) {
+            blocked[tile] = false;
+        }
+
+        int from = corridor.front();
+        int to = corridor.back();
+
+        unsigned char rotations[PATH_MAX_LENGTH];
+        int length = path_find(&critter, from, to, rotations, true, blockingAt, cannotPass);
+
+        EXPECT_EQ(length, PATH_MAX_LENGTH);
+
+        // Walk kept steps back from the destination, they must be the last
+        // steps of the shortest path.
+        int start = to;
+        for (int index = length - 1; index >= 0; index--) {
+            start = step(start, (rotations[index] + 3) % 6);
+        }
+
+        std::vector<int> distances = distancesFrom(from);
+        EXPECT_EQ(distances[start], distances[to] - PATH_MAX_LENGTH);
+        EXPECT_TRUE(followPath(start, to, rotations, length));
+    });
+
+    failed += run_test("RandomPathsAreWalkable", [&]() {
+        clearMap(false);
+
+        unsigned int seed = 0x12345678;
+        for (int tile = 0; tile < HEX_GRID_SIZE; tile++) {
+            seed = seed * 1103515245 + 12345;
+            if ((seed >> 8) % 100 < 25) {
+                blocked[tile] = true;
+            }
+        }
+
+        std::vector<int> open;
+        for (int tile = 0; tile < HEX_GRID_SIZE; tile++) {
+            if (!blocked[tile]) {
+                open.push_back(tile);
+            }
+        }
+
+        unsigned char rotations[PATH_MAX_LENGTH];
+        int found = 0;
+        int steps = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int query = 0; query < queries; query++) {
+            seed = seed * 1103515245 + 12345;
+            int from = open[(seed >> 8) % open.size()];
+            seed = seed * 1103515245 + 12345;
+            int to = open[(seed >> 8) % open.size()];
+
+            int length = path_find(&critter, from, to, rotations, query & 1, blockingAt, cannotPass);
+            if (length != 0) {
+                EXPECT_TRUE(followPath(from, to, rotations, length));
+                found++;
+                steps += length;
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        long long us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+        EXPECT_TRUE(found > 0);
+
+        std::cout << queries << " queries, " << found << " found, " << steps << " steps, "
+                  << (queries > 0 ? us / queries : 0) << " us/query" << std::endl;
+    });
+
+    path_exit();
+
+    return failed;
+}
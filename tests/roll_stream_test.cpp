@@ -0,0 +1,127 @@
+#include "game/roll.h"
+#include "test_harness.h"
+#include <thread>
+#include <vector>
+
+using namespace fallout;
+
+// Checks that split streams replay the same values on any thread and that
+// bulk fills match repeated single draws.
+
+namespace fallout {
+
+// Stubs for the rest of the game, streams only need a seed.
+
+int game_time()
+{
+    return 0;
+}
+
+unsigned int compat_timeGetTime()
+{
+    return 12345;
+}
+
+int debug_printf(const char* format, ...)
+{
+    return 0;
+}
+
+int db_freadInt(DB_FILE* stream, int* i)
+{
+    return -1;
+}
+
+int db_fwriteInt(DB_FILE* stream, int i)
+{
+    return -1;
+}
+
+int db_freadIntCount(DB_FILE* stream, int* i, int count)
+{
+    return -1;
+}
+
+} // namespace fallout
+
+namespace {
+
+std::vector<int> draw(RollStreamState state, int count)
+{
+    std::vector<int> values(count);
+    for (int index = 0; index < count; index++) {
+        values[index] = roll_stream_random(&state, 1, 100);
+    }
+    return values;
+}
+
+} // namespace
+
+int main()
+{
+    int failed = 0;
+    failed += run_test("SplitStreamReplays", []() {
+        roll_set_seed(42);
+
+        RollStreamState first;
+        RollStreamState second;
+        roll_stream_split(ROLL_STREAM_AI, &first);
+        roll_stream_split(ROLL_STREAM_AI, &second);
+
+        // Copies replay the same values, including on another thread.
+        std::vector<int> values = draw(first, 1000);
+        std::vector<int> threaded;
+        std::thread thread([&]() { threaded = draw(first, 1000); });
+        thread.join();
+        EXPECT_TRUE(values == threaded);
+
+        // Each split derives a different stream.
+        EXPECT_TRUE(draw(second, 1000) != values);
+
+        // Same seed gives the same splits.
+        roll_set_seed(42);
+        RollStreamState again;
+        roll_stream_split(ROLL_STREAM_AI, &again);
+        EXPECT_EQ(again.key, first.key);
+        EXPECT_TRUE(draw(again, 1000) == values);
+    });
+
+    failed += run_test("SplitDoesNotDisturbOtherStreams", []() {
+        roll_set_seed(7);
+        int expected = roll_random_stream(ROLL_STREAM_COMBAT, 1, 1000);
+
+        roll_set_seed(7);
+        RollStreamState state;
+        roll_stream_split(ROLL_STREAM_AI, &state);
+        EXPECT_EQ(roll_random_stream(ROLL_STREAM_COMBAT, 1, 1000), expected);
+    });
+
+    failed += run_test("FillMatchesSingleDraws", []() {
+        roll_set_seed(99);
+        RollStreamState state;
+        roll_stream_split(ROLL_STREAM_SCRIPTS, &state);
+
+        RollStreamState single = state;
+        std::vector<int> filled(257);
+        roll_stream_fill(&state, -3, 17, filled.data(), static_cast<int>(filled.size()));
+        for (size_t index = 0; index < filled.size(); index++) {
+            int value = roll_stream_random(&single, -3, 17);
+            EXPECT_EQ(filled[index], value);
+            EXPECT_TRUE(value >= -3 && value <= 17);
+        }
+        EXPECT_EQ(state.counter, single.counter);
+
+        roll_set_seed(5);
+        std::vector<int> expected(64);
+        for (size_t index = 0; index < expected.size(); index++) {
+            expected[index] = roll_random_stream(ROLL_STREAM_WORLDMAP, 1, 6);
+        }
+
+        roll_set_seed(5);
+        std::vector<int> values(64);
+        roll_random_fill(ROLL_STREAM_WORLDMAP, 1, 6, values.data(), static_cast<int>(values.size()));
+        EXPECT_TRUE(values == expected);
+    });
+
+    return failed;
+}